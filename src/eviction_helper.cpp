@@ -1,6 +1,9 @@
 #ifndef WIN32_LEAN_AND_MEAN
 #define WIN32_LEAN_AND_MEAN
 #endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
 
 #include <windows.h>
 #include <d3d12.h>
@@ -19,6 +22,10 @@
 #include "imgui_impl_dx12.h"
 #include "eviction_helper_shared.h"
 #include "eviction_helper_imgui.h"
+#include "eviction_helper_core.h"
+#include "eviction_helper_d3d12_device.h"
+#include "eviction_helper_service.h"
+#include "eviction_helper_frame_pacer.h"
 
 using Microsoft::WRL::ComPtr;
 using namespace DirectX;
@@ -28,11 +35,9 @@ constexpr UINT WINDOW_WIDTH	 = 1024;
 constexpr UINT WINDOW_HEIGHT = 720;
 constexpr UINT NUM_FRAMES	 = 2;
 
-#define EVICTION_HELPER_DEFAULT_ACTIVE EVICTION_HELPER_PRIORITY_HIGH
-#define EVICTION_HELPER_DEFAULT_UNUSED EVICTION_HELPER_PRIORITY_NORMAL
-
 // Command line options
 bool g_EnableDebugLayer = false;
+bool g_Headless			= false; // No window, swap chain or UI, see RunHeadless()
 
 // Forward declarations
 extern IMGUI_IMPL_API LRESULT ImGui_ImplWin32_WndProcHandler(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
@@ -65,75 +70,19 @@ HANDLE		 g_FenceEvent		 = nullptr;
 UINT64		 g_FenceValue		 = 0;
 UINT		 g_RtvDescriptorSize = 0;
 
-// VRAM management
-struct VRAMRenderTarget
-{
-	ComPtr<ID3D12Resource>		Resource;
-	D3D12_CPU_DESCRIPTOR_HANDLE RtvHandle;
-};
-
-std::vector<VRAMRenderTarget> g_VRAMRenderTargets;
-ComPtr<ID3D12DescriptorHeap>  g_VRAMRtvHeap;
-
-// Unused VRAM (allocated but not rendered to)
-std::vector<VRAMRenderTarget> g_UnusedVRAMRenderTargets;
-ComPtr<ID3D12DescriptorHeap>  g_UnusedVRAMRtvHeap;
-
-constexpr UINT64 RENDER_TARGET_SIZE_MB = 64; // Each RT is 64MB (2048x2048 RGBA8)
-constexpr UINT	 RT_WIDTH			   = 2048;
-constexpr UINT	 RT_HEIGHT			   = 2048;
-
 // Shared memory for inter-process communication
 EvictionHelperSharedMemory g_SharedMem = {};
 
+// Devices the allocations are made on, and the platform independent logic driving them
+EvictionHelperD3D12Device* g_VRAMDevice	= nullptr;
+EvictionHelperHostDevice   g_HostDevice;
+EvictionHelperCore*		   g_Core		= nullptr;
+
 // Adapter for memory queries
 ComPtr<IDXGIAdapter3> g_Adapter;
 
-// Timing
-constexpr double TARGET_FRAME_TIME_MS = 1000.0 / 30.0; // 30 FPS
-
-// D3D12 Heap allocations (VRAM)
-constexpr UINT64   HEAP_512MB_SIZE = 512ULL * 1024ULL * 1024ULL;
-constexpr UINT64   HEAP_1GB_SIZE   = 1024ULL * 1024ULL * 1024ULL;
-ComPtr<ID3D12Heap> g_Heap512MB;
-ComPtr<ID3D12Heap> g_Heap1GB;
-
-// Priority tracking for detecting changes
-int g_CurrentActiveVRAMPriority = EVICTION_HELPER_DEFAULT_ACTIVE;
-int g_CurrentUnusedVRAMPriority = EVICTION_HELPER_DEFAULT_UNUSED;
-
-// Convert index to D3D12_RESIDENCY_PRIORITY
-D3D12_RESIDENCY_PRIORITY IndexToPriority(int index)
-{
-	switch(index)
-	{
-	case EVICTION_HELPER_PRIORITY_MINIMUM:
-		return D3D12_RESIDENCY_PRIORITY_MINIMUM;
-	case EVICTION_HELPER_PRIORITY_LOW:
-		return D3D12_RESIDENCY_PRIORITY_LOW;
-	case EVICTION_HELPER_PRIORITY_NORMAL:
-		return D3D12_RESIDENCY_PRIORITY_NORMAL;
-	case EVICTION_HELPER_PRIORITY_HIGH:
-		return D3D12_RESIDENCY_PRIORITY_HIGH;
-	case EVICTION_HELPER_PRIORITY_MAXIMUM:
-		return D3D12_RESIDENCY_PRIORITY_MAXIMUM;
-	default:
-		return D3D12_RESIDENCY_PRIORITY_NORMAL;
-	}
-}
-
-// Apply priority to all resources in a vector
-void ApplyPriorityToResources(std::vector<VRAMRenderTarget>& targets, int priorityIndex)
-{
-	D3D12_RESIDENCY_PRIORITY priority = IndexToPriority(priorityIndex);
-	for(auto& rt : targets)
-	{
-		ID3D12Pageable* pageable = rt.Resource.Get();
-		g_Device->SetResidencyPriority(1, &pageable, &priority);
-	}
-}
-
 bool		  CreateDeviceD3D(HWND hWnd);
+bool		  CreateSwapChain(HWND hWnd, IDXGIFactory4* factory);
 void		  CleanupDeviceD3D();
 void		  CreateRenderTarget();
 void		  CleanupRenderTarget();
@@ -141,10 +90,7 @@ void		  WaitForLastSubmittedFrame();
 void		  WaitForGpu();
 FrameContext* WaitForNextFrameResources();
 void		  CreateTrianglePipeline();
-void		  AllocateVRAMRenderTargets(UINT64 targetBytes);
-void		  AllocateUnusedVRAMRenderTargets(UINT64 targetBytes);
-void		  RenderToAllVRAMTargets();
-void		  QueryMemoryInfo();
+int			  RunHeadless();
 
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow)
 {
@@ -153,18 +99,24 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow
 	{
 		g_EnableDebugLayer = true;
 	}
+	if(lpCmdLine && strstr(lpCmdLine, "-headless"))
+	{
+		g_Headless = true;
+	}
 
 	// Create shared memory for inter-process communication
 	if(!EvictionHelper_CreateSharedMemory(&g_SharedMem))
 	{
-		MessageBoxA(NULL, "Failed to create shared memory", "Error", MB_OK | MB_ICONERROR);
+		if(!g_Headless)
+			MessageBoxA(NULL, "Failed to create shared memory", "Error", MB_OK | MB_ICONERROR);
 		return 1;
 	}
 	g_SharedMem.pData->IsRunning = 1;
 
-	// Initialize default priority values
-	g_SharedMem.pData->ActiveVRAMPriority = EVICTION_HELPER_DEFAULT_ACTIVE;
-	g_SharedMem.pData->UnusedVRAMPriority = EVICTION_HELPER_DEFAULT_UNUSED;
+	if(g_Headless)
+	{
+		return RunHeadless();
+	}
 
 	// Register window class
 	WNDCLASSEXW wc	 = {};
@@ -190,6 +142,11 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow
 		return 1;
 	}
 
+	// Route all allocations through the device abstraction
+	g_VRAMDevice = new EvictionHelperD3D12Device(g_Device.Get(), g_Adapter.Get(), g_CommandQueue.Get());
+	g_Core		 = new EvictionHelperCore(&g_SharedMem, g_VRAMDevice, &g_HostDevice);
+	g_Core->InitializeDefaults();
+
 	ShowWindow(hWnd, nCmdShow);
 	UpdateWindow(hWnd);
 
@@ -215,9 +172,10 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow
 	ImGui_ImplDX12_Init(&init_info);
 
 	// Main loop
-	MSG	 msg		   = {};
-	bool running	   = true;
-	auto lastFrameTime = std::chrono::high_resolution_clock::now();
+	MSG						 msg			 = {};
+	bool					 running		 = true;
+	uint32_t				 lastWakeCounter = g_SharedMem.pData->WakeCounter.load(std::memory_order_acquire);
+	EvictionHelperFramePacer pacer;
 
 	while(running)
 	{
@@ -241,104 +199,33 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow
 			break;
 		}
 
-		// Frame timing for 30 FPS cap
-		auto   currentTime = std::chrono::high_resolution_clock::now();
-		double elapsedMs   = std::chrono::duration<double, std::milli>(currentTime - lastFrameTime).count();
-
-		if(elapsedMs < TARGET_FRAME_TIME_MS)
-		{
-			DWORD sleepTime = static_cast<DWORD>(TARGET_FRAME_TIME_MS - elapsedMs);
-			if(sleepTime > 0)
-			{
-				Sleep(sleepTime);
-			}
-			continue;
-		}
-		lastFrameTime = std::chrono::high_resolution_clock::now();
-
-		// Query memory info and update shared memory
-		QueryMemoryInfo();
-
-		// Update VRAM allocation based on shared memory target (MB -> bytes)
-		UINT64 targetBytes = static_cast<UINT64>(g_SharedMem.pData->TargetVRAMUsageMB) * 1024ULL * 1024ULL;
-		if(targetBytes != g_SharedMem.pData->CurrentVRAMAllocationBytes)
+		// Apply queued commands as soon as they are due, and changed inputs as soon as a controller signals them
+		// The counter is read first, a signal for commands pushed after ProcessCommands() then still ends the next wait
+		uint32_t wakeCounter = g_SharedMem.pData->WakeCounter.load(std::memory_order_acquire);
+		g_Core->ProcessCommands();
+		if(wakeCounter != lastWakeCounter)
 		{
-			AllocateVRAMRenderTargets(targetBytes);
+			lastWakeCounter = wakeCounter;
+			g_Core->UpdateAllocations();
 		}
 
-		// Update unused VRAM allocation based on shared memory target (MB -> bytes)
-		UINT64 targetUnusedBytes = static_cast<UINT64>(g_SharedMem.pData->TargetUnusedVRAMUsageMB) * 1024ULL * 1024ULL;
-		if(targetUnusedBytes != g_SharedMem.pData->CurrentUnusedVRAMAllocationBytes)
-		{
-			AllocateUnusedVRAMRenderTargets(targetUnusedBytes);
-		}
-
-		// Check for priority changes and apply to existing resources
-		if(g_SharedMem.pData->ActiveVRAMPriority != g_CurrentActiveVRAMPriority)
-		{
-			g_CurrentActiveVRAMPriority = g_SharedMem.pData->ActiveVRAMPriority;
-			ApplyPriorityToResources(g_VRAMRenderTargets, g_CurrentActiveVRAMPriority);
-		}
-		if(g_SharedMem.pData->UnusedVRAMPriority != g_CurrentUnusedVRAMPriority)
-		{
-			g_CurrentUnusedVRAMPriority = g_SharedMem.pData->UnusedVRAMPriority;
-			ApplyPriorityToResources(g_UnusedVRAMRenderTargets, g_CurrentUnusedVRAMPriority);
-			D3D12_RESIDENCY_PRIORITY priority = IndexToPriority(g_CurrentUnusedVRAMPriority);
-			if(g_Heap512MB)
-			{
-				ID3D12Pageable* pageable = g_Heap512MB.Get();
-				g_Device->SetResidencyPriority(1, &pageable, &priority);
-			}
-			if(g_Heap1GB)
-			{
-				ID3D12Pageable* pageable = g_Heap1GB.Get();
-				g_Device->SetResidencyPriority(1, &pageable, &priority);
-			}
-		}
-
-		// Handle D3D12 heap allocation based on shared memory flags
-		if(g_SharedMem.pData->Allocate512MBHeap && !g_Heap512MB)
-		{
-			D3D12_HEAP_DESC heapDesc = {};
-			heapDesc.SizeInBytes	 = HEAP_512MB_SIZE;
-			heapDesc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
-			heapDesc.Alignment		 = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
-			heapDesc.Flags			 = D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
-			g_Device->CreateHeap(&heapDesc, IID_PPV_ARGS(&g_Heap512MB));
-			if(g_Heap512MB)
-			{
-				ID3D12Pageable*			 pageable = g_Heap512MB.Get();
-				D3D12_RESIDENCY_PRIORITY priority = IndexToPriority(g_SharedMem.pData->UnusedVRAMPriority);
-				g_Device->SetResidencyPriority(1, &pageable, &priority);
-			}
-		}
-		else if(!g_SharedMem.pData->Allocate512MBHeap && g_Heap512MB)
-		{
-			g_Heap512MB.Reset();
-		}
-
-		if(g_SharedMem.pData->Allocate1GBHeap && !g_Heap1GB)
-		{
-			D3D12_HEAP_DESC heapDesc = {};
-			heapDesc.SizeInBytes	 = HEAP_1GB_SIZE;
-			heapDesc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
-			heapDesc.Alignment		 = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
-			heapDesc.Flags			 = D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
-			g_Device->CreateHeap(&heapDesc, IID_PPV_ARGS(&g_Heap1GB));
-			if(g_Heap1GB)
-			{
-				ID3D12Pageable*			 pageable = g_Heap1GB.Get();
-				D3D12_RESIDENCY_PRIORITY priority = IndexToPriority(g_SharedMem.pData->UnusedVRAMPriority);
-				g_Device->SetResidencyPriority(1, &pageable, &priority);
-			}
-		}
-		else if(!g_SharedMem.pData->Allocate1GBHeap && g_Heap1GB)
+		// Frames only touch active memory and update stats and UI. Until the next one is due, sleep until a controller
+		// signals a change, a delayed command becomes due or a window message arrives
+		pacer.Update(g_SharedMem.pData);
+		uint64_t now = EvictionHelper_GetTimestampNs();
+		if(!pacer.IsFrameDue(now))
 		{
-			g_Heap1GB.Reset();
+			uint64_t wakeNs		   = pacer.GetNextFrameNs();
+			uint64_t commandTimeNs = g_Core->GetNextCommandTimeNs();
+			if(commandTimeNs != 0 && commandTimeNs < wakeNs)
+				wakeNs = commandTimeNs;
+			pacer.WaitUntil(wakeNs, &g_SharedMem, lastWakeCounter, true);
+			continue;
 		}
+		UINT64 frameTimeNs = pacer.BeginFrame(now);
 
-		// Update current heap allocation in shared memory
-		g_SharedMem.pData->CurrentHeapAllocationBytes = (g_Heap512MB ? HEAP_512MB_SIZE : 0) + (g_Heap1GB ? HEAP_1GB_SIZE : 0);
+		// Query memory info, run the budget controller and pick up inputs changed without a signal (e.g. from the UI)
+		g_Core->BeginFrame(frameTimeNs);
 
 		// Start ImGui frame
 		ImGui_ImplDX12_NewFrame();
@@ -359,8 +246,9 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow
 		frameCtx->CommandAllocator->Reset();
 		g_CommandList->Reset(frameCtx->CommandAllocator.Get(), g_PipelineState.Get());
 
-		// Render to all VRAM targets to keep them resident
-		RenderToAllVRAMTargets();
+		// Render to all active VRAM targets and touch the active host memory to keep them resident
+		g_VRAMDevice->SetCommandList(g_CommandList.Get());
+		g_Core->TouchActiveMemory();
 
 		// Transition back buffer to render target
 		D3D12_RESOURCE_BARRIER barrier = {};
@@ -415,8 +303,8 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow
 		g_CommandQueue->Signal(g_Fence.Get(), fenceValue);
 		frameCtx->FenceValue = fenceValue;
 
-		// Increment frame counter for external monitoring
-		g_SharedMem.pData->FrameCount++;
+		// Increment frame counter, publish a consistent copy of this frame's output fields and append it to the history
+		g_Core->EndFrame(frameTimeNs);
 	}
 
 	WaitForGpu();
@@ -426,14 +314,11 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow
 	ImGui_ImplWin32_Shutdown();
 	ImGui::DestroyContext();
 
-	// Cleanup D3D12 heap allocations
-	g_Heap512MB.Reset();
-	g_Heap1GB.Reset();
-
-	g_VRAMRenderTargets.clear();
-	g_VRAMRtvHeap.Reset();
-	g_UnusedVRAMRenderTargets.clear();
-	g_UnusedVRAMRtvHeap.Reset();
+	// Cleanup all allocations before the device goes away
+	delete g_Core;
+	g_Core = nullptr;
+	delete g_VRAMDevice;
+	g_VRAMDevice = nullptr;
 	CleanupDeviceD3D();
 
 	// Cleanup shared memory
@@ -449,6 +334,74 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow
 	return 0;
 }
 
+// Headless frames record the touches into a bare command list and execute it on the direct queue
+// There is no back buffer, so frames only wait for the GPU when their command allocator is still in use.
+class HeadlessFrame : public EvictionHelperServiceFrame
+{
+public:
+	void BeginFrame() override
+	{
+		m_FrameContext = &g_FrameContext[g_FrameIndex % NUM_FRAMES];
+		if(m_FrameContext->FenceValue != 0 && g_Fence->GetCompletedValue() < m_FrameContext->FenceValue)
+		{
+			g_Fence->SetEventOnCompletion(m_FrameContext->FenceValue, g_FenceEvent);
+			WaitForSingleObject(g_FenceEvent, INFINITE);
+		}
+
+		m_FrameContext->CommandAllocator->Reset();
+		g_CommandList->Reset(m_FrameContext->CommandAllocator.Get(), nullptr);
+		g_VRAMDevice->SetCommandList(g_CommandList.Get());
+	}
+
+	void EndFrame() override
+	{
+		g_CommandList->Close();
+		ID3D12CommandList* cmdLists[] = { g_CommandList.Get() };
+		g_CommandQueue->ExecuteCommandLists(1, cmdLists);
+
+		UINT64 fenceValue = g_FenceValue++;
+		g_CommandQueue->Signal(g_Fence.Get(), fenceValue);
+		m_FrameContext->FenceValue = fenceValue;
+		g_FrameIndex++;
+	}
+
+private:
+	FrameContext* m_FrameContext = nullptr;
+};
+
+// Run without window, swap chain, pipeline or ImGui until a controller sets RequestShutdown
+// For unattended test machines, the helper is only controlled through shared memory
+int RunHeadless()
+{
+	if(!CreateDeviceD3D(nullptr))
+	{
+		CleanupDeviceD3D();
+		g_SharedMem.pData->IsRunning = 0;
+		EvictionHelper_CloseSharedMemory(&g_SharedMem);
+		return 1;
+	}
+
+	g_VRAMDevice = new EvictionHelperD3D12Device(g_Device.Get(), g_Adapter.Get(), g_CommandQueue.Get());
+	g_Core		 = new EvictionHelperCore(&g_SharedMem, g_VRAMDevice, &g_HostDevice);
+	g_Core->InitializeDefaults();
+
+	HeadlessFrame frame;
+	EvictionHelper_RunService(&g_SharedMem, g_Core, &frame);
+
+	WaitForGpu();
+
+	// Cleanup all allocations before the device goes away
+	delete g_Core;
+	g_Core = nullptr;
+	delete g_VRAMDevice;
+	g_VRAMDevice = nullptr;
+	CleanupDeviceD3D();
+
+	g_SharedMem.pData->IsRunning = 0;
+	EvictionHelper_CloseSharedMemory(&g_SharedMem);
+	return 0;
+}
+
 LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
 {
 	if(ImGui_ImplWin32_WndProcHandler(hWnd, msg, wParam, lParam))
@@ -470,6 +423,7 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
 	return DefWindowProcW(hWnd, msg, wParam, lParam);
 }
 
+// Without a window (headless mode) only the device, queue, command lists and fence are created
 bool CreateDeviceD3D(HWND hWnd)
 {
 	// Enable debug layer if requested
@@ -520,6 +474,46 @@ bool CreateDeviceD3D(HWND hWnd)
 		return false;
 	}
 
+	if(hWnd && !CreateSwapChain(hWnd, factory.Get()))
+	{
+		return false;
+	}
+
+	// Create frame resources
+	for(UINT i = 0; i < NUM_FRAMES; i++)
+	{
+		if(FAILED(g_Device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&g_FrameContext[i].CommandAllocator))))
+		{
+			return false;
+		}
+	}
+
+	// Create command list
+	if(FAILED(g_Device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, g_FrameContext[0].CommandAllocator.Get(), nullptr, IID_PPV_ARGS(&g_CommandList))))
+	{
+		return false;
+	}
+	g_CommandList->Close();
+
+	// Create fence
+	if(FAILED(g_Device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&g_Fence))))
+	{
+		return false;
+	}
+	g_FenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+
+	if(hWnd)
+	{
+		CreateRenderTarget();
+		CreateTrianglePipeline();
+	}
+
+	return true;
+}
+
+// Swap chain and the descriptor heaps for its back buffers and ImGui
+bool CreateSwapChain(HWND hWnd, IDXGIFactory4* factory)
+{
 	// Create swap chain
 	DXGI_SWAP_CHAIN_DESC1 swapChainDesc = {};
 	swapChainDesc.Width					= WINDOW_WIDTH;
@@ -560,32 +554,6 @@ bool CreateDeviceD3D(HWND hWnd)
 		return false;
 	}
 
-	// Create frame resources
-	for(UINT i = 0; i < NUM_FRAMES; i++)
-	{
-		if(FAILED(g_Device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&g_FrameContext[i].CommandAllocator))))
-		{
-			return false;
-		}
-	}
-
-	// Create command list
-	if(FAILED(g_Device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, g_FrameContext[0].CommandAllocator.Get(), nullptr, IID_PPV_ARGS(&g_CommandList))))
-	{
-		return false;
-	}
-	g_CommandList->Close();
-
-	// Create fence
-	if(FAILED(g_Device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&g_Fence))))
-	{
-		return false;
-	}
-	g_FenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
-
-	CreateRenderTarget();
-	CreateTrianglePipeline();
-
 	return true;
 }
 
@@ -771,260 +739,3 @@ void CreateTrianglePipeline()
 	g_VertexBufferView.SizeInBytes	  = sizeof(vertices);
 	g_VertexBufferView.StrideInBytes  = sizeof(Vertex);
 }
-
-void AllocateVRAMRenderTargets(UINT64 targetBytes)
-{
-	WaitForGpu();
-
-	// Calculate how many render targets we need
-	// Each RT is RT_WIDTH x RT_HEIGHT x 4 bytes (RGBA8)
-	UINT64 rtSize	   = RT_WIDTH * RT_HEIGHT * 4;
-	size_t targetCount = (targetBytes > 0) ? static_cast<size_t>((targetBytes + rtSize - 1) / rtSize) : 0;
-
-	// Release excess render targets
-	while(g_VRAMRenderTargets.size() > targetCount)
-	{
-		g_VRAMRenderTargets.pop_back();
-	}
-
-	// Recreate RTV heap if we need more descriptors
-	if(targetCount > 0)
-	{
-		size_t currentHeapSize = 0;
-		if(g_VRAMRtvHeap)
-		{
-			currentHeapSize = g_VRAMRtvHeap->GetDesc().NumDescriptors;
-		}
-
-		if(targetCount > currentHeapSize)
-		{
-			// Need a bigger heap - save existing resources
-			std::vector<ComPtr<ID3D12Resource> > existingResources;
-			for(auto& rt : g_VRAMRenderTargets)
-			{
-				existingResources.push_back(rt.Resource);
-			}
-			g_VRAMRenderTargets.clear();
-			g_VRAMRtvHeap.Reset();
-
-			// Create new heap
-			D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
-			heapDesc.Type						= D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
-			heapDesc.NumDescriptors				= static_cast<UINT>(targetCount + 64); // Add some padding
-			g_Device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&g_VRAMRtvHeap));
-
-			// Restore existing resources with new RTV handles
-			D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle = g_VRAMRtvHeap->GetCPUDescriptorHandleForHeapStart();
-			for(auto& resource : existingResources)
-			{
-				VRAMRenderTarget vramRT;
-				vramRT.Resource	 = resource;
-				vramRT.RtvHandle = rtvHandle;
-				g_Device->CreateRenderTargetView(resource.Get(), nullptr, rtvHandle);
-				g_VRAMRenderTargets.push_back(std::move(vramRT));
-				rtvHandle.ptr += g_RtvDescriptorSize;
-			}
-		}
-	}
-
-	// Allocate new render targets
-	while(g_VRAMRenderTargets.size() < targetCount)
-	{
-		D3D12_HEAP_PROPERTIES heapProps = {};
-		heapProps.Type					= D3D12_HEAP_TYPE_DEFAULT;
-
-		D3D12_RESOURCE_DESC texDesc = {};
-		texDesc.Dimension			= D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-		texDesc.Width				= RT_WIDTH;
-		texDesc.Height				= RT_HEIGHT;
-		texDesc.DepthOrArraySize	= 1;
-		texDesc.MipLevels			= 1;
-		texDesc.Format				= DXGI_FORMAT_R8G8B8A8_UNORM;
-		texDesc.SampleDesc.Count	= 1;
-		texDesc.Flags				= D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
-
-		D3D12_CLEAR_VALUE clearValue = {};
-		clearValue.Format			 = DXGI_FORMAT_R8G8B8A8_UNORM;
-		clearValue.Color[0]			 = 0.0f;
-		clearValue.Color[1]			 = 0.0f;
-		clearValue.Color[2]			 = 0.0f;
-		clearValue.Color[3]			 = 1.0f;
-
-		VRAMRenderTarget vramRT;
-		HRESULT			 hr = g_Device->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &texDesc, D3D12_RESOURCE_STATE_RENDER_TARGET, &clearValue, IID_PPV_ARGS(&vramRT.Resource));
-
-		if(FAILED(hr))
-		{
-			// Out of VRAM, stop allocating
-			break;
-		}
-
-		// Set residency priority from shared memory
-		ID3D12Pageable*			 pageable = vramRT.Resource.Get();
-		D3D12_RESIDENCY_PRIORITY priority = IndexToPriority(g_SharedMem.pData->ActiveVRAMPriority);
-		g_Device->SetResidencyPriority(1, &pageable, &priority);
-
-		// Create RTV
-		D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle = g_VRAMRtvHeap->GetCPUDescriptorHandleForHeapStart();
-		rtvHandle.ptr += g_VRAMRenderTargets.size() * g_RtvDescriptorSize;
-		vramRT.RtvHandle = rtvHandle;
-		g_Device->CreateRenderTargetView(vramRT.Resource.Get(), nullptr, rtvHandle);
-
-		g_VRAMRenderTargets.push_back(std::move(vramRT));
-	}
-
-	// Update shared memory with current allocation
-	if(g_SharedMem.pData)
-	{
-		g_SharedMem.pData->CurrentVRAMAllocationBytes = g_VRAMRenderTargets.size() * rtSize;
-		g_SharedMem.pData->AllocatedRenderTargetCount = static_cast<uint32_t>(g_VRAMRenderTargets.size());
-	}
-}
-
-void AllocateUnusedVRAMRenderTargets(UINT64 targetBytes)
-{
-	WaitForGpu();
-
-	// Calculate how many render targets we need
-	// Each RT is RT_WIDTH x RT_HEIGHT x 4 bytes (RGBA8)
-	UINT64 rtSize	   = RT_WIDTH * RT_HEIGHT * 4;
-	size_t targetCount = (targetBytes > 0) ? static_cast<size_t>((targetBytes + rtSize - 1) / rtSize) : 0;
-
-	// Release excess render targets
-	while(g_UnusedVRAMRenderTargets.size() > targetCount)
-	{
-		g_UnusedVRAMRenderTargets.pop_back();
-	}
-
-	// Recreate RTV heap if we need more descriptors
-	if(targetCount > 0)
-	{
-		size_t currentHeapSize = 0;
-		if(g_UnusedVRAMRtvHeap)
-		{
-			currentHeapSize = g_UnusedVRAMRtvHeap->GetDesc().NumDescriptors;
-		}
-
-		if(targetCount > currentHeapSize)
-		{
-			// Need a bigger heap - save existing resources
-			std::vector<ComPtr<ID3D12Resource> > existingResources;
-			for(auto& rt : g_UnusedVRAMRenderTargets)
-			{
-				existingResources.push_back(rt.Resource);
-			}
-			g_UnusedVRAMRenderTargets.clear();
-			g_UnusedVRAMRtvHeap.Reset();
-
-			// Create new heap
-			D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
-			heapDesc.Type						= D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
-			heapDesc.NumDescriptors				= static_cast<UINT>(targetCount + 64); // Add some padding
-			g_Device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&g_UnusedVRAMRtvHeap));
-
-			// Restore existing resources with new RTV handles
-			D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle = g_UnusedVRAMRtvHeap->GetCPUDescriptorHandleForHeapStart();
-			for(auto& resource : existingResources)
-			{
-				VRAMRenderTarget vramRT;
-				vramRT.Resource	 = resource;
-				vramRT.RtvHandle = rtvHandle;
-				g_Device->CreateRenderTargetView(resource.Get(), nullptr, rtvHandle);
-				g_UnusedVRAMRenderTargets.push_back(std::move(vramRT));
-				rtvHandle.ptr += g_RtvDescriptorSize;
-			}
-		}
-	}
-
-	// Allocate new render targets
-	while(g_UnusedVRAMRenderTargets.size() < targetCount)
-	{
-		D3D12_HEAP_PROPERTIES heapProps = {};
-		heapProps.Type					= D3D12_HEAP_TYPE_DEFAULT;
-
-		D3D12_RESOURCE_DESC texDesc = {};
-		texDesc.Dimension			= D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-		texDesc.Width				= RT_WIDTH;
-		texDesc.Height				= RT_HEIGHT;
-		texDesc.DepthOrArraySize	= 1;
-		texDesc.MipLevels			= 1;
-		texDesc.Format				= DXGI_FORMAT_R8G8B8A8_UNORM;
-		texDesc.SampleDesc.Count	= 1;
-		texDesc.Flags				= D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
-
-		D3D12_CLEAR_VALUE clearValue = {};
-		clearValue.Format			 = DXGI_FORMAT_R8G8B8A8_UNORM;
-		clearValue.Color[0]			 = 0.0f;
-		clearValue.Color[1]			 = 0.0f;
-		clearValue.Color[2]			 = 0.0f;
-		clearValue.Color[3]			 = 1.0f;
-
-		VRAMRenderTarget vramRT;
-		HRESULT			 hr = g_Device->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &texDesc, D3D12_RESOURCE_STATE_RENDER_TARGET, &clearValue, IID_PPV_ARGS(&vramRT.Resource));
-
-		if(FAILED(hr))
-		{
-			// Out of VRAM, stop allocating
-			break;
-		}
-
-		// Set residency priority from shared memory
-		ID3D12Pageable*			 pageable = vramRT.Resource.Get();
-		D3D12_RESIDENCY_PRIORITY priority = IndexToPriority(g_SharedMem.pData->UnusedVRAMPriority);
-		g_Device->SetResidencyPriority(1, &pageable, &priority);
-
-		// Create RTV
-		D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle = g_UnusedVRAMRtvHeap->GetCPUDescriptorHandleForHeapStart();
-		rtvHandle.ptr += g_UnusedVRAMRenderTargets.size() * g_RtvDescriptorSize;
-		vramRT.RtvHandle = rtvHandle;
-		g_Device->CreateRenderTargetView(vramRT.Resource.Get(), nullptr, rtvHandle);
-
-		g_UnusedVRAMRenderTargets.push_back(std::move(vramRT));
-	}
-
-	// Update shared memory with current allocation
-	if(g_SharedMem.pData)
-	{
-		g_SharedMem.pData->CurrentUnusedVRAMAllocationBytes = g_UnusedVRAMRenderTargets.size() * rtSize;
-		g_SharedMem.pData->AllocatedUnusedRenderTargetCount = static_cast<uint32_t>(g_UnusedVRAMRenderTargets.size());
-	}
-}
-
-void RenderToAllVRAMTargets()
-{
-	if(g_VRAMRenderTargets.empty())
-		return;
-
-	// Simple clear operation to each render target to ensure they stay resident
-	// Use the same color as D3D12_CLEAR_VALUE when creating the resources to avoid debug warnings
-	const float clearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
-
-	for(size_t i = 0; i < g_VRAMRenderTargets.size(); i++)
-	{
-		g_CommandList->ClearRenderTargetView(g_VRAMRenderTargets[i].RtvHandle, clearColor, 0, nullptr);
-	}
-}
-
-void QueryMemoryInfo()
-{
-	if(g_Adapter && g_SharedMem.pData)
-	{
-		DXGI_QUERY_VIDEO_MEMORY_INFO localInfo	  = {};
-		DXGI_QUERY_VIDEO_MEMORY_INFO nonLocalInfo = {};
-
-		g_Adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &localInfo);
-		g_Adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_NON_LOCAL, &nonLocalInfo);
-
-		// Update shared memory with local (VRAM) info
-		g_SharedMem.pData->LocalBudget					= localInfo.Budget;
-		g_SharedMem.pData->LocalCurrentUsage			= localInfo.CurrentUsage;
-		g_SharedMem.pData->LocalAvailableForReservation = localInfo.AvailableForReservation;
-		g_SharedMem.pData->LocalCurrentReservation		= localInfo.CurrentReservation;
-
-		// Update shared memory with non-local (system) info
-		g_SharedMem.pData->NonLocalBudget				   = nonLocalInfo.Budget;
-		g_SharedMem.pData->NonLocalCurrentUsage			   = nonLocalInfo.CurrentUsage;
-		g_SharedMem.pData->NonLocalAvailableForReservation = nonLocalInfo.AvailableForReservation;
-		g_SharedMem.pData->NonLocalCurrentReservation	   = nonLocalInfo.CurrentReservation;
-	}
-}
@@ -0,0 +1,234 @@
+#pragma once
+
+#include "eviction_helper_device.h"
+#include "eviction_helper_spsc_queue.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+class EvictionHelperPool;
+
+// Request types sent to the allocation worker
+#define EVICTION_HELPER_ALLOCATION_CREATE  0
+#define EVICTION_HELPER_ALLOCATION_DESTROY 1
+
+// Result status of a create request
+#define EVICTION_HELPER_ALLOCATION_CREATED	 0
+#define EVICTION_HELPER_ALLOCATION_FAILED	 1 // Out of memory
+#define EVICTION_HELPER_ALLOCATION_CANCELLED 2 // No longer needed when the worker got to it
+
+constexpr uint32_t EVICTION_HELPER_ALLOCATION_QUEUE_SIZE = 4096;
+
+struct EvictionHelperAllocationRequest
+{
+	EvictionHelperDevice*  Device;
+	EvictionHelperPool*	   Pool;		// Receives the result, never dereferenced by the worker
+	std::atomic<uint32_t>* CancelCount; // Create requests are skipped while this is non-zero, each skip decrements it
+	EvictionHelperResource Resource;	// Resource to destroy
+	uint64_t			   SizeBytes;
+	uint32_t			   Type; // EVICTION_HELPER_ALLOCATION_CREATE/DESTROY
+	uint32_t			   Kind; // EVICTION_HELPER_RESOURCE_*
+	int					   Priority;
+	uint64_t			   PlacementGroup; // See EvictionHelperDevice::CreateGroupedResource()
+};
+
+struct EvictionHelperAllocationResult
+{
+	EvictionHelperPool*	   Pool;
+	EvictionHelperResource Resource; // 0 unless Status is CREATED
+	uint64_t			   SizeBytes;
+	uint32_t			   Status; // EVICTION_HELPER_ALLOCATION_CREATED/FAILED/CANCELLED
+	int					   Priority;
+	uint64_t			   CreateNs; // Time spent in CreateResource()
+};
+
+// Creates and destroys resources off the frame thread so large target changes do not stall the frame loop
+// Requests and results are handed over through lock-free SPSC queues: the frame thread pushes requests and
+// pops results, the worker does the opposite. Destroy requests are only pushed once the device has completed
+// every frame that used the resource (see EvictionHelperDeferredReleaseQueue), so the worker never waits for the GPU.
+// Without Start() the worker does nothing on its own and ExecutePending() runs the requests on the calling
+// thread, which keeps runs on the simulated device deterministic.
+class EvictionHelperAllocationWorker
+{
+public:
+	typedef void (*IdleCallback)(void* context);
+
+	~EvictionHelperAllocationWorker()
+	{
+		Stop();
+	}
+
+	// Start the worker thread, onIdle is called from it whenever it runs out of requests
+	void Start(IdleCallback onIdle, void* context)
+	{
+		m_OnIdle		= onIdle;
+		m_OnIdleContext = context;
+		m_StopRequested = false;
+		m_Thread		= std::thread(&EvictionHelperAllocationWorker::Run, this);
+	}
+
+	// Stop the worker thread
+	// Remaining destroy requests are still executed, remaining create requests are dropped without a result
+	void Stop()
+	{
+		if(!m_Thread.joinable())
+			return;
+
+		{
+			std::lock_guard<std::mutex> lock(m_WakeMutex);
+			m_StopRequested = true;
+		}
+		m_WakeCondition.notify_one();
+		m_Thread.join();
+	}
+
+	bool IsRunning() const
+	{
+		return m_Thread.joinable();
+	}
+
+	// Frame thread: queue a request, returns false if the queue is full
+	// Call Kick() after queueing a batch to wake the worker
+	bool PushRequest(const EvictionHelperAllocationRequest& request)
+	{
+		if(!m_Requests.Push(request))
+			return false;
+
+		if(request.Type == EVICTION_HELPER_ALLOCATION_DESTROY)
+			m_PendingReleaseBytes.fetch_add(request.SizeBytes, std::memory_order_relaxed);
+		return true;
+	}
+
+	void Kick()
+	{
+		if(!m_Thread.joinable())
+			return;
+
+		// Taking the mutex orders the push before the worker's empty check, so the wake cannot be lost
+		{
+			std::lock_guard<std::mutex> lock(m_WakeMutex);
+		}
+		m_WakeCondition.notify_one();
+	}
+
+	// Frame thread: take the next finished create request, returns false if there is none
+	bool PopResult(EvictionHelperAllocationResult* outResult)
+	{
+		return m_Results.Pop(outResult);
+	}
+
+	// Execute all queued requests on the calling thread, only valid while the worker thread is not running
+	void ExecutePending()
+	{
+		EvictionHelperAllocationRequest request;
+		while(m_Requests.Pop(&request))
+		{
+			Execute(request);
+		}
+	}
+
+	// Bytes of destroy requests that have not been executed yet
+	uint64_t GetPendingReleaseBytes() const
+	{
+		return m_PendingReleaseBytes.load(std::memory_order_relaxed);
+	}
+
+private:
+	void Run()
+	{
+		EvictionHelperAllocationRequest request;
+		bool							busy = false;
+		while(true)
+		{
+			if(m_Requests.Pop(&request))
+			{
+				busy = true;
+				Execute(request);
+				continue;
+			}
+
+			if(busy)
+			{
+				busy = false;
+				if(m_OnIdle)
+					m_OnIdle(m_OnIdleContext);
+			}
+
+			std::unique_lock<std::mutex> lock(m_WakeMutex);
+			m_WakeCondition.wait(lock, [this] { return m_StopRequested || !m_Requests.IsEmpty(); });
+			if(m_StopRequested && m_Requests.IsEmpty())
+				return;
+		}
+	}
+
+	void Execute(const EvictionHelperAllocationRequest& request)
+	{
+		if(request.Type == EVICTION_HELPER_ALLOCATION_DESTROY)
+		{
+			request.Device->DestroyResource(request.Resource);
+			m_PendingReleaseBytes.fetch_sub(request.SizeBytes, std::memory_order_relaxed);
+			return;
+		}
+
+		if(m_StopRequested)
+			return;
+
+		EvictionHelperAllocationResult result = {};
+		result.Pool							  = request.Pool;
+		result.SizeBytes					  = request.SizeBytes;
+		result.Priority						  = request.Priority;
+
+		if(TryConsumeCancel(request.CancelCount))
+		{
+			result.Status = EVICTION_HELPER_ALLOCATION_CANCELLED;
+		}
+		else
+		{
+			auto start		= std::chrono::steady_clock::now();
+			result.Resource = request.Device->CreateGroupedResource(request.Kind, request.SizeBytes, request.Priority, request.PlacementGroup);
+			result.CreateNs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+			result.Status	= result.Resource ? EVICTION_HELPER_ALLOCATION_CREATED : EVICTION_HELPER_ALLOCATION_FAILED;
+		}
+
+		while(!m_Results.Push(result))
+		{
+			// The frame loop is not keeping up, or is shutting down and will not take the result anymore
+			if(m_StopRequested)
+			{
+				if(result.Resource)
+					request.Device->DestroyResource(result.Resource);
+				return;
+			}
+			std::this_thread::yield();
+		}
+	}
+
+	static bool TryConsumeCancel(std::atomic<uint32_t>* cancelCount)
+	{
+		if(!cancelCount)
+			return false;
+
+		uint32_t count = cancelCount->load(std::memory_order_acquire);
+		while(count > 0)
+		{
+			if(cancelCount->compare_exchange_weak(count, count - 1, std::memory_order_acq_rel))
+				return true;
+		}
+		return false;
+	}
+
+	EvictionHelperSpscQueue<EvictionHelperAllocationRequest, EVICTION_HELPER_ALLOCATION_QUEUE_SIZE> m_Requests;
+	EvictionHelperSpscQueue<EvictionHelperAllocationResult, EVICTION_HELPER_ALLOCATION_QUEUE_SIZE>	m_Results;
+	std::atomic<uint64_t>																			m_PendingReleaseBytes{ 0 };
+
+	std::thread				m_Thread;
+	std::mutex				m_WakeMutex;
+	std::condition_variable m_WakeCondition;
+	std::atomic<bool>		m_StopRequested{ false };
+	IdleCallback			m_OnIdle		= nullptr;
+	void*					m_OnIdleContext = nullptr;
+};
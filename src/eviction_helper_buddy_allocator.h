@@ -0,0 +1,136 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// CPU-side buddy suballocator for carving placed resources out of a heap
+// Manages offsets in [0, capacity) in power-of-two blocks of at least minBlockSize, every block is aligned to its
+// own size. The free state is kept in a complete binary tree with one byte per node holding the order of the
+// largest free block below it, so Allocate() and Free() are O(log(capacity / minBlockSize)) and never allocate.
+// Not thread safe, the owner locks around it.
+class EvictionHelperBuddyAllocator
+{
+public:
+	// capacity and minBlockSize are rounded down / up to powers of two
+	EvictionHelperBuddyAllocator(uint64_t capacity, uint64_t minBlockSize)
+	{
+		m_MinBlockShift = 0;
+		while((1ULL << m_MinBlockShift) < minBlockSize)
+			m_MinBlockShift++;
+
+		m_RootOrder = 0;
+		while((2ULL << (m_RootOrder + m_MinBlockShift)) <= capacity)
+			m_RootOrder++;
+
+		// Each node starts fully free: 1 + its order
+		uint64_t leafCount = 1ULL << m_RootOrder;
+		m_Tree.resize(static_cast<size_t>(leafCount * 2 - 1));
+		uint32_t order = m_RootOrder;
+		for(uint64_t levelStart = 0; levelStart < m_Tree.size(); levelStart = levelStart * 2 + 1, order--)
+		{
+			std::fill(m_Tree.begin() + static_cast<size_t>(levelStart), m_Tree.begin() + static_cast<size_t>(levelStart * 2 + 1), static_cast<uint8_t>(order + 1));
+		}
+	}
+
+	// Find a free block for sizeBytes, returns false if no block is large enough
+	bool Allocate(uint64_t sizeBytes, uint64_t* outOffset)
+	{
+		uint32_t order = GetOrder(sizeBytes);
+		if(order > m_RootOrder || m_Tree[0] < order + 1)
+			return false;
+
+		// Walk down, preferring the left child so allocations stay packed towards the start
+		size_t	 index	   = 0;
+		uint32_t nodeOrder = m_RootOrder;
+		while(nodeOrder != order)
+		{
+			size_t left = index * 2 + 1;
+			index		= (m_Tree[left] >= order + 1) ? left : left + 1;
+			nodeOrder--;
+		}
+		m_Tree[index] = 0;
+
+		uint64_t blockIndex = (static_cast<uint64_t>(index) + 1) * (1ULL << order) - (1ULL << m_RootOrder);
+		*outOffset			= blockIndex << m_MinBlockShift;
+		m_UsedBytes += 1ULL << (order + m_MinBlockShift);
+
+		UpdateParents(index, order);
+		return true;
+	}
+
+	// Release a block returned by Allocate() and merge it with its free buddies
+	void Free(uint64_t offset)
+	{
+		// Start at the leaf and walk up to the node that was handed out
+		size_t	 index	   = static_cast<size_t>((offset >> m_MinBlockShift) + (1ULL << m_RootOrder) - 1);
+		uint32_t nodeOrder = 0;
+		while(m_Tree[index] != 0)
+		{
+			if(index == 0)
+				return; // Not allocated
+			index = (index - 1) / 2;
+			nodeOrder++;
+		}
+
+		m_Tree[index] = static_cast<uint8_t>(nodeOrder + 1);
+		m_UsedBytes -= 1ULL << (nodeOrder + m_MinBlockShift);
+
+		UpdateParents(index, nodeOrder);
+	}
+
+	// Size of the block Allocate() would use for sizeBytes
+	uint64_t GetBlockSize(uint64_t sizeBytes) const
+	{
+		return 1ULL << (GetOrder(sizeBytes) + m_MinBlockShift);
+	}
+
+	uint64_t GetCapacity() const
+	{
+		return 1ULL << (m_RootOrder + m_MinBlockShift);
+	}
+
+	// Bytes in allocated blocks, including the rounding to powers of two
+	uint64_t GetUsedBytes() const
+	{
+		return m_UsedBytes;
+	}
+
+	uint64_t GetLargestFreeBlock() const
+	{
+		return m_Tree[0] ? 1ULL << (m_Tree[0] - 1 + m_MinBlockShift) : 0;
+	}
+
+	bool IsEmpty() const
+	{
+		return m_UsedBytes == 0;
+	}
+
+private:
+	uint32_t GetOrder(uint64_t sizeBytes) const
+	{
+		uint64_t blocks = (std::max<uint64_t>(sizeBytes, 1) + (1ULL << m_MinBlockShift) - 1) >> m_MinBlockShift;
+		uint32_t order	= 0;
+		while((1ULL << order) < blocks)
+			order++;
+		return order;
+	}
+
+	// Recompute the ancestors of a changed node, two fully free children merge into one free block
+	void UpdateParents(size_t index, uint32_t order)
+	{
+		while(index > 0)
+		{
+			index = (index - 1) / 2;
+			uint8_t left  = m_Tree[index * 2 + 1];
+			uint8_t right = m_Tree[index * 2 + 2];
+			m_Tree[index] = (left == order + 1 && right == order + 1) ? static_cast<uint8_t>(order + 2) : std::max(left, right);
+			order++;
+		}
+	}
+
+	std::vector<uint8_t> m_Tree;
+	uint32_t			 m_MinBlockShift;
+	uint32_t			 m_RootOrder;
+	uint64_t			 m_UsedBytes = 0;
+};
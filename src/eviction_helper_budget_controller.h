@@ -0,0 +1,94 @@
+#pragma once
+
+#include "eviction_helper_shared.h"
+
+#include <algorithm>
+#include <cstdint>
+
+// Default gains, tuned for a plant that reacts within one frame at 30 FPS
+constexpr double BUDGET_CONTROL_DEFAULT_KP		 = 0.5;					  // Output bytes per byte of error
+constexpr double BUDGET_CONTROL_DEFAULT_KI		 = 3.0;					  // Output bytes per byte of error and second
+constexpr double BUDGET_CONTROL_DEFAULT_DEADBAND = 32.0 * 1024.0 * 1024.0; // Two render targets, avoids hunting between neighbouring allocation steps
+
+// Usage the controller should hold for a given budget, in bytes
+inline uint64_t BudgetController_ComputeSetpoint(int mode, int percent, int headroomMB, uint64_t budgetBytes)
+{
+	switch(mode)
+	{
+	case EVICTION_HELPER_BUDGET_CONTROL_PERCENT:
+		return static_cast<uint64_t>(static_cast<double>(budgetBytes) * std::max(percent, 0) / 100.0);
+	case EVICTION_HELPER_BUDGET_CONTROL_HEADROOM:
+	{
+		uint64_t headroomBytes = static_cast<uint64_t>(std::max(headroomMB, 0)) * 1024ULL * 1024ULL;
+		return (budgetBytes > headroomBytes) ? budgetBytes - headroomBytes : 0;
+	}
+	default:
+		return 0;
+	}
+}
+
+// Damped PI controller that drives the size of one pool so the measured usage follows a setpoint
+// The output is the pool size in bytes. The integrator is only advanced while the output is not
+// saturated (or the error pulls it back out of saturation), so long stretches at the limits do not wind it up.
+class BudgetController
+{
+public:
+	void SetGains(double kp, double ki, double deadbandBytes)
+	{
+		m_Kp			= kp;
+		m_Ki			= ki;
+		m_DeadbandBytes = deadbandBytes;
+	}
+
+	// Start from the current pool size so enabling the controller does not cause a jump
+	void Reset(double initialOutputBytes)
+	{
+		m_Integral	 = initialOutputBytes;
+		m_Output	 = initialOutputBytes;
+		m_ErrorBytes = 0.0;
+	}
+
+	// Advance the controller by dtSeconds and return the new pool size in bytes, clamped to [minOutputBytes, maxOutputBytes]
+	double Update(double setpointBytes, double measuredBytes, double dtSeconds, double minOutputBytes, double maxOutputBytes)
+	{
+		m_ErrorBytes = setpointBytes - measuredBytes;
+
+		double error = m_ErrorBytes;
+		if(error > -m_DeadbandBytes && error < m_DeadbandBytes)
+		{
+			error = 0.0;
+		}
+
+		double integral	 = m_Integral + m_Ki * error * dtSeconds;
+		double output	 = m_Kp * error + integral;
+		double clamped	 = std::min(std::max(output, minOutputBytes), maxOutputBytes);
+		bool   saturated = (output > maxOutputBytes && error > 0.0) || (output < minOutputBytes && error < 0.0);
+
+		// Anti-windup: keep the integrator inside the output range and freeze it while pushing into a limit
+		if(!saturated)
+		{
+			m_Integral = std::min(std::max(integral, minOutputBytes), maxOutputBytes);
+		}
+
+		m_Output = clamped;
+		return m_Output;
+	}
+
+	double GetErrorBytes() const
+	{
+		return m_ErrorBytes;
+	}
+
+	double GetOutputBytes() const
+	{
+		return m_Output;
+	}
+
+private:
+	double m_Kp			   = BUDGET_CONTROL_DEFAULT_KP;
+	double m_Ki			   = BUDGET_CONTROL_DEFAULT_KI;
+	double m_DeadbandBytes = BUDGET_CONTROL_DEFAULT_DEADBAND;
+	double m_Integral	   = 0.0;
+	double m_Output		   = 0.0;
+	double m_ErrorBytes	   = 0.0;
+};
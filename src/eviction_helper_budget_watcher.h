@@ -0,0 +1,160 @@
+#pragma once
+
+#include "eviction_helper_device.h"
+#include "eviction_helper_shared.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+// Longest single wait of the watcher thread, bounds how long Stop() takes if a cancel is lost
+#define EVICTION_HELPER_BUDGET_WATCHER_WAIT_NS 1000000000ULL
+
+struct EvictionHelperBudgetWatcherStats
+{
+	uint64_t NotificationCount; // Notifications received, including ones that did not change the budget
+	uint64_t ChangeCount;		// Changes published, from notifications and polls
+	uint64_t LatencyMaxNs;		// Slowest notification from wake to publish
+};
+
+// Publishes every change of the local or non-local budget to the BudgetChanges ring and BudgetGeneration, so
+// controllers can wait for the next change instead of polling the budget.
+// On devices with budget change notifications a thread waits for them and queries the budget as soon as one arrives,
+// which also catches dips that are over before the next frame queries the budget. Devices without notifications are
+// polled by the frame loop through Poll() instead, which does nothing while the thread runs.
+// The first change published after Start() is the initial budget, with previous budgets of 0.
+class EvictionHelperBudgetWatcher
+{
+public:
+	EvictionHelperBudgetWatcher()
+	{
+		m_Stats = {};
+	}
+
+	~EvictionHelperBudgetWatcher()
+	{
+		Stop();
+	}
+
+	EvictionHelperBudgetWatcher(const EvictionHelperBudgetWatcher&)			   = delete;
+	EvictionHelperBudgetWatcher& operator=(const EvictionHelperBudgetWatcher&) = delete;
+
+	// Publish the current budget of device and watch it for notifications, restarts the stats
+	// Returns false if the device has no budget change notifications, Poll() has to be called every frame then.
+	bool Start(EvictionHelperDevice* device, const EvictionHelperSharedMemory* sharedMem)
+	{
+		Stop();
+
+		m_Device	= device;
+		m_SharedMem = sharedMem;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Stats			 = {};
+			m_LocalBudget	 = 0;
+			m_NonLocalBudget = 0;
+		}
+
+		EvictionHelperMemoryInfo local	  = {};
+		EvictionHelperMemoryInfo nonLocal = {};
+		uint64_t				 queryNs  = EvictionHelper_GetTimestampNs();
+		m_Device->QueryMemoryInfo(&local, &nonLocal);
+		Record(local, nonLocal, queryNs, EVICTION_HELPER_BUDGET_SOURCE_POLL);
+
+		if(!m_Device->SupportsBudgetChangeNotifications())
+			return false;
+
+		m_StopRequested = false;
+		m_Thread		= std::thread(&EvictionHelperBudgetWatcher::Run, this);
+		return true;
+	}
+
+	void Stop()
+	{
+		if(!m_Thread.joinable())
+			return;
+
+		m_StopRequested = true;
+		m_Device->CancelBudgetChangeWait();
+		m_Thread.join();
+	}
+
+	// True while the watcher thread waits for notifications
+	bool IsRunning() const
+	{
+		return m_Thread.joinable();
+	}
+
+	// Publish the budget queried by the frame loop if it changed, queryNs is the time right before the query
+	void Poll(const EvictionHelperMemoryInfo& local, const EvictionHelperMemoryInfo& nonLocal, uint64_t queryNs)
+	{
+		// A poll that raced with a notification could publish the budget from before the change again
+		if(IsRunning())
+			return;
+
+		Record(local, nonLocal, queryNs, EVICTION_HELPER_BUDGET_SOURCE_POLL);
+	}
+
+	void GetStats(EvictionHelperBudgetWatcherStats* outStats) const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		*outStats = m_Stats;
+	}
+
+private:
+	void Run()
+	{
+		while(!m_StopRequested)
+		{
+			if(!m_Device->WaitForBudgetChange(EVICTION_HELPER_BUDGET_WATCHER_WAIT_NS))
+				continue;
+
+			// Query right away, a short dip can be over by the time the frame loop queries again
+			uint64_t				 wakeNs	  = EvictionHelper_GetTimestampNs();
+			EvictionHelperMemoryInfo local	  = {};
+			EvictionHelperMemoryInfo nonLocal = {};
+			m_Device->QueryMemoryInfo(&local, &nonLocal);
+			Record(local, nonLocal, wakeNs, EVICTION_HELPER_BUDGET_SOURCE_NOTIFICATION);
+		}
+	}
+
+	void Record(const EvictionHelperMemoryInfo& local, const EvictionHelperMemoryInfo& nonLocal, uint64_t timestampNs, uint32_t source)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if(source == EVICTION_HELPER_BUDGET_SOURCE_NOTIFICATION)
+			m_Stats.NotificationCount++;
+		if(local.Budget == m_LocalBudget && nonLocal.Budget == m_NonLocalBudget)
+			return;
+
+		EvictionHelperBudgetChange change = {};
+		change.TimestampNs				  = timestampNs;
+		change.Source					  = source;
+		change.LocalBudget				  = local.Budget;
+		change.PreviousLocalBudget		  = m_LocalBudget;
+		change.NonLocalBudget			  = nonLocal.Budget;
+		change.PreviousNonLocalBudget	  = m_NonLocalBudget;
+		change.LocalCurrentUsage		  = local.CurrentUsage;
+		change.NonLocalCurrentUsage		  = nonLocal.CurrentUsage;
+		change.LatencyNs				  = EvictionHelper_GetTimestampNs() - timestampNs;
+		EvictionHelper_PublishBudgetChange(m_SharedMem, &change);
+
+		m_LocalBudget	 = local.Budget;
+		m_NonLocalBudget = nonLocal.Budget;
+		m_Stats.ChangeCount++;
+		if(source == EVICTION_HELPER_BUDGET_SOURCE_NOTIFICATION)
+			m_Stats.LatencyMaxNs = std::max(m_Stats.LatencyMaxNs, change.LatencyNs);
+	}
+
+	EvictionHelperDevice*			  m_Device	  = nullptr;
+	const EvictionHelperSharedMemory* m_SharedMem = nullptr;
+	std::atomic<bool>				  m_StopRequested{ false };
+
+	// Last published budget and the stats, written by the watcher thread and by Poll()
+	mutable std::mutex				 m_Mutex;
+	uint64_t						 m_LocalBudget	  = 0;
+	uint64_t						 m_NonLocalBudget = 0;
+	EvictionHelperBudgetWatcherStats m_Stats;
+
+	std::thread m_Thread;
+};
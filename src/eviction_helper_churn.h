@@ -0,0 +1,347 @@
+#pragma once
+
+#include "eviction_helper_device.h"
+#include "eviction_helper_random.h"
+#include "eviction_helper_shared.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// One size of an empirical size distribution
+struct EvictionHelperChurnBin
+{
+	uint64_t SizeBytes;
+	double	 Weight;
+};
+
+// What the churn workload allocates and how fast, set by the owner every frame
+struct EvictionHelperChurnConfig
+{
+	EvictionHelperDevice* Device;
+	uint32_t			  Kind;			// EVICTION_HELPER_RESOURCE_*
+	uint32_t			  Distribution; // EVICTION_HELPER_CHURN_*
+	double				  OpsPerSecond; // 0 = stopped, all churn resources are released
+	uint64_t			  TargetBytes;
+	uint64_t			  MinSizeBytes;
+	uint64_t			  MaxSizeBytes;
+	uint64_t			  SizeAlignment; // Sizes are rounded up to this
+	uint32_t			  LargePercent;	 // Share of the large mode of BIMODAL
+	uint32_t			  Seed;
+	int					  Priority;
+};
+
+struct EvictionHelperChurnStats
+{
+	uint64_t AllocatedBytes;
+	uint32_t ResourceCount;
+	uint64_t AllocCount;
+	uint64_t FreeCount;
+	uint64_t FailedAllocCount;
+	uint64_t AllocMaxNs;
+	uint64_t FreeMaxNs;
+	uint64_t AllocLatencyHistogram[EVICTION_HELPER_LATENCY_BUCKETS];
+	uint64_t FreeLatencyHistogram[EVICTION_HELPER_LATENCY_BUCKETS];
+};
+
+// Read an empirical size distribution, one "<size in KB> <weight>" pair per line, lines starting with # are skipped
+// Returns false if the file cannot be opened or contains no valid bin
+inline bool EvictionHelperChurn_LoadHistogram(const char* path, std::vector<EvictionHelperChurnBin>* outBins)
+{
+	outBins->clear();
+	FILE* file = fopen(path, "r");
+	if(!file)
+		return false;
+
+	char line[256];
+	while(fgets(line, sizeof(line), file))
+	{
+		double sizeKB = 0.0;
+		double weight = 0.0;
+		if(line[0] == '#' || sscanf(line, "%lf %lf", &sizeKB, &weight) != 2 || sizeKB <= 0.0 || weight <= 0.0)
+			continue;
+
+		EvictionHelperChurnBin bin;
+		bin.SizeBytes = static_cast<uint64_t>(sizeKB * 1024.0);
+		bin.Weight	  = weight;
+		outBins->push_back(bin);
+	}
+	fclose(file);
+	return !outBins->empty();
+}
+
+// Fragmentation workload: allocates and frees resources of random sizes at a fixed rate
+// Each operation allocates with a probability that falls from 1 below the target to 0 above it, so the total
+// hovers around TargetBytes while resources of all sizes keep being replaced. Frees pick a random resource, which
+// leaves holes of every size behind. Sizes follow a log-uniform, bimodal or empirical distribution from a seeded
+// generator. The latency of every CreateResource()/DestroyResource() call goes into a log2 histogram.
+// With Start() the operations run on their own thread paced by the real time. Without it Advance() runs them on the
+// calling thread paced by the time passed in, which keeps runs on the simulated device deterministic.
+// Churn resources are never used by GPU work, so they are destroyed right away.
+class EvictionHelperChurn
+{
+public:
+	EvictionHelperChurn()
+	{
+		m_Config = {};
+		m_Stats	 = {};
+	}
+
+	~EvictionHelperChurn()
+	{
+		Stop();
+	}
+
+	EvictionHelperChurn(const EvictionHelperChurn&)			   = delete;
+	EvictionHelperChurn& operator=(const EvictionHelperChurn&) = delete;
+
+	void Start()
+	{
+		m_StopRequested = false;
+		m_Thread		= std::thread(&EvictionHelperChurn::Run, this);
+	}
+
+	// Stop the thread, the resources stay alive until Release()
+	void Stop()
+	{
+		if(!m_Thread.joinable())
+			return;
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_StopRequested = true;
+		}
+		m_WakeCondition.notify_one();
+		m_Thread.join();
+	}
+
+	bool IsRunning() const
+	{
+		return m_Thread.joinable();
+	}
+
+	// Any thread, takes effect with the next operation
+	// Enabling churn, or changing its device, kind or seed, restarts it with new counters
+	void SetConfig(const EvictionHelperChurnConfig& config)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Config = config;
+	}
+
+	// Any thread, bins for EVICTION_HELPER_CHURN_HISTOGRAM
+	void SetHistogram(const std::vector<EvictionHelperChurnBin>& bins)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Bins		  = bins;
+		m_BinsChanged = true;
+	}
+
+	// Any thread
+	void GetStats(EvictionHelperChurnStats* outStats) const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		*outStats = m_Stats;
+	}
+
+	// Run the operations that are due after dtSeconds, only valid while the thread is not running
+	void Advance(double dtSeconds)
+	{
+		EvictionHelperChurnConfig config;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			config = m_Config;
+			if(m_BinsChanged)
+			{
+				m_ActiveBins  = m_Bins;
+				m_BinsChanged = false;
+				m_TotalWeight = 0.0;
+				for(const EvictionHelperChurnBin& bin : m_ActiveBins)
+				{
+					m_TotalWeight += bin.Weight;
+				}
+			}
+		}
+
+		bool enabled = config.OpsPerSecond > 0.0 && config.Device;
+		if(!enabled || config.Device != m_Device || config.Kind != m_Kind || config.Seed != m_Seed || !m_Enabled)
+		{
+			// Start over, either stopped or with fresh counters
+			Release();
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Stats	 = {};
+			m_Device = config.Device;
+			m_Kind	 = config.Kind;
+			m_Seed	 = config.Seed;
+			m_Random.Seed(config.Seed);
+			m_PendingOps = 0.0;
+			m_Enabled	 = enabled;
+			if(!enabled)
+				return;
+		}
+
+		// A backlog of more than 100 ms is dropped, the device is slower than the requested rate
+		m_PendingOps = std::min(m_PendingOps + config.OpsPerSecond * dtSeconds, std::max(config.OpsPerSecond * 0.1, 1.0));
+		for(; m_PendingOps >= 1.0; m_PendingOps -= 1.0)
+		{
+			double band		  = std::max(static_cast<double>(config.TargetBytes) * 0.1, static_cast<double>(config.MaxSizeBytes));
+			double error	  = (static_cast<double>(config.TargetBytes) - static_cast<double>(m_AllocatedBytes)) / band;
+			double allocShare = 0.5 + 0.5 * std::min(std::max(error, -1.0), 1.0);
+			if(m_Resources.empty() || m_Random.NextUnit() < allocShare)
+				Allocate(config);
+			else
+				Free(static_cast<size_t>(m_Random.Next() % m_Resources.size()));
+		}
+	}
+
+	// Destroy all churn resources, only valid while the thread is not running
+	void Release()
+	{
+		while(!m_Resources.empty())
+		{
+			Free(m_Resources.size() - 1);
+		}
+	}
+
+private:
+	struct Resource
+	{
+		EvictionHelperResource Handle;
+		uint64_t			   SizeBytes;
+	};
+
+	void Run()
+	{
+		auto last = std::chrono::steady_clock::now();
+		while(true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_WakeCondition.wait_for(lock, std::chrono::milliseconds(1), [this] { return m_StopRequested; });
+				if(m_StopRequested)
+					return;
+			}
+
+			auto now = std::chrono::steady_clock::now();
+			Advance(std::chrono::duration<double>(now - last).count());
+			last = now;
+		}
+	}
+
+	void Allocate(const EvictionHelperChurnConfig& config)
+	{
+		uint64_t sizeBytes = SampleSize(config);
+
+		auto				   start	= std::chrono::steady_clock::now();
+		EvictionHelperResource resource = m_Device->CreateResource(m_Kind, sizeBytes, config.Priority);
+		uint64_t			   ns		= static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if(!resource)
+		{
+			m_Stats.FailedAllocCount++;
+			return;
+		}
+		m_Resources.push_back({ resource, sizeBytes });
+		m_AllocatedBytes += sizeBytes;
+		m_Stats.AllocatedBytes = m_AllocatedBytes;
+		m_Stats.ResourceCount  = static_cast<uint32_t>(m_Resources.size());
+		m_Stats.AllocCount++;
+		m_Stats.AllocMaxNs = std::max(m_Stats.AllocMaxNs, ns);
+		m_Stats.AllocLatencyHistogram[EvictionHelper_GetLatencyBucket(ns)]++;
+	}
+
+	// Swap-remove, so resources are freed in random order
+	void Free(size_t index)
+	{
+		Resource resource  = m_Resources[index];
+		m_Resources[index] = m_Resources.back();
+		m_Resources.pop_back();
+
+		auto start = std::chrono::steady_clock::now();
+		m_Device->DestroyResource(resource.Handle);
+		uint64_t ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_AllocatedBytes -= resource.SizeBytes;
+		m_Stats.AllocatedBytes = m_AllocatedBytes;
+		m_Stats.ResourceCount  = static_cast<uint32_t>(m_Resources.size());
+		m_Stats.FreeCount++;
+		m_Stats.FreeMaxNs = std::max(m_Stats.FreeMaxNs, ns);
+		m_Stats.FreeLatencyHistogram[EvictionHelper_GetLatencyBucket(ns)]++;
+	}
+
+	uint64_t SampleSize(const EvictionHelperChurnConfig& config)
+	{
+		double minSize = static_cast<double>(std::max<uint64_t>(config.MinSizeBytes, 1));
+		double maxSize = std::max(static_cast<double>(config.MaxSizeBytes), minSize);
+		double size	   = minSize;
+		switch(config.Distribution)
+		{
+		case EVICTION_HELPER_CHURN_BIMODAL:
+			// Within a factor of two above the minimum or below the maximum
+			if(m_Random.NextUnit() * 100.0 < config.LargePercent)
+				size = LogUniform(std::max(maxSize * 0.5, minSize), maxSize);
+			else
+				size = LogUniform(minSize, std::min(minSize * 2.0, maxSize));
+			break;
+		case EVICTION_HELPER_CHURN_HISTOGRAM:
+			if(!m_ActiveBins.empty())
+			{
+				double pick = m_Random.NextUnit() * m_TotalWeight;
+				size		= static_cast<double>(m_ActiveBins.back().SizeBytes);
+				for(const EvictionHelperChurnBin& bin : m_ActiveBins)
+				{
+					if(pick < bin.Weight)
+					{
+						size = static_cast<double>(bin.SizeBytes);
+						break;
+					}
+					pick -= bin.Weight;
+				}
+			}
+			break;
+		case EVICTION_HELPER_CHURN_LOG_UNIFORM:
+		default:
+			size = LogUniform(minSize, maxSize);
+			break;
+		}
+
+		uint64_t alignment = std::max<uint64_t>(config.SizeAlignment, 1);
+		uint64_t sizeBytes = (static_cast<uint64_t>(size) + alignment - 1) / alignment * alignment;
+		return std::max(sizeBytes, alignment);
+	}
+
+	double LogUniform(double minValue, double maxValue)
+	{
+		return std::exp(std::log(minValue) + m_Random.NextUnit() * (std::log(maxValue) - std::log(minValue)));
+	}
+
+	// Shared with the owner, guarded by m_Mutex
+	mutable std::mutex					m_Mutex;
+	std::condition_variable				m_WakeCondition;
+	EvictionHelperChurnConfig			m_Config;
+	EvictionHelperChurnStats			m_Stats;
+	std::vector<EvictionHelperChurnBin> m_Bins;
+	bool								m_BinsChanged	= false;
+	bool								m_StopRequested = false;
+
+	// Only used by the thread running the operations
+	std::vector<Resource>				m_Resources;
+	std::vector<EvictionHelperChurnBin> m_ActiveBins;
+	EvictionHelperRandom				m_Random;
+	double								m_TotalWeight	 = 0.0;
+	EvictionHelperDevice*				m_Device		 = nullptr;
+	uint32_t							m_Kind			 = 0;
+	uint32_t							m_Seed			 = 0;
+	uint64_t							m_AllocatedBytes = 0;
+	double								m_PendingOps	 = 0.0;
+	bool								m_Enabled		 = false;
+
+	std::thread m_Thread;
+};
@@ -0,0 +1,1265 @@
+#include "eviction_helper_core.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+static_assert(EVICTION_HELPER_POOL_KIND_RENDER_TARGET == EVICTION_HELPER_RESOURCE_RENDER_TARGET && EVICTION_HELPER_POOL_KIND_HEAP == EVICTION_HELPER_RESOURCE_HEAP &&
+				  EVICTION_HELPER_POOL_KIND_HOST_MEMORY == EVICTION_HELPER_RESOURCE_HOST_MEMORY,
+			  "Pool kinds are passed to the devices as resource kinds");
+
+// Share of each touched resource that is written, TouchCoveragePercent clamped to [1, 100]
+static float GetTouchCoverage(uint32_t percent)
+{
+	return std::min(std::max(percent, 1u), 100u) / 100.0f;
+}
+
+// Advance a ramp towards targetMB with rates in MB per second and return the new position in bytes
+static uint64_t AdvanceRamp(RampLimiter* ramp, int targetMB, float upMBPerSecond, float downMBPerSecond, double dtSeconds)
+{
+	uint64_t targetBytes		= static_cast<uint64_t>(std::max(targetMB, 0)) * 1024ULL * 1024ULL;
+	double	 upBytesPerSecond	= std::max(upMBPerSecond, 0.0f) * 1024.0 * 1024.0;
+	double	 downBytesPerSecond = std::max(downMBPerSecond, 0.0f) * 1024.0 * 1024.0;
+	return ramp->Update(targetBytes, upBytesPerSecond, downBytesPerSecond, dtSeconds);
+}
+
+EvictionHelperCore::EvictionHelperCore(EvictionHelperSharedMemory* sharedMem, EvictionHelperDevice* vramDevice, EvictionHelperHostDevice* hostDevice, bool asyncAllocations)
+	: m_SharedMem(sharedMem)
+	, m_Data(sharedMem->pData)
+	, m_HostMemoryDevice(hostDevice)
+	, m_VRAMRecordingDevice(vramDevice)
+	, m_HostRecordingDevice(hostDevice)
+	, m_VRAMDevice(&m_VRAMRecordingDevice)
+	, m_HostDevice(&m_HostRecordingDevice)
+	, m_VRAMReleaseQueue(m_VRAMDevice)
+	, m_HostReleaseQueue(m_HostDevice)
+	, m_ActivePool(m_VRAMDevice, EVICTION_HELPER_RESOURCE_RENDER_TARGET, RT_SIZE, EVICTION_HELPER_DEFAULT_ACTIVE)
+	, m_UnusedPool(m_VRAMDevice, EVICTION_HELPER_RESOURCE_RENDER_TARGET, RT_SIZE, EVICTION_HELPER_DEFAULT_UNUSED)
+	, m_HostPool(m_HostDevice, EVICTION_HELPER_RESOURCE_HOST_MEMORY, HOST_MEMORY_CHUNK_SIZE, EVICTION_HELPER_DEFAULT_ACTIVE)
+	, m_UnusedHostPool(m_HostDevice, EVICTION_HELPER_RESOURCE_HOST_MEMORY, HOST_MEMORY_CHUNK_SIZE, EVICTION_HELPER_DEFAULT_UNUSED)
+	, m_MemoryInfoProvider(vramDevice)
+	, m_ActiveTouchPattern(EVICTION_HELPER_POOL_ACTIVE)
+	, m_HostTouchPattern(EVICTION_HELPER_POOL_HOST_ACTIVE)
+{
+	// Named pools start as empty render target pools and take their layout from the descriptor on the first update
+	for(uint32_t i = 0; i < EVICTION_HELPER_MAX_NAMED_POOLS; i++)
+	{
+		m_NamedPools.push_back(std::make_unique<EvictionHelperPool>(m_VRAMDevice, EVICTION_HELPER_RESOURCE_RENDER_TARGET, RT_SIZE, EVICTION_HELPER_PRIORITY_NORMAL));
+		m_NamedTouchPatterns[i].Reset(EVICTION_HELPER_POOL_NAMED(i));
+	}
+
+	for(uint32_t i = 0; i < EVICTION_HELPER_MAX_HEAPS; i++)
+	{
+		m_HeapTablePools.push_back(std::make_unique<EvictionHelperPool>(m_VRAMDevice, EVICTION_HELPER_RESOURCE_HEAP, HEAP_TABLE_INITIAL_SIZE, EVICTION_HELPER_PRIORITY_NORMAL));
+	}
+	m_HeapTableOffsets.resize(EVICTION_HELPER_MAX_HEAPS, 0);
+	m_HeapTablePlacedBytes.resize(EVICTION_HELPER_MAX_HEAPS, 0);
+
+	// Budget changes are published even without asyncAllocations, the watcher only reads
+	m_BudgetWatcher.Start(m_VRAMDevice, m_SharedMem);
+
+	if(asyncAllocations)
+	{
+		m_Worker.Start(&EvictionHelperCore::OnAllocationWorkerIdle, this);
+		m_Churn.Start();
+		m_TraceReplay.Start();
+	}
+}
+
+EvictionHelperCore::~EvictionHelperCore()
+{
+	Shutdown();
+}
+
+void EvictionHelperCore::InitializeDefaults()
+{
+	m_Data->ActiveVRAMPriority		 = EVICTION_HELPER_DEFAULT_ACTIVE;
+	m_Data->UnusedVRAMPriority		 = EVICTION_HELPER_DEFAULT_UNUSED;
+	m_Data->HostMemoryPriority		 = EVICTION_HELPER_DEFAULT_ACTIVE;
+	m_Data->UnusedHostMemoryPriority = EVICTION_HELPER_DEFAULT_UNUSED;
+	m_Data->BudgetControlPercent	 = 95;
+	m_Data->BudgetControlHeadroomMB	 = 512;
+	m_Data->ReleaseBudgetMBPerFrame	 = 256;
+	m_Data->TouchPercent			 = 100;
+	m_Data->TouchCoveragePercent	 = 100;
+	m_Data->TraceReplaySpeed		 = 1.0f;
+	m_Data->FrameSpinTailUs			 = 200;
+
+	for(EvictionHelperPoolDesc& desc : m_Data->NamedPools)
+	{
+		desc.Priority			  = EVICTION_HELPER_PRIORITY_NORMAL;
+		desc.TouchPercent		  = 100;
+		desc.TouchCoveragePercent = 100;
+	}
+
+	for(EvictionHelperHeapDesc& desc : m_Data->Heaps)
+	{
+		desc.Priority = EVICTION_HELPER_PRIORITY_NORMAL;
+	}
+}
+
+// Drain all commands that are due, in order
+// Each command is applied to the allocations before the next one is read so fast sequences are not collapsed
+void EvictionHelperCore::ProcessCommands()
+{
+	// Scenario steps on the monotonic clock take effect when they are due, not with the next frame
+	if(m_ScenarioRunning && m_ScenarioClock == EVICTION_HELPER_SCENARIO_CLOCK_MONOTONIC && ApplyScenario())
+	{
+		UpdateAllocations();
+	}
+
+	EvictionHelperCommand command;
+	uint64_t			  now = EvictionHelper_GetTimestampNs();
+	while(EvictionHelper_PeekCommand(m_Data, &command))
+	{
+		if(command.ExecuteAtNs > now)
+			break;
+
+		// A barrier completes once everything requested before it has been allocated or released
+		if(command.Type == EVICTION_HELPER_COMMAND_BARRIER)
+		{
+			UpdateAllocations();
+			if(!IsAllocationIdle() || !PollResidencyOp())
+				break;
+		}
+
+		// Residency commands wait for the previous one to finish paging
+		if((command.Type == EVICTION_HELPER_COMMAND_EVICT || command.Type == EVICTION_HELPER_COMMAND_MAKE_RESIDENT) && !PollResidencyOp())
+			break;
+
+		ApplyCommand(command);
+		if(command.Type != EVICTION_HELPER_COMMAND_BARRIER)
+		{
+			UpdateAllocations();
+		}
+		EvictionHelper_CompleteCommand(m_Data, &command);
+	}
+}
+
+void EvictionHelperCore::UpdateAllocations()
+{
+	CollectAllocationResults();
+
+	// Targets without a ramp rate take effect right away, ramps only move in BeginFrame()
+	AdvanceRamps(0.0);
+
+	// Apply priority changes first so new resources are requested with the current priority
+	int previousUnusedPriority = m_UnusedPool.GetPriority();
+	m_ActivePool.SetPriority(m_Data->ActiveVRAMPriority);
+	m_UnusedPool.SetPriority(m_Data->UnusedVRAMPriority);
+	if(m_UnusedPool.GetPriority() != previousUnusedPriority)
+	{
+		EvictionHelperResource heaps[2];
+		uint32_t			   heapCount = 0;
+		if(m_Heap512MB)
+			heaps[heapCount++] = m_Heap512MB;
+		if(m_Heap1GB)
+			heaps[heapCount++] = m_Heap1GB;
+		m_VRAMDevice->SetResidencyPriorities(heaps, heapCount, m_UnusedPool.GetPriority());
+	}
+
+	// Update VRAM allocations to the current ramp positions
+	m_VRAMDevice->SetPlacementHeapSize(static_cast<uint64_t>(m_Data->PlacementHeapMB) * 1024ULL * 1024ULL);
+	m_ActivePool.Update(&m_Worker, &m_VRAMReleaseQueue, m_Ramps[EVICTION_HELPER_POOL_ACTIVE].GetPositionBytes());
+	m_UnusedPool.Update(&m_Worker, &m_VRAMReleaseQueue, m_Ramps[EVICTION_HELPER_POOL_UNUSED].GetPositionBytes());
+	UpdateHostMemoryPools();
+	UpdateNamedPools();
+	UpdateHeapTable();
+
+	if(m_Worker.IsRunning())
+	{
+		m_Worker.Kick();
+	}
+	else
+	{
+		m_Worker.ExecutePending();
+		CollectAllocationResults();
+	}
+
+	// Handle heap allocation based on shared memory flags
+	UpdateHeap(&m_Heap512MB, m_Data->Allocate512MBHeap != 0, HEAP_512MB_SIZE);
+	UpdateHeap(&m_Heap1GB, m_Data->Allocate1GBHeap != 0, HEAP_1GB_SIZE);
+
+	UpdateHeapFragmentation();
+	PublishAllocationState();
+}
+
+bool EvictionHelperCore::IsAllocationIdle() const
+{
+	for(const RampLimiter& ramp : m_Ramps)
+	{
+		if(!ramp.IsAtTarget())
+			return false;
+	}
+
+	uint64_t pendingBytes = m_ActivePool.GetPendingBytes() + m_UnusedPool.GetPendingBytes() + m_HostPool.GetPendingBytes() + m_UnusedHostPool.GetPendingBytes();
+	for(uint32_t i = 0; i < EVICTION_HELPER_MAX_NAMED_POOLS; i++)
+	{
+		if(!m_NamedRamps[i].IsAtTarget() || !IsNamedPoolLayoutCurrent(i))
+			return false;
+		pendingBytes += m_NamedPools[i]->GetPendingBytes();
+	}
+	for(uint32_t i = 0; i < EVICTION_HELPER_MAX_HEAPS; i++)
+	{
+		if(!IsHeapTableLayoutCurrent(i))
+			return false;
+		pendingBytes += m_HeapTablePools[i]->GetPendingBytes();
+	}
+	return pendingBytes == 0 && m_Worker.GetPendingReleaseBytes() == 0 && m_VRAMReleaseQueue.IsEmpty() && m_HostReleaseQueue.IsEmpty();
+}
+
+void EvictionHelperCore::BeginFrame(uint64_t frameTimeNs)
+{
+	QueryMemoryInfo();
+	UpdateMemorySampler();
+
+	// The scenario writes its targets first, the budget controller overrides the target of its pool
+	UpdateScenario(frameTimeNs);
+
+	// Let the budget controller adjust its pool target before allocations are updated
+	UpdateBudgetControl(frameTimeNs / 1000000000.0);
+
+	// Move the pool sizes towards the (possibly just changed) targets
+	AdvanceRamps(frameTimeNs / 1000000000.0);
+
+	UpdateChurn(frameTimeNs / 1000000000.0);
+	UpdateTraceReplay(frameTimeNs / 1000000000.0);
+	UpdateTraceRecording();
+
+	// Destroy a bounded amount of released memory per frame, the worker is kicked by UpdateAllocations()
+	// Nothing is destroyed while a residency fence is pending, released resources may still be part of it
+	if(PollResidencyOp())
+		RetireReleases();
+
+	// Pick up inputs changed without a signal (e.g. from the UI)
+	UpdateAllocations();
+}
+
+void EvictionHelperCore::TouchActiveMemory()
+{
+	EvictionHelperSharedData* data = m_Data;
+
+	// Each pool gets its own stream from the seed, so all patterns are reproducible
+	if(data->TouchSeed != m_TouchSeed)
+	{
+		m_TouchSeed = data->TouchSeed;
+		m_ActiveTouchPattern.Reset((static_cast<uint64_t>(m_TouchSeed) << 8) | EVICTION_HELPER_POOL_ACTIVE);
+		m_HostTouchPattern.Reset((static_cast<uint64_t>(m_TouchSeed) << 8) | EVICTION_HELPER_POOL_HOST_ACTIVE);
+		for(uint32_t i = 0; i < EVICTION_HELPER_MAX_NAMED_POOLS; i++)
+		{
+			m_NamedTouchPatterns[i].Reset((static_cast<uint64_t>(m_TouchSeed) << 8) | EVICTION_HELPER_POOL_NAMED(i));
+		}
+	}
+	float coverage = GetTouchCoverage(data->TouchCoveragePercent);
+
+	m_VRAMDevice->BeginFrame(data->FrameCount);
+	m_ActiveTouchPattern.Generate(data->TouchPattern, m_ActivePool.GetTouchableCount(), data->TouchPercent, data->TouchZipfExponent, &m_TouchIndices);
+	data->TouchedVRAMBytesLastFrame = m_ActivePool.Touch(m_TouchIndices, data->FrameCount, coverage);
+	TouchNamedPools(m_VRAMDevice);
+	m_VRAMDevice->EndFrame();
+
+	m_HostDevice->BeginFrame(data->FrameCount);
+	m_HostTouchPattern.Generate(data->TouchPattern, m_HostPool.GetTouchableCount(), data->TouchPercent, data->TouchZipfExponent, &m_TouchIndices);
+	data->TouchedHostBytesLastFrame = m_HostPool.Touch(m_TouchIndices, data->FrameCount, coverage);
+	TouchNamedPools(m_HostDevice);
+	m_HostDevice->EndFrame();
+
+	ScanHostMemoryResidency();
+}
+
+void EvictionHelperCore::EndFrame(uint64_t frameTimeNs)
+{
+	// Resources released from now on wait for this frame's work
+	m_VRAMReleaseQueue.SignalFrame();
+	m_HostReleaseQueue.SignalFrame();
+
+	// Increment frame counter for external monitoring
+	m_Data->FrameCount++;
+
+	// Publish a consistent copy of this frame's output fields and append it to the history
+	PublishSnapshot();
+	RecordTelemetry(frameTimeNs);
+}
+
+uint64_t EvictionHelperCore::GetNextCommandTimeNs() const
+{
+	uint64_t			  nextNs = GetNextScenarioTimeNs();
+	EvictionHelperCommand command;
+
+	// A head command that is already due (or ASAP, 0) is blocked behind allocations or a residency operation, which
+	// make progress with the frames and the worker's wake signal. Only a future execute time is a time to wake at.
+	if(EvictionHelper_PeekCommand(m_Data, &command) && command.ExecuteAtNs > EvictionHelper_GetTimestampNs() && (nextNs == 0 || command.ExecuteAtNs < nextNs))
+		nextNs = command.ExecuteAtNs;
+	return nextNs;
+}
+
+void EvictionHelperCore::Shutdown()
+{
+	// The trace ends with the resources that were alive while the helper was running, not with their release
+	StopTraceRecording();
+
+	m_MemorySampler.Stop();
+	m_BudgetWatcher.Stop();
+
+	// Resources created before the worker stopped are still handed to the pools so they get released
+	m_Worker.Stop();
+	CollectAllocationResults();
+	m_Churn.Stop();
+	m_Churn.Release();
+	m_TraceReplay.Stop();
+	m_TraceReplay.Release();
+
+	while(!PollResidencyOp())
+	{
+		std::this_thread::yield();
+	}
+
+	UpdateHeap(&m_Heap512MB, false, HEAP_512MB_SIZE);
+	UpdateHeap(&m_Heap1GB, false, HEAP_1GB_SIZE);
+	m_VRAMReleaseQueue.Flush();
+	m_HostReleaseQueue.Flush();
+	m_ActivePool.Release();
+	m_UnusedPool.Release();
+	m_HostPool.Release();
+	m_UnusedHostPool.Release();
+	for(std::unique_ptr<EvictionHelperPool>& pool : m_NamedPools)
+	{
+		pool->Release();
+	}
+	for(std::unique_ptr<EvictionHelperPool>& pool : m_HeapTablePools)
+	{
+		pool->Release();
+	}
+}
+
+// Called on the worker thread, wakes the frame loop so it picks up the results and completes waiting barriers
+void EvictionHelperCore::OnAllocationWorkerIdle(void* context)
+{
+	EvictionHelper_SignalHelper(static_cast<EvictionHelperCore*>(context)->m_SharedMem);
+}
+
+void EvictionHelperCore::CollectAllocationResults()
+{
+	EvictionHelperAllocationResult result;
+	while(m_Worker.PopResult(&result))
+	{
+		result.Pool->OnAllocationResult(result);
+	}
+}
+
+void EvictionHelperCore::PublishAllocationState()
+{
+	m_Data->CurrentVRAMAllocationBytes			   = m_ActivePool.GetAllocatedBytes();
+	m_Data->AllocatedRenderTargetCount			   = m_ActivePool.GetResourceCount();
+	m_Data->CurrentUnusedVRAMAllocationBytes	   = m_UnusedPool.GetAllocatedBytes();
+	m_Data->AllocatedUnusedRenderTargetCount	   = m_UnusedPool.GetResourceCount();
+	m_Data->CurrentHeapAllocationBytes			   = (m_Heap512MB ? HEAP_512MB_SIZE : 0) + (m_Heap1GB ? HEAP_1GB_SIZE : 0);
+	m_Data->CurrentHostMemoryAllocationBytes	   = m_HostPool.GetAllocatedBytes();
+	m_Data->AllocatedHostMemoryChunkCount		   = m_HostPool.GetResourceCount();
+	m_Data->CurrentUnusedHostMemoryAllocationBytes = m_UnusedHostPool.GetAllocatedBytes();
+	m_Data->AllocatedUnusedHostMemoryChunkCount	   = m_UnusedHostPool.GetResourceCount();
+
+	m_Data->AllocationPendingBytes = m_ActivePool.GetPendingBytes() + m_UnusedPool.GetPendingBytes() + m_HostPool.GetPendingBytes() + m_UnusedHostPool.GetPendingBytes();
+	m_Data->AllocationReadyBytes   = m_ActivePool.GetAllocatedBytes() + m_UnusedPool.GetAllocatedBytes() + m_HostPool.GetAllocatedBytes() + m_UnusedHostPool.GetAllocatedBytes();
+	m_Data->ReleasePendingBytes	   = m_Worker.GetPendingReleaseBytes() + m_VRAMReleaseQueue.GetPendingBytes() + m_HostReleaseQueue.GetPendingBytes();
+	m_Data->ReleaseDeferredBytes   = m_VRAMReleaseQueue.GetPendingBytes() + m_HostReleaseQueue.GetPendingBytes();
+
+	for(uint32_t i = 0; i < EVICTION_HELPER_POOL_COUNT; i++)
+	{
+		m_Data->EvictedPoolBytes[i] = GetPool(i)->GetEvictedBytes();
+	}
+
+	for(uint32_t i = 0; i < EVICTION_HELPER_MAX_NAMED_POOLS; i++)
+	{
+		EvictionHelperPoolDesc&	  desc = m_Data->NamedPools[i];
+		const EvictionHelperPool& pool = *m_NamedPools[i];
+		desc.AllocatedBytes			   = pool.GetAllocatedBytes();
+		desc.PendingBytes			   = pool.GetPendingBytes();
+		desc.EvictedBytes			   = pool.GetEvictedBytes();
+		desc.ChunkSizeBytes			   = pool.GetChunkSize();
+		desc.ResourceCount			   = pool.GetResourceCount();
+		desc.OutOfMemory			   = pool.IsOutOfMemory() ? 1 : 0;
+
+		m_Data->AllocationPendingBytes += desc.PendingBytes;
+		m_Data->AllocationReadyBytes += desc.AllocatedBytes;
+	}
+
+	m_Data->HeapTableAllocatedBytes = 0;
+	m_Data->HeapTablePendingBytes	= 0;
+	m_Data->HeapTableMaxCreationNs	= 0;
+	for(uint32_t i = 0; i < EVICTION_HELPER_MAX_HEAPS; i++)
+	{
+		EvictionHelperHeapDesc&	  desc	  = m_Data->Heaps[i];
+		const EvictionHelperPool& pool	  = *m_HeapTablePools[i];
+		bool					  created = pool.GetResourceCount() > 0;
+		desc.AllocatedBytes				  = pool.GetAllocatedBytes();
+		desc.CreationNs					  = created ? pool.GetLastCreateNs() : 0;
+		desc.ModelOffset				  = m_HeapTableOffsets[i];
+		desc.OutOfMemory				  = pool.IsOutOfMemory() ? 1 : 0;
+
+		m_Data->HeapTableAllocatedBytes += desc.AllocatedBytes;
+		m_Data->HeapTablePendingBytes += pool.GetPendingBytes();
+		m_Data->HeapTableMaxCreationNs = std::max(m_Data->HeapTableMaxCreationNs, desc.CreationNs);
+	}
+	m_Data->AllocationPendingBytes += m_Data->HeapTablePendingBytes;
+	m_Data->AllocationReadyBytes += m_Data->HeapTableAllocatedBytes;
+
+	EvictionHelperHeapFragmentation& fragmentation = m_Data->HeapFragmentation;
+	fragmentation.AllocatedBytes				   = m_HeapFragmentation.GetAllocatedBytes();
+	fragmentation.FreeBytes						   = m_HeapFragmentation.GetFreeBytes();
+	fragmentation.LargestFreeBlock				   = m_HeapFragmentation.GetLargestFreeBlock();
+	fragmentation.SpanBytes						   = m_HeapFragmentation.GetSpanBytes();
+	fragmentation.HeapCount						   = m_HeapFragmentation.GetBlockCount();
+	fragmentation.FreeBlockCount				   = m_HeapFragmentation.GetFreeBlockCount();
+	fragmentation.FragmentationPercent			   = static_cast<float>(m_HeapFragmentation.GetFragmentation() * 100.0);
+}
+
+void EvictionHelperCore::QueryMemoryInfo()
+{
+	EvictionHelperMemoryInfo localInfo	  = {};
+	EvictionHelperMemoryInfo nonLocalInfo = {};
+	uint64_t				 queryNs	  = EvictionHelper_GetTimestampNs();
+	m_VRAMDevice->QueryMemoryInfo(&localInfo, &nonLocalInfo);
+
+	// Update shared memory with local (VRAM) info
+	m_Data->LocalBudget					 = localInfo.Budget;
+	m_Data->LocalCurrentUsage			 = localInfo.CurrentUsage;
+	m_Data->LocalAvailableForReservation = localInfo.AvailableForReservation;
+	m_Data->LocalCurrentReservation		 = localInfo.CurrentReservation;
+
+	// Update shared memory with non-local (system) info
+	m_Data->NonLocalBudget					= nonLocalInfo.Budget;
+	m_Data->NonLocalCurrentUsage			= nonLocalInfo.CurrentUsage;
+	m_Data->NonLocalAvailableForReservation = nonLocalInfo.AvailableForReservation;
+	m_Data->NonLocalCurrentReservation		= nonLocalInfo.CurrentReservation;
+
+	// Budget changes the watcher has not published from a notification
+	m_BudgetWatcher.Poll(localInfo, nonLocalInfo, queryNs);
+
+	EvictionHelperBudgetWatcherStats stats;
+	m_BudgetWatcher.GetStats(&stats);
+	m_Data->BudgetWatcherState		 = m_BudgetWatcher.IsRunning() ? EVICTION_HELPER_BUDGET_WATCHER_NOTIFIED : EVICTION_HELPER_BUDGET_WATCHER_POLLING;
+	m_Data->BudgetNotificationCount	 = stats.NotificationCount;
+	m_Data->BudgetChangeLatencyMaxNs = stats.LatencyMaxNs;
+}
+
+// Start, stop or re-rate the memory sampler and publish its counters
+void EvictionHelperCore::UpdateMemorySampler()
+{
+	EvictionHelperSharedData* data	 = m_Data;
+	uint32_t				  rateHz = std::min(data->MemorySampleRateHz, static_cast<uint32_t>(EVICTION_HELPER_MEMORY_SAMPLE_MAX_RATE_HZ));
+	uint64_t				  nowNs	 = EvictionHelper_GetTimestampNs();
+
+	if(rateHz == 0)
+	{
+		m_MemorySampler.Stop();
+		data->MemorySampleAchievedHz = 0.0f;
+		return;
+	}
+
+	if(!m_MemorySampler.IsRunning())
+	{
+		m_MemorySampler.Start(&m_MemoryInfoProvider, data, rateHz);
+		m_MemorySampleWindowStartNs	   = nowNs;
+		m_MemorySampleWindowStartCount = 0;
+	}
+	m_MemorySampler.SetRate(rateHz);
+
+	EvictionHelperMemorySamplerStats stats;
+	m_MemorySampler.GetStats(&stats);
+	data->MemorySampleMaxLateNs	  = stats.MaxLateNs;
+	data->MemorySampleMaxQueryNs  = stats.MaxQueryNs;
+	data->MemorySampleMeanQueryNs = stats.SampleCount ? stats.TotalQueryNs / stats.SampleCount : 0;
+	for(uint32_t i = 0; i < EVICTION_HELPER_LATENCY_BUCKETS; i++)
+	{
+		data->MemorySampleLateHistogram[i] = stats.LateHistogram[i];
+	}
+
+	// The achieved rate is averaged over a second, a frame sees too few samples at low rates
+	uint64_t windowNs = nowNs - m_MemorySampleWindowStartNs;
+	if(windowNs >= 1000000000ULL)
+	{
+		data->MemorySampleAchievedHz   = static_cast<float>((stats.SampleCount - m_MemorySampleWindowStartCount) * 1e9 / windowNs);
+		m_MemorySampleWindowStartNs	   = nowNs;
+		m_MemorySampleWindowStartCount = stats.SampleCount;
+	}
+}
+
+// Adjust the target of the controlled pool so local usage follows the configured fraction of the budget
+void EvictionHelperCore::UpdateBudgetControl(double frameTimeSeconds)
+{
+	int mode = m_Data->BudgetControlMode;
+	int pool = (m_Data->BudgetControlPool == EVICTION_HELPER_POOL_UNUSED) ? EVICTION_HELPER_POOL_UNUSED : EVICTION_HELPER_POOL_ACTIVE;
+
+	if(mode != EVICTION_HELPER_BUDGET_CONTROL_PERCENT && mode != EVICTION_HELPER_BUDGET_CONTROL_HEADROOM)
+	{
+		m_BudgetControlMode = EVICTION_HELPER_BUDGET_CONTROL_OFF;
+		return;
+	}
+
+	int*	 targetMB	  = (pool == EVICTION_HELPER_POOL_UNUSED) ? &m_Data->TargetUnusedVRAMUsageMB : &m_Data->TargetVRAMUsageMB;
+	uint64_t currentBytes = (pool == EVICTION_HELPER_POOL_UNUSED) ? m_Data->CurrentUnusedVRAMAllocationBytes : m_Data->CurrentVRAMAllocationBytes;
+
+	// Start from the current allocation whenever control is enabled or moved to another pool
+	if(mode != m_BudgetControlMode || pool != m_BudgetControlPool)
+	{
+		m_BudgetController.Reset(static_cast<double>(currentBytes));
+		m_BudgetControlMode = mode;
+		m_BudgetControlPool = pool;
+	}
+
+	double kp = (m_Data->BudgetControlKp > 0.0f) ? m_Data->BudgetControlKp : BUDGET_CONTROL_DEFAULT_KP;
+	double ki = (m_Data->BudgetControlKi > 0.0f) ? m_Data->BudgetControlKi : BUDGET_CONTROL_DEFAULT_KI;
+	m_BudgetController.SetGains(kp, ki, BUDGET_CONTROL_DEFAULT_DEADBAND);
+
+	// Limit the time step so a stalled frame does not cause a large integral jump
+	double	 dt		  = std::min(frameTimeSeconds, 0.1);
+	uint64_t setpoint = BudgetController_ComputeSetpoint(mode, m_Data->BudgetControlPercent, m_Data->BudgetControlHeadroomMB, m_Data->LocalBudget);
+	double	 output	  = m_BudgetController.Update(static_cast<double>(setpoint), static_cast<double>(m_Data->LocalCurrentUsage), dt, 0.0, static_cast<double>(m_Data->LocalBudget));
+
+	*targetMB						   = static_cast<int>(output / (1024.0 * 1024.0));
+	m_Data->BudgetControlSetpointBytes = setpoint;
+	m_Data->BudgetControlErrorBytes	   = static_cast<int64_t>(m_BudgetController.GetErrorBytes());
+}
+
+// Advance every pool's ramp towards its shared memory target (MB -> bytes) and publish the positions
+// Named pools beyond NamedPoolCount ramp down to zero
+void EvictionHelperCore::AdvanceRamps(double dtSeconds)
+{
+	const int targetsMB[EVICTION_HELPER_POOL_COUNT] = { m_Data->TargetVRAMUsageMB, m_Data->TargetUnusedVRAMUsageMB, m_Data->TargetHostMemoryUsageMB, m_Data->TargetUnusedHostMemoryUsageMB };
+	for(int i = 0; i < EVICTION_HELPER_POOL_COUNT; i++)
+	{
+		m_Data->RampPositionBytes[i] = AdvanceRamp(&m_Ramps[i], targetsMB[i], m_Data->RampUpMBPerSecond[i], m_Data->RampDownMBPerSecond[i], dtSeconds);
+	}
+
+	for(uint32_t i = 0; i < EVICTION_HELPER_MAX_NAMED_POOLS; i++)
+	{
+		EvictionHelperPoolDesc& desc	 = m_Data->NamedPools[i];
+		int						targetMB = (i < m_Data->NamedPoolCount) ? desc.TargetMB : 0;
+		desc.RampPositionBytes			 = AdvanceRamp(&m_NamedRamps[i], targetMB, desc.RampUpMBPerSecond, desc.RampDownMBPerSecond, dtSeconds);
+	}
+}
+
+// Hand released resources whose frames have completed to the worker, limited per device by ReleaseBudgetMBPerFrame
+void EvictionHelperCore::RetireReleases()
+{
+	uint64_t budgetBytes		   = static_cast<uint64_t>(m_Data->ReleaseBudgetMBPerFrame) * 1024ULL * 1024ULL;
+	m_Data->ReleasedBytesLastFrame = m_VRAMReleaseQueue.Retire(&m_Worker, budgetBytes) + m_HostReleaseQueue.Retire(&m_Worker, budgetBytes);
+}
+
+// Create or release a heap to match its allocation flag
+void EvictionHelperCore::UpdateHeap(EvictionHelperResource* heap, bool allocate, uint64_t sizeBytes)
+{
+	if(allocate && !*heap)
+	{
+		*heap = m_VRAMDevice->CreateResource(EVICTION_HELPER_RESOURCE_HEAP, sizeBytes, m_UnusedPool.GetPriority());
+	}
+	else if(!allocate && *heap)
+	{
+		m_VRAMReleaseQueue.Push(*heap, sizeBytes);
+		*heap = 0;
+	}
+}
+
+void EvictionHelperCore::UpdateHostMemoryPools()
+{
+	// Update host memory pools to the current ramp positions
+	m_HostPool.SetPriority(m_Data->HostMemoryPriority);
+	m_UnusedHostPool.SetPriority(m_Data->UnusedHostMemoryPriority);
+	m_HostPool.Update(&m_Worker, &m_HostReleaseQueue, m_Ramps[EVICTION_HELPER_POOL_HOST_ACTIVE].GetPositionBytes());
+	m_UnusedHostPool.Update(&m_Worker, &m_HostReleaseQueue, m_Ramps[EVICTION_HELPER_POOL_HOST_UNUSED].GetPositionBytes());
+}
+
+// Update the named pools to their descriptors and ramp positions
+// A pool whose kind or chunk size changed is shrunk to zero and only takes the new layout once all its resources
+// are gone and no request for the old layout is in flight anymore
+void EvictionHelperCore::UpdateNamedPools()
+{
+	for(uint32_t i = 0; i < EVICTION_HELPER_MAX_NAMED_POOLS; i++)
+	{
+		EvictionHelperPool& pool = *m_NamedPools[i];
+		if(!IsNamedPoolLayoutCurrent(i) && pool.IsIdle())
+		{
+			EvictionHelperDevice* device;
+			uint32_t			  kind;
+			uint64_t			  chunkSize;
+			GetNamedPoolLayout(m_Data->NamedPools[i], &device, &kind, &chunkSize);
+			pool.SetLayout(device, kind, chunkSize);
+		}
+
+		uint64_t targetBytes = IsNamedPoolLayoutCurrent(i) ? m_NamedRamps[i].GetPositionBytes() : 0;
+		pool.SetPriority(m_Data->NamedPools[i].Priority);
+		pool.Update(&m_Worker, GetReleaseQueue(pool.GetDevice()), targetBytes);
+	}
+}
+
+// Touch the named pools that live on a device, each with its own pattern
+// Heap pools cannot be touched
+void EvictionHelperCore::TouchNamedPools(EvictionHelperDevice* device)
+{
+	EvictionHelperSharedData* data = m_Data;
+	for(uint32_t i = 0; i < EVICTION_HELPER_MAX_NAMED_POOLS; i++)
+	{
+		EvictionHelperPoolDesc& desc = data->NamedPools[i];
+		EvictionHelperPool&		pool = *m_NamedPools[i];
+		if(pool.GetDevice() != device)
+			continue;
+
+		desc.TouchedBytesLastFrame = 0;
+		if(pool.GetKind() == EVICTION_HELPER_RESOURCE_HEAP)
+			continue;
+
+		m_NamedTouchPatterns[i].Generate(desc.TouchPattern, pool.GetTouchableCount(), desc.TouchPercent, data->TouchZipfExponent, &m_TouchIndices);
+		desc.TouchedBytesLastFrame = pool.Touch(m_TouchIndices, data->FrameCount, GetTouchCoverage(desc.TouchCoveragePercent));
+	}
+}
+
+// Device, resource kind and chunk size a named pool descriptor asks for
+// Render targets are whole rows of RT_WIDTH up to RT_MAX_SIZE, heaps and host memory are 64 KB aligned
+void EvictionHelperCore::GetNamedPoolLayout(const EvictionHelperPoolDesc& desc, EvictionHelperDevice** outDevice, uint32_t* outKind, uint64_t* outChunkSize) const
+{
+	const uint64_t rowSize	 = static_cast<uint64_t>(RT_WIDTH) * 4;
+	const uint64_t alignment = 64ULL * 1024ULL;
+	uint64_t	   chunkSize = static_cast<uint64_t>(desc.ChunkSizeKB) * 1024ULL;
+
+	switch(desc.Kind)
+	{
+	case EVICTION_HELPER_POOL_KIND_HEAP:
+		*outDevice	  = m_VRAMDevice;
+		*outKind	  = EVICTION_HELPER_RESOURCE_HEAP;
+		*outChunkSize = chunkSize ? (chunkSize + alignment - 1) / alignment * alignment : NAMED_POOL_DEFAULT_HEAP_SIZE;
+		break;
+	case EVICTION_HELPER_POOL_KIND_HOST_MEMORY:
+		*outDevice	  = m_HostDevice;
+		*outKind	  = EVICTION_HELPER_RESOURCE_HOST_MEMORY;
+		*outChunkSize = chunkSize ? (chunkSize + alignment - 1) / alignment * alignment : HOST_MEMORY_CHUNK_SIZE;
+		break;
+	case EVICTION_HELPER_POOL_KIND_RENDER_TARGET:
+	default:
+		*outDevice	  = m_VRAMDevice;
+		*outKind	  = EVICTION_HELPER_RESOURCE_RENDER_TARGET;
+		*outChunkSize = chunkSize ? std::min((chunkSize + rowSize - 1) / rowSize * rowSize, RT_MAX_SIZE) : RT_SIZE;
+		break;
+	}
+}
+
+bool EvictionHelperCore::IsNamedPoolLayoutCurrent(uint32_t index) const
+{
+	EvictionHelperDevice* device;
+	uint32_t			  kind;
+	uint64_t			  chunkSize;
+	GetNamedPoolLayout(m_Data->NamedPools[index], &device, &kind, &chunkSize);
+
+	const EvictionHelperPool& pool = *m_NamedPools[index];
+	return pool.GetDevice() == device && pool.GetKind() == kind && pool.GetChunkSize() == chunkSize;
+}
+
+EvictionHelperDeferredReleaseQueue* EvictionHelperCore::GetReleaseQueue(EvictionHelperDevice* device)
+{
+	return (device == m_HostDevice) ? &m_HostReleaseQueue : &m_VRAMReleaseQueue;
+}
+
+// Create, destroy and reprioritize the heaps of the heap table
+// Each heap is a pool of one resource, so it is created on the allocation worker and destroyed once the GPU is done
+// with it like any other pool resource. A heap whose size or type changed is destroyed before the new one is requested.
+void EvictionHelperCore::UpdateHeapTable()
+{
+	for(uint32_t i = 0; i < EVICTION_HELPER_MAX_HEAPS; i++)
+	{
+		EvictionHelperPool& pool = *m_HeapTablePools[i];
+		uint32_t			kind;
+		uint64_t			sizeBytes;
+		GetHeapTableLayout(i, &kind, &sizeBytes);
+
+		if(!IsHeapTableLayoutCurrent(i) && pool.IsIdle())
+		{
+			pool.SetLayout(m_VRAMDevice, kind, sizeBytes);
+		}
+
+		pool.SetPriority(m_Data->Heaps[i].Priority);
+		pool.Update(&m_Worker, &m_VRAMReleaseQueue, IsHeapTableLayoutCurrent(i) ? sizeBytes : 0);
+	}
+}
+
+// Place newly created heaps into the fragmentation model and remove released ones, in the order the pools saw them
+void EvictionHelperCore::UpdateHeapFragmentation()
+{
+	for(uint32_t i = 0; i < EVICTION_HELPER_MAX_HEAPS; i++)
+	{
+		const EvictionHelperPool& pool	  = *m_HeapTablePools[i];
+		bool					  created = pool.GetResourceCount() > 0;
+		if(created && m_HeapTablePlacedBytes[i] == 0)
+		{
+			m_HeapTablePlacedBytes[i] = pool.GetChunkSize();
+			m_HeapTableOffsets[i]	  = m_HeapFragmentation.Allocate(m_HeapTablePlacedBytes[i]);
+		}
+		else if(!created && m_HeapTablePlacedBytes[i] != 0)
+		{
+			m_HeapFragmentation.Free(m_HeapTableOffsets[i], m_HeapTablePlacedBytes[i]);
+			m_HeapTablePlacedBytes[i] = 0;
+			m_HeapTableOffsets[i]	  = 0;
+		}
+	}
+}
+
+// Resource kind and size a heap table entry asks for, size 0 for entries beyond HeapCount
+void EvictionHelperCore::GetHeapTableLayout(uint32_t index, uint32_t* outKind, uint64_t* outSizeBytes) const
+{
+	const EvictionHelperHeapDesc& desc = m_Data->Heaps[index];
+	*outKind						   = (desc.Type == EVICTION_HELPER_HEAP_TYPE_BUFFERS) ? EVICTION_HELPER_RESOURCE_BUFFER_HEAP : EVICTION_HELPER_RESOURCE_HEAP;
+	*outSizeBytes					   = (index < m_Data->HeapCount) ? static_cast<uint64_t>(desc.SizeMB) * 1024ULL * 1024ULL : 0;
+}
+
+// A heap that is not wanted keeps its layout, there is nothing to change until a size is set again
+bool EvictionHelperCore::IsHeapTableLayoutCurrent(uint32_t index) const
+{
+	uint32_t kind;
+	uint64_t sizeBytes;
+	GetHeapTableLayout(index, &kind, &sizeBytes);
+
+	const EvictionHelperPool& pool = *m_HeapTablePools[index];
+	return sizeBytes == 0 || (pool.GetKind() == kind && pool.GetChunkSize() == sizeBytes);
+}
+
+// Pass the churn inputs to the churn workload and publish its counters
+// Without the churn thread the operations of this frame run here, paced by the frame time
+void EvictionHelperCore::UpdateChurn(double frameTimeSeconds)
+{
+	EvictionHelperSharedData* data = m_Data;
+
+	// The histogram file is read on the frame thread whenever the path changes
+	data->ChurnHistogramPath[sizeof(data->ChurnHistogramPath) - 1] = '\0';
+	if(m_ChurnHistogramPath != data->ChurnHistogramPath)
+	{
+		m_ChurnHistogramPath = data->ChurnHistogramPath;
+		std::vector<EvictionHelperChurnBin> bins;
+		EvictionHelperChurn_LoadHistogram(m_ChurnHistogramPath.c_str(), &bins);
+		data->ChurnHistogramBinCount = static_cast<uint32_t>(bins.size());
+		m_Churn.SetHistogram(bins);
+	}
+
+	// Render targets are whole rows, heaps and host memory 64 KB aligned
+	EvictionHelperChurnConfig config = {};
+	switch(data->ChurnKind)
+	{
+	case EVICTION_HELPER_POOL_KIND_HEAP:
+		config.Device		 = m_VRAMDevice;
+		config.Kind			 = EVICTION_HELPER_RESOURCE_HEAP;
+		config.SizeAlignment = 64ULL * 1024ULL;
+		break;
+	case EVICTION_HELPER_POOL_KIND_HOST_MEMORY:
+		config.Device		 = m_HostDevice;
+		config.Kind			 = EVICTION_HELPER_RESOURCE_HOST_MEMORY;
+		config.SizeAlignment = 64ULL * 1024ULL;
+		break;
+	case EVICTION_HELPER_POOL_KIND_RENDER_TARGET:
+	default:
+		config.Device		 = m_VRAMDevice;
+		config.Kind			 = EVICTION_HELPER_RESOURCE_RENDER_TARGET;
+		config.SizeAlignment = static_cast<uint64_t>(RT_WIDTH) * 4;
+		break;
+	}
+	config.Distribution = data->ChurnDistribution;
+	config.OpsPerSecond = data->ChurnOpsPerSecond;
+	config.TargetBytes	= static_cast<uint64_t>(data->ChurnTargetMB) * 1024ULL * 1024ULL;
+	config.MinSizeBytes = data->ChurnMinSizeKB ? static_cast<uint64_t>(data->ChurnMinSizeKB) * 1024ULL : CHURN_DEFAULT_MIN_SIZE;
+	config.MaxSizeBytes = data->ChurnMaxSizeKB ? static_cast<uint64_t>(data->ChurnMaxSizeKB) * 1024ULL : CHURN_DEFAULT_MAX_SIZE;
+	config.LargePercent = data->ChurnLargePercent;
+	config.Seed			= data->ChurnSeed;
+	config.Priority		= EVICTION_HELPER_PRIORITY_NORMAL;
+	if(config.Kind == EVICTION_HELPER_RESOURCE_RENDER_TARGET)
+	{
+		config.MaxSizeBytes = std::min(config.MaxSizeBytes, RT_MAX_SIZE);
+	}
+	m_Churn.SetConfig(config);
+
+	if(!m_Churn.IsRunning())
+	{
+		m_Churn.Advance(frameTimeSeconds);
+	}
+
+	EvictionHelperChurnStats stats;
+	m_Churn.GetStats(&stats);
+	uint64_t opCount				= stats.AllocCount + stats.FreeCount + stats.FailedAllocCount;
+	data->ChurnAllocatedBytes		= stats.AllocatedBytes;
+	data->ChurnResourceCount		= stats.ResourceCount;
+	data->ChurnAllocCount			= stats.AllocCount;
+	data->ChurnFreeCount			= stats.FreeCount;
+	data->ChurnFailedAllocCount		= stats.FailedAllocCount;
+	data->ChurnAchievedOpsPerSecond = (frameTimeSeconds > 0.0 && opCount >= m_ChurnLastOpCount) ? static_cast<float>((opCount - m_ChurnLastOpCount) / frameTimeSeconds) : 0.0f;
+	data->ChurnAllocMaxNs			= stats.AllocMaxNs;
+	data->ChurnFreeMaxNs			= stats.FreeMaxNs;
+	for(uint32_t i = 0; i < EVICTION_HELPER_LATENCY_BUCKETS; i++)
+	{
+		data->ChurnAllocLatencyHistogram[i] = stats.AllocLatencyHistogram[i];
+		data->ChurnFreeLatencyHistogram[i]	= stats.FreeLatencyHistogram[i];
+	}
+	m_ChurnLastOpCount = opCount;
+}
+
+// Pass the trace replay inputs to the replay and publish its counters
+// Without the replay thread the events due in this frame are issued here, against the frame time
+void EvictionHelperCore::UpdateTraceReplay(double frameTimeSeconds)
+{
+	EvictionHelperSharedData* data = m_Data;
+
+	data->TraceReplayPath[sizeof(data->TraceReplayPath) - 1] = '\0';
+	EvictionHelperTraceReplayConfig config;
+	config.Path		  = data->TraceReplayPath;
+	config.Playing	  = data->TraceReplay != 0;
+	config.Speed	  = std::max(data->TraceReplaySpeed, 0.0f);
+	config.VRAMDevice = m_VRAMDevice;
+	config.HostDevice = m_HostDevice;
+	m_TraceReplay.SetConfig(config);
+
+	if(!m_TraceReplay.IsRunning())
+	{
+		m_TraceReplay.Advance(frameTimeSeconds);
+	}
+
+	EvictionHelperTraceReplayStats stats;
+	m_TraceReplay.GetStats(&stats);
+	data->TraceReplayState		 = stats.State;
+	data->TraceResourceCount	 = stats.ResourceCount;
+	data->TraceEventCount		 = stats.EventCount;
+	data->TraceIssuedEventCount	 = stats.IssuedEventCount;
+	data->TraceSkippedEventCount = stats.SkippedEventCount;
+	data->TraceFailedAllocCount	 = stats.FailedAllocCount;
+	data->TraceAllocatedBytes	 = stats.AllocatedBytes;
+	data->TracePositionNs		 = stats.PositionNs;
+	data->TraceDurationNs		 = stats.DurationNs;
+	data->TraceDriftNs			 = stats.DriftNs;
+	data->TraceMaxDriftNs		 = stats.MaxDriftNs;
+	data->TraceMeanDriftNs		 = stats.IssuedEventCount ? stats.TotalDriftNs / stats.IssuedEventCount : 0;
+	data->TraceAllocMaxNs		 = stats.AllocMaxNs;
+	data->TraceFreeMaxNs		 = stats.FreeMaxNs;
+	for(uint32_t i = 0; i < EVICTION_HELPER_LATENCY_BUCKETS; i++)
+	{
+		data->TraceAllocLatencyHistogram[i] = stats.AllocLatencyHistogram[i];
+		data->TraceFreeLatencyHistogram[i]	= stats.FreeLatencyHistogram[i];
+		data->TraceDriftHistogram[i]		= stats.DriftHistogram[i];
+	}
+}
+
+// Open or close the trace recording when TraceRecord changes
+// TraceRecord is cleared again if TraceRecordPath cannot be created
+void EvictionHelperCore::UpdateTraceRecording()
+{
+	EvictionHelperSharedData* data = m_Data;
+
+	bool recording = m_TraceWriter.IsOpen();
+	if(data->TraceRecord && !recording)
+	{
+		data->TraceRecordPath[sizeof(data->TraceRecordPath) - 1] = '\0';
+		if(m_TraceWriter.Open(data->TraceRecordPath))
+		{
+			m_VRAMRecordingDevice.StartRecording(&m_TraceWriter);
+			m_HostRecordingDevice.StartRecording(&m_TraceWriter);
+		}
+		else
+		{
+			data->TraceRecord = 0;
+		}
+	}
+	else if(!data->TraceRecord && recording)
+	{
+		StopTraceRecording();
+	}
+
+	data->TraceRecording		  = m_TraceWriter.IsOpen() ? 1 : 0;
+	data->TraceRecordedEventCount = m_TraceWriter.GetEventCount();
+}
+
+void EvictionHelperCore::StopTraceRecording()
+{
+	m_VRAMRecordingDevice.StopRecording();
+	m_HostRecordingDevice.StopRecording();
+	m_TraceWriter.Close();
+}
+
+// Start or stop the scenario when the Scenario input changes, advance the frame clock and apply the current values
+void EvictionHelperCore::UpdateScenario(uint64_t frameTimeNs)
+{
+	EvictionHelperSharedData* data = m_Data;
+
+	bool enabled = data->Scenario != 0;
+	if(enabled && !m_ScenarioEnabled)
+	{
+		data->ScenarioPath[sizeof(data->ScenarioPath) - 1] = '\0';
+		bool loaded										   = m_Scenario.Load(data->ScenarioPath);
+
+		m_ScenarioRunning		 = loaded;
+		m_ScenarioClock			 = data->ScenarioClock;
+		m_ScenarioStartNs		 = EvictionHelper_GetTimestampNs();
+		m_ScenarioTimeNs		 = 0;
+		m_ScenarioDurationNs	 = std::max(static_cast<uint64_t>(m_Scenario.GetDurationSeconds() * 1000000000.0), static_cast<uint64_t>(1));
+		data->ScenarioState		 = loaded ? EVICTION_HELPER_SCENARIO_STATE_RUNNING : EVICTION_HELPER_SCENARIO_STATE_FAILED;
+		data->ScenarioStep		 = -1;
+		data->ScenarioStepLine	 = 0;
+		data->ScenarioStepCount	 = m_Scenario.GetSegmentCount();
+		data->ScenarioLoopCount	 = 0;
+		data->ScenarioErrorLine	 = m_Scenario.GetErrorLine();
+		data->ScenarioTimeNs	 = 0;
+		data->ScenarioDurationNs = loaded ? m_ScenarioDurationNs : 0;
+		snprintf(data->ScenarioError, sizeof(data->ScenarioError), "%s", m_Scenario.GetError().c_str());
+	}
+	else if(!enabled && m_ScenarioEnabled)
+	{
+		m_ScenarioRunning	= false;
+		data->ScenarioState = EVICTION_HELPER_SCENARIO_STATE_IDLE;
+	}
+	else if(m_ScenarioRunning && m_ScenarioClock == EVICTION_HELPER_SCENARIO_CLOCK_FRAME)
+	{
+		m_ScenarioTimeNs += frameTimeNs;
+	}
+	m_ScenarioEnabled = enabled;
+
+	ApplyScenario();
+}
+
+// Write the scenario values for the current time into the inputs and publish the current step
+// Returns true if an input changed
+bool EvictionHelperCore::ApplyScenario()
+{
+	EvictionHelperSharedData* data = m_Data;
+	if(!m_ScenarioRunning)
+		return false;
+
+	if(m_ScenarioClock == EVICTION_HELPER_SCENARIO_CLOCK_MONOTONIC)
+	{
+		m_ScenarioTimeNs = EvictionHelper_GetTimestampNs() - m_ScenarioStartNs;
+	}
+
+	uint64_t timeNs = m_ScenarioTimeNs;
+	if(m_Scenario.IsLooping())
+	{
+		data->ScenarioLoopCount = static_cast<uint32_t>(timeNs / m_ScenarioDurationNs);
+		timeNs %= m_ScenarioDurationNs;
+	}
+	else if(timeNs >= m_ScenarioDurationNs)
+	{
+		// The final values are written once, afterwards the inputs are free again
+		timeNs				= m_ScenarioDurationNs;
+		m_ScenarioRunning	= false;
+		data->ScenarioState = EVICTION_HELPER_SCENARIO_STATE_FINISHED;
+	}
+
+	double timeSeconds = timeNs / 1000000000.0;
+	m_Scenario.Evaluate(timeSeconds, &m_ScenarioValues);
+	bool changed = false;
+	for(const EvictionHelperScenarioValue& value : m_ScenarioValues)
+	{
+		changed |= SetScenarioInput(value);
+	}
+
+	int step			   = m_Scenario.GetCurrentSegment(timeSeconds);
+	data->ScenarioStep	   = step;
+	data->ScenarioStepLine = (step >= 0) ? m_Scenario.GetSegment(step).Line : 0;
+	data->ScenarioTimeNs   = timeNs;
+	return changed;
+}
+
+// Returns true if the input had a different value
+bool EvictionHelperCore::SetScenarioInput(const EvictionHelperScenarioValue& value)
+{
+	EvictionHelperSharedData* data = m_Data;
+	bool					  size = value.Property == EVICTION_HELPER_SCENARIO_SIZE;
+
+	int* input = nullptr;
+	if(value.Target == EVICTION_HELPER_POOL_ACTIVE)
+		input = size ? &data->TargetVRAMUsageMB : &data->ActiveVRAMPriority;
+	else if(value.Target == EVICTION_HELPER_POOL_UNUSED)
+		input = size ? &data->TargetUnusedVRAMUsageMB : &data->UnusedVRAMPriority;
+	else if(value.Target == EVICTION_HELPER_POOL_HOST_ACTIVE)
+		input = size ? &data->TargetHostMemoryUsageMB : &data->HostMemoryPriority;
+	else if(value.Target == EVICTION_HELPER_POOL_HOST_UNUSED)
+		input = size ? &data->TargetUnusedHostMemoryUsageMB : &data->UnusedHostMemoryPriority;
+	else if(value.Target >= EVICTION_HELPER_POOL_NAMED(0) && value.Target < EVICTION_HELPER_POOL_NAMED(EVICTION_HELPER_MAX_NAMED_POOLS))
+	{
+		EvictionHelperPoolDesc& desc = data->NamedPools[value.Target - EVICTION_HELPER_POOL_NAMED(0)];
+		input						 = size ? &desc.TargetMB : &desc.Priority;
+	}
+
+	if(!input || *input == value.Value)
+		return false;
+	*input = value.Value;
+	return true;
+}
+
+// Monotonic time of the next value jump of a scenario on the monotonic clock, 0 if there is none
+// Counted from the last applied time rather than now, so a jump that passed during a long frame is still reported and
+// applied right away
+uint64_t EvictionHelperCore::GetNextScenarioTimeNs() const
+{
+	if(!m_ScenarioRunning || m_ScenarioClock != EVICTION_HELPER_SCENARIO_CLOCK_MONOTONIC)
+		return 0;
+
+	uint64_t elapsedNs	 = m_ScenarioTimeNs;
+	uint64_t loopStartNs = m_ScenarioStartNs;
+	if(m_Scenario.IsLooping())
+	{
+		loopStartNs += (elapsedNs / m_ScenarioDurationNs) * m_ScenarioDurationNs;
+		elapsedNs %= m_ScenarioDurationNs;
+	}
+
+	double nextSeconds = m_Scenario.GetNextChangeSeconds(elapsedNs / 1000000000.0);
+	if(!std::isfinite(nextSeconds))
+		return 0;
+	return loopStartNs + static_cast<uint64_t>(std::ceil(nextSeconds * 1000000000.0));
+}
+
+// Advance the host residency scanners by a bounded number of pages and publish the results
+void EvictionHelperCore::ScanHostMemoryResidency()
+{
+	EvictionHelperSharedData* data			= m_Data;
+	uint64_t				  pagesPerFrame = data->HostResidencyScanPagesPerFrame ? data->HostResidencyScanPagesPerFrame : HOST_RESIDENCY_DEFAULT_PAGES_PER_FRAME;
+
+	m_HostResidencyScanner.Scan(*m_HostMemoryDevice, m_HostPool, pagesPerFrame);
+	m_UnusedHostResidencyScanner.Scan(*m_HostMemoryDevice, m_UnusedHostPool, pagesPerFrame);
+
+	data->HostMemoryResidentBytes		   = m_HostResidencyScanner.GetResidentBytes();
+	data->HostMemoryNonResidentBytes	   = m_HostResidencyScanner.GetNonResidentBytes();
+	data->UnusedHostMemoryResidentBytes	   = m_UnusedHostResidencyScanner.GetResidentBytes();
+	data->UnusedHostMemoryNonResidentBytes = m_UnusedHostResidencyScanner.GetNonResidentBytes();
+	data->HostResidencyScanPasses		   = m_UnusedHostResidencyScanner.GetCompletedPasses();
+
+	// Group the counters by the priority each pool is reported under
+	for(int i = 0; i < 5; i++)
+	{
+		data->HostResidentBytesByPriority[i]	= 0;
+		data->HostNonResidentBytesByPriority[i] = 0;
+	}
+	int activePri = data->HostMemoryPriority;
+	int unusedPri = data->UnusedHostMemoryPriority;
+	if(activePri >= 0 && activePri <= 4)
+	{
+		data->HostResidentBytesByPriority[activePri] += data->HostMemoryResidentBytes;
+		data->HostNonResidentBytesByPriority[activePri] += data->HostMemoryNonResidentBytes;
+	}
+	if(unusedPri >= 0 && unusedPri <= 4)
+	{
+		data->HostResidentBytesByPriority[unusedPri] += data->UnusedHostMemoryResidentBytes;
+		data->HostNonResidentBytesByPriority[unusedPri] += data->UnusedHostMemoryNonResidentBytes;
+	}
+}
+
+// Apply a single command from the command ring to the shared memory inputs
+void EvictionHelperCore::ApplyCommand(const EvictionHelperCommand& command)
+{
+	EvictionHelperSharedData* data	= m_Data;
+	int						  value = static_cast<int>(command.Value);
+
+	switch(command.Type)
+	{
+	case EVICTION_HELPER_COMMAND_SET_TARGET:
+		if(command.Target == EVICTION_HELPER_POOL_ACTIVE)
+			data->TargetVRAMUsageMB = value;
+		else if(command.Target == EVICTION_HELPER_POOL_UNUSED)
+			data->TargetUnusedVRAMUsageMB = value;
+		else if(command.Target == EVICTION_HELPER_POOL_HOST_ACTIVE)
+			data->TargetHostMemoryUsageMB = value;
+		else if(command.Target == EVICTION_HELPER_POOL_HOST_UNUSED)
+			data->TargetUnusedHostMemoryUsageMB = value;
+		else if(command.Target >= EVICTION_HELPER_POOL_NAMED(0) && command.Target < EVICTION_HELPER_POOL_NAMED(EVICTION_HELPER_MAX_NAMED_POOLS))
+			data->NamedPools[command.Target - EVICTION_HELPER_POOL_NAMED(0)].TargetMB = value;
+		break;
+	case EVICTION_HELPER_COMMAND_SET_PRIORITY:
+		// Priorities index per-priority tables and map to D3D12 priorities, anything outside 0-4 is ignored
+		if(command.Value < EVICTION_HELPER_PRIORITY_MINIMUM || command.Value > EVICTION_HELPER_PRIORITY_MAXIMUM)
+			break;
+		if(command.Target == EVICTION_HELPER_POOL_ACTIVE)
+			data->ActiveVRAMPriority = value;
+		else if(command.Target == EVICTION_HELPER_POOL_UNUSED)
+			data->UnusedVRAMPriority = value;
+		else if(command.Target == EVICTION_HELPER_POOL_HOST_ACTIVE)
+			data->HostMemoryPriority = value;
+		else if(command.Target == EVICTION_HELPER_POOL_HOST_UNUSED)
+			data->UnusedHostMemoryPriority = value;
+		else if(command.Target >= EVICTION_HELPER_POOL_NAMED(0) && command.Target < EVICTION_HELPER_POOL_NAMED(EVICTION_HELPER_MAX_NAMED_POOLS))
+			data->NamedPools[command.Target - EVICTION_HELPER_POOL_NAMED(0)].Priority = value;
+		break;
+	case EVICTION_HELPER_COMMAND_ALLOCATE_HEAP:
+		if(command.Target == EVICTION_HELPER_HEAP_512MB)
+			data->Allocate512MBHeap = value ? 1 : 0;
+		else if(command.Target == EVICTION_HELPER_HEAP_1GB)
+			data->Allocate1GBHeap = value ? 1 : 0;
+		else if(command.Target >= EVICTION_HELPER_HEAP_TABLE(0) && command.Target < EVICTION_HELPER_HEAP_TABLE(EVICTION_HELPER_MAX_HEAPS))
+		{
+			// Grow the table to include the heap, entries beyond HeapCount are not created
+			uint32_t index			  = command.Target - EVICTION_HELPER_HEAP_TABLE(0);
+			data->Heaps[index].SizeMB = static_cast<uint32_t>(std::max(value, 0));
+			data->HeapCount			  = std::max(data->HeapCount, index + 1);
+		}
+		break;
+	case EVICTION_HELPER_COMMAND_EVICT:
+	case EVICTION_HELPER_COMMAND_MAKE_RESIDENT:
+		BeginResidencyOp(command);
+		break;
+	case EVICTION_HELPER_COMMAND_BARRIER:
+	default:
+		break;
+	}
+}
+
+// Evict a pool or make it resident again and publish how long it took
+// Only the resources that are not in the requested state yet are passed to the device, so the reference counted
+// D3D12 calls stay balanced. An enqueued MAKE_RESIDENT finishes in PollResidencyOp() once its fence completes.
+void EvictionHelperCore::BeginResidencyOp(const EvictionHelperCommand& command)
+{
+	EvictionHelperSharedData* data	= m_Data;
+	data->ResidencyOpSequence		= command.Sequence;
+	data->ResidencyOpType			= command.Type;
+	data->ResidencyOpPool			= command.Target;
+	data->ResidencyOpMode			= static_cast<uint32_t>(command.Value);
+	data->ResidencyOpBytes			= 0;
+	data->ResidencyOpSubmitNs		= 0;
+	data->ResidencyOpDurationNs		= 0;
+	data->ResidencyOpBytesPerSecond = 0;
+
+	EvictionHelperPool* pool = GetPool(command.Target);
+	if(!pool)
+	{
+		FinishResidencyOp(false, EvictionHelper_GetTimestampNs());
+		return;
+	}
+
+	const std::vector<EvictionHelperResource>& resources	 = pool->GetResources();
+	uint32_t								   resourceCount = pool->GetResourceCount();
+	uint32_t								   evictedCount	 = pool->GetEvictedCount();
+	EvictionHelperDevice*					   device		 = pool->GetDevice();
+
+	uint64_t startNs   = EvictionHelper_GetTimestampNs();
+	bool	 succeeded = true;
+	if(command.Type == EVICTION_HELPER_COMMAND_EVICT)
+	{
+		uint32_t count		   = resourceCount - evictedCount;
+		data->ResidencyOpBytes = count * pool->GetChunkSize();
+		if(count > 0)
+			succeeded = device->Evict(resources.data() + evictedCount, count);
+		if(succeeded)
+			pool->SetEvictedCount(resourceCount);
+	}
+	else if(command.Value == EVICTION_HELPER_MAKE_RESIDENT_ENQUEUE && evictedCount > 0)
+	{
+		data->ResidencyOpBytes = pool->GetEvictedBytes();
+		uint64_t fenceValue	   = device->EnqueueMakeResident(resources.data(), evictedCount);
+		if(fenceValue != 0)
+		{
+			// The pool stays evicted, and untouched, until the fence has completed
+			data->ResidencyOpSubmitNs = EvictionHelper_GetTimestampNs() - startNs;
+			data->ResidencyOpStatus	  = EVICTION_HELPER_RESIDENCY_OP_PENDING;
+			m_ResidencyOpPool		  = pool;
+			m_ResidencyOpFenceValue	  = fenceValue;
+			m_ResidencyOpStartNs	  = startNs;
+			PollResidencyOp();
+			return;
+		}
+		succeeded = false;
+	}
+	else
+	{
+		data->ResidencyOpBytes = pool->GetEvictedBytes();
+		if(evictedCount > 0)
+			succeeded = device->MakeResident(resources.data(), evictedCount);
+		if(succeeded)
+			pool->SetEvictedCount(0);
+	}
+
+	data->ResidencyOpSubmitNs = EvictionHelper_GetTimestampNs() - startNs;
+	FinishResidencyOp(succeeded, startNs);
+}
+
+// Returns true once no residency command is waiting for its fence anymore
+// The duration of an enqueued MAKE_RESIDENT is measured up to the first poll that sees its fence completed
+bool EvictionHelperCore::PollResidencyOp()
+{
+	if(!m_ResidencyOpPool)
+		return true;
+
+	if(m_ResidencyOpPool->GetDevice()->GetCompletedResidencyFenceValue() < m_ResidencyOpFenceValue)
+		return false;
+
+	m_ResidencyOpPool->SetEvictedCount(0);
+	m_ResidencyOpPool		= nullptr;
+	m_ResidencyOpFenceValue = 0;
+	FinishResidencyOp(true, m_ResidencyOpStartNs);
+	return true;
+}
+
+void EvictionHelperCore::FinishResidencyOp(bool succeeded, uint64_t startNs)
+{
+	EvictionHelperSharedData* data	= m_Data;
+	data->ResidencyOpDurationNs		= EvictionHelper_GetTimestampNs() - startNs;
+	data->ResidencyOpBytesPerSecond = (data->ResidencyOpDurationNs > 0) ? static_cast<uint64_t>(data->ResidencyOpBytes * 1000000000.0 / data->ResidencyOpDurationNs) : 0;
+	data->ResidencyOpStatus			= succeeded ? EVICTION_HELPER_RESIDENCY_OP_DONE : EVICTION_HELPER_RESIDENCY_OP_FAILED;
+	PublishAllocationState();
+}
+
+// Pool for an EVICTION_HELPER_POOL_* target, nullptr if the target is invalid
+EvictionHelperPool* EvictionHelperCore::GetPool(uint32_t pool)
+{
+	if(pool >= EVICTION_HELPER_POOL_NAMED(0) && pool < EVICTION_HELPER_POOL_NAMED(EVICTION_HELPER_MAX_NAMED_POOLS))
+		return m_NamedPools[pool - EVICTION_HELPER_POOL_NAMED(0)].get();
+
+	switch(pool)
+	{
+	case EVICTION_HELPER_POOL_ACTIVE:
+		return &m_ActivePool;
+	case EVICTION_HELPER_POOL_UNUSED:
+		return &m_UnusedPool;
+	case EVICTION_HELPER_POOL_HOST_ACTIVE:
+		return &m_HostPool;
+	case EVICTION_HELPER_POOL_HOST_UNUSED:
+		return &m_UnusedHostPool;
+	default:
+		return nullptr;
+	}
+}
+
+void EvictionHelperCore::PublishSnapshot()
+{
+	const EvictionHelperSharedData* data = m_Data;
+
+	EvictionHelperSnapshot snapshot					= {};
+	snapshot.FrameCount								= data->FrameCount;
+	snapshot.CurrentVRAMAllocationBytes				= data->CurrentVRAMAllocationBytes;
+	snapshot.CurrentUnusedVRAMAllocationBytes		= data->CurrentUnusedVRAMAllocationBytes;
+	snapshot.CurrentHeapAllocationBytes				= data->CurrentHeapAllocationBytes;
+	snapshot.AllocatedRenderTargetCount				= data->AllocatedRenderTargetCount;
+	snapshot.AllocatedUnusedRenderTargetCount		= data->AllocatedUnusedRenderTargetCount;
+	snapshot.LocalBudget							= data->LocalBudget;
+	snapshot.LocalCurrentUsage						= data->LocalCurrentUsage;
+	snapshot.LocalAvailableForReservation			= data->LocalAvailableForReservation;
+	snapshot.LocalCurrentReservation				= data->LocalCurrentReservation;
+	snapshot.NonLocalBudget							= data->NonLocalBudget;
+	snapshot.NonLocalCurrentUsage					= data->NonLocalCurrentUsage;
+	snapshot.NonLocalAvailableForReservation		= data->NonLocalAvailableForReservation;
+	snapshot.NonLocalCurrentReservation				= data->NonLocalCurrentReservation;
+	snapshot.CurrentHostMemoryAllocationBytes		= data->CurrentHostMemoryAllocationBytes;
+	snapshot.CurrentUnusedHostMemoryAllocationBytes	= data->CurrentUnusedHostMemoryAllocationBytes;
+
+	EvictionHelper_WriteSnapshot(m_Data, &snapshot);
+}
+
+void EvictionHelperCore::RecordTelemetry(uint64_t frameTimeNs)
+{
+	const EvictionHelperSharedData* data = m_Data;
+
+	EvictionHelperTelemetrySample sample   = {};
+	sample.TimestampNs					   = EvictionHelper_GetTimestampNs();
+	sample.FrameCount					   = data->FrameCount;
+	sample.FrameTimeNs					   = frameTimeNs;
+	sample.LocalBudget					   = data->LocalBudget;
+	sample.LocalCurrentUsage			   = data->LocalCurrentUsage;
+	sample.LocalCurrentReservation		   = data->LocalCurrentReservation;
+	sample.NonLocalBudget				   = data->NonLocalBudget;
+	sample.NonLocalCurrentUsage			   = data->NonLocalCurrentUsage;
+	sample.NonLocalCurrentReservation	   = data->NonLocalCurrentReservation;
+	sample.ActiveAllocationBytes		   = data->CurrentVRAMAllocationBytes;
+	sample.UnusedAllocationBytes		   = data->CurrentUnusedVRAMAllocationBytes;
+	sample.HeapAllocationBytes			   = data->CurrentHeapAllocationBytes;
+	sample.HostMemoryAllocationBytes	   = data->CurrentHostMemoryAllocationBytes;
+	sample.UnusedHostMemoryAllocationBytes = data->CurrentUnusedHostMemoryAllocationBytes;
+
+	EvictionHelper_WriteTelemetry(m_Data, &sample);
+}
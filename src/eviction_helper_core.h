@@ -0,0 +1,220 @@
+#pragma once
+
+#include "eviction_helper_shared.h"
+#include "eviction_helper_device.h"
+#include "eviction_helper_pool.h"
+#include "eviction_helper_allocation_worker.h"
+#include "eviction_helper_deferred_release.h"
+#include "eviction_helper_host_memory.h"
+#include "eviction_helper_residency_scanner.h"
+#include "eviction_helper_budget_controller.h"
+#include "eviction_helper_ramp.h"
+#include "eviction_helper_touch_pattern.h"
+#include "eviction_helper_fragmentation.h"
+#include "eviction_helper_churn.h"
+#include "eviction_helper_trace.h"
+#include "eviction_helper_trace_replay.h"
+#include "eviction_helper_scenario.h"
+#include "eviction_helper_memory_sampler.h"
+#include "eviction_helper_budget_watcher.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define EVICTION_HELPER_DEFAULT_ACTIVE EVICTION_HELPER_PRIORITY_HIGH
+#define EVICTION_HELPER_DEFAULT_UNUSED EVICTION_HELPER_PRIORITY_NORMAL
+
+// D3D12 heap allocations (VRAM)
+constexpr uint64_t HEAP_512MB_SIZE = 512ULL * 1024ULL * 1024ULL;
+constexpr uint64_t HEAP_1GB_SIZE   = 1024ULL * 1024ULL * 1024ULL;
+
+// Chunk size of named heap pools without an explicit one
+constexpr uint64_t NAMED_POOL_DEFAULT_HEAP_SIZE = 64ULL * 1024ULL * 1024ULL;
+
+// Size of the heap table entries before their first layout, never allocated
+constexpr uint64_t HEAP_TABLE_INITIAL_SIZE = 1024ULL * 1024ULL;
+
+// Churn size range without explicit ChurnMinSizeKB/ChurnMaxSizeKB
+constexpr uint64_t CHURN_DEFAULT_MIN_SIZE = 64ULL * 1024ULL;
+constexpr uint64_t CHURN_DEFAULT_MAX_SIZE = 64ULL * 1024ULL * 1024ULL;
+
+// Platform independent part of the helper
+// Owns the built-in VRAM and host memory pools and the named pools, applies the shared memory inputs and commands to them and
+// publishes the results. It only talks to the GPU through EvictionHelperDevice, so the same code runs
+// on the D3D12 device in the windowed app and on the simulated device without a GPU.
+// With asyncAllocations, pools are grown and shrunk by a worker thread that signals the helper when it is done,
+// otherwise all allocations are made synchronously inside UpdateAllocations().
+class EvictionHelperCore
+{
+public:
+	EvictionHelperCore(EvictionHelperSharedMemory* sharedMem, EvictionHelperDevice* vramDevice, EvictionHelperHostDevice* hostDevice, bool asyncAllocations = true);
+	~EvictionHelperCore();
+
+	EvictionHelperCore(const EvictionHelperCore&)			 = delete;
+	EvictionHelperCore& operator=(const EvictionHelperCore&) = delete;
+
+	// Write the default input values into freshly created shared memory
+	void InitializeDefaults();
+
+	// Apply all commands from the command ring that are due, in order
+	void ProcessCommands();
+
+	// Take finished allocations from the worker and request new ones to match the shared memory inputs
+	void UpdateAllocations();
+
+	// True once every pool ramp has reached its target and every requested allocation and release has been executed
+	bool IsAllocationIdle() const;
+
+	// Start of a frame: query memory info, start or stop the memory sampler, run the budget controller, advance the pool ramps, retire released
+	// resources whose frames have completed and update allocations
+	// frameTimeNs is the only clock the core uses, pass a virtual frame time to run ramps faster than real time
+	void BeginFrame(uint64_t frameTimeNs);
+
+	// Touch the working set of the active pools selected by the touch pattern, and advance the host residency scan
+	// With the D3D12 device the clears are recorded into its current command list
+	void TouchActiveMemory();
+
+	// End of a frame, after its work has been submitted: signal the device fences, advance the frame counter
+	// and publish snapshot and telemetry
+	void EndFrame(uint64_t frameTimeNs);
+
+	// Execute time of the next delayed command or scenario step on the monotonic clock, 0 if nothing is waiting for a
+	// time. A command that is due but blocked is picked up by the next frame and does not count.
+	uint64_t GetNextCommandTimeNs() const;
+
+	// Stop the allocation worker and release all allocations, the devices must still be alive
+	void Shutdown();
+
+private:
+	static void OnAllocationWorkerIdle(void* context);
+
+	void CollectAllocationResults();
+	void PublishAllocationState();
+	void QueryMemoryInfo();
+	void UpdateBudgetControl(double frameTimeSeconds);
+	void AdvanceRamps(double dtSeconds);
+	void RetireReleases();
+	void UpdateHeap(EvictionHelperResource* heap, bool allocate, uint64_t sizeBytes);
+	void UpdateHostMemoryPools();
+	void UpdateNamedPools();
+	void TouchNamedPools(EvictionHelperDevice* device);
+	void GetNamedPoolLayout(const EvictionHelperPoolDesc& desc, EvictionHelperDevice** outDevice, uint32_t* outKind, uint64_t* outChunkSize) const;
+	bool IsNamedPoolLayoutCurrent(uint32_t index) const;
+	EvictionHelperDeferredReleaseQueue* GetReleaseQueue(EvictionHelperDevice* device);
+	void UpdateHeapTable();
+	void UpdateHeapFragmentation();
+	void GetHeapTableLayout(uint32_t index, uint32_t* outKind, uint64_t* outSizeBytes) const;
+	bool IsHeapTableLayoutCurrent(uint32_t index) const;
+	void UpdateChurn(double frameTimeSeconds);
+	void UpdateTraceReplay(double frameTimeSeconds);
+	void UpdateTraceRecording();
+	void StopTraceRecording();
+	void UpdateScenario(uint64_t frameTimeNs);
+	bool ApplyScenario();
+	bool SetScenarioInput(const EvictionHelperScenarioValue& value);
+	uint64_t GetNextScenarioTimeNs() const;
+	void UpdateMemorySampler();
+	void ScanHostMemoryResidency();
+	void ApplyCommand(const EvictionHelperCommand& command);
+	void BeginResidencyOp(const EvictionHelperCommand& command);
+	bool PollResidencyOp();
+	void FinishResidencyOp(bool succeeded, uint64_t startNs);
+	EvictionHelperPool* GetPool(uint32_t pool);
+	void PublishSnapshot();
+	void RecordTelemetry(uint64_t frameTimeNs);
+
+	EvictionHelperSharedMemory* m_SharedMem;
+	EvictionHelperSharedData*	m_Data;
+	EvictionHelperHostDevice*	m_HostMemoryDevice;
+
+	// Everything goes through the recording devices, so all resources the helper creates, destroys or reprioritizes
+	// can be written into a trace
+	EvictionHelperTraceWriter		   m_TraceWriter;
+	EvictionHelperTraceRecordingDevice m_VRAMRecordingDevice;
+	EvictionHelperTraceRecordingDevice m_HostRecordingDevice;
+	EvictionHelperDevice*			   m_VRAMDevice;
+	EvictionHelperDevice*			   m_HostDevice;
+
+	// Creates and destroys the pool resources, runs on its own thread with asyncAllocations
+	EvictionHelperAllocationWorker m_Worker;
+
+	// Released resources wait here until the frames using them have completed
+	EvictionHelperDeferredReleaseQueue m_VRAMReleaseQueue;
+	EvictionHelperDeferredReleaseQueue m_HostReleaseQueue;
+
+	// VRAM pools, the active pool is touched every frame
+	EvictionHelperPool m_ActivePool;
+	EvictionHelperPool m_UnusedPool;
+
+	// Heaps follow the priority of the unused pool
+	EvictionHelperResource m_Heap512MB = 0;
+	EvictionHelperResource m_Heap1GB   = 0;
+
+	// Host (system RAM) memory pools, same active/unused semantics as the VRAM pools
+	EvictionHelperPool m_HostPool;
+	EvictionHelperPool m_UnusedHostPool;
+
+	// Pools configured through NamedPools, at the same index
+	std::vector<std::unique_ptr<EvictionHelperPool>> m_NamedPools;
+	RampLimiter										 m_NamedRamps[EVICTION_HELPER_MAX_NAMED_POOLS];
+	EvictionHelperTouchPattern						 m_NamedTouchPatterns[EVICTION_HELPER_MAX_NAMED_POOLS];
+
+	// Heap table, each entry of Heaps is a pool of at most one heap
+	std::vector<std::unique_ptr<EvictionHelperPool>> m_HeapTablePools;
+	std::vector<uint64_t>							 m_HeapTableOffsets;
+	std::vector<uint64_t>							 m_HeapTablePlacedBytes; // 0 while the heap is not in the fragmentation model
+	EvictionHelperFragmentationModel				 m_HeapFragmentation;
+
+	// Random-size allocation churn, runs on its own thread with asyncAllocations
+	EvictionHelperChurn m_Churn;
+	std::string			m_ChurnHistogramPath;
+	uint64_t			m_ChurnLastOpCount = 0;
+
+	// Allocation trace replay, runs on its own thread with asyncAllocations
+	EvictionHelperTraceReplay m_TraceReplay;
+
+	// Scenario driving the pool targets and priorities, the clock is chosen when it starts
+	EvictionHelperScenario					 m_Scenario;
+	std::vector<EvictionHelperScenarioValue> m_ScenarioValues;
+	bool									 m_ScenarioEnabled	  = false; // Scenario input seen in the last frame
+	bool									 m_ScenarioRunning	  = false;
+	uint32_t								 m_ScenarioClock	  = EVICTION_HELPER_SCENARIO_CLOCK_FRAME;
+	uint64_t								 m_ScenarioStartNs	  = 0; // Monotonic clock at the start
+	uint64_t								 m_ScenarioTimeNs	  = 0; // Scenario clock at the last update, since the start
+	uint64_t								 m_ScenarioDurationNs = 1;
+
+	// Budget and usage of the VRAM device sampled on its own thread at MemorySampleRateHz, even without asyncAllocations
+	// as it only reads
+	EvictionHelperDeviceMemoryInfoProvider m_MemoryInfoProvider;
+	EvictionHelperMemorySampler			   m_MemorySampler;
+	uint64_t							   m_MemorySampleWindowStartNs	  = 0;
+	uint64_t							   m_MemorySampleWindowStartCount = 0;
+
+	// Publishes budget changes as soon as the VRAM device reports them, or from QueryMemoryInfo() without notifications
+	EvictionHelperBudgetWatcher m_BudgetWatcher;
+
+	// Incremental residency tracking for the host memory pools
+	HostResidencyScanner m_HostResidencyScanner;
+	HostResidencyScanner m_UnusedHostResidencyScanner;
+
+	// Working set of the active pools, restarted when the seed changes
+	EvictionHelperTouchPattern m_ActiveTouchPattern;
+	EvictionHelperTouchPattern m_HostTouchPattern;
+	uint32_t				   m_TouchSeed = 0;
+	std::vector<uint32_t>	   m_TouchIndices;
+
+	// Pool sizes ramping towards the targets, indexed by EVICTION_HELPER_POOL_*
+	RampLimiter m_Ramps[EVICTION_HELPER_POOL_COUNT];
+
+	// MAKE_RESIDENT with ENQUEUE waiting for the residency fence of its device, only one residency command runs at a time
+	EvictionHelperPool* m_ResidencyOpPool		= nullptr;
+	uint64_t			m_ResidencyOpFenceValue = 0;
+	uint64_t			m_ResidencyOpStartNs	= 0;
+
+	// Closed-loop budget control, mode and pool of the last frame to detect changes
+	BudgetController m_BudgetController;
+	int				 m_BudgetControlMode = EVICTION_HELPER_BUDGET_CONTROL_OFF;
+	int				 m_BudgetControlPool = EVICTION_HELPER_POOL_ACTIVE;
+};
@@ -0,0 +1,678 @@
+#pragma once
+
+#include <d3d12.h>
+#include <dxgi1_4.h>
+#include <wrl/client.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "eviction_helper_shared.h"
+#include "eviction_helper_device.h"
+#include "eviction_helper_placement_heaps.h"
+
+// Convert index to D3D12_RESIDENCY_PRIORITY
+inline D3D12_RESIDENCY_PRIORITY IndexToPriority(int index)
+{
+	switch(index)
+	{
+	case EVICTION_HELPER_PRIORITY_MINIMUM:
+		return D3D12_RESIDENCY_PRIORITY_MINIMUM;
+	case EVICTION_HELPER_PRIORITY_LOW:
+		return D3D12_RESIDENCY_PRIORITY_LOW;
+	case EVICTION_HELPER_PRIORITY_NORMAL:
+		return D3D12_RESIDENCY_PRIORITY_NORMAL;
+	case EVICTION_HELPER_PRIORITY_HIGH:
+		return D3D12_RESIDENCY_PRIORITY_HIGH;
+	case EVICTION_HELPER_PRIORITY_MAXIMUM:
+		return D3D12_RESIDENCY_PRIORITY_MAXIMUM;
+	default:
+		return D3D12_RESIDENCY_PRIORITY_NORMAL;
+	}
+}
+
+// EvictionHelperDevice backed by a real D3D12 device
+// Render targets are committed RGBA8 textures with an RTV each, heaps are ID3D12Heaps that only allow
+// RT/DS textures. Touching a render target records a clear into the command list set with SetCommandList().
+// With a placement heap size, render targets are placed resources suballocated from shared heaps by a buddy
+// allocator instead. Residency priority then applies per heap: new render targets only go into heaps of their pool
+// (placement group) and priority, and changing the priority of one of them changes it for the whole heap.
+// Evict() and MakeResident() work on the same pageables, so evicting a placed render target evicts its whole heap.
+// Heaps count their evicted render targets, a heap is only evicted with the first and made resident with the last one,
+// and no render target is placed in an evicted heap.
+// EnqueueMakeResident() needs ID3D12Device3 and signals a residency fence separate from the frame fence.
+// Resources can be created and destroyed on the allocation worker while the frame thread touches others, the
+// resource table is protected by a lock that is never held across D3D12 object creation.
+class EvictionHelperD3D12Device : public EvictionHelperDevice
+{
+public:
+	EvictionHelperD3D12Device(ID3D12Device1* device, IDXGIAdapter3* adapter, ID3D12CommandQueue* commandQueue)
+		: m_Device(device)
+		, m_Adapter(adapter)
+		, m_CommandQueue(commandQueue)
+	{
+		m_RtvDescriptorSize = m_Device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+		m_Device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_Fence));
+		m_FenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+
+		if(SUCCEEDED(m_Device.As(&m_Device3)))
+		{
+			m_Device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_ResidencyFence));
+		}
+
+		// The adapter sets m_BudgetEvent whenever the budget of this process changes, see WaitForBudgetChange()
+		m_BudgetEvent		= CreateEvent(nullptr, FALSE, FALSE, nullptr);
+		m_BudgetCancelEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+		if(m_BudgetEvent && FAILED(m_Adapter->RegisterVideoMemoryBudgetChangeNotificationEvent(m_BudgetEvent, &m_BudgetCookie)))
+		{
+			CloseHandle(m_BudgetEvent);
+			m_BudgetEvent = nullptr;
+		}
+	}
+
+	~EvictionHelperD3D12Device()
+	{
+		WaitForIdle();
+		m_Resources.clear();
+		m_RtvHeap.Reset();
+		if(m_FenceEvent)
+		{
+			CloseHandle(m_FenceEvent);
+		}
+		if(m_BudgetEvent)
+		{
+			m_Adapter->UnregisterVideoMemoryBudgetChangeNotification(m_BudgetCookie);
+			CloseHandle(m_BudgetEvent);
+		}
+		if(m_BudgetCancelEvent)
+		{
+			CloseHandle(m_BudgetCancelEvent);
+		}
+	}
+
+	// Command list that TouchResource() records its clears into, must be open while touching
+	void SetCommandList(ID3D12GraphicsCommandList* commandList)
+	{
+		m_CommandList = commandList;
+	}
+
+	EvictionHelperResource CreateResource(uint32_t kind, uint64_t sizeBytes, int priority) override
+	{
+		return CreateGroupedResource(kind, sizeBytes, priority, 0);
+	}
+
+	EvictionHelperResource CreateGroupedResource(uint32_t kind, uint64_t sizeBytes, int priority, uint64_t placementGroup) override
+	{
+		Resource resource;
+		resource.RtvIndex = UINT_MAX;
+		resource.Block	  = UINT_MAX;
+
+		if(kind == EVICTION_HELPER_RESOURCE_RENDER_TARGET)
+		{
+			D3D12_HEAP_PROPERTIES heapProps = {};
+			heapProps.Type					= D3D12_HEAP_TYPE_DEFAULT;
+
+			// Each RT is RT_WIDTH x height x 4 bytes (RGBA8)
+			UINT64 height = sizeBytes / (RT_WIDTH * 4ULL);
+			height		  = (height < 1) ? 1 : (height > D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION ? D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION : height);
+
+			D3D12_RESOURCE_DESC texDesc = {};
+			texDesc.Dimension			= D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+			texDesc.Width				= RT_WIDTH;
+			texDesc.Height				= static_cast<UINT>(height);
+			resource.Height				= texDesc.Height;
+			texDesc.DepthOrArraySize	= 1;
+			texDesc.MipLevels			= 1;
+			texDesc.Format				= DXGI_FORMAT_R8G8B8A8_UNORM;
+			texDesc.SampleDesc.Count	= 1;
+			texDesc.Flags				= D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+
+			D3D12_CLEAR_VALUE clearValue = {};
+			clearValue.Format			 = DXGI_FORMAT_R8G8B8A8_UNORM;
+			clearValue.Color[0]			 = 0.0f;
+			clearValue.Color[1]			 = 0.0f;
+			clearValue.Color[2]			 = 0.0f;
+			clearValue.Color[3]			 = 1.0f;
+
+			// Render targets that do not fit into a placement heap are still committed
+			UINT64						   placementHeapSize = m_PlacementHeapSize.load(std::memory_order_relaxed);
+			D3D12_RESOURCE_ALLOCATION_INFO allocationInfo	 = {};
+			if(placementHeapSize > 0)
+			{
+				allocationInfo = m_Device->GetResourceAllocationInfo(0, 1, &texDesc);
+			}
+
+			if(placementHeapSize > 0 && allocationInfo.SizeInBytes <= placementHeapSize)
+			{
+				Microsoft::WRL::ComPtr<ID3D12Heap> heap;
+				if(!AllocatePlacement(allocationInfo.SizeInBytes, placementHeapSize, priority, placementGroup, &resource.Block, &resource.Offset, &heap))
+				{
+					return 0;
+				}
+
+				HRESULT hr = m_Device->CreatePlacedResource(heap.Get(), resource.Offset, &texDesc, D3D12_RESOURCE_STATE_RENDER_TARGET, &clearValue, IID_PPV_ARGS(&resource.Texture));
+				if(FAILED(hr))
+				{
+					FreePlacement(resource.Block, resource.Offset);
+					return 0;
+				}
+
+				// The heap is the residency object, its priority was set when the heap was created
+				resource.Pageable			 = heap;
+				resource.NeedsInitialization = true;
+			}
+			else
+			{
+				HRESULT hr = m_Device->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &texDesc, D3D12_RESOURCE_STATE_RENDER_TARGET, &clearValue, IID_PPV_ARGS(&resource.Texture));
+				if(FAILED(hr))
+				{
+					// Out of VRAM
+					return 0;
+				}
+				resource.Pageable = resource.Texture;
+			}
+		}
+		else if(kind == EVICTION_HELPER_RESOURCE_HEAP || kind == EVICTION_HELPER_RESOURCE_BUFFER_HEAP)
+		{
+			D3D12_HEAP_DESC heapDesc = {};
+			heapDesc.SizeInBytes	 = sizeBytes;
+			heapDesc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+			heapDesc.Alignment		 = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+			heapDesc.Flags			 = (kind == EVICTION_HELPER_RESOURCE_BUFFER_HEAP) ? D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS : D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+			if(FAILED(m_Device->CreateHeap(&heapDesc, IID_PPV_ARGS(&resource.Heap))))
+			{
+				return 0;
+			}
+			resource.Pageable = resource.Heap;
+		}
+		else
+		{
+			return 0;
+		}
+
+		// Set residency priority
+		if(resource.Block == UINT_MAX)
+		{
+			ID3D12Pageable*			 pageable		   = resource.Pageable.Get();
+			D3D12_RESIDENCY_PRIORITY residencyPriority = IndexToPriority(priority);
+			m_Device->SetResidencyPriority(1, &pageable, &residencyPriority);
+		}
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if(resource.Texture)
+		{
+			// Create RTV
+			resource.RtvIndex = AllocateRtv();
+			m_Device->CreateRenderTargetView(resource.Texture.Get(), nullptr, GetRtvHandle(resource.RtvIndex));
+		}
+
+		if(!m_FreeSlots.empty())
+		{
+			UINT slot = m_FreeSlots.back();
+			m_FreeSlots.pop_back();
+			m_Resources[slot] = std::move(resource);
+			return slot + 1;
+		}
+		m_Resources.push_back(std::move(resource));
+		return m_Resources.size();
+	}
+
+	void DestroyResource(EvictionHelperResource handle) override
+	{
+		// The last references are released outside the lock
+		Resource						   removed;
+		Microsoft::WRL::ComPtr<ID3D12Heap> emptyHeap;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			Resource*					resource = Get(handle);
+			if(!resource)
+				return;
+
+			if(resource->RtvIndex != UINT_MAX)
+			{
+				m_FreeRtvs.push_back(resource->RtvIndex);
+			}
+			if(resource->Block != UINT_MAX)
+			{
+				emptyHeap = FreePlacementLocked(resource->Block, resource->Offset, resource->Evicted);
+			}
+			removed	  = std::move(*resource);
+			*resource = Resource();
+			m_FreeSlots.push_back(static_cast<UINT>(handle - 1));
+		}
+	}
+
+	void SetResidencyPriority(EvictionHelperResource handle, int priority) override
+	{
+		SetResidencyPriorities(&handle, 1, priority);
+	}
+
+	// The pageables are gathered into contiguous arrays and submitted with a single SetResidencyPriority() call
+	// The arrays are kept between calls and hold references, so the objects stay alive once the table lock is
+	// released and the worker can keep destroying resources while the call runs
+	void SetResidencyPriorities(const EvictionHelperResource* handles, uint32_t count, int priority) override
+	{
+		std::lock_guard<std::mutex> batchLock(m_BatchMutex);
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			for(uint32_t i = 0; i < count; i++)
+			{
+				Resource* resource = Get(handles[i]);
+				if(!resource)
+					continue;
+
+				// Placed resources share the priority of their heap, which only needs to be set once
+				if(resource->Block != UINT_MAX && !m_PlacementHeaps.SetPriority(resource->Block, priority))
+					continue;
+				m_BatchRefs.push_back(resource->Pageable);
+			}
+		}
+
+		if(!m_BatchRefs.empty())
+		{
+			for(const Microsoft::WRL::ComPtr<ID3D12Pageable>& pageable : m_BatchRefs)
+			{
+				m_BatchPageables.push_back(pageable.Get());
+			}
+			m_BatchPriorities.assign(m_BatchPageables.size(), IndexToPriority(priority));
+			m_Device->SetResidencyPriority(static_cast<UINT>(m_BatchPageables.size()), m_BatchPageables.data(), m_BatchPriorities.data());
+		}
+
+		m_BatchRefs.clear();
+		m_BatchPageables.clear();
+	}
+
+	bool Evict(const EvictionHelperResource* handles, uint32_t count) override
+	{
+		std::lock_guard<std::mutex> batchLock(m_BatchMutex);
+		GatherResidencyBatch(handles, count, true);
+
+		HRESULT hr = m_BatchPageables.empty() ? S_OK : m_Device->Evict(static_cast<UINT>(m_BatchPageables.size()), m_BatchPageables.data());
+		EndResidencyBatch(SUCCEEDED(hr));
+		return SUCCEEDED(hr);
+	}
+
+	bool MakeResident(const EvictionHelperResource* handles, uint32_t count) override
+	{
+		std::lock_guard<std::mutex> batchLock(m_BatchMutex);
+		GatherResidencyBatch(handles, count, false);
+
+		HRESULT hr = m_BatchPageables.empty() ? S_OK : m_Device->MakeResident(static_cast<UINT>(m_BatchPageables.size()), m_BatchPageables.data());
+		EndResidencyBatch(SUCCEEDED(hr));
+		return SUCCEEDED(hr);
+	}
+
+	uint64_t EnqueueMakeResident(const EvictionHelperResource* handles, uint32_t count) override
+	{
+		if(!m_Device3 || !m_ResidencyFence)
+			return 0;
+
+		std::lock_guard<std::mutex> batchLock(m_BatchMutex);
+		GatherResidencyBatch(handles, count, false);
+
+		UINT64	fenceValue = ++m_ResidencyFenceValue;
+		HRESULT hr		   = S_OK;
+		if(m_BatchPageables.empty())
+			hr = m_ResidencyFence->Signal(fenceValue);
+		else
+			hr = m_Device3->EnqueueMakeResident(D3D12_RESIDENCY_FLAG_NONE, static_cast<UINT>(m_BatchPageables.size()), m_BatchPageables.data(), m_ResidencyFence.Get(), fenceValue);
+		EndResidencyBatch(SUCCEEDED(hr));
+		return SUCCEEDED(hr) ? fenceValue : 0;
+	}
+
+	uint64_t GetCompletedResidencyFenceValue() override
+	{
+		return m_ResidencyFence ? m_ResidencyFence->GetCompletedValue() : 0;
+	}
+
+	// Rounded down to a power of two so the buddy allocator can use the whole heap
+	void SetPlacementHeapSize(uint64_t heapSizeBytes) override
+	{
+		uint64_t heapSize = 0;
+		if(heapSizeBytes >= D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT)
+		{
+			heapSize = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+			while(heapSize * 2 <= heapSizeBytes)
+				heapSize *= 2;
+		}
+		m_PlacementHeapSize.store(heapSize, std::memory_order_relaxed);
+	}
+
+	void BeginFrame(uint64_t frameIndex) override
+	{
+		(void)frameIndex;
+	}
+
+	void TouchResource(EvictionHelperResource handle) override
+	{
+		TouchResourcePartial(handle, 1.0f);
+	}
+
+	// Clear the top rows of the render target, the whole render target stays resident
+	void TouchResourcePartial(EvictionHelperResource handle, float coverage) override
+	{
+		// Simple clear operation to the render target to ensure it stays resident
+		// Use the same color as D3D12_CLEAR_VALUE when creating the resources to avoid debug warnings
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		Resource*					resource = Get(handle);
+		if(!resource || resource->RtvIndex == UINT_MAX || !m_CommandList)
+			return;
+
+		// Placed render targets start with undefined contents and must be initialized before the first partial clear,
+		// this is recorded here because resources are created on the allocation worker while the frame thread owns the
+		// command list
+		if(resource->NeedsInitialization)
+		{
+			m_CommandList->DiscardResource(resource->Texture.Get(), nullptr);
+			resource->NeedsInitialization = false;
+		}
+
+		const float clearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+		if(coverage >= 1.0f)
+		{
+			m_CommandList->ClearRenderTargetView(GetRtvHandle(resource->RtvIndex), clearColor, 0, nullptr);
+			return;
+		}
+
+		D3D12_RECT rect = {};
+		rect.right		= RT_WIDTH;
+		rect.bottom		= std::max(static_cast<LONG>(resource->Height * coverage), 1L);
+		m_CommandList->ClearRenderTargetView(GetRtvHandle(resource->RtvIndex), clearColor, 1, &rect);
+	}
+
+	void EndFrame() override
+	{
+	}
+
+	void WaitForIdle() override
+	{
+		std::lock_guard<std::mutex> lock(m_FenceMutex);
+		UINT64						fenceValue = ++m_FenceValue;
+		m_CommandQueue->Signal(m_Fence.Get(), fenceValue);
+		if(m_Fence->GetCompletedValue() < fenceValue)
+		{
+			m_Fence->SetEventOnCompletion(fenceValue, m_FenceEvent);
+			WaitForSingleObject(m_FenceEvent, INFINITE);
+		}
+	}
+
+	uint64_t Signal() override
+	{
+		std::lock_guard<std::mutex> lock(m_FenceMutex);
+		UINT64						fenceValue = ++m_FenceValue;
+		m_CommandQueue->Signal(m_Fence.Get(), fenceValue);
+		return fenceValue;
+	}
+
+	uint64_t GetCompletedFenceValue() override
+	{
+		return m_Fence->GetCompletedValue();
+	}
+
+	void QueryMemoryInfo(EvictionHelperMemoryInfo* outLocal, EvictionHelperMemoryInfo* outNonLocal) override
+	{
+		DXGI_QUERY_VIDEO_MEMORY_INFO localInfo	  = {};
+		DXGI_QUERY_VIDEO_MEMORY_INFO nonLocalInfo = {};
+
+		m_Adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &localInfo);
+		m_Adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_NON_LOCAL, &nonLocalInfo);
+
+		outLocal->Budget				  = localInfo.Budget;
+		outLocal->CurrentUsage			  = localInfo.CurrentUsage;
+		outLocal->AvailableForReservation = localInfo.AvailableForReservation;
+		outLocal->CurrentReservation	  = localInfo.CurrentReservation;
+
+		outNonLocal->Budget					 = nonLocalInfo.Budget;
+		outNonLocal->CurrentUsage			 = nonLocalInfo.CurrentUsage;
+		outNonLocal->AvailableForReservation = nonLocalInfo.AvailableForReservation;
+		outNonLocal->CurrentReservation		 = nonLocalInfo.CurrentReservation;
+	}
+
+	bool SupportsBudgetChangeNotifications() override
+	{
+		return m_BudgetEvent && m_BudgetCancelEvent;
+	}
+
+	bool WaitForBudgetChange(uint64_t timeoutNs) override
+	{
+		if(!SupportsBudgetChangeNotifications())
+			return false;
+
+		HANDLE events[2] = { m_BudgetEvent, m_BudgetCancelEvent };
+		DWORD  timeoutMs = static_cast<DWORD>((timeoutNs + 999999) / 1000000);
+		return WaitForMultipleObjects(2, events, FALSE, timeoutMs) == WAIT_OBJECT_0;
+	}
+
+	void CancelBudgetChangeWait() override
+	{
+		if(m_BudgetCancelEvent)
+		{
+			SetEvent(m_BudgetCancelEvent);
+		}
+	}
+
+private:
+	struct Resource
+	{
+		Microsoft::WRL::ComPtr<ID3D12Pageable> Pageable; // The placement heap for placed render targets
+		Microsoft::WRL::ComPtr<ID3D12Resource> Texture;
+		Microsoft::WRL::ComPtr<ID3D12Heap>	   Heap;
+		UINT								   RtvIndex			   = UINT_MAX;
+		UINT								   Height			   = 0;
+		UINT								   Block			   = UINT_MAX; // Block of m_PlacementHeaps for placed render targets
+		UINT64								   Offset			   = 0;
+		bool								   NeedsInitialization = false; // Placed render target that has not been discarded or cleared yet
+		bool								   Evicted			   = false; // Set by Evict(), cleared by MakeResident()
+	};
+
+	// Mark the resources of a residency batch and collect the pageables that change residency into m_BatchPageables
+	// Residency calls are reference counted, so resources already in the requested state are skipped and a placement
+	// heap is only added with its first evicted resource or its last one made resident
+	// Called with m_BatchMutex held, EndResidencyBatch() finishes the batch
+	void GatherResidencyBatch(const EvictionHelperResource* handles, uint32_t count, bool evict)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			for(uint32_t i = 0; i < count; i++)
+			{
+				Resource* resource = Get(handles[i]);
+				if(!resource || resource->Evicted == evict)
+					continue;
+
+				resource->Evicted = evict;
+				m_BatchResources.emplace_back(handles[i], GetIdentity(*resource));
+				if(resource->Block != UINT_MAX)
+				{
+					bool heapChanged = evict ? m_PlacementHeaps.Evict(resource->Block) : m_PlacementHeaps.MakeResident(resource->Block);
+					if(!heapChanged)
+						continue;
+				}
+				m_BatchRefs.push_back(resource->Pageable);
+			}
+			m_BatchEvict = evict;
+		}
+
+		for(const Microsoft::WRL::ComPtr<ID3D12Pageable>& pageable : m_BatchRefs)
+		{
+			m_BatchPageables.push_back(pageable.Get());
+		}
+	}
+
+	// Undo the marks of a batch the device call failed for, so the core can retry it
+	void EndResidencyBatch(bool succeeded)
+	{
+		if(!succeeded)
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			for(const auto& batchResource : m_BatchResources)
+			{
+				Resource* resource = Get(batchResource.first);
+				if(!resource || resource->Evicted != m_BatchEvict || GetIdentity(*resource) != batchResource.second)
+					continue;
+
+				resource->Evicted = !m_BatchEvict;
+				if(resource->Block != UINT_MAX)
+				{
+					if(m_BatchEvict)
+						m_PlacementHeaps.MakeResident(resource->Block);
+					else
+						m_PlacementHeaps.Evict(resource->Block);
+				}
+			}
+		}
+
+		m_BatchResources.clear();
+		m_BatchRefs.clear();
+		m_BatchPageables.clear();
+	}
+
+	// The D3D12 object only this resource holds, the batch keeps a reference so a reused slot can be told apart
+	static Microsoft::WRL::ComPtr<ID3D12Pageable> GetIdentity(const Resource& resource)
+	{
+		if(resource.Texture)
+			return resource.Texture;
+		return resource.Pageable;
+	}
+
+	// Find room for a placed resource in a heap of its placement group and priority, creating a new heap if none has room
+	// The heap is created outside the lock. Render targets are only created by the allocation worker, and two
+	// threads racing here would only create one heap too many.
+	bool AllocatePlacement(UINT64 sizeBytes, UINT64 heapSize, int priority, uint64_t placementGroup, UINT* outBlock, UINT64* outOffset, Microsoft::WRL::ComPtr<ID3D12Heap>* outHeap)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			if(m_PlacementHeaps.Allocate(placementGroup, priority, heapSize, sizeBytes, outBlock, outOffset))
+			{
+				*outHeap = m_BlockHeaps[*outBlock];
+				return true;
+			}
+		}
+
+		D3D12_HEAP_DESC heapDesc = {};
+		heapDesc.SizeInBytes	 = heapSize;
+		heapDesc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+		heapDesc.Alignment		 = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+		heapDesc.Flags			 = D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+
+		Microsoft::WRL::ComPtr<ID3D12Heap> heap;
+		if(FAILED(m_Device->CreateHeap(&heapDesc, IID_PPV_ARGS(&heap))))
+		{
+			return false;
+		}
+
+		ID3D12Pageable*			 pageable		   = heap.Get();
+		D3D12_RESIDENCY_PRIORITY residencyPriority = IndexToPriority(priority);
+		m_Device->SetResidencyPriority(1, &pageable, &residencyPriority);
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		*outBlock = m_PlacementHeaps.AddBlock(placementGroup, priority, heapSize, sizeBytes, outOffset);
+		if(*outBlock >= m_BlockHeaps.size())
+			m_BlockHeaps.resize(*outBlock + 1);
+		m_BlockHeaps[*outBlock] = heap;
+		*outHeap				= heap;
+		return true;
+	}
+
+	void FreePlacement(UINT blockIndex, UINT64 offset)
+	{
+		Microsoft::WRL::ComPtr<ID3D12Heap> emptyHeap;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			emptyHeap = FreePlacementLocked(blockIndex, offset, false);
+		}
+	}
+
+	// Returns the heap once its last resource is gone so the caller can release it outside the lock
+	Microsoft::WRL::ComPtr<ID3D12Heap> FreePlacementLocked(UINT blockIndex, UINT64 offset, bool evicted)
+	{
+		if(!m_PlacementHeaps.Free(blockIndex, offset, evicted))
+			return nullptr;
+		return std::move(m_BlockHeaps[blockIndex]);
+	}
+
+	Resource* Get(EvictionHelperResource handle)
+	{
+		if(handle == 0 || handle > m_Resources.size() || !m_Resources[handle - 1].Pageable)
+			return nullptr;
+		return &m_Resources[handle - 1];
+	}
+
+	D3D12_CPU_DESCRIPTOR_HANDLE GetRtvHandle(UINT index) const
+	{
+		D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle = m_RtvHeap->GetCPUDescriptorHandleForHeapStart();
+		rtvHandle.ptr += static_cast<SIZE_T>(index) * m_RtvDescriptorSize;
+		return rtvHandle;
+	}
+
+	// Take a free RTV slot, growing the RTV heap if needed
+	// RTV heaps are not shader visible, so existing descriptors can be copied into the new heap
+	UINT AllocateRtv()
+	{
+		if(m_FreeRtvs.empty())
+		{
+			UINT oldCount = m_RtvHeap ? m_RtvHeap->GetDesc().NumDescriptors : 0;
+			UINT newCount = oldCount * 2 + 64;
+
+			D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+			heapDesc.Type						= D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
+			heapDesc.NumDescriptors				= newCount;
+
+			Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> newHeap;
+			m_Device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(&newHeap));
+			if(oldCount > 0)
+			{
+				m_Device->CopyDescriptorsSimple(oldCount, newHeap->GetCPUDescriptorHandleForHeapStart(), m_RtvHeap->GetCPUDescriptorHandleForHeapStart(), D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+			}
+			m_RtvHeap = newHeap;
+
+			for(UINT i = newCount; i > oldCount; i--)
+			{
+				m_FreeRtvs.push_back(i - 1);
+			}
+		}
+
+		UINT index = m_FreeRtvs.back();
+		m_FreeRtvs.pop_back();
+		return index;
+	}
+
+	Microsoft::WRL::ComPtr<ID3D12Device1>		 m_Device;
+	Microsoft::WRL::ComPtr<IDXGIAdapter3>		 m_Adapter;
+	Microsoft::WRL::ComPtr<ID3D12CommandQueue>	 m_CommandQueue;
+	Microsoft::WRL::ComPtr<ID3D12Fence>			 m_Fence;
+	Microsoft::WRL::ComPtr<ID3D12Device3>		 m_Device3;
+	Microsoft::WRL::ComPtr<ID3D12Fence>			 m_ResidencyFence;
+	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_RtvHeap;
+	std::mutex									 m_FenceMutex;
+	std::mutex									 m_Mutex;
+	ID3D12GraphicsCommandList*					 m_CommandList		 = nullptr;
+	HANDLE										 m_FenceEvent		 = nullptr;
+	UINT64										 m_FenceValue		 = 0;
+	UINT										 m_RtvDescriptorSize = 0;
+	std::vector<Resource>						 m_Resources;
+	std::vector<UINT>							 m_FreeSlots;
+	std::vector<UINT>							 m_FreeRtvs;
+	EvictionHelperPlacementHeaps				 m_PlacementHeaps;
+	std::atomic<uint64_t>						 m_PlacementHeapSize{ 0 };
+
+	// Heap of each block of m_PlacementHeaps, protected by m_Mutex
+	std::vector<Microsoft::WRL::ComPtr<ID3D12Heap>> m_BlockHeaps;
+
+	// Scratch arrays for batched priority and residency calls, protected by m_BatchMutex
+	std::mutex											m_BatchMutex;
+	UINT64												m_ResidencyFenceValue = 0;
+	bool												m_BatchEvict		  = false;
+	std::vector<Microsoft::WRL::ComPtr<ID3D12Pageable>> m_BatchRefs;
+	std::vector<ID3D12Pageable*>						m_BatchPageables;
+	std::vector<D3D12_RESIDENCY_PRIORITY>				m_BatchPriorities;
+
+	// Resources marked by the current residency batch, protected by m_BatchMutex
+	std::vector<std::pair<EvictionHelperResource, Microsoft::WRL::ComPtr<ID3D12Pageable>>> m_BatchResources;
+
+	// Budget change notification, m_BudgetEvent is null if the adapter could not register it
+	HANDLE m_BudgetEvent	   = nullptr;
+	HANDLE m_BudgetCancelEvent = nullptr;
+	DWORD  m_BudgetCookie	   = 0;
+};
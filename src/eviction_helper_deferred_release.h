@@ -0,0 +1,114 @@
+#pragma once
+
+#include "eviction_helper_device.h"
+#include "eviction_helper_allocation_worker.h"
+
+#include <cstdint>
+#include <deque>
+
+// Resources removed from a pool wait here until the frames that used them have completed on the device
+// Each resource is tagged with the fence value of the last frame signaled before it was released, so it is
+// retired without draining the GPU. Retired resources are handed to the allocation worker in FIFO order, limited
+// to a number of bytes per frame so a large shrink does not cause a burst of kernel frees in a single frame.
+// Resources must only be released between frames, after SignalFrame() and before the next touches are recorded.
+class EvictionHelperDeferredReleaseQueue
+{
+public:
+	explicit EvictionHelperDeferredReleaseQueue(EvictionHelperDevice* device)
+		: m_Device(device)
+	{
+	}
+
+	EvictionHelperDeferredReleaseQueue(const EvictionHelperDeferredReleaseQueue&)			 = delete;
+	EvictionHelperDeferredReleaseQueue& operator=(const EvictionHelperDeferredReleaseQueue&) = delete;
+
+	// Call once the work of a frame has been submitted, resources released after this wait for that frame
+	void SignalFrame()
+	{
+		m_FrameFenceValue = m_Device->Signal();
+	}
+
+	// Queue a resource that no new work will use
+	void Push(EvictionHelperResource resource, uint64_t sizeBytes)
+	{
+		Entry entry;
+		entry.Resource	 = resource;
+		entry.SizeBytes	 = sizeBytes;
+		entry.FenceValue = m_FrameFenceValue;
+		m_Entries.push_back(entry);
+		m_PendingBytes += sizeBytes;
+	}
+
+	// Hand resources whose frames have completed to the worker for destruction, returns the bytes handed over
+	// At most budgetBytes are retired per call (0 = no limit), but always at least one resource so that
+	// resources larger than the budget still make progress
+	uint64_t Retire(EvictionHelperAllocationWorker* worker, uint64_t budgetBytes)
+	{
+		if(m_Entries.empty())
+			return 0;
+
+		uint64_t completedValue = m_Device->GetCompletedFenceValue();
+		uint64_t retiredBytes	= 0;
+
+		EvictionHelperAllocationRequest request = {};
+		request.Device							= m_Device;
+		request.Type							= EVICTION_HELPER_ALLOCATION_DESTROY;
+		while(!m_Entries.empty())
+		{
+			const Entry& entry = m_Entries.front();
+			if(entry.FenceValue > completedValue)
+				break;
+			if(budgetBytes > 0 && retiredBytes > 0 && retiredBytes + entry.SizeBytes > budgetBytes)
+				break;
+
+			request.Resource  = entry.Resource;
+			request.SizeBytes = entry.SizeBytes;
+			if(!worker->PushRequest(request))
+				break;
+
+			retiredBytes += entry.SizeBytes;
+			m_PendingBytes -= entry.SizeBytes;
+			m_Entries.pop_front();
+		}
+		return retiredBytes;
+	}
+
+	// Wait for the device and destroy everything right away, the allocation worker must be stopped
+	void Flush()
+	{
+		if(m_Entries.empty())
+			return;
+
+		m_Device->WaitForIdle();
+		for(const Entry& entry : m_Entries)
+		{
+			m_Device->DestroyResource(entry.Resource);
+		}
+		m_Entries.clear();
+		m_PendingBytes = 0;
+	}
+
+	// Bytes waiting for their frame to complete or for the per-frame budget
+	uint64_t GetPendingBytes() const
+	{
+		return m_PendingBytes;
+	}
+
+	bool IsEmpty() const
+	{
+		return m_Entries.empty();
+	}
+
+private:
+	struct Entry
+	{
+		EvictionHelperResource Resource;
+		uint64_t			   SizeBytes;
+		uint64_t			   FenceValue;
+	};
+
+	EvictionHelperDevice* m_Device;
+	std::deque<Entry>	  m_Entries;
+	uint64_t			  m_FrameFenceValue = 0;
+	uint64_t			  m_PendingBytes	= 0;
+};
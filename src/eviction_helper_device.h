@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstdint>
+
+// Opaque handle to a resource created by an EvictionHelperDevice, 0 is never a valid handle
+typedef uint64_t EvictionHelperResource;
+
+// Kinds of resources a device can create
+#define EVICTION_HELPER_RESOURCE_RENDER_TARGET 0 // Render target, touched by clearing it
+#define EVICTION_HELPER_RESOURCE_HEAP          1 // Bare heap for render targets and depth stencils, only counts towards usage and cannot be touched
+#define EVICTION_HELPER_RESOURCE_HOST_MEMORY   2 // Host memory chunk, touched by writing every page
+#define EVICTION_HELPER_RESOURCE_BUFFER_HEAP   3 // Bare heap for buffers, otherwise like EVICTION_HELPER_RESOURCE_HEAP
+
+// Render targets are RT_WIDTH wide RGBA8 textures, their height follows from the requested size
+constexpr uint32_t RT_WIDTH	   = 2048;
+constexpr uint32_t RT_HEIGHT   = 2048;
+constexpr uint64_t RT_SIZE	   = static_cast<uint64_t>(RT_WIDTH) * RT_HEIGHT * 4; // 16 MB
+constexpr uint64_t RT_MAX_SIZE = static_cast<uint64_t>(RT_WIDTH) * 16384 * 4;	  // 128 MB, the maximum texture height
+
+// Mirrors DXGI_QUERY_VIDEO_MEMORY_INFO
+struct EvictionHelperMemoryInfo
+{
+	uint64_t Budget;
+	uint64_t CurrentUsage;
+	uint64_t AvailableForReservation;
+	uint64_t CurrentReservation;
+};
+
+// Abstraction of everything the helper needs from a graphics device
+// Implemented by the D3D12 backend, the host-memory backend and the simulated backend, so the
+// allocation and priority logic can run without a GPU
+// CreateResource() and DestroyResource() are called from the allocation worker and churn threads while the frame thread
+// uses the other methods, implementations must allow this.
+class EvictionHelperDevice
+{
+public:
+	virtual ~EvictionHelperDevice()
+	{
+	}
+
+	// Create a resource with an initial residency priority (EVICTION_HELPER_PRIORITY_*)
+	// Returns 0 if the device is out of memory
+	virtual EvictionHelperResource CreateResource(uint32_t kind, uint64_t sizeBytes, int priority) = 0;
+	virtual void				   DestroyResource(EvictionHelperResource resource)				   = 0;
+
+	// Like CreateResource(), for resources with an owner. Backends that place render targets in shared heaps only
+	// share a heap between resources of the same placementGroup, so priority and residency calls for one owner never
+	// change another. Pools pass their address, 0 is the group of resources without an owner.
+	virtual EvictionHelperResource CreateGroupedResource(uint32_t kind, uint64_t sizeBytes, int priority, uint64_t placementGroup)
+	{
+		(void)placementGroup;
+		return CreateResource(kind, sizeBytes, priority);
+	}
+
+	// Change the residency priority (EVICTION_HELPER_PRIORITY_*) of a resource
+	virtual void SetResidencyPriority(EvictionHelperResource resource, int priority) = 0;
+
+	// Change the residency priority of many resources at once, backends submit them in as few calls as possible
+	virtual void SetResidencyPriorities(const EvictionHelperResource* resources, uint32_t count, int priority)
+	{
+		for(uint32_t i = 0; i < count; i++)
+		{
+			SetResidencyPriority(resources[i], priority);
+		}
+	}
+
+	// Place render targets created from now on in shared heaps of this size instead of one allocation each,
+	// 0 = one allocation per render target. Backends without placed resources ignore it.
+	virtual void SetPlacementHeapSize(uint64_t heapSizeBytes)
+	{
+		(void)heapSizeBytes;
+	}
+
+	// Page resources out of and back into local memory like ID3D12Device::Evict() and MakeResident(), both block
+	// until the paging is done. The calls are reference counted, a resource evicted twice has to be made resident
+	// twice. Return false if the backend cannot do it or ran out of memory.
+	virtual bool Evict(const EvictionHelperResource* resources, uint32_t count)
+	{
+		(void)resources;
+		(void)count;
+		return false;
+	}
+
+	virtual bool MakeResident(const EvictionHelperResource* resources, uint32_t count)
+	{
+		(void)resources;
+		(void)count;
+		return false;
+	}
+
+	// Like ID3D12Device3::EnqueueMakeResident(): start paging resources in and return right away with a value that
+	// GetCompletedResidencyFenceValue() reaches once they are resident. The resources must not be used before that.
+	// Returns 0 if the backend cannot do it.
+	virtual uint64_t EnqueueMakeResident(const EvictionHelperResource* resources, uint32_t count)
+	{
+		(void)resources;
+		(void)count;
+		return 0;
+	}
+
+	virtual uint64_t GetCompletedResidencyFenceValue()
+	{
+		return 0;
+	}
+
+	// Resources touched between BeginFrame() and EndFrame() are used by that frame's work
+	virtual void BeginFrame(uint64_t frameIndex)				= 0;
+	virtual void TouchResource(EvictionHelperResource resource) = 0;
+	virtual void EndFrame()										= 0;
+
+	// Touch only the first part of a resource, coverage is 0-1. Residency is tracked per resource on a GPU, so this
+	// keeps the whole resource resident while writing less memory. Defaults to touching the whole resource.
+	virtual void TouchResourcePartial(EvictionHelperResource resource, float coverage)
+	{
+		(void)coverage;
+		TouchResource(resource);
+	}
+
+	// Block until all submitted work has finished, required before destroying resources used by it
+	virtual void WaitForIdle() = 0;
+
+	// Called once the work of a frame has been submitted, returns a fence value that GetCompletedFenceValue()
+	// reaches when that work has finished. Resources used up to that frame can be destroyed from then on.
+	virtual uint64_t Signal()				  = 0;
+	virtual uint64_t GetCompletedFenceValue() = 0;
+
+	// Equivalent of IDXGIAdapter3::QueryVideoMemoryInfo for the local and non-local segment groups
+	virtual void QueryMemoryInfo(EvictionHelperMemoryInfo* outLocal, EvictionHelperMemoryInfo* outNonLocal) = 0;
+
+	// Like IDXGIAdapter3::RegisterVideoMemoryBudgetChangeNotificationEvent(): true if WaitForBudgetChange() can block
+	// until the OS reports a budget change. Backends without notifications are only polled with QueryMemoryInfo().
+	virtual bool SupportsBudgetChangeNotifications()
+	{
+		return false;
+	}
+
+	// Block until the OS reports a budget change, the timeout expires or CancelBudgetChangeWait() is called
+	// Returns true only for a report. A notification does not guarantee that the budget actually changed.
+	virtual bool WaitForBudgetChange(uint64_t timeoutNs)
+	{
+		(void)timeoutNs;
+		return false;
+	}
+
+	// Make the current or next WaitForBudgetChange() return, callable from any thread
+	virtual void CancelBudgetChangeWait() {}
+};
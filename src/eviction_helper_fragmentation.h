@@ -0,0 +1,128 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <map>
+
+// CPU-side model of how a sequence of heap creations and destructions fragments an address range
+// Every block is placed first-fit into the holes left by freed blocks, or appended at the end. This is what a
+// simple driver allocator does with a heap table, the real placement in VRAM is not visible to applications.
+// The model only depends on the order of Allocate() and Free(), so it reports the same numbers on every device.
+class EvictionHelperFragmentationModel
+{
+public:
+	// Place a block and return its offset
+	uint64_t Allocate(uint64_t sizeBytes)
+	{
+		for(auto it = m_FreeBlocks.begin(); it != m_FreeBlocks.end(); ++it)
+		{
+			if(it->second < sizeBytes)
+				continue;
+
+			uint64_t offset	   = it->first;
+			uint64_t remaining = it->second - sizeBytes;
+			m_FreeBlocks.erase(it);
+			if(remaining > 0)
+				m_FreeBlocks[offset + sizeBytes] = remaining;
+			m_FreeBytes -= sizeBytes;
+			m_AllocatedBytes += sizeBytes;
+			m_BlockCount++;
+			return offset;
+		}
+
+		uint64_t offset = m_EndOffset;
+		m_EndOffset += sizeBytes;
+		m_AllocatedBytes += sizeBytes;
+		m_BlockCount++;
+		return offset;
+	}
+
+	// Free a block returned by Allocate() and merge it with neighbouring holes
+	// A hole at the end shrinks the used range instead
+	void Free(uint64_t offset, uint64_t sizeBytes)
+	{
+		m_AllocatedBytes -= sizeBytes;
+		m_BlockCount--;
+		m_FreeBytes += sizeBytes;
+
+		auto next = m_FreeBlocks.lower_bound(offset);
+		if(next != m_FreeBlocks.end() && offset + sizeBytes == next->first)
+		{
+			sizeBytes += next->second;
+			next = m_FreeBlocks.erase(next);
+		}
+		if(next != m_FreeBlocks.begin())
+		{
+			auto previous = std::prev(next);
+			if(previous->first + previous->second == offset)
+			{
+				offset = previous->first;
+				sizeBytes += previous->second;
+				m_FreeBlocks.erase(previous);
+			}
+		}
+
+		if(offset + sizeBytes == m_EndOffset)
+		{
+			m_EndOffset = offset;
+			m_FreeBytes -= sizeBytes;
+		}
+		else
+		{
+			m_FreeBlocks[offset] = sizeBytes;
+		}
+	}
+
+	// Bytes in blocks
+	uint64_t GetAllocatedBytes() const
+	{
+		return m_AllocatedBytes;
+	}
+
+	// Bytes in holes between blocks
+	uint64_t GetFreeBytes() const
+	{
+		return m_FreeBytes;
+	}
+
+	uint64_t GetLargestFreeBlock() const
+	{
+		uint64_t largest = 0;
+		for(const auto& block : m_FreeBlocks)
+		{
+			largest = std::max(largest, block.second);
+		}
+		return largest;
+	}
+
+	uint32_t GetFreeBlockCount() const
+	{
+		return static_cast<uint32_t>(m_FreeBlocks.size());
+	}
+
+	uint32_t GetBlockCount() const
+	{
+		return m_BlockCount;
+	}
+
+	// End of the last block, allocated plus free bytes
+	uint64_t GetSpanBytes() const
+	{
+		return m_EndOffset;
+	}
+
+	// Share of the free bytes that is not in the largest hole, 0 = one hole or none, close to 1 = many small holes
+	double GetFragmentation() const
+	{
+		return (m_FreeBytes > 0) ? 1.0 - static_cast<double>(GetLargestFreeBlock()) / static_cast<double>(m_FreeBytes) : 0.0;
+	}
+
+private:
+	// Offset -> size of the holes below m_EndOffset
+	std::map<uint64_t, uint64_t> m_FreeBlocks;
+	uint64_t					 m_EndOffset	  = 0;
+	uint64_t					 m_FreeBytes	  = 0;
+	uint64_t					 m_AllocatedBytes = 0;
+	uint32_t					 m_BlockCount	  = 0;
+};
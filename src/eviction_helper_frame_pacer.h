@@ -0,0 +1,279 @@
+#pragma once
+
+#include "eviction_helper_shared.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32) && !defined(CREATE_WAITABLE_TIMER_HIGH_RESOLUTION)
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+// Frame rate while FrameRate is 0
+constexpr uint32_t FRAME_PACER_DEFAULT_FRAME_RATE = 30;
+
+// Frames the frame time percentiles are computed over, about 17 seconds at 30 FPS
+constexpr uint32_t FRAME_PACER_WINDOW = 512;
+
+struct EvictionHelperFramePacerStats
+{
+	uint64_t FrameTimeP50Ns; // Over the last FRAME_PACER_WINDOW frames
+	uint64_t FrameTimeP99Ns;
+	uint64_t FrameTimeMaxNs;
+	uint64_t LateMaxNs; // Latest frame start relative to its schedule, over the same frames
+	uint64_t SleepNs;	// Total time spent in the OS wait
+	uint64_t SpinNs;	// Total time spent spinning
+	uint64_t FrameTimeHistogram[EVICTION_HELPER_LATENCY_BUCKETS];
+};
+
+// Paces a frame loop on an absolute timeline, so a late frame does not push back the frames after it
+// Waits sleep on a high resolution timer until the spin tail before the deadline, then spin the rest with yields
+// because even a high resolution timer wakes up tens to hundreds of microseconds late. The timer is a high resolution
+// waitable timer on Windows (the millisecond timeouts of the wait functions round to the 15.6 ms system tick) and an
+// absolute CLOCK_MONOTONIC futex wait or clock_nanosleep() on Linux. Waits return early when a controller signals the
+// helper, so inputs and commands are still applied immediately.
+// Not thread safe, owned by the frame loop.
+class EvictionHelperFramePacer
+{
+public:
+	EvictionHelperFramePacer()
+	{
+		m_Stats = {};
+		m_FrameTimes.reserve(FRAME_PACER_WINDOW);
+		m_Lateness.reserve(FRAME_PACER_WINDOW);
+#ifdef _WIN32
+		m_Timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+		if(!m_Timer)
+		{
+			// Before Windows 10 1803, still better than the wait timeouts with timeBeginPeriod()
+			m_Timer = CreateWaitableTimerW(nullptr, FALSE, nullptr);
+		}
+#endif
+	}
+
+	~EvictionHelperFramePacer()
+	{
+#ifdef _WIN32
+		if(m_Timer)
+			CloseHandle(m_Timer);
+#endif
+	}
+
+	EvictionHelperFramePacer(const EvictionHelperFramePacer&)			 = delete;
+	EvictionHelperFramePacer& operator=(const EvictionHelperFramePacer&) = delete;
+
+	// 0 = FRAME_PACER_DEFAULT_FRAME_RATE, a change takes effect from the last frame start
+	void SetFrameRate(uint32_t framesPerSecond)
+	{
+		uint64_t intervalNs = 1000000000ULL / (framesPerSecond ? framesPerSecond : FRAME_PACER_DEFAULT_FRAME_RATE);
+		if(intervalNs != m_IntervalNs)
+		{
+			m_IntervalNs = intervalNs;
+			if(m_LastFrameNs != 0)
+				m_NextFrameNs = m_LastFrameNs + intervalNs;
+		}
+	}
+
+	// Part of each wait spent spinning instead of sleeping, 0 = sleep only
+	void SetSpinTail(uint64_t spinTailNs)
+	{
+		m_SpinTailNs = spinTailNs;
+	}
+
+	uint64_t GetIntervalNs() const
+	{
+		return m_IntervalNs;
+	}
+
+	// Start time of the next frame on the EvictionHelper_GetTimestampNs() clock, 0 before the first frame
+	uint64_t GetNextFrameNs() const
+	{
+		return m_NextFrameNs;
+	}
+
+	bool IsFrameDue(uint64_t nowNs) const
+	{
+		return nowNs >= m_NextFrameNs;
+	}
+
+	// Start a frame that is due, returns the time since the previous frame started (the interval for the first frame)
+	uint64_t BeginFrame(uint64_t nowNs)
+	{
+		uint64_t frameTimeNs = m_LastFrameNs ? nowNs - m_LastFrameNs : m_IntervalNs;
+		uint64_t lateNs		 = (m_NextFrameNs && nowNs > m_NextFrameNs) ? nowNs - m_NextFrameNs : 0;
+
+		// Stay on the timeline unless a whole frame was missed, then start a new one instead of catching up
+		m_NextFrameNs = m_NextFrameNs ? m_NextFrameNs + m_IntervalNs : nowNs + m_IntervalNs;
+		if(m_NextFrameNs <= nowNs)
+			m_NextFrameNs = nowNs + m_IntervalNs;
+		m_LastFrameNs = nowNs;
+
+		if(m_FrameTimes.size() < FRAME_PACER_WINDOW)
+		{
+			m_FrameTimes.push_back(frameTimeNs);
+			m_Lateness.push_back(lateNs);
+		}
+		else
+		{
+			m_FrameTimes[m_WindowIndex] = frameTimeNs;
+			m_Lateness[m_WindowIndex]	= lateNs;
+		}
+		m_WindowIndex = (m_WindowIndex + 1) % FRAME_PACER_WINDOW;
+		m_Stats.FrameTimeHistogram[EvictionHelper_GetLatencyBucket(frameTimeNs)]++;
+		UpdatePercentiles();
+		return frameTimeNs;
+	}
+
+	// Wait until wakeNs (EvictionHelper_GetTimestampNs() clock) or until the wake counter of sharedMem (optional) is no
+	// longer lastWakeCounter. With windowMessages the sleep also ends when a message arrives for the thread (Windows).
+	// Returns true if wakeNs was reached
+	bool WaitUntil(uint64_t wakeNs, const EvictionHelperSharedMemory* sharedMem, uint32_t lastWakeCounter, bool windowMessages = false)
+	{
+		const std::atomic<uint32_t>* wakeCounter = sharedMem ? &sharedMem->pData->WakeCounter : nullptr;
+		if(wakeCounter && wakeCounter->load(std::memory_order_acquire) != lastWakeCounter)
+			return false;
+
+		uint64_t nowNs = EvictionHelper_GetTimestampNs();
+		if(nowNs + m_SpinTailNs < wakeNs)
+		{
+			uint64_t sleepStartNs = nowNs;
+			bool	 timerFired	  = SleepUntil(wakeNs - m_SpinTailNs, sharedMem, lastWakeCounter, windowMessages);
+			nowNs				  = EvictionHelper_GetTimestampNs();
+			m_Stats.SleepNs += nowNs - sleepStartNs;
+			if(!timerFired)
+				return nowNs >= wakeNs;
+		}
+
+		// Spin the rest, a signal still ends the wait
+		uint64_t spinStartNs = nowNs;
+		while(nowNs < wakeNs)
+		{
+			if(wakeCounter && wakeCounter->load(std::memory_order_acquire) != lastWakeCounter)
+				break;
+			std::this_thread::yield();
+			nowNs = EvictionHelper_GetTimestampNs();
+		}
+		m_Stats.SpinNs += nowNs - spinStartNs;
+		return nowNs >= wakeNs;
+	}
+
+	const EvictionHelperFramePacerStats& GetStats() const
+	{
+		return m_Stats;
+	}
+
+	// Write the frame rate inputs into the pacer and the stats into the outputs, once per frame
+	void Update(EvictionHelperSharedData* data)
+	{
+		SetFrameRate(data->FrameRate);
+		SetSpinTail(static_cast<uint64_t>(data->FrameSpinTailUs) * 1000ULL);
+
+		data->FrameTimePercentile50Ns = m_Stats.FrameTimeP50Ns;
+		data->FrameTimePercentile99Ns = m_Stats.FrameTimeP99Ns;
+		data->FrameTimeMaxNs		  = m_Stats.FrameTimeMaxNs;
+		data->FrameLateMaxNs		  = m_Stats.LateMaxNs;
+		data->FrameSleepTotalNs		  = m_Stats.SleepNs;
+		data->FrameSpinTotalNs		  = m_Stats.SpinNs;
+		for(uint32_t i = 0; i < EVICTION_HELPER_LATENCY_BUCKETS; i++)
+		{
+			data->FrameTimeHistogram[i] = m_Stats.FrameTimeHistogram[i];
+		}
+	}
+
+private:
+	void UpdatePercentiles()
+	{
+		m_Sorted = m_FrameTimes;
+		std::sort(m_Sorted.begin(), m_Sorted.end());
+		m_Stats.FrameTimeP50Ns = m_Sorted[(m_Sorted.size() - 1) / 2];
+		m_Stats.FrameTimeP99Ns = m_Sorted[(m_Sorted.size() - 1) * 99 / 100];
+		m_Stats.FrameTimeMaxNs = m_Sorted.back();
+		m_Stats.LateMaxNs	   = *std::max_element(m_Lateness.begin(), m_Lateness.end());
+	}
+
+	// Sleep on the OS timer until deadlineNs, returns false if a signal or a window message ended it early
+	bool SleepUntil(uint64_t deadlineNs, const EvictionHelperSharedMemory* sharedMem, uint32_t lastWakeCounter, bool windowMessages)
+	{
+		uint64_t nowNs = EvictionHelper_GetTimestampNs();
+		if(nowNs >= deadlineNs)
+			return true;
+#ifdef _WIN32
+		(void)lastWakeCounter;
+		HANDLE handles[2];
+		DWORD  handleCount = 0;
+		DWORD  timeoutMs   = INFINITE;
+		if(m_Timer)
+		{
+			// Relative due time in 100 ns units
+			LARGE_INTEGER dueTime;
+			dueTime.QuadPart = -static_cast<LONGLONG>(std::max<uint64_t>((deadlineNs - nowNs) / 100, 1));
+			SetWaitableTimer(m_Timer, &dueTime, 0, nullptr, nullptr, FALSE);
+			handles[handleCount++] = m_Timer;
+		}
+		else
+		{
+			timeoutMs = static_cast<DWORD>((deadlineNs - nowNs) / 1000000ULL);
+		}
+		if(sharedMem && sharedMem->hWakeEvent)
+			handles[handleCount++] = sharedMem->hWakeEvent;
+		if(handleCount == 0 && !windowMessages)
+		{
+			::Sleep(timeoutMs);
+			return true;
+		}
+
+		// The wake event is set after the counter is incremented, so a signal after the check in WaitUntil() still ends the wait
+		DWORD result = windowMessages ? MsgWaitForMultipleObjects(handleCount, handles, FALSE, timeoutMs, QS_ALLINPUT) : WaitForMultipleObjects(handleCount, handles, FALSE, timeoutMs);
+		if(m_Timer && result != WAIT_OBJECT_0)
+			CancelWaitableTimer(m_Timer);
+		return m_Timer ? result == WAIT_OBJECT_0 : result == WAIT_TIMEOUT;
+#elif defined(__linux__)
+		struct timespec deadline;
+		deadline.tv_sec	 = static_cast<time_t>(deadlineNs / 1000000000ULL);
+		deadline.tv_nsec = static_cast<long>(deadlineNs % 1000000000ULL);
+		if(sharedMem)
+		{
+			// FUTEX_WAIT_BITSET takes an absolute CLOCK_MONOTONIC deadline, the clock of EvictionHelper_GetTimestampNs()
+			syscall(SYS_futex, (uint32_t*)&sharedMem->pData->WakeCounter, FUTEX_WAIT_BITSET, lastWakeCounter, &deadline, NULL, FUTEX_BITSET_MATCH_ANY);
+			if(sharedMem->pData->WakeCounter.load(std::memory_order_acquire) != lastWakeCounter)
+				return false;
+		}
+		else
+		{
+			while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR)
+			{
+			}
+		}
+		(void)windowMessages;
+		return EvictionHelper_GetTimestampNs() >= deadlineNs;
+#else
+		(void)windowMessages;
+		if(sharedMem)
+			return EvictionHelper_WaitForSignal(sharedMem, lastWakeCounter, deadlineNs - nowNs) == lastWakeCounter;
+		struct timespec timeout;
+		timeout.tv_sec	= static_cast<time_t>((deadlineNs - nowNs) / 1000000000ULL);
+		timeout.tv_nsec = static_cast<long>((deadlineNs - nowNs) % 1000000000ULL);
+		nanosleep(&timeout, nullptr);
+		return true;
+#endif
+	}
+
+	uint64_t m_IntervalNs  = 1000000000ULL / FRAME_PACER_DEFAULT_FRAME_RATE;
+	uint64_t m_SpinTailNs  = 0;
+	uint64_t m_NextFrameNs = 0;
+	uint64_t m_LastFrameNs = 0;
+
+	// Frame times and lateness of the last FRAME_PACER_WINDOW frames, m_WindowIndex is the oldest once full
+	std::vector<uint64_t>		  m_FrameTimes;
+	std::vector<uint64_t>		  m_Lateness;
+	std::vector<uint64_t>		  m_Sorted;
+	uint32_t					  m_WindowIndex = 0;
+	EvictionHelperFramePacerStats m_Stats;
+
+#ifdef _WIN32
+	HANDLE m_Timer = nullptr;
+#endif
+};
@@ -0,0 +1,116 @@
+// Headless eviction-helper for Linux and other POSIX systems
+// Runs the same core and frame loop as the headless mode of the Windows app, with the VRAM pools on the simulated
+// device or on host memory. Controllers talk to it through the same shared memory, so the whole control path can be
+// soak-tested without Windows or a GPU.
+//
+// Build: g++ -std=c++17 -O2 -Isrc src/eviction_helper_headless.cpp src/eviction_helper_core.cpp -lpthread -lrt
+
+#include "eviction_helper_shared.h"
+#include "eviction_helper_core.h"
+#include "eviction_helper_sim_device.h"
+#include "eviction_helper_service.h"
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+// Shared memory, also used by the signal handler to stop the loop
+static EvictionHelperSharedMemory g_SharedMem = {};
+
+static void OnStopSignal(int)
+{
+	if(g_SharedMem.pData)
+	{
+		g_SharedMem.pData->RequestShutdown = 1;
+		EvictionHelper_SignalHelper(&g_SharedMem);
+	}
+}
+
+static void PrintUsage(const char* program)
+{
+	printf("Usage: %s [options]\n", program);
+	printf("  --vram sim|host             Device of the VRAM pools (default: sim)\n");
+	printf("  --budget-mb <MB>            Local budget of the simulated device (default: 8192)\n");
+	printf("  --non-local-mb <MB>         Non-local budget of the simulated device (default: 16384)\n");
+	printf("  --creation-latency-us <us>  Time each simulated resource creation takes (default: 0)\n");
+	printf("  --fps <frames>              Touches per second, FrameRate in shared memory (default: 30)\n");
+	printf("  --sync                      Allocate on the frame thread instead of the worker threads\n");
+}
+
+int main(int argc, char** argv)
+{
+	bool	 hostVRAM		   = false;
+	bool	 asyncAllocations  = true;
+	uint64_t budgetMB		   = 8192;
+	uint64_t nonLocalMB		   = 16384;
+	uint64_t creationLatencyUs = 0;
+	uint32_t framesPerSecond   = 30;
+	for(int i = 1; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+		if(!strcmp(argv[i], "--vram") && hasValue)
+			hostVRAM = !strcmp(argv[++i], "host");
+		else if(!strcmp(argv[i], "--budget-mb") && hasValue)
+			budgetMB = strtoull(argv[++i], nullptr, 10);
+		else if(!strcmp(argv[i], "--non-local-mb") && hasValue)
+			nonLocalMB = strtoull(argv[++i], nullptr, 10);
+		else if(!strcmp(argv[i], "--creation-latency-us") && hasValue)
+			creationLatencyUs = strtoull(argv[++i], nullptr, 10);
+		else if(!strcmp(argv[i], "--fps") && hasValue)
+			framesPerSecond = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+		else if(!strcmp(argv[i], "--sync"))
+			asyncAllocations = false;
+		else
+		{
+			PrintUsage(argv[0]);
+			return 1;
+		}
+	}
+	if(framesPerSecond == 0)
+	{
+		PrintUsage(argv[0]);
+		return 1;
+	}
+
+	if(!EvictionHelper_CreateSharedMemory(&g_SharedMem))
+	{
+		fprintf(stderr, "Failed to create shared memory\n");
+		return 1;
+	}
+	g_SharedMem.pData->IsRunning = 1;
+
+	signal(SIGINT, OnStopSignal);
+	signal(SIGTERM, OnStopSignal);
+
+	// VRAM pools on the simulated device, or on a second host memory device to put real pressure on the machine
+	std::unique_ptr<EvictionHelperDevice> vramDevice;
+	if(hostVRAM)
+	{
+		vramDevice.reset(new EvictionHelperHostDevice());
+	}
+	else
+	{
+		EvictionHelperSimDevice* simDevice = new EvictionHelperSimDevice(budgetMB << 20, nonLocalMB << 20);
+		simDevice->SetCreationLatency(creationLatencyUs * 1000);
+		vramDevice.reset(simDevice);
+	}
+	EvictionHelperHostDevice hostDevice;
+
+	{
+		EvictionHelperCore core(&g_SharedMem, vramDevice.get(), &hostDevice, asyncAllocations);
+		core.InitializeDefaults();
+		g_SharedMem.pData->FrameRate = framesPerSecond;
+
+		printf("eviction-helper running headless on the %s device, stop with Ctrl+C or RequestShutdown\n", hostVRAM ? "host memory" : "simulated");
+		EvictionHelper_RunService(&g_SharedMem, &core, nullptr);
+
+		// Release all allocations before the devices go away
+		core.Shutdown();
+	}
+
+	g_SharedMem.pData->IsRunning = 0;
+	EvictionHelper_CloseSharedMemory(&g_SharedMem);
+	return 0;
+}
@@ -0,0 +1,339 @@
+#pragma once
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#include "eviction_helper_device.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+// Host memory pools allocate chunks of this size
+constexpr uint64_t HOST_MEMORY_CHUNK_SIZE = 64ULL * 1024ULL * 1024ULL;
+
+// System page size, used as the stride when touching memory
+inline uint64_t HostMemory_GetPageSize()
+{
+#ifdef _WIN32
+	SYSTEM_INFO systemInfo;
+	GetSystemInfo(&systemInfo);
+	return systemInfo.dwPageSize;
+#else
+	return static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+// Allocate page-aligned, committed host memory
+// Returns nullptr if the OS refuses the allocation
+inline void* HostMemory_Allocate(uint64_t sizeBytes)
+{
+#ifdef _WIN32
+	return VirtualAlloc(nullptr, static_cast<SIZE_T>(sizeBytes), MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+	void* address = mmap(nullptr, static_cast<size_t>(sizeBytes), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	return (address == MAP_FAILED) ? nullptr : address;
+#endif
+}
+
+inline void HostMemory_Free(void* address, uint64_t sizeBytes)
+{
+#ifdef _WIN32
+	(void)sizeBytes;
+	VirtualFree(address, 0, MEM_RELEASE);
+#else
+	munmap(address, static_cast<size_t>(sizeBytes));
+#endif
+}
+
+// Write one byte per page so every page is faulted in and marked as recently used
+inline void HostMemory_TouchPages(void* address, uint64_t sizeBytes, uint64_t pageSize, uint8_t value)
+{
+	volatile uint8_t* bytes = static_cast<volatile uint8_t*>(address);
+	for(uint64_t offset = 0; offset < sizeBytes; offset += pageSize)
+	{
+		bytes[offset] = value;
+	}
+}
+
+// Ask the OS to take the pages out of RAM now instead of waiting for memory pressure
+// Returns false if the OS has no way to do that
+inline bool HostMemory_PageOut(void* address, uint64_t sizeBytes)
+{
+#ifdef _WIN32
+	// Unlocking pages that are not locked removes them from the working set, it reports ERROR_NOT_LOCKED on success
+	return VirtualUnlock(address, static_cast<SIZE_T>(sizeBytes)) || GetLastError() == ERROR_NOT_LOCKED;
+#elif defined(MADV_PAGEOUT)
+	return madvise(address, static_cast<size_t>(sizeBytes), MADV_PAGEOUT) == 0;
+#else
+	(void)address;
+	(void)sizeBytes;
+	return false;
+#endif
+}
+
+// Query physical memory and swap of the whole system
+inline void HostMemory_QuerySystemMemory(uint64_t* outTotalBytes, uint64_t* outAvailableBytes, uint64_t* outSwapTotalBytes, uint64_t* outSwapUsedBytes)
+{
+	*outTotalBytes	   = 0;
+	*outAvailableBytes = 0;
+	*outSwapTotalBytes = 0;
+	*outSwapUsedBytes  = 0;
+#ifdef _WIN32
+	MEMORYSTATUSEX status = {};
+	status.dwLength		  = sizeof(status);
+	if(GlobalMemoryStatusEx(&status))
+	{
+		*outTotalBytes	   = status.ullTotalPhys;
+		*outAvailableBytes = status.ullAvailPhys;
+		*outSwapTotalBytes = (status.ullTotalPageFile > status.ullTotalPhys) ? status.ullTotalPageFile - status.ullTotalPhys : 0;
+		*outSwapUsedBytes  = (status.ullTotalPageFile - status.ullAvailPageFile > status.ullTotalPhys - status.ullAvailPhys)
+								 ? (status.ullTotalPageFile - status.ullAvailPageFile) - (status.ullTotalPhys - status.ullAvailPhys)
+								 : 0;
+	}
+#else
+	FILE* file = fopen("/proc/meminfo", "r");
+	if(!file)
+		return;
+
+	char			   line[256];
+	unsigned long long swapFreeKB = 0;
+	while(fgets(line, sizeof(line), file))
+	{
+		unsigned long long valueKB = 0;
+		if(sscanf(line, "MemTotal: %llu kB", &valueKB) == 1)
+			*outTotalBytes = valueKB * 1024ULL;
+		else if(sscanf(line, "MemAvailable: %llu kB", &valueKB) == 1)
+			*outAvailableBytes = valueKB * 1024ULL;
+		else if(sscanf(line, "SwapTotal: %llu kB", &valueKB) == 1)
+			*outSwapTotalBytes = valueKB * 1024ULL;
+		else if(sscanf(line, "SwapFree: %llu kB", &valueKB) == 1)
+			swapFreeKB = valueKB;
+	}
+	fclose(file);
+	*outSwapUsedBytes = (*outSwapTotalBytes > swapFreeKB * 1024ULL) ? *outSwapTotalBytes - swapFreeKB * 1024ULL : 0;
+#endif
+}
+
+// Device backend that allocates host (system RAM) memory instead of GPU resources
+// Every resource is a page-aligned allocation whose pages are all committed on creation. Touching a
+// resource writes one byte per page, so active pools stay hot while idle pools can be reclaimed by the OS.
+// Host memory has no residency priority, the priority is only stored for reporting.
+// Evict() pushes the pages out of RAM (MADV_PAGEOUT, or trimming the working set on Windows) and MakeResident()
+// faults them back in by touching them, so both measure the OS paging path.
+// Local memory info reports physical RAM, non-local memory info reports swap.
+// All methods are thread safe. The slow parts (committing and freeing pages) run outside the lock.
+class EvictionHelperHostDevice : public EvictionHelperDevice
+{
+public:
+	EvictionHelperHostDevice()
+		: m_PageSize(HostMemory_GetPageSize())
+	{
+	}
+
+	~EvictionHelperHostDevice()
+	{
+		for(size_t i = 0; i < m_Allocations.size(); i++)
+		{
+			if(m_Allocations[i].Address)
+				HostMemory_Free(m_Allocations[i].Address, m_Allocations[i].SizeBytes);
+		}
+	}
+
+	EvictionHelperResource CreateResource(uint32_t kind, uint64_t sizeBytes, int priority) override
+	{
+		(void)kind;
+
+		// Round up to whole pages
+		sizeBytes = (sizeBytes + m_PageSize - 1) / m_PageSize * m_PageSize;
+
+		Allocation allocation;
+		allocation.SizeBytes = sizeBytes;
+		allocation.Priority	 = priority;
+		allocation.Address	 = HostMemory_Allocate(sizeBytes);
+		if(!allocation.Address)
+			return 0;
+
+		// Commit every page now, an untouched anonymous mapping does not consume memory
+		HostMemory_TouchPages(allocation.Address, sizeBytes, m_PageSize, 1);
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_AllocatedBytes += sizeBytes;
+
+		if(!m_FreeSlots.empty())
+		{
+			uint32_t slot = m_FreeSlots.back();
+			m_FreeSlots.pop_back();
+			m_Allocations[slot] = allocation;
+			return slot + 1;
+		}
+		m_Allocations.push_back(allocation);
+		return m_Allocations.size();
+	}
+
+	void DestroyResource(EvictionHelperResource resource) override
+	{
+		Allocation allocation;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			Allocation*					entry = Get(resource);
+			if(!entry)
+				return;
+
+			allocation = *entry;
+			m_AllocatedBytes -= entry->SizeBytes;
+			entry->Address = nullptr;
+			m_FreeSlots.push_back(static_cast<uint32_t>(resource - 1));
+		}
+		HostMemory_Free(allocation.Address, allocation.SizeBytes);
+	}
+
+	void SetResidencyPriority(EvictionHelperResource resource, int priority) override
+	{
+		SetResidencyPriorities(&resource, 1, priority);
+	}
+
+	void SetResidencyPriorities(const EvictionHelperResource* resources, uint32_t count, int priority) override
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		for(uint32_t i = 0; i < count; i++)
+		{
+			Allocation* allocation = Get(resources[i]);
+			if(allocation)
+				allocation->Priority = priority;
+		}
+	}
+
+	bool Evict(const EvictionHelperResource* resources, uint32_t count) override
+	{
+		bool succeeded = true;
+		for(uint32_t i = 0; i < count; i++)
+		{
+			void*	 address;
+			uint64_t sizeBytes;
+			if(GetResourceRange(resources[i], &address, &sizeBytes) && !HostMemory_PageOut(address, sizeBytes))
+				succeeded = false;
+		}
+		return succeeded;
+	}
+
+	bool MakeResident(const EvictionHelperResource* resources, uint32_t count) override
+	{
+		for(uint32_t i = 0; i < count; i++)
+		{
+			TouchResource(resources[i]);
+		}
+		return true;
+	}
+
+	void BeginFrame(uint64_t frameIndex) override
+	{
+		m_Frame = frameIndex;
+	}
+
+	// The caller owns the resource, so it cannot be destroyed while its pages are touched outside the lock
+	void TouchResource(EvictionHelperResource resource) override
+	{
+		TouchResourcePartial(resource, 1.0f);
+	}
+
+	// Host memory is paged per page, so the untouched rest of the chunk can be paged out by the OS
+	void TouchResourcePartial(EvictionHelperResource resource, float coverage) override
+	{
+		void*	 address;
+		uint64_t sizeBytes;
+		if(GetResourceRange(resource, &address, &sizeBytes))
+		{
+			uint64_t touchBytes = std::max(static_cast<uint64_t>(static_cast<double>(sizeBytes) * std::min(coverage, 1.0f)), m_PageSize);
+			HostMemory_TouchPages(address, touchBytes, m_PageSize, static_cast<uint8_t>(m_Frame));
+		}
+	}
+
+	void EndFrame() override
+	{
+	}
+
+	void WaitForIdle() override
+	{
+	}
+
+	// Pages are touched synchronously, so every frame has completed by the time it is signaled
+	uint64_t Signal() override
+	{
+		return ++m_FenceValue;
+	}
+
+	uint64_t GetCompletedFenceValue() override
+	{
+		return m_FenceValue;
+	}
+
+	void QueryMemoryInfo(EvictionHelperMemoryInfo* outLocal, EvictionHelperMemoryInfo* outNonLocal) override
+	{
+		uint64_t totalBytes, availableBytes, swapTotalBytes, swapUsedBytes;
+		HostMemory_QuerySystemMemory(&totalBytes, &availableBytes, &swapTotalBytes, &swapUsedBytes);
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		outLocal->Budget				  = totalBytes;
+		outLocal->CurrentUsage			  = m_AllocatedBytes;
+		outLocal->AvailableForReservation = availableBytes;
+		outLocal->CurrentReservation	  = 0;
+
+		outNonLocal->Budget					 = swapTotalBytes;
+		outNonLocal->CurrentUsage			 = swapUsedBytes;
+		outNonLocal->AvailableForReservation = swapTotalBytes - swapUsedBytes;
+		outNonLocal->CurrentReservation		 = 0;
+	}
+
+	// Address range of a resource, used by the residency scanner
+	bool GetResourceRange(EvictionHelperResource resource, void** outAddress, uint64_t* outSizeBytes) const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		const Allocation*			allocation = const_cast<EvictionHelperHostDevice*>(this)->Get(resource);
+		if(!allocation)
+			return false;
+
+		*outAddress	  = allocation->Address;
+		*outSizeBytes = allocation->SizeBytes;
+		return true;
+	}
+
+	uint64_t GetPageSize() const
+	{
+		return m_PageSize;
+	}
+
+private:
+	struct Allocation
+	{
+		void*	 Address;
+		uint64_t SizeBytes;
+		int		 Priority;
+	};
+
+	Allocation* Get(EvictionHelperResource resource)
+	{
+		if(resource == 0 || resource > m_Allocations.size() || !m_Allocations[resource - 1].Address)
+			return nullptr;
+		return &m_Allocations[resource - 1];
+	}
+
+	mutable std::mutex		m_Mutex;
+	std::vector<Allocation> m_Allocations;
+	std::vector<uint32_t>	m_FreeSlots;
+	uint64_t				m_PageSize;
+	uint64_t				m_AllocatedBytes = 0;
+	uint64_t				m_Frame			 = 0;
+	uint64_t				m_FenceValue	 = 0;
+};
@@ -6,6 +6,18 @@
 // Priority names for ImGui combo boxes
 inline const char* EvictionHelper_PriorityNames[] = { "Minimum", "Low", "Normal", "High", "Maximum" };
 
+// Pool names indexed by EVICTION_HELPER_POOL_*
+inline const char* EvictionHelper_PoolNames[EVICTION_HELPER_POOL_COUNT] = { "Active VRAM", "Unused VRAM", "Active Host", "Unused Host" };
+
+// Plot a log2 microsecond latency histogram from shared memory
+inline void EvictionHelper_PlotLatencyHistogram(const char* label, const uint64_t* buckets)
+{
+	float values[EVICTION_HELPER_LATENCY_BUCKETS];
+	for (int i = 0; i < EVICTION_HELPER_LATENCY_BUCKETS; i++)
+		values[i] = static_cast<float>(buckets[i]);
+	ImGui::PlotHistogram(label, values, EVICTION_HELPER_LATENCY_BUCKETS, 0, "log2 us", 0.0f, FLT_MAX, ImVec2(0, 60));
+}
+
 // Render the Eviction Helper ImGui UI contents (without Begin/End)
 // Call this between ImGui::Begin() and ImGui::End() to render the UI
 // This function can be called from any application that has access to the shared memory
@@ -31,6 +43,204 @@ inline void EvictionHelper_RenderImGui(EvictionHelperSharedData* data)
 	if (ImGui::Checkbox("Allocate 1 GB Heap", &alloc1GB))
 		data->Allocate1GBHeap = alloc1GB ? 1 : 0;
 
+	ImGui::SeparatorText("Heap Table:");
+	const uint32_t heapCountMin = 0;
+	const uint32_t heapCountMax = EVICTION_HELPER_MAX_HEAPS;
+	ImGui::SliderScalar("Heap Count", ImGuiDataType_U32, &data->HeapCount, &heapCountMin, &heapCountMax);
+	const char* heapTypes[] = { "RT/DS Textures", "Buffers" };
+	for (uint32_t i = 0; i < data->HeapCount && i < EVICTION_HELPER_MAX_HEAPS; i++)
+	{
+		EvictionHelperHeapDesc& desc = data->Heaps[i];
+		ImGui::PushID(static_cast<int>(i));
+		if (ImGui::TreeNode("Heap", "Heap %u: %u MB%s", i, desc.SizeMB, desc.OutOfMemory ? ", out of memory" : (desc.AllocatedBytes ? "" : ", pending")))
+		{
+			const uint32_t heapSizeMin = 0;
+			const uint32_t heapSizeMax = 4096;
+			ImGui::SliderScalar("Size", ImGuiDataType_U32, &desc.SizeMB, &heapSizeMin, &heapSizeMax, "%u MB");
+			ImGui::Combo("Priority", &desc.Priority, EvictionHelper_PriorityNames, IM_ARRAYSIZE(EvictionHelper_PriorityNames));
+			int heapType = (desc.Type == EVICTION_HELPER_HEAP_TYPE_BUFFERS) ? 1 : 0;
+			if (ImGui::Combo("Type", &heapType, heapTypes, IM_ARRAYSIZE(heapTypes)))
+				desc.Type = static_cast<uint32_t>(heapType);
+			ImGui::Text("Created in %.2f ms", desc.CreationNs / 1000000.0);
+			ImGui::TreePop();
+		}
+		ImGui::PopID();
+	}
+	const EvictionHelperHeapFragmentation& fragmentation = data->HeapFragmentation;
+	ImGui::Text("%.2f GB in %u heaps, slowest creation %.2f ms", data->HeapTableAllocatedBytes / (1024.0 * 1024.0 * 1024.0), fragmentation.HeapCount, data->HeapTableMaxCreationNs / 1000000.0);
+	ImGui::Text("Fragmentation: %.1f%%, %u holes with %.2f GB, largest %.0f MB", fragmentation.FragmentationPercent, fragmentation.FreeBlockCount, fragmentation.FreeBytes / (1024.0 * 1024.0 * 1024.0), fragmentation.LargestFreeBlock / (1024.0 * 1024.0));
+
+	ImGui::SeparatorText("Render Target Placement:");
+	const char* placementNames[] = { "Committed", "Placed in 256 MB Heaps", "Placed in 1 GB Heaps", "Placed in 4 GB Heaps" };
+	const uint32_t placementHeapSizesMB[] = { 0, 256, 1024, 4096 };
+	int placement = 0;
+	for (int i = 0; i < IM_ARRAYSIZE(placementHeapSizesMB); i++)
+	{
+		if (data->PlacementHeapMB == placementHeapSizesMB[i])
+			placement = i;
+	}
+	if (ImGui::Combo("Placement", &placement, placementNames, IM_ARRAYSIZE(placementNames)))
+		data->PlacementHeapMB = placementHeapSizesMB[placement];
+
+	ImGui::SeparatorText("Working Set (active pools):");
+	const char* touchPatterns[] = { "All", "Round Robin", "Random", "Zipf (Hot/Cold)" };
+	int touchPattern = static_cast<int>(data->TouchPattern);
+	if (ImGui::Combo("Touch Pattern", &touchPattern, touchPatterns, IM_ARRAYSIZE(touchPatterns)))
+		data->TouchPattern = static_cast<uint32_t>(touchPattern);
+	const uint32_t percentMin = 1;
+	const uint32_t percentMax = 100;
+	if (data->TouchPattern != EVICTION_HELPER_TOUCH_ALL)
+		ImGui::SliderScalar("Touched per Frame", ImGuiDataType_U32, &data->TouchPercent, &percentMin, &percentMax, "%u%%");
+	if (data->TouchPattern == EVICTION_HELPER_TOUCH_ZIPF)
+		ImGui::SliderFloat("Zipf Exponent", &data->TouchZipfExponent, 0.0f, 3.0f, data->TouchZipfExponent > 0.0f ? "%.2f" : "Default");
+	if (data->TouchPattern == EVICTION_HELPER_TOUCH_RANDOM || data->TouchPattern == EVICTION_HELPER_TOUCH_ZIPF)
+		ImGui::InputScalar("Seed", ImGuiDataType_U32, &data->TouchSeed);
+	ImGui::SliderScalar("Coverage", ImGuiDataType_U32, &data->TouchCoveragePercent, &percentMin, &percentMax, "%u%% of each resource");
+	ImGui::Text("Touched last frame: %.2f GB VRAM, %.2f GB host", data->TouchedVRAMBytesLastFrame / (1024.0 * 1024.0 * 1024.0), data->TouchedHostBytesLastFrame / (1024.0 * 1024.0 * 1024.0));
+
+	ImGui::SeparatorText("Budget Control:");
+	const char* budgetControlModes[] = { "Off", "Percent of Budget", "Leave Headroom" };
+	const char* budgetControlPools[] = { "Active VRAM", "Unused VRAM" };
+	ImGui::Combo("Mode", &data->BudgetControlMode, budgetControlModes, IM_ARRAYSIZE(budgetControlModes));
+	if(data->BudgetControlMode != EVICTION_HELPER_BUDGET_CONTROL_OFF)
+	{
+		ImGui::Combo("Controlled Pool", &data->BudgetControlPool, budgetControlPools, IM_ARRAYSIZE(budgetControlPools));
+		if(data->BudgetControlMode == EVICTION_HELPER_BUDGET_CONTROL_PERCENT)
+			ImGui::SliderInt("Percent of Budget", &data->BudgetControlPercent, 0, 150, "%d %%");
+		else
+			ImGui::SliderInt("Headroom MB", &data->BudgetControlHeadroomMB, -4096, 8192, "%d MB");
+		ImGui::Text("Setpoint: %.2f GB, Error: %.0f MB", data->BudgetControlSetpointBytes / (1024.0 * 1024.0 * 1024.0), data->BudgetControlErrorBytes / (1024.0 * 1024.0));
+	}
+
+	ImGui::SeparatorText("Host Memory (system RAM):");
+	ImGui::SliderInt("Active Host MB", &data->TargetHostMemoryUsageMB, 0, 64 << 10, "%d MB");
+	ImGui::SliderInt("Unused Host MB", &data->TargetUnusedHostMemoryUsageMB, 0, 64 << 10, "%d MB");
+
+	ImGui::SeparatorText("Named Pools:");
+	const uint32_t namedPoolCountMin = 0;
+	const uint32_t namedPoolCountMax = EVICTION_HELPER_MAX_NAMED_POOLS;
+	ImGui::SliderScalar("Named Pool Count", ImGuiDataType_U32, &data->NamedPoolCount, &namedPoolCountMin, &namedPoolCountMax);
+	const char* poolKinds[] = { "Render Targets", "Heaps", "Host Memory" };
+	const char* namedTouchPatterns[] = { "All", "Round Robin", "Random", "Zipf (Hot/Cold)", "None" };
+	for (uint32_t i = 0; i < data->NamedPoolCount && i < EVICTION_HELPER_MAX_NAMED_POOLS; i++)
+	{
+		EvictionHelperPoolDesc& desc = data->NamedPools[i];
+		ImGui::PushID(static_cast<int>(i));
+		const char* kindName = (desc.Kind <= EVICTION_HELPER_POOL_KIND_HOST_MEMORY) ? poolKinds[desc.Kind] : poolKinds[0];
+		if (ImGui::TreeNode("Pool", "%s (%s): %.2f GB%s", desc.Name[0] ? desc.Name : "Unnamed", kindName, desc.AllocatedBytes / (1024.0 * 1024.0 * 1024.0), desc.OutOfMemory ? ", out of memory" : ""))
+		{
+			ImGui::SliderInt("Target MB", &desc.TargetMB, 0, 32 << 10, "%d MB");
+			ImGui::Combo("Priority", &desc.Priority, EvictionHelper_PriorityNames, IM_ARRAYSIZE(EvictionHelper_PriorityNames));
+			int touch = static_cast<int>(desc.TouchPattern);
+			if (desc.Kind != EVICTION_HELPER_POOL_KIND_HEAP && ImGui::Combo("Touch Pattern", &touch, namedTouchPatterns, IM_ARRAYSIZE(namedTouchPatterns)))
+				desc.TouchPattern = static_cast<uint32_t>(touch);
+			if (desc.Kind != EVICTION_HELPER_POOL_KIND_HEAP && desc.TouchPattern != EVICTION_HELPER_TOUCH_ALL && desc.TouchPattern != EVICTION_HELPER_TOUCH_NONE)
+				ImGui::SliderScalar("Touched per Frame", ImGuiDataType_U32, &desc.TouchPercent, &percentMin, &percentMax, "%u%%");
+			ImGui::Text("%u x %.0f MB, touched last frame: %.2f GB", desc.ResourceCount, desc.ChunkSizeBytes / (1024.0 * 1024.0), desc.TouchedBytesLastFrame / (1024.0 * 1024.0 * 1024.0));
+			ImGui::TreePop();
+		}
+		ImGui::PopID();
+	}
+
+	ImGui::SeparatorText("Churn (random-size alloc/free):");
+	const uint32_t churnOpsMin = 0;
+	const uint32_t churnOpsMax = 10000;
+	ImGui::SliderScalar("Churn Ops/s", ImGuiDataType_U32, &data->ChurnOpsPerSecond, &churnOpsMin, &churnOpsMax, data->ChurnOpsPerSecond ? "%u ops/s" : "Off");
+	if (data->ChurnOpsPerSecond)
+	{
+		const uint32_t churnTargetMin = 0;
+		const uint32_t churnTargetMax = 32 << 10;
+		const uint32_t churnSizeMin = 0;
+		const uint32_t churnSizeMax = 1024 << 10;
+		const char* churnDistributions[] = { "Log-Uniform", "Bimodal", "Histogram File" };
+		ImGui::SliderScalar("Churn Target", ImGuiDataType_U32, &data->ChurnTargetMB, &churnTargetMin, &churnTargetMax, "%u MB");
+		int churnKind = (data->ChurnKind <= EVICTION_HELPER_POOL_KIND_HOST_MEMORY) ? static_cast<int>(data->ChurnKind) : 0;
+		if (ImGui::Combo("Churn Kind", &churnKind, poolKinds, IM_ARRAYSIZE(poolKinds)))
+			data->ChurnKind = static_cast<uint32_t>(churnKind);
+		int churnDistribution = (data->ChurnDistribution <= EVICTION_HELPER_CHURN_HISTOGRAM) ? static_cast<int>(data->ChurnDistribution) : 0;
+		if (ImGui::Combo("Distribution", &churnDistribution, churnDistributions, IM_ARRAYSIZE(churnDistributions)))
+			data->ChurnDistribution = static_cast<uint32_t>(churnDistribution);
+		if (data->ChurnDistribution == EVICTION_HELPER_CHURN_HISTOGRAM)
+		{
+			ImGui::InputText("Histogram File", data->ChurnHistogramPath, sizeof(data->ChurnHistogramPath));
+			ImGui::Text("%u bins", data->ChurnHistogramBinCount);
+		}
+		else
+		{
+			ImGui::SliderScalar("Min Size", ImGuiDataType_U32, &data->ChurnMinSizeKB, &churnSizeMin, &churnSizeMax, data->ChurnMinSizeKB ? "%u KB" : "Default");
+			ImGui::SliderScalar("Max Size", ImGuiDataType_U32, &data->ChurnMaxSizeKB, &churnSizeMin, &churnSizeMax, data->ChurnMaxSizeKB ? "%u KB" : "Default");
+		}
+		if (data->ChurnDistribution == EVICTION_HELPER_CHURN_BIMODAL)
+			ImGui::SliderScalar("Large", ImGuiDataType_U32, &data->ChurnLargePercent, &percentMin, &percentMax, "%u%%");
+		ImGui::InputScalar("Churn Seed", ImGuiDataType_U32, &data->ChurnSeed);
+	}
+	ImGui::Text("%.2f GB in %u resources, %.0f ops/s, %llu failed", data->ChurnAllocatedBytes / (1024.0 * 1024.0 * 1024.0), data->ChurnResourceCount, data->ChurnAchievedOpsPerSecond, static_cast<unsigned long long>(data->ChurnFailedAllocCount));
+	ImGui::Text("Slowest alloc %.2f ms, slowest free %.2f ms", data->ChurnAllocMaxNs / 1000000.0, data->ChurnFreeMaxNs / 1000000.0);
+	if (data->ChurnAllocCount && ImGui::TreeNode("Churn Latency", "Latency (%llu allocs, %llu frees)", static_cast<unsigned long long>(data->ChurnAllocCount), static_cast<unsigned long long>(data->ChurnFreeCount)))
+	{
+		EvictionHelper_PlotLatencyHistogram("Alloc", data->ChurnAllocLatencyHistogram);
+		EvictionHelper_PlotLatencyHistogram("Free", data->ChurnFreeLatencyHistogram);
+		ImGui::TreePop();
+	}
+
+	ImGui::SeparatorText("Allocation Trace:");
+	const char* traceStates[] = { "Idle", "Playing", "Finished", "Failed to open" };
+	ImGui::InputText("Replay File", data->TraceReplayPath, sizeof(data->TraceReplayPath));
+	bool traceReplay = data->TraceReplay != 0;
+	if (ImGui::Checkbox("Replay", &traceReplay))
+		data->TraceReplay = traceReplay ? 1 : 0;
+	ImGui::SameLine();
+	ImGui::SliderFloat("Speed", &data->TraceReplaySpeed, 0.0f, 16.0f, data->TraceReplaySpeed > 0.0f ? "%.2fx" : "As fast as possible");
+	ImGui::Text("%s: %llu / %llu events, %.2f GB in %u resources", data->TraceReplayState <= EVICTION_HELPER_TRACE_STATE_FAILED ? traceStates[data->TraceReplayState] : traceStates[0], static_cast<unsigned long long>(data->TraceIssuedEventCount), static_cast<unsigned long long>(data->TraceEventCount), data->TraceAllocatedBytes / (1024.0 * 1024.0 * 1024.0), data->TraceResourceCount);
+	ImGui::ProgressBar(data->TraceDurationNs ? static_cast<float>(static_cast<double>(data->TracePositionNs) / data->TraceDurationNs) : 0.0f);
+	ImGui::Text("Drift %.2f ms, mean %.2f ms, max %.2f ms, %llu skipped, %llu failed", data->TraceDriftNs / 1000000.0, data->TraceMeanDriftNs / 1000000.0, data->TraceMaxDriftNs / 1000000.0, static_cast<unsigned long long>(data->TraceSkippedEventCount), static_cast<unsigned long long>(data->TraceFailedAllocCount));
+	if (data->TraceIssuedEventCount && ImGui::TreeNode("Trace Latency", "Latency (slowest alloc %.2f ms, free %.2f ms)", data->TraceAllocMaxNs / 1000000.0, data->TraceFreeMaxNs / 1000000.0))
+	{
+		EvictionHelper_PlotLatencyHistogram("Alloc", data->TraceAllocLatencyHistogram);
+		EvictionHelper_PlotLatencyHistogram("Free", data->TraceFreeLatencyHistogram);
+		EvictionHelper_PlotLatencyHistogram("Drift", data->TraceDriftHistogram);
+		ImGui::TreePop();
+	}
+	ImGui::InputText("Record File", data->TraceRecordPath, sizeof(data->TraceRecordPath));
+	bool traceRecord = data->TraceRecord != 0;
+	if (ImGui::Checkbox("Record", &traceRecord))
+		data->TraceRecord = traceRecord ? 1 : 0;
+	ImGui::SameLine();
+	ImGui::Text("%s%llu events", data->TraceRecording ? "Recording, " : "", static_cast<unsigned long long>(data->TraceRecordedEventCount));
+
+	ImGui::SeparatorText("Scenario:");
+	const char* scenarioStates[] = { "Idle", "Running", "Finished", "Failed" };
+	const char* scenarioClocks[] = { "Frame clock", "Monotonic clock" };
+	ImGui::InputText("Scenario File", data->ScenarioPath, sizeof(data->ScenarioPath));
+	bool scenario = data->Scenario != 0;
+	if (ImGui::Checkbox("Run", &scenario))
+		data->Scenario = scenario ? 1 : 0;
+	ImGui::SameLine();
+	int scenarioClock = static_cast<int>(data->ScenarioClock);
+	if (ImGui::Combo("Clock", &scenarioClock, scenarioClocks, IM_ARRAYSIZE(scenarioClocks)))
+		data->ScenarioClock = static_cast<uint32_t>(scenarioClock);
+	if (data->ScenarioState == EVICTION_HELPER_SCENARIO_STATE_FAILED)
+		ImGui::Text("Failed: %s", data->ScenarioError);
+	else
+		ImGui::Text("%s: step %d of %u (line %u), %.1f / %.1f s, %u loops", data->ScenarioState <= EVICTION_HELPER_SCENARIO_STATE_FAILED ? scenarioStates[data->ScenarioState] : scenarioStates[0], data->ScenarioStep + 1, data->ScenarioStepCount, data->ScenarioStepLine, data->ScenarioTimeNs / 1000000000.0, data->ScenarioDurationNs / 1000000000.0, data->ScenarioLoopCount);
+
+	ImGui::SeparatorText("Ramp Rates (0 = instant):");
+	for (int i = 0; i < EVICTION_HELPER_POOL_COUNT; i++)
+	{
+		ImGui::PushID(i);
+		ImGui::SliderFloat("##Up", &data->RampUpMBPerSecond[i], 0.0f, 16384.0f, "Up %.0f MB/s");
+		ImGui::SameLine();
+		ImGui::SliderFloat("##Down", &data->RampDownMBPerSecond[i], 0.0f, 16384.0f, "Down %.0f MB/s");
+		ImGui::SameLine();
+		ImGui::Text("%s: %.2f GB", EvictionHelper_PoolNames[i], data->RampPositionBytes[i] / (1024.0 * 1024.0 * 1024.0));
+		ImGui::PopID();
+	}
+
+	ImGui::SeparatorText("Deferred Release:");
+	const uint32_t releaseBudgetMin = 0;
+	const uint32_t releaseBudgetMax = 4096;
+	ImGui::SliderScalar("Release MB per Frame", ImGuiDataType_U32, &data->ReleaseBudgetMBPerFrame, &releaseBudgetMin, &releaseBudgetMax, data->ReleaseBudgetMBPerFrame ? "%u MB" : "Unlimited");
+
 	ImGui::SeparatorText("Memory Usage");
 	uint64_t heapAllocation = data->CurrentHeapAllocationBytes;
 	uint64_t totalMemory = data->CurrentVRAMAllocationBytes + data->CurrentUnusedVRAMAllocationBytes + heapAllocation;
@@ -43,6 +253,34 @@ inline void EvictionHelper_RenderImGui(EvictionHelperSharedData* data)
 		ImGui::Text("Unused Heaps: %.2f GB", heapAllocation / (1024.0 * 1024.0 * 1024.0));
 	}
 	ImGui::Text("Total VRAM Usage: %.2f GB", totalMemory / (1024.0 * 1024.0 * 1024.0));
+	if(data->AllocationPendingBytes > 0 || data->ReleasePendingBytes > 0)
+	{
+		ImGui::Text("  Pending: %.2f GB to allocate, %.2f GB to release", data->AllocationPendingBytes / (1024.0 * 1024.0 * 1024.0), data->ReleasePendingBytes / (1024.0 * 1024.0 * 1024.0));
+		ImGui::Text("  Waiting for GPU: %.2f GB, Released last frame: %.0f MB", data->ReleaseDeferredBytes / (1024.0 * 1024.0 * 1024.0), data->ReleasedBytesLastFrame / (1024.0 * 1024.0));
+	}
+	ImGui::Text("Active Host Memory: %.2f GB", data->CurrentHostMemoryAllocationBytes / (1024.0 * 1024.0 * 1024.0));
+	ImGui::Text("Unused Host Memory: %.2f GB", data->CurrentUnusedHostMemoryAllocationBytes / (1024.0 * 1024.0 * 1024.0));
+	if(data->CurrentUnusedHostMemoryAllocationBytes > 0)
+	{
+		ImGui::Text("  Resident: %.2f GB, Paged Out: %.2f GB", data->UnusedHostMemoryResidentBytes / (1024.0 * 1024.0 * 1024.0), data->UnusedHostMemoryNonResidentBytes / (1024.0 * 1024.0 * 1024.0));
+	}
+
+	// Last explicit EVICT / MAKE_RESIDENT command
+	if (data->ResidencyOpStatus != EVICTION_HELPER_RESIDENCY_OP_NONE)
+	{
+		const char* poolName = "Invalid Pool";
+		if (data->ResidencyOpPool < EVICTION_HELPER_POOL_COUNT)
+			poolName = EvictionHelper_PoolNames[data->ResidencyOpPool];
+		else if (data->ResidencyOpPool < EVICTION_HELPER_POOL_NAMED(EVICTION_HELPER_MAX_NAMED_POOLS))
+			poolName = data->NamedPools[data->ResidencyOpPool - EVICTION_HELPER_POOL_NAMED(0)].Name;
+		const char* opName = (data->ResidencyOpType == EVICTION_HELPER_COMMAND_EVICT) ? "Evict" : (data->ResidencyOpMode == EVICTION_HELPER_MAKE_RESIDENT_ENQUEUE) ? "Enqueue Make Resident" : "Make Resident";
+		if (data->ResidencyOpStatus == EVICTION_HELPER_RESIDENCY_OP_PENDING)
+			ImGui::Text("%s %s: %.2f GB pending", opName, poolName, data->ResidencyOpBytes / (1024.0 * 1024.0 * 1024.0));
+		else if (data->ResidencyOpStatus == EVICTION_HELPER_RESIDENCY_OP_FAILED)
+			ImGui::Text("%s %s: failed", opName, poolName);
+		else
+			ImGui::Text("%s %s: %.2f GB in %.1f ms (%.2f GB/s)", opName, poolName, data->ResidencyOpBytes / (1024.0 * 1024.0 * 1024.0), data->ResidencyOpDurationNs / 1000000.0, data->ResidencyOpBytesPerSecond / (1024.0 * 1024.0 * 1024.0));
+	}
 
 	// Calculate memory by priority level
 	uint64_t memoryByPriority[5] = { 0, 0, 0, 0, 0 };
@@ -55,6 +293,18 @@ inline void EvictionHelper_RenderImGui(EvictionHelperSharedData* data)
 		memoryByPriority[unusedPri] += data->CurrentUnusedVRAMAllocationBytes;
 		memoryByPriority[unusedPri] += heapAllocation;
 	}
+	for (uint32_t i = 0; i < EVICTION_HELPER_MAX_NAMED_POOLS; i++)
+	{
+		const EvictionHelperPoolDesc& desc = data->NamedPools[i];
+		if (desc.Kind != EVICTION_HELPER_POOL_KIND_HOST_MEMORY && desc.Priority >= 0 && desc.Priority <= 4)
+			memoryByPriority[desc.Priority] += desc.AllocatedBytes;
+	}
+	for (uint32_t i = 0; i < EVICTION_HELPER_MAX_HEAPS; i++)
+	{
+		const EvictionHelperHeapDesc& desc = data->Heaps[i];
+		if (desc.Priority >= 0 && desc.Priority <= 4)
+			memoryByPriority[desc.Priority] += desc.AllocatedBytes;
+	}
 
 	ImGui::SeparatorText("Memory by Priority");
 	for (int i = 0; i < 5; i++)
@@ -77,4 +327,64 @@ inline void EvictionHelper_RenderImGui(EvictionHelperSharedData* data)
 	ImGui::Text("  Current Usage: %.2f GB", data->NonLocalCurrentUsage / (1024.0 * 1024.0 * 1024.0));
 	ImGui::Text("  Available for Reservation: %.2f GB", data->NonLocalAvailableForReservation / (1024.0 * 1024.0 * 1024.0));
 	ImGui::Text("  Current Reservation: %.2f GB", data->NonLocalCurrentReservation / (1024.0 * 1024.0 * 1024.0));
+
+	ImGui::SeparatorText("Memory Sampler:");
+	const uint32_t sampleRateMin = 0;
+	const uint32_t sampleRateMax = EVICTION_HELPER_MEMORY_SAMPLE_MAX_RATE_HZ;
+	ImGui::SliderScalar("Sample Rate", ImGuiDataType_U32, &data->MemorySampleRateHz, &sampleRateMin, &sampleRateMax, data->MemorySampleRateHz ? "%u Hz" : "Off");
+	ImGui::Text("%.0f Hz, %llu samples, up to %.3f ms late", data->MemorySampleAchievedHz, static_cast<unsigned long long>(data->MemorySamples.Head.load(std::memory_order_relaxed)), data->MemorySampleMaxLateNs / 1000000.0);
+	ImGui::Text("Query mean %.3f ms, slowest %.3f ms", data->MemorySampleMeanQueryNs / 1000000.0, data->MemorySampleMaxQueryNs / 1000000.0);
+	if (data->MemorySamples.Head.load(std::memory_order_relaxed) && ImGui::TreeNode("Memory Samples", "Recent samples"))
+	{
+		// The last 512 samples, read like a controlling application would
+		static EvictionHelperMemorySample samples[512];
+		static float localUsage[512];
+		uint64_t head = data->MemorySamples.Head.load(std::memory_order_acquire);
+		uint64_t index = (head > IM_ARRAYSIZE(samples)) ? head - IM_ARRAYSIZE(samples) : 0;
+		uint32_t count = EvictionHelper_ReadMemorySamples(data, &index, samples, IM_ARRAYSIZE(samples), nullptr);
+		for (uint32_t i = 0; i < count; i++)
+			localUsage[i] = static_cast<float>(samples[i].LocalCurrentUsage / (1024.0 * 1024.0 * 1024.0));
+		ImGui::PlotLines("Local Usage", localUsage, static_cast<int>(count), 0, nullptr, FLT_MAX, FLT_MAX, ImVec2(0, 60));
+		if (count)
+			ImGui::Text("%.2f GB over %.1f ms", localUsage[count - 1], (samples[count - 1].TimestampNs - samples[0].TimestampNs) / 1000000.0);
+		EvictionHelper_PlotLatencyHistogram("Late", data->MemorySampleLateHistogram);
+		ImGui::TreePop();
+	}
+
+	ImGui::SeparatorText("Budget Changes:");
+	ImGui::Text("Generation %u, %s", data->BudgetGeneration.load(std::memory_order_relaxed), data->BudgetWatcherState == EVICTION_HELPER_BUDGET_WATCHER_NOTIFIED ? "OS notifications" : "polled every frame");
+	ImGui::Text("%llu notifications, slowest %.3f ms from wake to publish", static_cast<unsigned long long>(data->BudgetNotificationCount), data->BudgetChangeLatencyMaxNs / 1000000.0);
+	if (data->BudgetChanges.Head.load(std::memory_order_relaxed) && ImGui::TreeNode("Budget Change History", "Recent changes"))
+	{
+		// The last 16 changes, newest first
+		EvictionHelperBudgetChange changes[16];
+		uint64_t head = data->BudgetChanges.Head.load(std::memory_order_acquire);
+		uint64_t index = (head > IM_ARRAYSIZE(changes)) ? head - IM_ARRAYSIZE(changes) : 0;
+		uint32_t count = EvictionHelper_ReadBudgetChanges(data, &index, changes, IM_ARRAYSIZE(changes), nullptr);
+		uint64_t nowNs = EvictionHelper_GetTimestampNs();
+		for (uint32_t i = count; i-- > 0;)
+		{
+			const EvictionHelperBudgetChange& change = changes[i];
+			ImGui::Text("#%u %.1f s ago (%s): local %.2f -> %.2f GB, non-local %.2f -> %.2f GB", change.Generation, (nowNs - change.TimestampNs) / 1000000000.0,
+				change.Source == EVICTION_HELPER_BUDGET_SOURCE_NOTIFICATION ? "notification" : "poll",
+				change.PreviousLocalBudget / (1024.0 * 1024.0 * 1024.0), change.LocalBudget / (1024.0 * 1024.0 * 1024.0),
+				change.PreviousNonLocalBudget / (1024.0 * 1024.0 * 1024.0), change.NonLocalBudget / (1024.0 * 1024.0 * 1024.0));
+		}
+		ImGui::TreePop();
+	}
+
+	ImGui::SeparatorText("Frame Pacing:");
+	const uint32_t frameRateMin = 0;
+	const uint32_t frameRateMax = 240;
+	const uint32_t spinTailMin = 0;
+	const uint32_t spinTailMax = 5000;
+	ImGui::SliderScalar("Frame Rate", ImGuiDataType_U32, &data->FrameRate, &frameRateMin, &frameRateMax, data->FrameRate ? "%u FPS" : "Default (30 FPS)");
+	ImGui::SliderScalar("Spin Tail", ImGuiDataType_U32, &data->FrameSpinTailUs, &spinTailMin, &spinTailMax, data->FrameSpinTailUs ? "%u us" : "Sleep only");
+	ImGui::Text("Frame time p50 %.3f ms, p99 %.3f ms, max %.3f ms", data->FrameTimePercentile50Ns / 1000000.0, data->FrameTimePercentile99Ns / 1000000.0, data->FrameTimeMaxNs / 1000000.0);
+	ImGui::Text("Up to %.3f ms late, %.1f s asleep, %.2f s spinning", data->FrameLateMaxNs / 1000000.0, data->FrameSleepTotalNs / 1000000000.0, data->FrameSpinTotalNs / 1000000000.0);
+	if (ImGui::TreeNode("Frame Time Histogram"))
+	{
+		EvictionHelper_PlotLatencyHistogram("Frame Time", data->FrameTimeHistogram);
+		ImGui::TreePop();
+	}
 }
@@ -0,0 +1,365 @@
+#pragma once
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "eviction_helper_host_memory.h"
+#include "eviction_helper_shared.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#if defined(_WIN32) && !defined(CREATE_WAITABLE_TIMER_HIGH_RESOLUTION)
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+// Source of the budget and usage the memory sampler records
+// QueryMemoryInfo() is called from the sampler thread while other threads use the rest of the device, implementations
+// must allow this.
+class EvictionHelperMemoryInfoProvider
+{
+public:
+	virtual ~EvictionHelperMemoryInfoProvider() = default;
+
+	virtual void QueryMemoryInfo(EvictionHelperMemoryInfo* outLocal, EvictionHelperMemoryInfo* outNonLocal) = 0;
+};
+
+// Samples the memory info of a device, the D3D12 device (DXGI video memory info), the simulated device or the host device
+class EvictionHelperDeviceMemoryInfoProvider : public EvictionHelperMemoryInfoProvider
+{
+public:
+	explicit EvictionHelperDeviceMemoryInfoProvider(EvictionHelperDevice* device)
+		: m_Device(device)
+	{
+	}
+
+	void QueryMemoryInfo(EvictionHelperMemoryInfo* outLocal, EvictionHelperMemoryInfo* outNonLocal) override
+	{
+		m_Device->QueryMemoryInfo(outLocal, outNonLocal);
+	}
+
+private:
+	EvictionHelperDevice* m_Device;
+};
+
+// Samples physical memory and swap of the whole system, reported like EvictionHelperHostDevice does
+// On Linux /proc/meminfo stays open and is re-read from the start for every sample, which avoids the open and close
+// of HostMemory_QuerySystemMemory() at high rates.
+class EvictionHelperSystemMemoryInfoProvider : public EvictionHelperMemoryInfoProvider
+{
+public:
+	EvictionHelperSystemMemoryInfoProvider()
+	{
+#ifndef _WIN32
+		m_File = open("/proc/meminfo", O_RDONLY | O_CLOEXEC);
+#endif
+	}
+
+	~EvictionHelperSystemMemoryInfoProvider()
+	{
+#ifndef _WIN32
+		if(m_File >= 0)
+			close(m_File);
+#endif
+	}
+
+	EvictionHelperSystemMemoryInfoProvider(const EvictionHelperSystemMemoryInfoProvider&)			 = delete;
+	EvictionHelperSystemMemoryInfoProvider& operator=(const EvictionHelperSystemMemoryInfoProvider&) = delete;
+
+	void QueryMemoryInfo(EvictionHelperMemoryInfo* outLocal, EvictionHelperMemoryInfo* outNonLocal) override
+	{
+		uint64_t totalBytes		= 0;
+		uint64_t availableBytes = 0;
+		uint64_t swapTotalBytes = 0;
+		uint64_t swapUsedBytes	= 0;
+#ifdef _WIN32
+		HostMemory_QuerySystemMemory(&totalBytes, &availableBytes, &swapTotalBytes, &swapUsedBytes);
+#else
+		ReadMemInfo(&totalBytes, &availableBytes, &swapTotalBytes, &swapUsedBytes);
+#endif
+
+		*outLocal				  = {};
+		outLocal->Budget		  = totalBytes;
+		outLocal->CurrentUsage	  = totalBytes - std::min(availableBytes, totalBytes);
+		*outNonLocal			  = {};
+		outNonLocal->Budget		  = swapTotalBytes;
+		outNonLocal->CurrentUsage = swapUsedBytes;
+	}
+
+private:
+#ifndef _WIN32
+	void ReadMemInfo(uint64_t* outTotalBytes, uint64_t* outAvailableBytes, uint64_t* outSwapTotalBytes, uint64_t* outSwapUsedBytes)
+	{
+		char	buffer[8192];
+		ssize_t size = (m_File >= 0) ? pread(m_File, buffer, sizeof(buffer) - 1, 0) : -1;
+		if(size <= 0)
+			return;
+		buffer[size] = '\0';
+
+		// Lines look like "MemTotal:       16318412 kB"
+		uint64_t swapFreeBytes = 0;
+		for(const char* line = buffer; line && *line; line = strchr(line, '\n'), line = line ? line + 1 : nullptr)
+		{
+			uint64_t* value = nullptr;
+			if(!strncmp(line, "MemTotal:", 9))
+				value = outTotalBytes;
+			else if(!strncmp(line, "MemAvailable:", 13))
+				value = outAvailableBytes;
+			else if(!strncmp(line, "SwapTotal:", 10))
+				value = outSwapTotalBytes;
+			else if(!strncmp(line, "SwapFree:", 9))
+				value = &swapFreeBytes;
+			if(value)
+				*value = strtoull(strchr(line, ':') + 1, nullptr, 10) * 1024ULL;
+		}
+		*outSwapUsedBytes = (*outSwapTotalBytes > swapFreeBytes) ? *outSwapTotalBytes - swapFreeBytes : 0;
+	}
+
+	int m_File = -1;
+#endif
+};
+
+struct EvictionHelperMemorySamplerStats
+{
+	uint64_t SampleCount;
+	uint64_t MaxLateNs;
+	uint64_t MaxQueryNs;
+	uint64_t TotalQueryNs;
+	uint64_t LateHistogram[EVICTION_HELPER_LATENCY_BUCKETS]; // Lateness of each sample relative to its schedule
+};
+
+// Absolute timeline of the memory sampler, kept apart from the thread so it can be checked on made up timestamps
+// A late sample does not push back the ones after it. When a sample ends more than one interval behind (e.g. the
+// thread was not scheduled for a while) the missed samples are dropped instead of being taken back to back.
+class EvictionHelperSampleSchedule
+{
+public:
+	// The first sample is due at nowNs
+	void Start(uint64_t nowNs, uint64_t intervalNs)
+	{
+		m_DeadlineNs = nowNs;
+		m_IntervalNs = intervalNs;
+	}
+
+	// Time the current sample is due
+	uint64_t GetDeadlineNs() const
+	{
+		return m_DeadlineNs;
+	}
+
+	// Lateness of a sample taken at sampleNs
+	uint64_t GetLateNs(uint64_t sampleNs) const
+	{
+		return (sampleNs > m_DeadlineNs) ? sampleNs - m_DeadlineNs : 0;
+	}
+
+	// Move to the next sample after the current one ended at endNs, returns its deadline
+	// A rate change restarts the timeline at endNs
+	uint64_t Advance(uint64_t endNs, uint64_t intervalNs)
+	{
+		if(intervalNs != m_IntervalNs)
+		{
+			m_IntervalNs = intervalNs;
+			m_DeadlineNs = endNs;
+		}
+		m_DeadlineNs += m_IntervalNs;
+		if(endNs > m_DeadlineNs + m_IntervalNs)
+		{
+			m_DeadlineNs = endNs;
+		}
+		return m_DeadlineNs;
+	}
+
+private:
+	uint64_t m_DeadlineNs = 0;
+	uint64_t m_IntervalNs = 0;
+};
+
+// Queries a provider at a fixed rate on its own thread and appends every result to the MemorySamples ring
+// Samples follow an EvictionHelperSampleSchedule, the lateness of the first sample after a gap shows how long it was.
+// The wait uses a high resolution waitable timer on Windows, the default timer resolution would limit the rate to 64 Hz.
+class EvictionHelperMemorySampler
+{
+public:
+	EvictionHelperMemorySampler()
+	{
+		m_Stats = {};
+	}
+
+	~EvictionHelperMemorySampler()
+	{
+		Stop();
+	}
+
+	EvictionHelperMemorySampler(const EvictionHelperMemorySampler&)			   = delete;
+	EvictionHelperMemorySampler& operator=(const EvictionHelperMemorySampler&) = delete;
+
+	// Start sampling provider into data->MemorySamples, restarts the stats
+	// rateHz is clamped to [1, EVICTION_HELPER_MEMORY_SAMPLE_MAX_RATE_HZ]
+	void Start(EvictionHelperMemoryInfoProvider* provider, EvictionHelperSharedData* data, uint32_t rateHz)
+	{
+		Stop();
+
+		m_Provider = provider;
+		m_Data	   = data;
+		m_Stats	   = {};
+		SetRate(rateHz);
+#ifdef _WIN32
+		m_StopEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+		m_Timer		= CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+		if(!m_Timer)
+		{
+			// Before Windows 10 1803
+			m_Timer = CreateWaitableTimerW(nullptr, FALSE, nullptr);
+		}
+#else
+		m_StopRequested = false;
+#endif
+		m_Thread = std::thread(&EvictionHelperMemorySampler::Run, this);
+	}
+
+	void Stop()
+	{
+		if(!m_Thread.joinable())
+			return;
+
+#ifdef _WIN32
+		SetEvent(m_StopEvent);
+		m_Thread.join();
+		CloseHandle(m_Timer);
+		CloseHandle(m_StopEvent);
+		m_Timer		= nullptr;
+		m_StopEvent = nullptr;
+#else
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_StopRequested = true;
+		}
+		m_WakeCondition.notify_one();
+		m_Thread.join();
+#endif
+	}
+
+	bool IsRunning() const
+	{
+		return m_Thread.joinable();
+	}
+
+	// Any thread, takes effect after the next sample
+	void SetRate(uint32_t rateHz)
+	{
+		rateHz = std::min(std::max(rateHz, 1u), static_cast<uint32_t>(EVICTION_HELPER_MEMORY_SAMPLE_MAX_RATE_HZ));
+		m_IntervalNs.store(1000000000ULL / rateHz, std::memory_order_relaxed);
+	}
+
+	uint64_t GetIntervalNs() const
+	{
+		return m_IntervalNs.load(std::memory_order_relaxed);
+	}
+
+	void GetStats(EvictionHelperMemorySamplerStats* outStats) const
+	{
+		std::lock_guard<std::mutex> lock(m_StatsMutex);
+		*outStats = m_Stats;
+	}
+
+private:
+	void Run()
+	{
+		EvictionHelperSampleSchedule schedule;
+		schedule.Start(EvictionHelper_GetTimestampNs(), m_IntervalNs.load(std::memory_order_relaxed));
+		while(true)
+		{
+			EvictionHelperMemorySample sample	= {};
+			EvictionHelperMemoryInfo   local	= {};
+			EvictionHelperMemoryInfo   nonLocal	= {};
+
+			sample.TimestampNs = EvictionHelper_GetTimestampNs();
+			m_Provider->QueryMemoryInfo(&local, &nonLocal);
+			uint64_t endNs = EvictionHelper_GetTimestampNs();
+
+			sample.QueryNs						   = endNs - sample.TimestampNs;
+			sample.LateNs						   = schedule.GetLateNs(sample.TimestampNs);
+			sample.LocalBudget					   = local.Budget;
+			sample.LocalCurrentUsage			   = local.CurrentUsage;
+			sample.LocalAvailableForReservation	   = local.AvailableForReservation;
+			sample.LocalCurrentReservation		   = local.CurrentReservation;
+			sample.NonLocalBudget				   = nonLocal.Budget;
+			sample.NonLocalCurrentUsage			   = nonLocal.CurrentUsage;
+			sample.NonLocalAvailableForReservation = nonLocal.AvailableForReservation;
+			sample.NonLocalCurrentReservation	   = nonLocal.CurrentReservation;
+			EvictionHelper_WriteMemorySample(m_Data, &sample);
+
+			{
+				std::lock_guard<std::mutex> lock(m_StatsMutex);
+				m_Stats.SampleCount++;
+				m_Stats.MaxLateNs  = std::max(m_Stats.MaxLateNs, sample.LateNs);
+				m_Stats.MaxQueryNs = std::max(m_Stats.MaxQueryNs, sample.QueryNs);
+				m_Stats.TotalQueryNs += sample.QueryNs;
+				m_Stats.LateHistogram[EvictionHelper_GetLatencyBucket(sample.LateNs)]++;
+			}
+
+			if(!WaitUntil(schedule.Advance(endNs, m_IntervalNs.load(std::memory_order_relaxed))))
+				return;
+		}
+	}
+
+	// Sleep until the deadline on the EvictionHelper_GetTimestampNs() clock, false once Stop() was called
+	bool WaitUntil(uint64_t deadlineNs)
+	{
+		uint64_t nowNs	= EvictionHelper_GetTimestampNs();
+		uint64_t waitNs = (deadlineNs > nowNs) ? deadlineNs - nowNs : 0;
+#ifdef _WIN32
+		if(m_Timer)
+		{
+			// Relative due time in 100 ns units
+			LARGE_INTEGER dueTime;
+			dueTime.QuadPart = -static_cast<LONGLONG>(std::max<uint64_t>(waitNs / 100, 1));
+			SetWaitableTimer(m_Timer, &dueTime, 0, nullptr, nullptr, FALSE);
+			HANDLE handles[2] = { m_StopEvent, m_Timer };
+			return WaitForMultipleObjects(2, handles, FALSE, INFINITE) != WAIT_OBJECT_0;
+		}
+		return WaitForSingleObject(m_StopEvent, static_cast<DWORD>((waitNs + 999999) / 1000000)) != WAIT_OBJECT_0;
+#else
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_WakeCondition.wait_for(lock, std::chrono::nanoseconds(waitNs), [this] { return m_StopRequested; });
+		return !m_StopRequested;
+#endif
+	}
+
+	EvictionHelperMemoryInfoProvider* m_Provider = nullptr;
+	EvictionHelperSharedData*		  m_Data	 = nullptr;
+	std::atomic<uint64_t>			  m_IntervalNs{ 1000000000ULL };
+
+	// Written by the sampler thread, read by the owner
+	mutable std::mutex				 m_StatsMutex;
+	EvictionHelperMemorySamplerStats m_Stats;
+
+	// Wakes the sampler thread early to stop it
+#ifdef _WIN32
+	HANDLE m_StopEvent = nullptr;
+	HANDLE m_Timer	   = nullptr;
+#else
+	std::mutex				m_Mutex;
+	std::condition_variable m_WakeCondition;
+	bool					m_StopRequested = false;
+#endif
+
+	std::thread m_Thread;
+};
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "eviction_helper_buddy_allocator.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Same as D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT, the smallest block of a placement heap
+constexpr uint64_t PLACEMENT_HEAP_ALIGNMENT = 64ULL * 1024ULL;
+
+// Bookkeeping of the shared heaps that placed render targets are suballocated from, without the heaps themselves
+// Every block is one heap with its buddy allocator. All resources in a block belong to the same placement group (the
+// owning pool) and have the same priority, so a priority change or residency call on the resources of one pool never
+// reaches resources of another. Backends keep their heap objects in a table indexed by block.
+// A block also counts its evicted resources. Residency calls on a heap are reference counted, so the heap is only
+// evicted with its first evicted resource and made resident with its last one, and no new resource is placed in it
+// while it is evicted.
+// Not thread safe, the owner locks around it.
+class EvictionHelperPlacementHeaps
+{
+public:
+	// Find room in an existing resident heap of the group, priority and size
+	// Returns false if a new heap is needed, see AddBlock()
+	bool Allocate(uint64_t placementGroup, int priority, uint64_t heapSize, uint64_t sizeBytes, uint32_t* outBlock, uint64_t* outOffset)
+	{
+		for(uint32_t i = 0; i < m_Blocks.size(); i++)
+		{
+			Block& block = m_Blocks[i];
+			if(block.Allocator && block.EvictedCount == 0 && block.PlacementGroup == placementGroup && block.Priority == priority &&
+			   block.Allocator->GetCapacity() == heapSize && block.Allocator->Allocate(sizeBytes, outOffset))
+			{
+				block.ResourceCount++;
+				*outBlock = i;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Track a newly created heap of heapSize bytes (a power of two) and place the first resource in it
+	// Returns the block index, indices of released heaps are reused
+	uint32_t AddBlock(uint64_t placementGroup, int priority, uint64_t heapSize, uint64_t sizeBytes, uint64_t* outOffset)
+	{
+		Block block;
+		block.Allocator		 = std::make_unique<EvictionHelperBuddyAllocator>(heapSize, PLACEMENT_HEAP_ALIGNMENT);
+		block.PlacementGroup = placementGroup;
+		block.Priority		 = priority;
+		block.ResourceCount	 = 1;
+		block.Allocator->Allocate(sizeBytes, outOffset);
+
+		for(uint32_t i = 0; i < m_Blocks.size(); i++)
+		{
+			if(!m_Blocks[i].Allocator)
+			{
+				m_Blocks[i] = std::move(block);
+				return i;
+			}
+		}
+		m_Blocks.push_back(std::move(block));
+		return static_cast<uint32_t>(m_Blocks.size() - 1);
+	}
+
+	// Free a placed resource, evicted if it was evicted and not made resident since
+	// Returns true if that emptied the block and its heap can be released
+	bool Free(uint32_t blockIndex, uint64_t offset, bool evicted)
+	{
+		Block& block = m_Blocks[blockIndex];
+		block.Allocator->Free(offset);
+		if(evicted && block.EvictedCount > 0)
+			block.EvictedCount--;
+		if(--block.ResourceCount > 0)
+			return false;
+
+		block = Block();
+		return true;
+	}
+
+	// Change the priority of a block, returns false if it already has it and no call is needed
+	bool SetPriority(uint32_t blockIndex, int priority)
+	{
+		Block& block = m_Blocks[blockIndex];
+		if(block.Priority == priority)
+			return false;
+		block.Priority = priority;
+		return true;
+	}
+
+	// A resident resource of the block is evicted, returns true if it is the first one and the heap has to be evicted
+	bool Evict(uint32_t blockIndex)
+	{
+		return m_Blocks[blockIndex].EvictedCount++ == 0;
+	}
+
+	// An evicted resource of the block is made resident, returns true if it is the last one and the heap has to be
+	// made resident
+	bool MakeResident(uint32_t blockIndex)
+	{
+		Block& block = m_Blocks[blockIndex];
+		if(block.EvictedCount == 0)
+			return false;
+		return --block.EvictedCount == 0;
+	}
+
+	uint64_t GetPlacementGroup(uint32_t blockIndex) const
+	{
+		return m_Blocks[blockIndex].PlacementGroup;
+	}
+
+	uint32_t GetResourceCount(uint32_t blockIndex) const
+	{
+		return m_Blocks[blockIndex].ResourceCount;
+	}
+
+	uint32_t GetEvictedCount(uint32_t blockIndex) const
+	{
+		return m_Blocks[blockIndex].EvictedCount;
+	}
+
+	// Number of block indices in use or free for reuse
+	uint32_t GetBlockCount() const
+	{
+		return static_cast<uint32_t>(m_Blocks.size());
+	}
+
+private:
+	struct Block
+	{
+		std::unique_ptr<EvictionHelperBuddyAllocator> Allocator; // Null for a released block
+		uint64_t									  PlacementGroup = 0;
+		int											  Priority		 = 0;
+		uint32_t									  ResourceCount	 = 0;
+		uint32_t									  EvictedCount	 = 0; // The heap is evicted while this is not 0
+	};
+
+	std::vector<Block> m_Blocks;
+};
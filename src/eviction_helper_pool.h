@@ -0,0 +1,329 @@
+#pragma once
+
+#include "eviction_helper_device.h"
+#include "eviction_helper_allocation_worker.h"
+#include "eviction_helper_deferred_release.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// A pool of equally sized resources on one device, grown or shrunk to follow a target size
+// Backend independent, the device decides what a resource is (render target, host memory chunk, ...)
+// Resources are created by an EvictionHelperAllocationWorker. The pool only owns the resources that have been
+// handed back to the frame loop, and keeps track of the requests still in flight. Removed resources go to a
+// deferred release queue that destroys them once the GPU is done with them.
+class EvictionHelperPool
+{
+public:
+	EvictionHelperPool(EvictionHelperDevice* device, uint32_t kind, uint64_t chunkSize, int priority)
+		: m_Device(device)
+		, m_Kind(kind)
+		, m_ChunkSize(chunkSize)
+		, m_Priority(priority)
+	{
+	}
+
+	EvictionHelperPool(const EvictionHelperPool&)			 = delete;
+	EvictionHelperPool& operator=(const EvictionHelperPool&) = delete;
+
+	// Request creation or release of resources until the pool will cover targetBytes
+	// Requests that are still queued are cancelled first when the target shrinks
+	void Update(EvictionHelperAllocationWorker* worker, EvictionHelperDeferredReleaseQueue* releaseQueue, uint64_t targetBytes)
+	{
+		uint64_t targetCount = (targetBytes > 0) ? (targetBytes + m_ChunkSize - 1) / m_ChunkSize : 0;
+		if(targetCount != m_TargetCount)
+		{
+			// A new target is a new chance after running out of memory
+			m_TargetCount = targetCount;
+			m_OutOfMemory = false;
+		}
+
+		uint64_t expectedCount = m_Resources.size() + GetPendingCount();
+		if(expectedCount < targetCount && !m_OutOfMemory)
+		{
+			uint64_t missing = targetCount - expectedCount;
+
+			// Take back cancellations the worker has not consumed yet
+			missing -= TakeBackCancels(missing);
+
+			EvictionHelperAllocationRequest request = {};
+			request.Device							= m_Device;
+			request.Pool							= this;
+			request.CancelCount						= &m_CancelCount;
+			request.SizeBytes						= m_ChunkSize;
+			request.Type							= EVICTION_HELPER_ALLOCATION_CREATE;
+			request.Kind							= m_Kind;
+			request.Priority						= m_Priority;
+			request.PlacementGroup					= reinterpret_cast<uintptr_t>(this);
+			for(; missing > 0; missing--)
+			{
+				if(!worker->PushRequest(request))
+					break;
+				m_RequestedCount++;
+			}
+		}
+		else if(expectedCount > targetCount)
+		{
+			uint64_t excess = expectedCount - targetCount;
+
+			// Cancel requests that have not been executed yet before releasing finished resources
+			uint64_t cancel = std::min<uint64_t>(excess, GetPendingCount());
+			m_CancelledCount += cancel;
+			m_CancelCount.fetch_add(static_cast<uint32_t>(cancel), std::memory_order_acq_rel);
+			excess -= cancel;
+
+			for(; excess > 0 && !m_Resources.empty(); excess--)
+			{
+				releaseQueue->Push(m_Resources.back(), m_ChunkSize);
+				m_Resources.pop_back();
+				m_LastTouchedFrames.pop_back();
+				m_RemovedCount++;
+			}
+			m_EvictedCount = std::min(m_EvictedCount, static_cast<uint32_t>(m_Resources.size()));
+		}
+	}
+
+	// Take a finished create request from the worker
+	void OnAllocationResult(const EvictionHelperAllocationResult& result)
+	{
+		m_RequestedCount--;
+		if(result.Status == EVICTION_HELPER_ALLOCATION_CANCELLED)
+		{
+			m_CancelledCount--;
+			return;
+		}
+
+		// A cancel issued while this request was already executing would be left for a future request
+		if(m_CancelledCount > m_RequestedCount)
+		{
+			TakeBackCancels(m_CancelledCount - m_RequestedCount);
+		}
+
+		if(result.Status == EVICTION_HELPER_ALLOCATION_CREATED)
+		{
+			m_LastCreateNs = result.CreateNs;
+			// The priority may have changed while the request was queued, fixed in one batch by SetPriority()
+			if(result.Priority != m_Priority)
+			{
+				m_StalePriorityResources.push_back(result.Resource);
+			}
+			m_Resources.push_back(result.Resource);
+			m_LastTouchedFrames.push_back(0);
+		}
+		else if(result.Status == EVICTION_HELPER_ALLOCATION_FAILED)
+		{
+			// Out of memory, stop requesting until the target changes
+			m_OutOfMemory = true;
+		}
+	}
+
+	// Apply a new residency priority to all existing and future resources
+	// The whole pool is submitted to the device as one batch, resources that arrived from the worker with an
+	// older priority are fixed in the same way
+	void SetPriority(int priority)
+	{
+		if(priority != m_Priority)
+		{
+			m_Priority = priority;
+			SubmitPriority(m_Resources);
+		}
+		else if(!m_StalePriorityResources.empty())
+		{
+			SubmitPriority(m_StalePriorityResources);
+		}
+		m_StalePriorityResources.clear();
+	}
+
+	// Mark the selected resources as used by the current frame and stamp them with it, writing coverage (0-1) of each
+	// Indices count from the first resource that is not explicitly evicted (see GetTouchableCount()), so evicted
+	// resources are never touched. Returns the bytes of the touched resources.
+	uint64_t Touch(const std::vector<uint32_t>& indices, uint64_t frame, float coverage)
+	{
+		for(uint32_t index : indices)
+		{
+			size_t i = m_EvictedCount + index;
+			m_Device->TouchResourcePartial(m_Resources[i], coverage);
+			m_LastTouchedFrames[i] = frame;
+		}
+		return static_cast<uint64_t>(indices.size()) * m_ChunkSize;
+	}
+
+	// The first count resources have been explicitly evicted and must not be used until they are made resident
+	// Resources created later are appended, so the evicted ones always stay at the front
+	void SetEvictedCount(uint32_t count)
+	{
+		m_EvictedCount = std::min(count, static_cast<uint32_t>(m_Resources.size()));
+	}
+
+	// Change the device, kind and size of the resources, only allowed while IsIdle()
+	void SetLayout(EvictionHelperDevice* device, uint32_t kind, uint64_t chunkSize)
+	{
+		m_Device	  = device;
+		m_Kind		  = kind;
+		m_ChunkSize	  = chunkSize;
+		m_TargetCount = 0;
+		m_OutOfMemory = false;
+	}
+
+	// No resources and no requests in flight, including cancelled ones the worker has not returned yet
+	bool IsIdle() const
+	{
+		return m_Resources.empty() && m_RequestedCount == 0;
+	}
+
+	// Destroy all resources right away, the allocation worker must be stopped
+	void Release()
+	{
+		if(!m_Resources.empty())
+		{
+			m_Device->WaitForIdle();
+			for(EvictionHelperResource resource : m_Resources)
+			{
+				m_Device->DestroyResource(resource);
+			}
+			m_RemovedCount += m_Resources.size();
+			m_Resources.clear();
+			m_LastTouchedFrames.clear();
+		}
+		m_StalePriorityResources.clear();
+		m_EvictedCount	 = 0;
+		m_RequestedCount = 0;
+		m_CancelledCount = 0;
+		m_TargetCount	 = 0;
+		m_CancelCount.store(0, std::memory_order_relaxed);
+	}
+
+	uint64_t GetAllocatedBytes() const
+	{
+		return static_cast<uint64_t>(m_Resources.size()) * m_ChunkSize;
+	}
+
+	// Bytes requested from the worker that are still expected to arrive
+	uint64_t GetPendingBytes() const
+	{
+		return GetPendingCount() * m_ChunkSize;
+	}
+
+	uint32_t GetResourceCount() const
+	{
+		return static_cast<uint32_t>(m_Resources.size());
+	}
+
+	// Resources Touch() can select from
+	uint32_t GetTouchableCount() const
+	{
+		return static_cast<uint32_t>(m_Resources.size()) - m_EvictedCount;
+	}
+
+	// Frame a resource was last touched in, 0 if it never was
+	uint64_t GetLastTouchedFrame(uint32_t index) const
+	{
+		return m_LastTouchedFrames[index];
+	}
+
+	uint32_t GetEvictedCount() const
+	{
+		return m_EvictedCount;
+	}
+
+	uint64_t GetEvictedBytes() const
+	{
+		return static_cast<uint64_t>(m_EvictedCount) * m_ChunkSize;
+	}
+
+	uint32_t GetKind() const
+	{
+		return m_Kind;
+	}
+
+	uint64_t GetChunkSize() const
+	{
+		return m_ChunkSize;
+	}
+
+	int GetPriority() const
+	{
+		return m_Priority;
+	}
+
+	EvictionHelperDevice* GetDevice() const
+	{
+		return m_Device;
+	}
+
+	// An allocation failed, no more are requested until the target changes
+	bool IsOutOfMemory() const
+	{
+		return m_OutOfMemory;
+	}
+
+	// Time the device took to create the most recent resource
+	uint64_t GetLastCreateNs() const
+	{
+		return m_LastCreateNs;
+	}
+
+	const std::vector<EvictionHelperResource>& GetResources() const
+	{
+		return m_Resources;
+	}
+
+	// Number of resources taken out of the pool so far, a resource created later can get the handle and address of a
+	// removed one
+	uint64_t GetRemovedCount() const
+	{
+		return m_RemovedCount;
+	}
+
+private:
+	void SubmitPriority(const std::vector<EvictionHelperResource>& resources)
+	{
+		if(!resources.empty())
+		{
+			m_Device->SetResidencyPriorities(resources.data(), static_cast<uint32_t>(resources.size()), m_Priority);
+		}
+	}
+
+	// Create requests in flight that have not been cancelled
+	// Cancels the worker already consumed still count until their CANCELLED result is collected, otherwise the
+	// request would look pending again between the two and a shrink would cancel it a second time
+	uint64_t GetPendingCount() const
+	{
+		return (m_RequestedCount > m_CancelledCount) ? m_RequestedCount - m_CancelledCount : 0;
+	}
+
+	// Undo up to count cancels the worker has not consumed yet, returns how many were taken back
+	uint64_t TakeBackCancels(uint64_t count)
+	{
+		uint64_t takenBack = 0;
+		uint32_t cancelled = m_CancelCount.load(std::memory_order_acquire);
+		while(takenBack < count && cancelled > 0)
+		{
+			if(m_CancelCount.compare_exchange_weak(cancelled, cancelled - 1, std::memory_order_acq_rel))
+			{
+				cancelled--;
+				takenBack++;
+			}
+		}
+		m_CancelledCount -= takenBack;
+		return takenBack;
+	}
+
+	std::vector<EvictionHelperResource> m_Resources;
+	std::vector<EvictionHelperResource> m_StalePriorityResources;
+	std::vector<uint64_t>				m_LastTouchedFrames; // Parallel to m_Resources
+	EvictionHelperDevice*				m_Device;
+	uint32_t							m_Kind;
+	uint64_t							m_ChunkSize;
+	int									m_Priority;
+	uint64_t							m_TargetCount	 = 0;
+	uint64_t							m_RequestedCount = 0;
+	uint64_t							m_CancelledCount = 0; // Cancels issued that have neither been taken back nor returned as CANCELLED
+	uint32_t							m_EvictedCount	 = 0;
+	uint64_t							m_LastCreateNs	 = 0;
+	uint64_t							m_RemovedCount	 = 0;
+	bool								m_OutOfMemory	 = false;
+	std::atomic<uint32_t>				m_CancelCount{ 0 };
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+// Moves a pool size towards its target at a limited rate, with separate rates up and down
+// Turns target steps into ramps like a streaming system growing its pool would. A rate of 0 jumps to the
+// target immediately. The ramp only advances by the time passed to Update(), so it follows whatever clock the
+// caller uses, e.g. a virtual clock that runs a 10 minute ramp in a few milliseconds.
+class RampLimiter
+{
+public:
+	// Advance by dtSeconds towards targetBytes and return the new position in bytes
+	uint64_t Update(uint64_t targetBytes, double upBytesPerSecond, double downBytesPerSecond, double dtSeconds)
+	{
+		m_TargetBytes = targetBytes;
+
+		double target = static_cast<double>(targetBytes);
+		if(target > m_Position)
+		{
+			m_Position = (upBytesPerSecond > 0.0) ? std::min(target, m_Position + upBytesPerSecond * dtSeconds) : target;
+		}
+		else if(target < m_Position)
+		{
+			m_Position = (downBytesPerSecond > 0.0) ? std::max(target, m_Position - downBytesPerSecond * dtSeconds) : target;
+		}
+		return GetPositionBytes();
+	}
+
+	uint64_t GetPositionBytes() const
+	{
+		return static_cast<uint64_t>(m_Position);
+	}
+
+	bool IsAtTarget() const
+	{
+		return m_Position == static_cast<double>(m_TargetBytes);
+	}
+
+private:
+	// Kept as double so slow ramps still make progress with short frames
+	double	 m_Position	   = 0.0;
+	uint64_t m_TargetBytes = 0;
+};
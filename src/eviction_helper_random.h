@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+
+// Small seeded generator (splitmix64) for touch patterns, churn and scenario walks
+// Every platform and compiler produces the same sequence for a seed, which std:: distributions do not guarantee.
+class EvictionHelperRandom
+{
+public:
+	explicit EvictionHelperRandom(uint64_t seed = 0)
+		: m_State(seed)
+	{
+	}
+
+	// Restart the sequence from a seed
+	void Seed(uint64_t seed)
+	{
+		m_State = seed;
+	}
+
+	uint64_t Next()
+	{
+		uint64_t z = (m_State += 0x9E3779B97F4A7C15ULL);
+		z		   = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z		   = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+
+	// Uniform in [0, 1)
+	double NextUnit()
+	{
+		return static_cast<double>(Next() >> 11) * (1.0 / 9007199254740992.0);
+	}
+
+private:
+	uint64_t m_State;
+};
@@ -0,0 +1,266 @@
+#pragma once
+
+#include "eviction_helper_host_memory.h"
+#include "eviction_helper_pool.h"
+
+#ifdef _WIN32
+#include <psapi.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Default number of pages checked per frame and pool, 256 MB with 4 KB pages
+constexpr uint64_t HOST_RESIDENCY_DEFAULT_PAGES_PER_FRAME = 65536;
+
+// Incrementally tracks which pages of a pool on an EvictionHelperHostDevice are resident
+// Each call to Scan() checks a bounded number of pages and continues where the previous call stopped,
+// so a full pass over a large pool is spread over many frames. Residency is kept as one bit per page.
+// Each scanner owns its query buffers, so scanners can run on different threads.
+class HostResidencyScanner
+{
+public:
+	HostResidencyScanner() = default;
+
+	~HostResidencyScanner()
+	{
+#ifndef _WIN32
+		if(m_PagemapFd >= 0)
+			close(m_PagemapFd);
+#endif
+	}
+
+	HostResidencyScanner(const HostResidencyScanner&)			 = delete;
+	HostResidencyScanner& operator=(const HostResidencyScanner&) = delete;
+
+	// Check up to maxPages pages of the pool, starting at the current cursor
+	void Scan(const EvictionHelperHostDevice& device, const EvictionHelperPool& pool, uint64_t maxPages)
+	{
+		SyncChunks(device, pool);
+		if(m_Chunks.empty() || maxPages == 0)
+			return;
+
+		uint64_t pageSize = device.GetPageSize();
+		while(maxPages > 0)
+		{
+			if(m_CursorChunk >= m_Chunks.size())
+			{
+				m_CursorChunk = 0;
+				m_CursorPage  = 0;
+				m_CompletedPasses++;
+			}
+
+			ChunkState& chunk	  = m_Chunks[m_CursorChunk];
+			uint64_t	pageCount = std::min(maxPages, chunk.PageCount - m_CursorPage);
+
+			m_Scratch.resize(static_cast<size_t>(pageCount));
+			void* address = static_cast<uint8_t*>(chunk.Address) + m_CursorPage * pageSize;
+			if(!QueryResidency(address, pageCount, pageSize, m_Scratch.data()))
+				return;
+
+			for(uint64_t i = 0; i < pageCount; i++)
+			{
+				uint64_t  page	   = m_CursorPage + i;
+				uint64_t& word	   = chunk.Bits[static_cast<size_t>(page / 64)];
+				uint64_t  mask	   = 1ULL << (page % 64);
+				bool	  resident = m_Scratch[static_cast<size_t>(i)] != 0;
+				if(resident != ((word & mask) != 0))
+				{
+					word ^= mask;
+					if(resident)
+					{
+						chunk.ResidentPages++;
+						m_ResidentPages++;
+					}
+					else
+					{
+						chunk.ResidentPages--;
+						m_ResidentPages--;
+					}
+				}
+			}
+
+			maxPages -= pageCount;
+			m_CursorPage += pageCount;
+			if(m_CursorPage >= chunk.PageCount)
+			{
+				m_CursorChunk++;
+				m_CursorPage = 0;
+			}
+		}
+	}
+
+	uint64_t GetResidentBytes() const
+	{
+		return m_ResidentPages * m_PageSize;
+	}
+
+	uint64_t GetNonResidentBytes() const
+	{
+		return (m_TotalPages - m_ResidentPages) * m_PageSize;
+	}
+
+	// Number of full passes over the pool since the scanner was created
+	uint64_t GetCompletedPasses() const
+	{
+		return m_CompletedPasses;
+	}
+
+	// Read residency from /proc/self/pagemap instead of mincore(), which is the fallback where mincore() fails
+	void SetUsePagemap(bool usePagemap)
+	{
+		m_UsePagemap = usePagemap;
+	}
+
+private:
+	struct ChunkState
+	{
+		EvictionHelperResource Resource;
+		void*				   Address;
+		uint64_t			   SizeBytes;
+		uint64_t			   PageCount;
+		uint64_t			   ResidentPages;
+		std::vector<uint64_t>  Bits;
+	};
+
+	// Query which pages of a page-aligned range are resident in physical memory
+	// outResident receives one byte per page (1 = resident)
+	// Returns false if residency cannot be queried on this system
+	bool QueryResidency(void* address, uint64_t pageCount, uint64_t pageSize, uint8_t* outResident)
+	{
+#ifdef _WIN32
+		// Pages are counted as resident while they are in the working set, pages on the standby list are not
+		m_WorkingSetInfo.resize(static_cast<size_t>(pageCount));
+		for(uint64_t i = 0; i < pageCount; i++)
+		{
+			m_WorkingSetInfo[i].VirtualAddress = static_cast<uint8_t*>(address) + i * pageSize;
+		}
+		if(!QueryWorkingSetEx(GetCurrentProcess(), m_WorkingSetInfo.data(), static_cast<DWORD>(pageCount * sizeof(PSAPI_WORKING_SET_EX_INFORMATION))))
+		{
+			return false;
+		}
+		for(uint64_t i = 0; i < pageCount; i++)
+		{
+			outResident[i] = m_WorkingSetInfo[i].VirtualAttributes.Valid ? 1 : 0;
+		}
+		return true;
+#else
+		// Prefer mincore(), fall back to /proc/self/pagemap where mincore() is not available
+		if(!m_UsePagemap)
+		{
+			if(mincore(address, static_cast<size_t>(pageCount * pageSize), reinterpret_cast<unsigned char*>(outResident)) == 0)
+			{
+				for(uint64_t i = 0; i < pageCount; i++)
+				{
+					outResident[i] &= 1;
+				}
+				return true;
+			}
+			m_UsePagemap = true;
+		}
+
+		if(m_PagemapFd < 0)
+			m_PagemapFd = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+		if(m_PagemapFd < 0)
+		{
+			return false;
+		}
+
+		// One 64-bit entry per virtual page, bit 63 = present in RAM
+		m_PagemapEntries.resize(static_cast<size_t>(pageCount));
+		off_t offset	  = static_cast<off_t>(reinterpret_cast<uintptr_t>(address) / pageSize * sizeof(uint64_t));
+		ssize_t byteCount = static_cast<ssize_t>(pageCount * sizeof(uint64_t));
+		if(pread(m_PagemapFd, m_PagemapEntries.data(), static_cast<size_t>(byteCount), offset) != byteCount)
+		{
+			return false;
+		}
+		for(uint64_t i = 0; i < pageCount; i++)
+		{
+			outResident[i] = (m_PagemapEntries[i] >> 63) & 1;
+		}
+		return true;
+#endif
+	}
+
+	// Follow chunks added to or removed from the pool since the last scan
+	// Chunks only keep their state while nothing was removed from the pool, a chunk created after a removal can have
+	// the handle and address of a removed one. New chunks start out as resident since the pool touches every page when
+	// allocating.
+	void SyncChunks(const EvictionHelperHostDevice& device, const EvictionHelperPool& pool)
+	{
+		const std::vector<EvictionHelperResource>& resources = pool.GetResources();
+		m_PageSize											 = device.GetPageSize();
+
+		bool changed = resources.size() != m_Chunks.size();
+		if(pool.GetRemovedCount() != m_PoolRemovedCount)
+		{
+			m_PoolRemovedCount = pool.GetRemovedCount();
+			m_Chunks.clear();
+			changed = true;
+		}
+		for(size_t i = 0; i < resources.size(); i++)
+		{
+			void*	 address   = nullptr;
+			uint64_t sizeBytes = 0;
+			device.GetResourceRange(resources[i], &address, &sizeBytes);
+			if(i < m_Chunks.size() && m_Chunks[i].Resource == resources[i] && m_Chunks[i].Address == address && m_Chunks[i].SizeBytes == sizeBytes)
+				continue;
+
+			ChunkState state;
+			state.Resource		= resources[i];
+			state.Address		= address;
+			state.SizeBytes		= sizeBytes;
+			state.PageCount		= sizeBytes / m_PageSize;
+			state.ResidentPages = state.PageCount;
+			state.Bits.assign(static_cast<size_t>((state.PageCount + 63) / 64), ~0ULL);
+			if(i < m_Chunks.size())
+				m_Chunks[i] = std::move(state);
+			else
+				m_Chunks.push_back(std::move(state));
+			changed = true;
+		}
+
+		if(!changed)
+			return;
+
+		m_Chunks.resize(resources.size());
+		m_TotalPages	= 0;
+		m_ResidentPages = 0;
+		for(const ChunkState& chunk : m_Chunks)
+		{
+			m_TotalPages += chunk.PageCount;
+			m_ResidentPages += chunk.ResidentPages;
+		}
+		if(m_CursorChunk >= m_Chunks.size())
+		{
+			m_CursorChunk = 0;
+			m_CursorPage  = 0;
+		}
+		else if(m_CursorPage >= m_Chunks[m_CursorChunk].PageCount)
+		{
+			// The chunk under the cursor was replaced by a smaller one
+			m_CursorPage = 0;
+		}
+	}
+
+	std::vector<ChunkState> m_Chunks;
+	std::vector<uint8_t>	m_Scratch;
+#ifdef _WIN32
+	std::vector<PSAPI_WORKING_SET_EX_INFORMATION> m_WorkingSetInfo;
+#else
+	std::vector<uint64_t> m_PagemapEntries;
+	int					  m_PagemapFd = -1;
+#endif
+	bool	 m_UsePagemap		= false;
+	size_t	 m_CursorChunk		= 0;
+	uint64_t m_CursorPage		= 0;
+	uint64_t m_PageSize			= 4096;
+	uint64_t m_TotalPages		= 0;
+	uint64_t m_ResidentPages	= 0;
+	uint64_t m_CompletedPasses	= 0;
+	uint64_t m_PoolRemovedCount = 0;
+};
@@ -0,0 +1,565 @@
+#pragma once
+
+#include "eviction_helper_random.h"
+#include "eviction_helper_shared.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+// Scenario file format
+// A text file with one segment per line, '#' starts a comment. Times are in seconds from the start of the scenario,
+// sizes in MB and priorities 0-4 or minimum/low/normal/high/maximum.
+//
+//   step     <t>           <target> <property> <value>
+//   ramp     <start> <end> <target> <property> <from> <to>
+//   sawtooth <start> <end> <target> <property> <min> <max> <period>
+//   square   <start> <end> <target> <property> <low> <high> <period> [<duty percent, default 50>]
+//   random   <start> <end> <target> <property> <min> <max> <step> <interval> [<seed>]
+//   end      <t>           Length of the scenario, default is the end of the last segment
+//   loop                   Start over at the end
+//
+// Targets are active, unused, host, unused_host and named0 to named15, properties are size and priority.
+// Each target/property pair is a track. A track follows the segment that started last (the later line on ties) and
+// keeps the value the segment ended with until the next one starts. Before its first segment a track is left alone.
+// Sawtooth rises from min to max over each period, square starts high, random starts halfway between min and max
+// and moves by step up or down every interval.
+//
+//   # Grow the active pool to 6 GB, then pulse the unused pool while the host pool walks around 2 GB
+//   step     0       active      priority high
+//   ramp     0   20  active      size     1024 6144
+//   square   20  60  unused      size     0    2048 4 25
+//   random   20  60  host        size     1024 3072 128 0.5 7
+//   end      60
+
+// Segment shapes
+#define EVICTION_HELPER_SCENARIO_STEP     0
+#define EVICTION_HELPER_SCENARIO_RAMP     1
+#define EVICTION_HELPER_SCENARIO_SAWTOOTH 2
+#define EVICTION_HELPER_SCENARIO_SQUARE   3
+#define EVICTION_HELPER_SCENARIO_RANDOM   4
+
+// Track properties
+#define EVICTION_HELPER_SCENARIO_SIZE     0 // Target size in MB
+#define EVICTION_HELPER_SCENARIO_PRIORITY 1 // EVICTION_HELPER_PRIORITY_*
+
+// Upper limit for the precomputed values of a random walk
+#define EVICTION_HELPER_SCENARIO_MAX_WALK_STEPS (1u << 20)
+
+struct EvictionHelperScenarioSegment
+{
+	uint32_t			Line;	  // In the scenario file, starting at 1
+	uint32_t			Shape;	  // EVICTION_HELPER_SCENARIO_STEP, _RAMP, ...
+	uint32_t			Target;	  // EVICTION_HELPER_POOL_* or EVICTION_HELPER_POOL_NAMED(index)
+	uint32_t			Property; // EVICTION_HELPER_SCENARIO_SIZE or _PRIORITY
+	double				Start;	  // Seconds
+	double				End;	  // Seconds, equal to Start for steps
+	double				From;	  // Step value, ramp start, sawtooth and random minimum, square low
+	double				To;		  // Ramp end, sawtooth and random maximum, square high
+	double				Period;	  // Sawtooth and square period, random walk interval
+	double				Duty;	  // Fraction of a square period spent high
+	std::vector<double> Walk;	  // Random walk value of each interval
+};
+
+struct EvictionHelperScenarioValue
+{
+	uint32_t Target;   // EVICTION_HELPER_POOL_* or EVICTION_HELPER_POOL_NAMED(index)
+	uint32_t Property; // EVICTION_HELPER_SCENARIO_SIZE or _PRIORITY
+	int		 Value;	   // MB or EVICTION_HELPER_PRIORITY_*
+};
+
+// Parsed scenario and the value of each of its tracks over time
+// Only a function of the time passed in, so the caller decides the clock: the frame time for a virtual clock that
+// runs a long scenario in a few milliseconds on the simulated device, or the monotonic clock for real runs.
+class EvictionHelperScenario
+{
+public:
+	// Replace the scenario with the text, on failure the scenario is empty and GetError() describes the first bad line
+	bool Parse(const char* text)
+	{
+		Clear();
+
+		uint32_t	lineNumber = 0;
+		const char* lineStart  = text;
+		while(*lineStart)
+		{
+			const char* lineEnd = lineStart + strcspn(lineStart, "\r\n");
+			++lineNumber;
+			if(!ParseLine(std::string(lineStart, lineEnd), lineNumber))
+			{
+				std::string error	= m_Error;
+				uint32_t	errorLine = m_ErrorLine;
+				Clear();
+				m_Error		= error;
+				m_ErrorLine = errorLine;
+				return false;
+			}
+			lineStart = lineEnd;
+			if(*lineStart == '\r' && lineStart[1] == '\n')
+				++lineStart;
+			if(*lineStart)
+				++lineStart;
+		}
+
+		if(m_Segments.empty())
+			return Fail(0, "no segments");
+
+		if(m_Duration < 0.0)
+		{
+			m_Duration = 0.0;
+			for(const EvictionHelperScenarioSegment& segment : m_Segments)
+				m_Duration = std::max(m_Duration, segment.End);
+		}
+		if(m_Loop && m_Duration <= 0.0)
+		{
+			Clear();
+			return Fail(0, "loop needs a length above 0");
+		}
+
+		BuildTracks();
+		return true;
+	}
+
+	// Parse the scenario file at path
+	bool Load(const char* path)
+	{
+		Clear();
+		FILE* file = fopen(path, "rb");
+		if(!file)
+			return Fail(0, "cannot open the file");
+
+		std::string text;
+		char		buffer[4096];
+		size_t		read;
+		while((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+			text.append(buffer, read);
+		fclose(file);
+
+		return Parse(text.c_str());
+	}
+
+	void Clear()
+	{
+		m_Segments.clear();
+		m_Tracks.clear();
+		m_Duration	= -1.0;
+		m_Loop		= false;
+		m_Error.clear();
+		m_ErrorLine = 0;
+	}
+
+	bool IsEmpty() const
+	{
+		return m_Segments.empty();
+	}
+
+	// "line <n>: <reason>" for the last failed Parse() or Load()
+	const std::string& GetError() const
+	{
+		return m_Error;
+	}
+
+	// 0 if the error is not about a single line
+	uint32_t GetErrorLine() const
+	{
+		return m_ErrorLine;
+	}
+
+	uint32_t GetSegmentCount() const
+	{
+		return static_cast<uint32_t>(m_Segments.size());
+	}
+
+	const EvictionHelperScenarioSegment& GetSegment(uint32_t index) const
+	{
+		return m_Segments[index];
+	}
+
+	double GetDurationSeconds() const
+	{
+		return std::max(m_Duration, 0.0);
+	}
+
+	bool IsLooping() const
+	{
+		return m_Loop;
+	}
+
+	// Value of every track that has started by timeSeconds, the caller wraps looping scenarios into the duration
+	void Evaluate(double timeSeconds, std::vector<EvictionHelperScenarioValue>* outValues) const
+	{
+		outValues->clear();
+		for(const Track& track : m_Tracks)
+		{
+			int segmentIndex = FindSegment(track, timeSeconds);
+			if(segmentIndex < 0)
+				continue;
+
+			const EvictionHelperScenarioSegment& segment = m_Segments[segmentIndex];
+			double								 value	 = SampleSegment(segment, std::min(timeSeconds, segment.End));
+
+			EvictionHelperScenarioValue result;
+			result.Target	= track.Target;
+			result.Property = track.Property;
+			if(track.Property == EVICTION_HELPER_SCENARIO_PRIORITY)
+				result.Value = std::min(std::max(static_cast<int>(std::lround(value)), EVICTION_HELPER_PRIORITY_MINIMUM), EVICTION_HELPER_PRIORITY_MAXIMUM);
+			else
+				result.Value = std::max(static_cast<int>(std::lround(value)), 0);
+			outValues->push_back(result);
+		}
+	}
+
+	// Index of the segment that started last at or before timeSeconds (the later line on ties), -1 before the first one
+	int GetCurrentSegment(double timeSeconds) const
+	{
+		int current = -1;
+		for(uint32_t i = 0; i < m_Segments.size(); ++i)
+		{
+			if(m_Segments[i].Start <= timeSeconds && (current < 0 || m_Segments[i].Start >= m_Segments[current].Start))
+				current = static_cast<int>(i);
+		}
+		return current;
+	}
+
+	// First time after timeSeconds at which a value jumps: segment starts, square edges, sawtooth drops, random walk
+	// steps and the end of the scenario. Infinity if nothing jumps anymore. Ramps change continuously and are only
+	// sampled by the caller.
+	double GetNextChangeSeconds(double timeSeconds) const
+	{
+		double next = std::numeric_limits<double>::infinity();
+		if(m_Duration > timeSeconds)
+			next = m_Duration;
+
+		for(const EvictionHelperScenarioSegment& segment : m_Segments)
+		{
+			if(segment.Start > timeSeconds)
+			{
+				next = std::min(next, segment.Start);
+				continue;
+			}
+			if(timeSeconds >= segment.End || segment.Period <= 0.0)
+				continue;
+
+			double periodStart = segment.Start + GetPeriodIndex(segment, timeSeconds) * segment.Period;
+			double edge		   = periodStart + segment.Period;
+			if(segment.Shape == EVICTION_HELPER_SCENARIO_SQUARE)
+			{
+				double fall = periodStart + segment.Duty * segment.Period;
+				if(fall > timeSeconds && fall - periodStart < segment.Period)
+					edge = fall;
+			}
+			if(edge < segment.End)
+				next = std::min(next, edge);
+		}
+		return next;
+	}
+
+private:
+	// Segments of one target/property pair, sorted by start time
+	struct Track
+	{
+		uint32_t			  Target;
+		uint32_t			  Property;
+		std::vector<uint32_t> Segments;
+	};
+
+	// Period boundaries are nudged towards the later period, so a time computed by GetNextChangeSeconds() lands in it
+	// The end of the segment still belongs to the last period, so the segment holds the value it had just before it
+	static double GetPeriodIndex(const EvictionHelperScenarioSegment& segment, double timeSeconds)
+	{
+		return std::min(std::floor((timeSeconds - segment.Start) / segment.Period + 1e-9), GetLastPeriodIndex(segment));
+	}
+
+	static double GetLastPeriodIndex(const EvictionHelperScenarioSegment& segment)
+	{
+		return std::max(std::ceil((segment.End - segment.Start) / segment.Period - 1e-9) - 1.0, 0.0);
+	}
+
+	static double SampleSegment(const EvictionHelperScenarioSegment& segment, double timeSeconds)
+	{
+		switch(segment.Shape)
+		{
+		case EVICTION_HELPER_SCENARIO_RAMP:
+			if(segment.End <= segment.Start)
+				return segment.To;
+			return segment.From + (segment.To - segment.From) * (timeSeconds - segment.Start) / (segment.End - segment.Start);
+		case EVICTION_HELPER_SCENARIO_SAWTOOTH:
+		{
+			double phase = (timeSeconds - segment.Start) / segment.Period - GetPeriodIndex(segment, timeSeconds);
+			return segment.From + (segment.To - segment.From) * std::max(phase, 0.0);
+		}
+		case EVICTION_HELPER_SCENARIO_SQUARE:
+		{
+			double phase = (timeSeconds - segment.Start) / segment.Period - GetPeriodIndex(segment, timeSeconds);
+			return (phase + 1e-9 < segment.Duty) ? segment.To : segment.From;
+		}
+		case EVICTION_HELPER_SCENARIO_RANDOM:
+		{
+			size_t step = static_cast<size_t>(std::max(GetPeriodIndex(segment, timeSeconds), 0.0));
+			return segment.Walk[std::min(step, segment.Walk.size() - 1)];
+		}
+		default:
+			return segment.From;
+		}
+	}
+
+	int FindSegment(const Track& track, double timeSeconds) const
+	{
+		int found = -1;
+		for(uint32_t index : track.Segments)
+		{
+			if(m_Segments[index].Start > timeSeconds)
+				break;
+			found = static_cast<int>(index);
+		}
+		return found;
+	}
+
+	void BuildTracks()
+	{
+		for(uint32_t i = 0; i < m_Segments.size(); ++i)
+		{
+			const EvictionHelperScenarioSegment& segment = m_Segments[i];
+
+			Track* track = nullptr;
+			for(Track& existing : m_Tracks)
+			{
+				if(existing.Target == segment.Target && existing.Property == segment.Property)
+					track = &existing;
+			}
+			if(!track)
+			{
+				m_Tracks.push_back(Track{segment.Target, segment.Property, {}});
+				track = &m_Tracks.back();
+			}
+			track->Segments.push_back(i);
+		}
+
+		// Stable, so segments starting at the same time stay in file order and the later line wins
+		for(Track& track : m_Tracks)
+		{
+			std::stable_sort(track.Segments.begin(), track.Segments.end(), [this](uint32_t a, uint32_t b) { return m_Segments[a].Start < m_Segments[b].Start; });
+		}
+	}
+
+	bool Fail(uint32_t line, const char* reason)
+	{
+		char error[160];
+		if(line > 0)
+			snprintf(error, sizeof(error), "line %u: %s", line, reason);
+		else
+			snprintf(error, sizeof(error), "%s", reason);
+		m_Error		= error;
+		m_ErrorLine = line;
+		return false;
+	}
+
+	static bool ParseNumber(const std::string& token, double* outValue)
+	{
+		char*  end	 = nullptr;
+		double value = strtod(token.c_str(), &end);
+		if(end == token.c_str() || *end != '\0' || !std::isfinite(value))
+			return false;
+		*outValue = value;
+		return true;
+	}
+
+	static bool ParseTarget(const std::string& token, uint32_t* outTarget)
+	{
+		if(token == "active")
+			*outTarget = EVICTION_HELPER_POOL_ACTIVE;
+		else if(token == "unused")
+			*outTarget = EVICTION_HELPER_POOL_UNUSED;
+		else if(token == "host")
+			*outTarget = EVICTION_HELPER_POOL_HOST_ACTIVE;
+		else if(token == "unused_host")
+			*outTarget = EVICTION_HELPER_POOL_HOST_UNUSED;
+		else if(token.compare(0, 5, "named") == 0 && token.size() > 5)
+		{
+			char*		  end	= nullptr;
+			unsigned long index = strtoul(token.c_str() + 5, &end, 10);
+			if(*end != '\0' || index >= EVICTION_HELPER_MAX_NAMED_POOLS)
+				return false;
+			*outTarget = EVICTION_HELPER_POOL_NAMED(static_cast<uint32_t>(index));
+		}
+		else
+			return false;
+		return true;
+	}
+
+	static bool ParseValue(const std::string& token, uint32_t property, double* outValue)
+	{
+		if(property == EVICTION_HELPER_SCENARIO_PRIORITY)
+		{
+			static const char* names[] = {"minimum", "low", "normal", "high", "maximum"};
+			for(int i = 0; i < 5; ++i)
+			{
+				if(token == names[i])
+				{
+					*outValue = EVICTION_HELPER_PRIORITY_MINIMUM + i;
+					return true;
+				}
+			}
+			return ParseNumber(token, outValue) && *outValue >= EVICTION_HELPER_PRIORITY_MINIMUM && *outValue <= EVICTION_HELPER_PRIORITY_MAXIMUM;
+		}
+		return ParseNumber(token, outValue) && *outValue >= 0.0 && *outValue <= static_cast<double>(INT32_MAX);
+	}
+
+	bool ParseLine(const std::string& line, uint32_t lineNumber)
+	{
+		std::vector<std::string> tokens;
+		size_t					 position = 0;
+		while(position < line.size() && line[position] != '#')
+		{
+			size_t start = line.find_first_not_of(" \t", position);
+			if(start == std::string::npos || line[start] == '#')
+				break;
+			size_t end = line.find_first_of(" \t#", start);
+			if(end == std::string::npos)
+				end = line.size();
+			tokens.push_back(line.substr(start, end - start));
+			position = end;
+		}
+		if(tokens.empty())
+			return true;
+
+		const std::string& keyword = tokens[0];
+		if(keyword == "loop")
+		{
+			if(tokens.size() != 1)
+				return Fail(lineNumber, "loop takes no arguments");
+			m_Loop = true;
+			return true;
+		}
+		if(keyword == "end")
+		{
+			double end = 0.0;
+			if(tokens.size() != 2 || !ParseNumber(tokens[1], &end) || end < 0.0)
+				return Fail(lineNumber, "expected end <seconds>");
+			m_Duration = end;
+			return true;
+		}
+
+		EvictionHelperScenarioSegment segment = {};
+		segment.Line						  = lineNumber;
+
+		// Minimum and maximum number of tokens including the keyword
+		size_t minTokens;
+		size_t maxTokens;
+		if(keyword == "step")
+		{
+			segment.Shape = EVICTION_HELPER_SCENARIO_STEP;
+			minTokens = maxTokens = 5;
+		}
+		else if(keyword == "ramp")
+		{
+			segment.Shape = EVICTION_HELPER_SCENARIO_RAMP;
+			minTokens = maxTokens = 7;
+		}
+		else if(keyword == "sawtooth")
+		{
+			segment.Shape = EVICTION_HELPER_SCENARIO_SAWTOOTH;
+			minTokens = maxTokens = 8;
+		}
+		else if(keyword == "square")
+		{
+			segment.Shape = EVICTION_HELPER_SCENARIO_SQUARE;
+			minTokens	  = 8;
+			maxTokens	  = 9;
+		}
+		else if(keyword == "random")
+		{
+			segment.Shape = EVICTION_HELPER_SCENARIO_RANDOM;
+			minTokens	  = 9;
+			maxTokens	  = 10;
+		}
+		else
+			return Fail(lineNumber, "unknown keyword");
+
+		if(tokens.size() < minTokens || tokens.size() > maxTokens)
+			return Fail(lineNumber, "wrong number of arguments");
+
+		// Steps have a single time, everything else a start and an end
+		size_t next = 1;
+		if(!ParseNumber(tokens[next++], &segment.Start) || segment.Start < 0.0)
+			return Fail(lineNumber, "invalid start time");
+		segment.End = segment.Start;
+		if(segment.Shape != EVICTION_HELPER_SCENARIO_STEP && (!ParseNumber(tokens[next++], &segment.End) || segment.End < segment.Start))
+			return Fail(lineNumber, "invalid end time");
+
+		if(!ParseTarget(tokens[next++], &segment.Target))
+			return Fail(lineNumber, "unknown target");
+
+		const std::string& property = tokens[next++];
+		if(property == "size")
+			segment.Property = EVICTION_HELPER_SCENARIO_SIZE;
+		else if(property == "priority")
+			segment.Property = EVICTION_HELPER_SCENARIO_PRIORITY;
+		else
+			return Fail(lineNumber, "unknown property");
+
+		if(!ParseValue(tokens[next++], segment.Property, &segment.From))
+			return Fail(lineNumber, "invalid value");
+		segment.To = segment.From;
+		if(segment.Shape != EVICTION_HELPER_SCENARIO_STEP && !ParseValue(tokens[next++], segment.Property, &segment.To))
+			return Fail(lineNumber, "invalid value");
+
+		if(segment.Shape == EVICTION_HELPER_SCENARIO_SAWTOOTH || segment.Shape == EVICTION_HELPER_SCENARIO_SQUARE)
+		{
+			if(!ParseNumber(tokens[next++], &segment.Period) || segment.Period <= 0.0)
+				return Fail(lineNumber, "invalid period");
+
+			double dutyPercent = 50.0;
+			if(next < tokens.size() && (!ParseNumber(tokens[next++], &dutyPercent) || dutyPercent < 0.0 || dutyPercent > 100.0))
+				return Fail(lineNumber, "invalid duty percentage");
+			segment.Duty = dutyPercent / 100.0;
+		}
+		else if(segment.Shape == EVICTION_HELPER_SCENARIO_RANDOM)
+		{
+			double stepSize = 0.0;
+			double seed		= 1.0;
+			if(segment.To < segment.From)
+				return Fail(lineNumber, "min is above max");
+			if(!ParseNumber(tokens[next++], &stepSize) || stepSize <= 0.0)
+				return Fail(lineNumber, "invalid step");
+			if(!ParseNumber(tokens[next++], &segment.Period) || segment.Period <= 0.0)
+				return Fail(lineNumber, "invalid interval");
+			if(next < tokens.size() && (!ParseNumber(tokens[next++], &seed) || seed < 0.0))
+				return Fail(lineNumber, "invalid seed");
+			if((segment.End - segment.Start) / segment.Period >= EVICTION_HELPER_SCENARIO_MAX_WALK_STEPS)
+				return Fail(lineNumber, "too many random walk steps");
+			BuildWalk(&segment, stepSize, static_cast<uint64_t>(seed));
+		}
+
+		m_Segments.push_back(std::move(segment));
+		return true;
+	}
+
+	// The walk only depends on the segment and the seed, so a scenario replays the same on every run
+	static void BuildWalk(EvictionHelperScenarioSegment* segment, double stepSize, uint64_t seed)
+	{
+		size_t count = static_cast<size_t>(GetLastPeriodIndex(*segment)) + 1;
+		segment->Walk.resize(count);
+
+		double				 value = (segment->From + segment->To) * 0.5;
+		EvictionHelperRandom random(seed);
+		for(size_t i = 0; i < count; ++i)
+		{
+			segment->Walk[i] = value;
+			value			 = std::min(std::max(value + ((random.Next() >> 63) ? stepSize : -stepSize), segment->From), segment->To);
+		}
+	}
+
+	std::vector<EvictionHelperScenarioSegment> m_Segments;
+	std::vector<Track>						   m_Tracks;
+	double									   m_Duration = -1.0; // Below 0 until an end line or the last segment sets it
+	bool									   m_Loop	  = false;
+	std::string								   m_Error;
+	uint32_t								   m_ErrorLine = 0;
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "eviction_helper_shared.h"
+#include "eviction_helper_core.h"
+#include "eviction_helper_frame_pacer.h"
+
+#include <cstdint>
+
+// Submission of the touches of a headless frame, implemented by the platform
+// The D3D12 implementation resets and binds a command list and executes it on a bare queue, devices that touch
+// on the CPU need nothing.
+class EvictionHelperServiceFrame
+{
+public:
+	virtual ~EvictionHelperServiceFrame() = default;
+
+	// Called before the active pools are touched
+	virtual void BeginFrame() {}
+
+	// Called after the active pools are touched, before EvictionHelperCore::EndFrame() signals the device fences
+	virtual void EndFrame() {}
+};
+
+// Frame loop without window, swap chain or UI, returns once a controller sets RequestShutdown
+// Applies commands as soon as they are due and inputs as soon as a controller signals them, and touches the active
+// pools at FrameRate. In between it sleeps on the wake signal, so it does nothing but the touches while no controller
+// is talking to it.
+// frame can be null if the devices need no submission.
+inline void EvictionHelper_RunService(EvictionHelperSharedMemory* sharedMem, EvictionHelperCore* core, EvictionHelperServiceFrame* frame)
+{
+	EvictionHelperSharedData* data			  = sharedMem->pData;
+	uint32_t				  lastWakeCounter = data->WakeCounter.load(std::memory_order_acquire);
+	EvictionHelperFramePacer  pacer;
+
+	while(!data->RequestShutdown)
+	{
+		// Apply queued commands as soon as they are due, and changed inputs as soon as a controller signals them
+		// The counter is read first, a signal for commands pushed after ProcessCommands() then still ends the next wait
+		uint32_t wakeCounter = data->WakeCounter.load(std::memory_order_acquire);
+		core->ProcessCommands();
+		if(wakeCounter != lastWakeCounter)
+		{
+			lastWakeCounter = wakeCounter;
+			core->UpdateAllocations();
+		}
+
+		// Sleep until the next frame, a signal or the next delayed command
+		pacer.Update(data);
+		uint64_t now = EvictionHelper_GetTimestampNs();
+		if(!pacer.IsFrameDue(now))
+		{
+			uint64_t wakeNs		   = pacer.GetNextFrameNs();
+			uint64_t commandTimeNs = core->GetNextCommandTimeNs();
+			if(commandTimeNs != 0 && commandTimeNs < wakeNs)
+				wakeNs = commandTimeNs;
+			pacer.WaitUntil(wakeNs, sharedMem, lastWakeCounter);
+			continue;
+		}
+		uint64_t elapsedNs = pacer.BeginFrame(now);
+
+		// Query memory info, run the budget controller and pick up inputs changed without a signal
+		core->BeginFrame(elapsedNs);
+
+		if(frame)
+			frame->BeginFrame();
+		core->TouchActiveMemory();
+		if(frame)
+			frame->EndFrame();
+
+		// Increment frame counter, publish a consistent copy of this frame's output fields and append it to the history
+		core->EndFrame(elapsedNs);
+	}
+}
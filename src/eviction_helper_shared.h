@@ -1,13 +1,59 @@
 #pragma once
 
+#ifdef _WIN32
 #ifndef WIN32_LEAN_AND_MEAN
 #define WIN32_LEAN_AND_MEAN
 #endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
 #include <windows.h>
+#else
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sched.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+#endif
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <cstdio>
+#include <cstring>
 
 // Shared memory name - use this to open from other processes
+#ifdef _WIN32
 #define EVICTION_HELPER_SHARED_MEMORY_NAME "Local\\EvictionHelperSharedMemory"
+// Auto-reset event used to wake eviction-helper, WaitOnAddress cannot be used across processes
+#define EVICTION_HELPER_WAKE_EVENT_NAME "Local\\EvictionHelperWakeEvent"
+// Manual-reset events set for odd and even budget generations, see EvictionHelper_WaitForBudgetChange()
+#define EVICTION_HELPER_BUDGET_EVENT_NAME_0 "Local\\EvictionHelperBudgetEvent0"
+#define EVICTION_HELPER_BUDGET_EVENT_NAME_1 "Local\\EvictionHelperBudgetEvent1"
+// Longest single wait on a budget event, bounds how late a waiter notices a change whose event was reset again
+#define EVICTION_HELPER_BUDGET_WAIT_SLICE_MS 16
+#else
+#define EVICTION_HELPER_SHARED_MEMORY_NAME "/EvictionHelperSharedMemory"
+// Directory of the backing file used instead of shm_open when huge pages are requested and hugetlbfs is mounted, the
+// file is named like the shared memory object
+#ifndef EVICTION_HELPER_HUGETLBFS_DIR
+#define EVICTION_HELPER_HUGETLBFS_DIR "/dev/hugepages"
+#endif
+#define EVICTION_HELPER_HUGETLBFS_PATH EVICTION_HELPER_HUGETLBFS_DIR EVICTION_HELPER_SHARED_MEMORY_NAME
+#define EVICTION_HELPER_HUGE_PAGE_SIZE (2ULL * 1024ULL * 1024ULL)
+#endif
+
+// Mapping flags for EvictionHelper_CreateSharedMemoryEx / EvictionHelper_OpenSharedMemoryEx
+// These only affect the POSIX implementation and are ignored on Windows
+#define EVICTION_HELPER_MAPPING_DEFAULT    0
+#define EVICTION_HELPER_MAPPING_HUGE_PAGES 0x1 // Back the mapping with huge pages (hugetlbfs, or transparent huge pages as fallback)
+#define EVICTION_HELPER_MAPPING_POPULATE   0x2 // Prefault the mapping with MAP_POPULATE so the first access does not page-fault
 
 // Priority values (maps to D3D12_RESIDENCY_PRIORITY)
 // 0 = MINIMUM, 1 = LOW, 2 = NORMAL, 3 = HIGH, 4 = MAXIMUM
@@ -17,6 +63,313 @@
 #define EVICTION_HELPER_PRIORITY_HIGH     3
 #define EVICTION_HELPER_PRIORITY_MAXIMUM  4
 
+// Consistent copy of the output fields of EvictionHelperSharedData, all taken from the same frame
+struct EvictionHelperSnapshot
+{
+    uint64_t FrameCount;
+
+    uint64_t CurrentVRAMAllocationBytes;
+    uint64_t CurrentUnusedVRAMAllocationBytes;
+    uint64_t CurrentHeapAllocationBytes;
+    uint32_t AllocatedRenderTargetCount;
+    uint32_t AllocatedUnusedRenderTargetCount;
+
+    uint64_t LocalBudget;
+    uint64_t LocalCurrentUsage;
+    uint64_t LocalAvailableForReservation;
+    uint64_t LocalCurrentReservation;
+
+    uint64_t NonLocalBudget;
+    uint64_t NonLocalCurrentUsage;
+    uint64_t NonLocalAvailableForReservation;
+    uint64_t NonLocalCurrentReservation;
+
+    uint64_t CurrentHostMemoryAllocationBytes;
+    uint64_t CurrentUnusedHostMemoryAllocationBytes;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared memory atomics must be lock free to work across processes");
+
+// Command types for the command ring (see EvictionHelper_PushCommand)
+#define EVICTION_HELPER_COMMAND_SET_TARGET    1 // Target = EVICTION_HELPER_POOL_*, Value = target size in MB
+#define EVICTION_HELPER_COMMAND_SET_PRIORITY  2 // Target = EVICTION_HELPER_POOL_*, Value = EVICTION_HELPER_PRIORITY_*, other values are ignored
+#define EVICTION_HELPER_COMMAND_ALLOCATE_HEAP 3 // Target = EVICTION_HELPER_HEAP_*, Value = 1 to allocate, 0 to release. For EVICTION_HELPER_HEAP_TABLE(index) Value = size in MB
+#define EVICTION_HELPER_COMMAND_BARRIER       4 // No effect, completes once all earlier commands have been applied
+#define EVICTION_HELPER_COMMAND_EVICT         5 // Target = EVICTION_HELPER_POOL_*, evicts the whole pool, see ResidencyOp*
+#define EVICTION_HELPER_COMMAND_MAKE_RESIDENT 6 // Target = EVICTION_HELPER_POOL_*, Value = EVICTION_HELPER_MAKE_RESIDENT_*
+
+// How MAKE_RESIDENT pages a pool back in
+#define EVICTION_HELPER_MAKE_RESIDENT_BLOCKING 0 // ID3D12Device::MakeResident, returns once the pool is resident
+#define EVICTION_HELPER_MAKE_RESIDENT_ENQUEUE  1 // ID3D12Device3::EnqueueMakeResident, completes when its fence is signaled
+
+// State of the last EVICT or MAKE_RESIDENT command (see ResidencyOpStatus)
+#define EVICTION_HELPER_RESIDENCY_OP_NONE    0
+#define EVICTION_HELPER_RESIDENCY_OP_PENDING 1 // Enqueued, waiting for the residency fence
+#define EVICTION_HELPER_RESIDENCY_OP_DONE    2
+#define EVICTION_HELPER_RESIDENCY_OP_FAILED  3 // Not supported by the device, out of memory or invalid target
+
+// Command targets
+#define EVICTION_HELPER_POOL_ACTIVE 0
+#define EVICTION_HELPER_POOL_UNUSED 1
+#define EVICTION_HELPER_POOL_HOST_ACTIVE 2
+#define EVICTION_HELPER_POOL_HOST_UNUSED 3
+#define EVICTION_HELPER_POOL_COUNT  4
+#define EVICTION_HELPER_POOL_NAMED(index) (EVICTION_HELPER_POOL_COUNT + (index)) // NamedPools[index]
+#define EVICTION_HELPER_HEAP_512MB  0
+#define EVICTION_HELPER_HEAP_1GB    1
+#define EVICTION_HELPER_HEAP_TABLE(index) (2 + (index)) // Heaps[index]
+
+// Number of entries in NamedPools
+#define EVICTION_HELPER_MAX_NAMED_POOLS 16
+
+// What the resources of a named pool are (see EvictionHelperPoolDesc::Kind)
+#define EVICTION_HELPER_POOL_KIND_RENDER_TARGET 0 // VRAM render targets, touched by clearing them
+#define EVICTION_HELPER_POOL_KIND_HEAP          1 // Bare VRAM heaps, only count towards usage and are never touched
+#define EVICTION_HELPER_POOL_KIND_HOST_MEMORY   2 // Host memory chunks, touched by writing their pages
+
+// Number of entries in Heaps
+#define EVICTION_HELPER_MAX_HEAPS 256
+
+// Resources a heap of the heap table accepts (see EvictionHelperHeapDesc::Type)
+#define EVICTION_HELPER_HEAP_TYPE_RT_DS   0 // D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES
+#define EVICTION_HELPER_HEAP_TYPE_BUFFERS 1 // D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS
+
+// Size distributions of the churn workload (see ChurnDistribution)
+#define EVICTION_HELPER_CHURN_LOG_UNIFORM 0 // Log-uniform between ChurnMinSizeKB and ChurnMaxSizeKB
+#define EVICTION_HELPER_CHURN_BIMODAL     1 // Within a factor of 2 above ChurnMinSizeKB or below ChurnMaxSizeKB, ChurnLargePercent are large
+#define EVICTION_HELPER_CHURN_HISTOGRAM   2 // Sizes and weights read from ChurnHistogramPath
+
+// Buckets of the latency histograms, bucket i counts operations that took [2^i, 2^(i+1)) microseconds
+#define EVICTION_HELPER_LATENCY_BUCKETS 24
+
+// Trace replay states (see TraceReplayState)
+#define EVICTION_HELPER_TRACE_STATE_IDLE     0 // TraceReplay is off, no replayed resources
+#define EVICTION_HELPER_TRACE_STATE_PLAYING  1
+#define EVICTION_HELPER_TRACE_STATE_FINISHED 2 // All events issued, the resources live at the end of the trace are kept
+#define EVICTION_HELPER_TRACE_STATE_FAILED   3 // TraceReplayPath could not be opened or is not a trace file
+
+// Scenario states (see ScenarioState)
+#define EVICTION_HELPER_SCENARIO_STATE_IDLE     0 // Scenario is off, the inputs keep their last values
+#define EVICTION_HELPER_SCENARIO_STATE_RUNNING  1
+#define EVICTION_HELPER_SCENARIO_STATE_FINISHED 2 // Past the end of a scenario without loop, the inputs are no longer written
+#define EVICTION_HELPER_SCENARIO_STATE_FAILED   3 // ScenarioPath could not be read or parsed, see ScenarioError
+
+// Scenario clocks (see ScenarioClock)
+#define EVICTION_HELPER_SCENARIO_CLOCK_FRAME     0 // Frame times passed to BeginFrame(), virtual with the simulated device
+#define EVICTION_HELPER_SCENARIO_CLOCK_MONOTONIC 1 // Wall clock, steps are applied between frames when they are due
+
+// Touch patterns of the active pools (see TouchPattern)
+#define EVICTION_HELPER_TOUCH_ALL         0 // Every resource every frame
+#define EVICTION_HELPER_TOUCH_ROUND_ROBIN 1 // A window of TouchPercent of the pool that moves on every frame
+#define EVICTION_HELPER_TOUCH_RANDOM      2 // A random TouchPercent of the pool every frame
+#define EVICTION_HELPER_TOUCH_ZIPF        3 // Hot/cold, resource i is touched with a probability proportional to 1 / (i + 1)^TouchZipfExponent
+#define EVICTION_HELPER_TOUCH_NONE        4 // Never touched, an idle pool
+
+// Budget control modes (see BudgetControlMode)
+#define EVICTION_HELPER_BUDGET_CONTROL_OFF      0 // Pool targets are set by the controlling application
+#define EVICTION_HELPER_BUDGET_CONTROL_PERCENT  1 // Hold local usage at BudgetControlPercent of the local budget
+#define EVICTION_HELPER_BUDGET_CONTROL_HEADROOM 2 // Hold local usage at the local budget minus BudgetControlHeadroomMB
+
+// Number of commands in the ring, must be a power of two
+#define EVICTION_HELPER_COMMAND_RING_SIZE 256
+
+// A single command, written by the controller and applied in order by eviction-helper
+struct EvictionHelperCommand
+{
+    uint64_t Sequence;          // Assigned by EvictionHelper_PushCommand, starts at 1
+    uint64_t TimestampNs;       // Submission time (EvictionHelper_GetTimestampNs)
+    uint64_t ExecuteAtNs;       // Not applied before this time, 0 = as soon as possible
+    uint32_t Type;              // EVICTION_HELPER_COMMAND_*
+    uint32_t Target;            // Pool or heap the command applies to
+    int64_t Value;
+};
+
+// Single-producer/single-consumer command queue
+// Only one controlling application may push commands at a time
+struct EvictionHelperCommandRing
+{
+    alignas(64) std::atomic<uint64_t> WriteIndex;           // Advanced by the controller
+    alignas(64) std::atomic<uint64_t> ReadIndex;            // Advanced by eviction-helper
+    alignas(64) std::atomic<uint64_t> CompletedSequence;    // Sequence of the last applied command
+    EvictionHelperCommand Commands[EVICTION_HELPER_COMMAND_RING_SIZE];
+};
+
+// Number of samples kept in the telemetry history, must be a power of two
+#define EVICTION_HELPER_TELEMETRY_RING_SIZE 4096
+
+// Per-frame telemetry sample, appended to the history ring by eviction-helper
+struct EvictionHelperTelemetrySample
+{
+    uint64_t TimestampNs;       // EvictionHelper_GetTimestampNs() when the sample was taken
+    uint64_t FrameCount;
+    uint64_t FrameTimeNs;       // Time since the previous frame started
+
+    uint64_t LocalBudget;
+    uint64_t LocalCurrentUsage;
+    uint64_t LocalCurrentReservation;
+    uint64_t NonLocalBudget;
+    uint64_t NonLocalCurrentUsage;
+    uint64_t NonLocalCurrentReservation;
+
+    uint64_t ActiveAllocationBytes;
+    uint64_t UnusedAllocationBytes;
+    uint64_t HeapAllocationBytes;
+    uint64_t HostMemoryAllocationBytes;
+    uint64_t UnusedHostMemoryAllocationBytes;
+};
+
+// Slot in the telemetry ring, Sequence is 2 * index + 1 while the sample is written and 2 * index + 2 once complete
+struct EvictionHelperTelemetrySlot
+{
+    std::atomic<uint64_t> Sequence;
+    EvictionHelperTelemetrySample Sample;
+};
+
+// Fixed-capacity history of telemetry samples, single writer, any number of lock-free readers
+struct EvictionHelperTelemetryRing
+{
+    alignas(64) std::atomic<uint64_t> Head;     // Total number of samples written, index of the next sample
+    EvictionHelperTelemetrySlot Slots[EVICTION_HELPER_TELEMETRY_RING_SIZE];
+};
+
+// Number of samples kept in the memory sample history, must be a power of two (8 seconds at the maximum rate)
+#define EVICTION_HELPER_MEMORY_SAMPLE_RING_SIZE 8192
+
+// Highest rate of the memory sampler (see MemorySampleRateHz)
+#define EVICTION_HELPER_MEMORY_SAMPLE_MAX_RATE_HZ 1000
+
+// Budget and usage sampled by the memory sampler thread, independent of the frame rate
+struct EvictionHelperMemorySample
+{
+    uint64_t TimestampNs;       // EvictionHelper_GetTimestampNs() right before the query
+    uint64_t QueryNs;           // Time the query took
+    uint64_t LateNs;            // How much later than scheduled the sample was taken
+
+    uint64_t LocalBudget;
+    uint64_t LocalCurrentUsage;
+    uint64_t LocalAvailableForReservation;
+    uint64_t LocalCurrentReservation;
+    uint64_t NonLocalBudget;
+    uint64_t NonLocalCurrentUsage;
+    uint64_t NonLocalAvailableForReservation;
+    uint64_t NonLocalCurrentReservation;
+};
+
+// Slot in the memory sample ring, same sequence protocol as EvictionHelperTelemetrySlot
+struct EvictionHelperMemorySampleSlot
+{
+    std::atomic<uint64_t> Sequence;
+    EvictionHelperMemorySample Sample;
+};
+
+// Fixed-capacity history of memory samples, single writer (the sampler thread), any number of lock-free readers
+struct EvictionHelperMemorySampleRing
+{
+    alignas(64) std::atomic<uint64_t> Head;     // Total number of samples written, index of the next sample
+    EvictionHelperMemorySampleSlot Slots[EVICTION_HELPER_MEMORY_SAMPLE_RING_SIZE];
+};
+
+// Number of budget changes kept in the budget change history, must be a power of two
+#define EVICTION_HELPER_BUDGET_CHANGE_RING_SIZE 256
+
+// How a budget change was noticed (see EvictionHelperBudgetChange::Source)
+#define EVICTION_HELPER_BUDGET_SOURCE_POLL         0 // Frame loop query, the only source without OS notifications
+#define EVICTION_HELPER_BUDGET_SOURCE_NOTIFICATION 1 // Budget change notification of the OS
+
+// Budget watcher state (see BudgetWatcherState)
+#define EVICTION_HELPER_BUDGET_WATCHER_POLLING  0 // The device has no notifications, changes are only seen by the frame loop
+#define EVICTION_HELPER_BUDGET_WATCHER_NOTIFIED 1 // Waiting for OS notifications on the watcher thread
+
+// A change of the local or non-local budget
+struct EvictionHelperBudgetChange
+{
+    uint64_t TimestampNs;           // EvictionHelper_GetTimestampNs() when the notification woke the watcher, or of the query for POLL
+    uint64_t LatencyNs;             // From TimestampNs until the change was published
+    uint32_t Generation;            // BudgetGeneration after this change
+    uint32_t Source;                // EVICTION_HELPER_BUDGET_SOURCE_*
+
+    uint64_t LocalBudget;
+    uint64_t PreviousLocalBudget;
+    uint64_t NonLocalBudget;
+    uint64_t PreviousNonLocalBudget;
+    uint64_t LocalCurrentUsage;
+    uint64_t NonLocalCurrentUsage;
+};
+
+// Slot in the budget change ring, same sequence protocol as EvictionHelperTelemetrySlot
+struct EvictionHelperBudgetChangeSlot
+{
+    std::atomic<uint64_t> Sequence;
+    EvictionHelperBudgetChange Sample;
+};
+
+// Fixed-capacity history of budget changes, single writer (the budget watcher), any number of lock-free readers
+struct EvictionHelperBudgetChangeRing
+{
+    alignas(64) std::atomic<uint64_t> Head;     // Total number of changes written, index of the next change
+    EvictionHelperBudgetChangeSlot Slots[EVICTION_HELPER_BUDGET_CHANGE_RING_SIZE];
+};
+
+// A pool of equally sized resources configured by the controlling application (see NamedPools)
+// Changing Kind or ChunkSizeKB releases the pool and allocates it again with the new layout
+struct EvictionHelperPoolDesc
+{
+    // Input
+    char Name[32];                  // Shown in the UI, not used by the helper
+    int TargetMB;                   // Target size in megabytes
+    int Priority;                   // EVICTION_HELPER_PRIORITY_*, Default: NORMAL
+    uint32_t Kind;                  // EVICTION_HELPER_POOL_KIND_*
+    uint32_t ChunkSizeKB;           // Size of each resource, 0 = default for the kind (16 MB render targets, 64 MB otherwise)
+    uint32_t TouchPattern;          // EVICTION_HELPER_TOUCH_*, Default: ALL
+    uint32_t TouchPercent;          // Resources touched per frame in percent of the pool, Default: 100
+    uint32_t TouchCoveragePercent;  // Part of each resource that is written when touched, Default: 100
+    float RampUpMBPerSecond;        // 0 = reach the target in one step
+    float RampDownMBPerSecond;
+    uint32_t _padding;
+
+    // Output
+    uint64_t AllocatedBytes;
+    uint64_t PendingBytes;          // Requested from the worker but not created yet
+    uint64_t EvictedBytes;          // Explicitly evicted with EVICTION_HELPER_COMMAND_EVICT
+    uint64_t RampPositionBytes;
+    uint64_t TouchedBytesLastFrame;
+    uint64_t ChunkSizeBytes;        // Chunk size currently allocated, differs from ChunkSizeKB while the pool is released for a new layout
+    uint32_t ResourceCount;
+    uint32_t OutOfMemory;           // 1 once an allocation failed, retried when the target changes
+};
+
+// A heap of the heap table (see Heaps)
+// Changing SizeMB or Type of an existing heap destroys it and creates a new one
+struct EvictionHelperHeapDesc
+{
+    // Input
+    uint32_t SizeMB;                // 0 = no heap
+    int Priority;                   // EVICTION_HELPER_PRIORITY_*, Default: NORMAL
+    uint32_t Type;                  // EVICTION_HELPER_HEAP_TYPE_*
+    uint32_t _padding;
+
+    // Output
+    uint64_t AllocatedBytes;        // 0 until the heap has been created
+    uint64_t CreationNs;            // Time the device took to create the heap
+    uint64_t ModelOffset;           // Position in the fragmentation model (see HeapFragmentation)
+    uint32_t OutOfMemory;           // 1 if creating the heap failed, retried when SizeMB changes
+    uint32_t _padding2;
+};
+
+// CPU-side fragmentation report of the heap table
+// Models placing the heaps first-fit into one address range in the order they were created and destroyed
+struct EvictionHelperHeapFragmentation
+{
+    uint64_t AllocatedBytes;        // Bytes in heaps
+    uint64_t FreeBytes;             // Bytes in holes between heaps
+    uint64_t LargestFreeBlock;
+    uint64_t SpanBytes;             // End of the last heap, AllocatedBytes + FreeBytes
+    uint32_t HeapCount;
+    uint32_t FreeBlockCount;
+    float FragmentationPercent;     // Share of FreeBytes outside the largest hole
+    uint32_t _padding;
+};
+
 // Shared data structure between eviction-helper and controlling applications
 struct EvictionHelperSharedData
 {
@@ -63,28 +416,587 @@ struct EvictionHelperSharedData
 
     // Frame counter - increments each frame, use to verify app is running
     uint64_t FrameCount;
+
+    // Output: Seqlock protected copy of the output fields above, published once per frame
+    // The sequence is odd while the helper is writing, use EvictionHelper_ReadSnapshot() to read it
+    std::atomic<uint64_t> SnapshotSequence;
+    EvictionHelperSnapshot Snapshot;
+
+    // Input/Output: Ordered command queue, see EvictionHelper_PushCommand()
+    EvictionHelperCommandRing CommandRing;
+
+    // Input: Incremented by EvictionHelper_SignalHelper() to wake eviction-helper immediately
+    // Futex word on Linux, must stay 32 bits
+    alignas(64) std::atomic<uint32_t> WakeCounter;
+
+    // Output: Per-frame history of budget and usage, see EvictionHelper_ReadTelemetry()
+    EvictionHelperTelemetryRing Telemetry;
+
+    // Input: Host (system RAM) memory targets in megabytes, same semantics as the VRAM targets
+    int TargetHostMemoryUsageMB;        // Host memory that is touched every frame
+    int TargetUnusedHostMemoryUsageMB;  // Host memory that is allocated but left idle
+
+    // Output: Current host memory allocation state
+    uint64_t CurrentHostMemoryAllocationBytes;
+    uint64_t CurrentUnusedHostMemoryAllocationBytes;
+    uint32_t AllocatedHostMemoryChunkCount;
+    uint32_t AllocatedUnusedHostMemoryChunkCount;
+
+    // Input: Priority the host memory pools are reported under in the residency counters (0-4, see EVICTION_HELPER_PRIORITY_*)
+    // Host memory has no per-allocation residency priority, this only groups the counters below
+    int HostMemoryPriority;             // Default: HIGH
+    int UnusedHostMemoryPriority;       // Default: NORMAL
+
+    // Input: Pages checked per frame and pool by the host residency scanner, 0 = default (65536)
+    uint32_t HostResidencyScanPagesPerFrame;
+    uint32_t _padding3;
+
+    // Output: Host memory actually resident in RAM, updated incrementally by the residency scanner
+    uint64_t HostMemoryResidentBytes;
+    uint64_t HostMemoryNonResidentBytes;
+    uint64_t UnusedHostMemoryResidentBytes;
+    uint64_t UnusedHostMemoryNonResidentBytes;
+    uint64_t HostResidentBytesByPriority[5];
+    uint64_t HostNonResidentBytesByPriority[5];
+    uint64_t HostResidencyScanPasses;   // Completed full passes over the unused pool
+
+    // Input: Closed-loop budget control, the helper adjusts the target of one VRAM pool every frame
+    // While enabled the pool's Target*MB field is overwritten by the helper
+    int BudgetControlMode;              // EVICTION_HELPER_BUDGET_CONTROL_*
+    int BudgetControlPool;              // EVICTION_HELPER_POOL_ACTIVE or EVICTION_HELPER_POOL_UNUSED
+    int BudgetControlPercent;           // Target usage in percent of LocalBudget (PERCENT mode)
+    int BudgetControlHeadroomMB;        // LocalBudget minus target usage (HEADROOM mode)
+    float BudgetControlKp;              // Proportional gain, 0 = default
+    float BudgetControlKi;              // Integral gain per second, 0 = default
+
+    // Output: Budget control state
+    uint64_t BudgetControlSetpointBytes;
+    int64_t BudgetControlErrorBytes;    // Setpoint minus LocalCurrentUsage
+
+    // Output: Allocation progress, summed over all pools (allocations are made on a worker thread)
+    uint64_t AllocationPendingBytes;    // Requested from the worker but not created yet
+    uint64_t AllocationReadyBytes;      // Created and handed to the frame loop
+    uint64_t ReleasePendingBytes;       // Removed from the pools but not destroyed yet
+
+    // Input: Released resources are destroyed once the frames using them have completed, spread over frames
+    uint32_t ReleaseBudgetMBPerFrame;   // Per device, 0 = no limit. At least one resource is destroyed per frame. Default: 256
+    uint32_t _padding4;
+
+    // Output: Deferred release state
+    uint64_t ReleaseDeferredBytes;      // Part of ReleasePendingBytes waiting for the GPU or the per-frame budget
+    uint64_t ReleasedBytesLastFrame;    // Handed to the worker for destruction in the last frame
+
+    // Input: Ramp rates per pool in MB per second, indexed by EVICTION_HELPER_POOL_*, 0 = reach the target in one step
+    // Ramps advance by the frame time, so a helper driven by a virtual clock ramps in virtual time
+    float RampUpMBPerSecond[EVICTION_HELPER_POOL_COUNT];
+    float RampDownMBPerSecond[EVICTION_HELPER_POOL_COUNT];
+
+    // Output: Size each pool is currently ramping through, indexed by EVICTION_HELPER_POOL_*
+    uint64_t RampPositionBytes[EVICTION_HELPER_POOL_COUNT];
+
+    // Input: Size of the heaps render targets are placed in, rounded down to a power of two
+    // 0 = one committed resource per render target. Existing render targets keep how they were allocated.
+    uint32_t PlacementHeapMB;
+    uint32_t _padding5;
+
+    // Output: Last EVICT or MAKE_RESIDENT command, final once ResidencyOpStatus is DONE or FAILED
+    // Explicitly evicted resources are not touched until they are made resident again
+    uint64_t ResidencyOpSequence;       // Sequence of the command
+    uint32_t ResidencyOpType;           // EVICTION_HELPER_COMMAND_EVICT or EVICTION_HELPER_COMMAND_MAKE_RESIDENT
+    uint32_t ResidencyOpPool;           // EVICTION_HELPER_POOL_*
+    uint32_t ResidencyOpMode;           // EVICTION_HELPER_MAKE_RESIDENT_* for MAKE_RESIDENT
+    uint32_t ResidencyOpStatus;         // EVICTION_HELPER_RESIDENCY_OP_*
+    uint64_t ResidencyOpBytes;          // Bytes evicted or made resident
+    uint64_t ResidencyOpSubmitNs;       // Time spent in the device call
+    uint64_t ResidencyOpDurationNs;     // Time until the memory was paged, includes waiting for the fence with ENQUEUE
+    uint64_t ResidencyOpBytesPerSecond; // ResidencyOpBytes over ResidencyOpDurationNs
+
+    // Output: Explicitly evicted bytes per pool, indexed by EVICTION_HELPER_POOL_*
+    uint64_t EvictedPoolBytes[EVICTION_HELPER_POOL_COUNT];
+
+    // Input: Working set of the active VRAM and host pools, the same pattern is applied to both
+    uint32_t TouchPattern;              // EVICTION_HELPER_TOUCH_*, Default: ALL
+    uint32_t TouchPercent;              // Resources touched per frame in percent of the pool, not used by ALL. Default: 100
+    uint32_t TouchCoveragePercent;      // Part of each render target / host chunk that is written when touched. Default: 100
+    uint32_t TouchSeed;                 // Seed of RANDOM and ZIPF, changing it restarts the sequence
+    float TouchZipfExponent;            // Skew of ZIPF, 0 = default (1.0)
+    uint32_t _padding6;
+
+    // Output: Bytes of the resources touched in the last frame
+    uint64_t TouchedVRAMBytesLastFrame;
+    uint64_t TouchedHostBytesLastFrame;
+
+    // Input/Output: Additional pools on top of the four built-in ones, the first NamedPoolCount entries are allocated
+    // Commands address them as EVICTION_HELPER_POOL_NAMED(index). Pools beyond NamedPoolCount are released.
+    uint32_t NamedPoolCount;
+    uint32_t _padding7;
+    EvictionHelperPoolDesc NamedPools[EVICTION_HELPER_MAX_NAMED_POOLS];
+
+    // Input/Output: Heaps of any size and count on top of Allocate512MBHeap/Allocate1GBHeap, the first HeapCount
+    // entries are created. Heaps are created on the allocation worker one after the other and destroyed through the
+    // deferred release queue, so large tables build up and tear down incrementally.
+    uint32_t HeapCount;
+    uint32_t _padding8;
+    EvictionHelperHeapDesc Heaps[EVICTION_HELPER_MAX_HEAPS];
+
+    // Output: Totals of the heap table
+    uint64_t HeapTableAllocatedBytes;
+    uint64_t HeapTablePendingBytes;     // Requested from the worker but not created yet
+    uint64_t HeapTableMaxCreationNs;    // Slowest creation among the current heaps
+    EvictionHelperHeapFragmentation HeapFragmentation;
+
+    // Input: Churn workload, allocates and frees resources of random sizes at ChurnOpsPerSecond while holding the
+    // total around ChurnTargetMB. Runs on its own thread with async allocations and never touches its resources.
+    uint32_t ChurnOpsPerSecond;         // 0 = off, the churn resources are released
+    uint32_t ChurnTargetMB;
+    uint32_t ChurnKind;                 // EVICTION_HELPER_POOL_KIND_*
+    uint32_t ChurnDistribution;         // EVICTION_HELPER_CHURN_*
+    uint32_t ChurnMinSizeKB;            // 0 = 64 KB
+    uint32_t ChurnMaxSizeKB;            // 0 = 64 MB
+    uint32_t ChurnLargePercent;         // Share of large allocations for BIMODAL
+    uint32_t ChurnSeed;                 // Changing it restarts the churn
+    char ChurnHistogramPath[260];       // For HISTOGRAM, a text file with one "<size in KB> <weight>" pair per line
+    uint32_t _padding9;
+
+    // Output: Churn workload, the counters restart when churn is enabled or its kind or seed changes
+    uint64_t ChurnAllocatedBytes;
+    uint32_t ChurnResourceCount;
+    uint32_t ChurnHistogramBinCount;    // Bins read from ChurnHistogramPath, 0 if it could not be read
+    uint64_t ChurnAllocCount;
+    uint64_t ChurnFreeCount;
+    uint64_t ChurnFailedAllocCount;     // Allocations the device could not make, out of memory
+    float ChurnAchievedOpsPerSecond;    // Over the last frame
+    uint32_t _padding10;
+    uint64_t ChurnAllocMaxNs;
+    uint64_t ChurnFreeMaxNs;
+    uint64_t ChurnAllocLatencyHistogram[EVICTION_HELPER_LATENCY_BUCKETS];
+    uint64_t ChurnFreeLatencyHistogram[EVICTION_HELPER_LATENCY_BUCKETS];
+
+    // Input: Trace replay (see eviction_helper_trace.h for the file format). Setting TraceReplay starts from the first
+    // event, clearing it releases the replayed resources. Runs on its own thread with async allocations.
+    uint32_t TraceReplay;
+    float TraceReplaySpeed;             // 1 = original speed, 2 = twice as fast, 0 = as fast as possible
+    char TraceReplayPath[260];
+
+    // Input: Trace recording, all resources created, destroyed or reprioritized by the helper are written to
+    // TraceRecordPath while TraceRecord is set. Resources that are already alive are recorded as allocated at time 0.
+    uint32_t TraceRecord;
+    char TraceRecordPath[260];
+    uint32_t _padding11;
+
+    // Output: Trace replay, the counters restart with every replay
+    uint32_t TraceReplayState;          // EVICTION_HELPER_TRACE_STATE_*
+    uint32_t TraceResourceCount;
+    uint64_t TraceEventCount;
+    uint64_t TraceIssuedEventCount;
+    uint64_t TraceSkippedEventCount;    // Unknown resource kinds, ids that are not live or already live
+    uint64_t TraceFailedAllocCount;
+    uint64_t TraceAllocatedBytes;
+    uint64_t TracePositionNs;           // Trace time reached
+    uint64_t TraceDurationNs;
+    uint64_t TraceDriftNs;              // How much later than scheduled the last event was issued
+    uint64_t TraceMaxDriftNs;
+    uint64_t TraceMeanDriftNs;
+    uint64_t TraceAllocMaxNs;
+    uint64_t TraceFreeMaxNs;
+    uint64_t TraceAllocLatencyHistogram[EVICTION_HELPER_LATENCY_BUCKETS];
+    uint64_t TraceFreeLatencyHistogram[EVICTION_HELPER_LATENCY_BUCKETS];
+    uint64_t TraceDriftHistogram[EVICTION_HELPER_LATENCY_BUCKETS];
+
+    // Output: Trace recording
+    uint32_t TraceRecording;            // 1 while TraceRecordPath is open
+    uint32_t _padding12;
+    uint64_t TraceRecordedEventCount;
+
+    // Input: Scenario (see eviction_helper_scenario.h for the file format). Setting Scenario reads ScenarioPath and runs
+    // it from the start, writing the pool targets and priorities it drives. Clearing it stops the scenario.
+    uint32_t Scenario;
+    uint32_t ScenarioClock;             // EVICTION_HELPER_SCENARIO_CLOCK_*
+    char ScenarioPath[260];
+
+    // Output: Scenario
+    uint32_t ScenarioState;             // EVICTION_HELPER_SCENARIO_STATE_*
+    int ScenarioStep;                   // Segment that started last, -1 before the first one
+    uint32_t ScenarioStepLine;          // Line of ScenarioStep in the file, 0 before the first one
+    uint32_t ScenarioStepCount;         // Segments in the file
+    uint32_t ScenarioLoopCount;         // Times a looping scenario started over
+    uint32_t ScenarioErrorLine;         // First bad line for FAILED, 0 if the error is not about a single line
+    uint32_t _padding13;
+    uint64_t ScenarioTimeNs;            // Scenario time reached, within the current loop
+    uint64_t ScenarioDurationNs;
+    char ScenarioError[128];
+
+    // Input: Memory sampler, queries budget and usage on its own thread at this rate and appends the results to
+    // MemorySamples, see EvictionHelper_ReadMemorySamples(). Independent of the frame rate and frame hitches.
+    uint32_t MemorySampleRateHz;        // 0 = off, at most EVICTION_HELPER_MEMORY_SAMPLE_MAX_RATE_HZ
+
+    // Output: Memory sampler, the counters restart when the sampler is started
+    float MemorySampleAchievedHz;       // Over the last second
+    uint64_t MemorySampleMaxLateNs;     // Latest sample relative to its schedule
+    uint64_t MemorySampleMaxQueryNs;    // Slowest query
+    uint64_t MemorySampleMeanQueryNs;
+    uint64_t MemorySampleLateHistogram[EVICTION_HELPER_LATENCY_BUCKETS];
+    EvictionHelperMemorySampleRing MemorySamples;
+
+    // Input: Frame pacing of the helper's own loop
+    uint32_t FrameRate;                 // Frames (active pool touches) per second, 0 = 30
+    uint32_t FrameSpinTailUs;           // Each wait spins this long before the deadline instead of sleeping. Default: 200
+
+    // Output: Frame pacing, percentiles over the last 512 frames
+    uint64_t FrameTimePercentile50Ns;
+    uint64_t FrameTimePercentile99Ns;
+    uint64_t FrameTimeMaxNs;
+    uint64_t FrameLateMaxNs;            // Latest frame start relative to its schedule
+    uint64_t FrameSleepTotalNs;         // Time spent sleeping between frames
+    uint64_t FrameSpinTotalNs;          // Time spent spinning before frames, costs CPU time
+    uint64_t FrameTimeHistogram[EVICTION_HELPER_LATENCY_BUCKETS];
+
+    // Output: Budget changes, recorded by the budget watcher as soon as the OS reports them (polled once per frame
+    // without notifications). Every change increments BudgetGeneration and is appended to BudgetChanges, wait for the
+    // next one with EvictionHelper_WaitForBudgetChange() and read them with EvictionHelper_ReadBudgetChanges().
+    std::atomic<uint32_t> BudgetGeneration;
+    uint32_t BudgetWatcherState;        // EVICTION_HELPER_BUDGET_WATCHER_*
+    uint64_t BudgetNotificationCount;   // Notifications received, including ones that did not change the budget
+    uint64_t BudgetChangeLatencyMaxNs;  // Slowest notification from wake to publish
+    EvictionHelperBudgetChangeRing BudgetChanges;
 };
 
+// Monotonic timestamp in nanoseconds, comparable between processes on the same machine
+inline uint64_t EvictionHelper_GetTimestampNs()
+{
+#ifdef _WIN32
+    static LARGE_INTEGER frequency = {};
+    if (frequency.QuadPart == 0)
+    {
+        QueryPerformanceFrequency(&frequency);
+    }
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    uint64_t seconds = (uint64_t)(counter.QuadPart / frequency.QuadPart);
+    uint64_t remainder = (uint64_t)(counter.QuadPart % frequency.QuadPart);
+    return seconds * 1000000000ULL + remainder * 1000000000ULL / (uint64_t)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+// Latency histogram bucket of a duration, the first and last bucket also count everything below and above
+inline uint32_t EvictionHelper_GetLatencyBucket(uint64_t ns)
+{
+    uint64_t us = ns / 1000;
+    uint32_t bucket = 0;
+    while (us > 1 && bucket < EVICTION_HELPER_LATENCY_BUCKETS - 1)
+    {
+        us >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+// Maximum number of times EvictionHelper_ReadSnapshot() retries when it races with the writer
+#define EVICTION_HELPER_SNAPSHOT_MAX_ATTEMPTS 64
+
+// Publish a new snapshot (call from eviction-helper, single writer only)
+inline void EvictionHelper_WriteSnapshot(EvictionHelperSharedData* data, const EvictionHelperSnapshot* snapshot)
+{
+    uint64_t sequence = data->SnapshotSequence.load(std::memory_order_relaxed);
+    data->SnapshotSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    memcpy(&data->Snapshot, snapshot, sizeof(EvictionHelperSnapshot));
+
+    data->SnapshotSequence.store(sequence + 2, std::memory_order_release);
+}
+
+// Read a consistent snapshot without taking a lock (call from controlling application)
+// Performs at most EVICTION_HELPER_SNAPSHOT_MAX_ATTEMPTS copies and never blocks the writer
+// Returns false if every attempt overlapped with a write, outSnapshot is then left unspecified
+inline bool EvictionHelper_ReadSnapshot(const EvictionHelperSharedData* data, EvictionHelperSnapshot* outSnapshot)
+{
+    if (!data || !outSnapshot) return false;
+
+    for (int attempt = 0; attempt < EVICTION_HELPER_SNAPSHOT_MAX_ATTEMPTS; attempt++)
+    {
+        uint64_t before = data->SnapshotSequence.load(std::memory_order_acquire);
+        if (before & 1)
+        {
+            continue;
+        }
+
+        memcpy(outSnapshot, (const void*)&data->Snapshot, sizeof(EvictionHelperSnapshot));
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        uint64_t after = data->SnapshotSequence.load(std::memory_order_relaxed);
+        if (before == after)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Queue a command (call from controlling application)
+// executeAtNs delays the command until EvictionHelper_GetTimestampNs() reaches it, 0 applies it as soon as possible
+// Returns the command sequence number, or 0 if the ring is full
+inline uint64_t EvictionHelper_PushCommand(EvictionHelperSharedData* data, uint32_t type, uint32_t target, int64_t value, uint64_t executeAtNs)
+{
+    if (!data) return 0;
+
+    EvictionHelperCommandRing* ring = &data->CommandRing;
+    uint64_t writeIndex = ring->WriteIndex.load(std::memory_order_relaxed);
+    uint64_t readIndex = ring->ReadIndex.load(std::memory_order_acquire);
+    if (writeIndex - readIndex >= EVICTION_HELPER_COMMAND_RING_SIZE)
+    {
+        return 0;
+    }
+
+    EvictionHelperCommand* command = &ring->Commands[writeIndex & (EVICTION_HELPER_COMMAND_RING_SIZE - 1)];
+    command->Sequence = writeIndex + 1;
+    command->TimestampNs = EvictionHelper_GetTimestampNs();
+    command->ExecuteAtNs = executeAtNs;
+    command->Type = type;
+    command->Target = target;
+    command->Value = value;
+
+    ring->WriteIndex.store(writeIndex + 1, std::memory_order_release);
+    return writeIndex + 1;
+}
+
+// Returns true once the command with the given sequence number (and all earlier ones) has been applied
+inline bool EvictionHelper_IsCommandComplete(const EvictionHelperSharedData* data, uint64_t sequence)
+{
+    return data && data->CommandRing.CompletedSequence.load(std::memory_order_acquire) >= sequence;
+}
+
+// Wait until a command has been applied (call from controlling application)
+// Returns false if the timeout expired first
+inline bool EvictionHelper_WaitForCommand(const EvictionHelperSharedData* data, uint64_t sequence, uint32_t timeoutMs)
+{
+    uint64_t deadline = EvictionHelper_GetTimestampNs() + (uint64_t)timeoutMs * 1000000ULL;
+    while (!EvictionHelper_IsCommandComplete(data, sequence))
+    {
+        if (EvictionHelper_GetTimestampNs() >= deadline)
+        {
+            return false;
+        }
+#ifdef _WIN32
+        Sleep(0);
+#else
+        sched_yield();
+#endif
+    }
+    return true;
+}
+
+// Get the oldest pending command without removing it (call from eviction-helper)
+// Returns false if the ring is empty
+inline bool EvictionHelper_PeekCommand(EvictionHelperSharedData* data, EvictionHelperCommand* outCommand)
+{
+    EvictionHelperCommandRing* ring = &data->CommandRing;
+    uint64_t readIndex = ring->ReadIndex.load(std::memory_order_relaxed);
+    uint64_t writeIndex = ring->WriteIndex.load(std::memory_order_acquire);
+    if (readIndex == writeIndex)
+    {
+        return false;
+    }
+
+    *outCommand = ring->Commands[readIndex & (EVICTION_HELPER_COMMAND_RING_SIZE - 1)];
+    return true;
+}
+
+// Remove the command returned by EvictionHelper_PeekCommand() and mark it as applied (call from eviction-helper)
+inline void EvictionHelper_CompleteCommand(EvictionHelperSharedData* data, const EvictionHelperCommand* command)
+{
+    EvictionHelperCommandRing* ring = &data->CommandRing;
+    ring->ReadIndex.store(ring->ReadIndex.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    ring->CompletedSequence.store(command->Sequence, std::memory_order_release);
+}
+
+// Append a sample to a seqlock ring (single writer only)
+// Slots[i].Sequence is 2 * index + 1 while the sample is written and 2 * index + 2 once complete
+template <typename Ring, typename Sample>
+inline void EvictionHelper_WriteRing(Ring* ring, const Sample* sample)
+{
+    const uint64_t capacity = sizeof(ring->Slots) / sizeof(ring->Slots[0]);
+    uint64_t index = ring->Head.load(std::memory_order_relaxed);
+    auto* slot = &ring->Slots[index & (capacity - 1)];
+
+    slot->Sequence.store(index * 2 + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy((void*)&slot->Sample, sample, sizeof(Sample));
+    slot->Sequence.store(index * 2 + 2, std::memory_order_release);
+
+    ring->Head.store(index + 1, std::memory_order_release);
+}
+
+// Read samples from a seqlock ring without taking a lock, see EvictionHelper_ReadTelemetry()
+template <typename Ring, typename Sample>
+inline uint32_t EvictionHelper_ReadRing(const Ring* ring, uint64_t* inOutIndex, Sample* outSamples, uint32_t maxSamples, uint64_t* outDroppedCount)
+{
+    const uint64_t capacity = sizeof(ring->Slots) / sizeof(ring->Slots[0]);
+    uint64_t head = ring->Head.load(std::memory_order_acquire);
+    uint64_t index = *inOutIndex;
+    uint64_t dropped = 0;
+
+    // The reader fell behind by more than the ring capacity
+    if (head - index > capacity && index < head)
+    {
+        dropped += head - capacity - index;
+        index = head - capacity;
+    }
+
+    uint32_t count = 0;
+    while (index < head && count < maxSamples)
+    {
+        const auto* slot = &ring->Slots[index & (capacity - 1)];
+        uint64_t expected = index * 2 + 2;
+
+        uint64_t before = slot->Sequence.load(std::memory_order_acquire);
+        if (before == expected)
+        {
+            memcpy(&outSamples[count], (const void*)&slot->Sample, sizeof(Sample));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot->Sequence.load(std::memory_order_relaxed) == expected)
+            {
+                count++;
+                index++;
+                continue;
+            }
+        }
+
+        // Overwritten by a newer sample while we were reading
+        dropped++;
+        index++;
+    }
+
+    *inOutIndex = index;
+    if (outDroppedCount)
+    {
+        *outDroppedCount += dropped;
+    }
+    return count;
+}
+
+// Append a telemetry sample to the history ring (call from eviction-helper, single writer only)
+inline void EvictionHelper_WriteTelemetry(EvictionHelperSharedData* data, const EvictionHelperTelemetrySample* sample)
+{
+    EvictionHelper_WriteRing(&data->Telemetry, sample);
+}
+
+// Read telemetry samples without taking a lock (call from controlling application)
+// inOutIndex is the index of the next sample to read, start with 0 (or the current Head) and pass it back on the next call
+// Samples that were overwritten before they could be read are skipped and added to outDroppedCount (optional)
+// Returns the number of samples copied to outSamples
+inline uint32_t EvictionHelper_ReadTelemetry(const EvictionHelperSharedData* data, uint64_t* inOutIndex, EvictionHelperTelemetrySample* outSamples, uint32_t maxSamples, uint64_t* outDroppedCount)
+{
+    if (!data || !inOutIndex || !outSamples) return 0;
+
+    return EvictionHelper_ReadRing(&data->Telemetry, inOutIndex, outSamples, maxSamples, outDroppedCount);
+}
+
+// Append a memory sample to the sample ring (call from the memory sampler thread of eviction-helper only)
+inline void EvictionHelper_WriteMemorySample(EvictionHelperSharedData* data, const EvictionHelperMemorySample* sample)
+{
+    EvictionHelper_WriteRing(&data->MemorySamples, sample);
+}
+
+// Read memory samples without taking a lock (call from controlling application), same semantics as EvictionHelper_ReadTelemetry()
+inline uint32_t EvictionHelper_ReadMemorySamples(const EvictionHelperSharedData* data, uint64_t* inOutIndex, EvictionHelperMemorySample* outSamples, uint32_t maxSamples, uint64_t* outDroppedCount)
+{
+    if (!data || !inOutIndex || !outSamples) return 0;
+
+    return EvictionHelper_ReadRing(&data->MemorySamples, inOutIndex, outSamples, maxSamples, outDroppedCount);
+}
+
+// Read budget changes without taking a lock (call from controlling application), same semantics as EvictionHelper_ReadTelemetry()
+inline uint32_t EvictionHelper_ReadBudgetChanges(const EvictionHelperSharedData* data, uint64_t* inOutIndex, EvictionHelperBudgetChange* outChanges, uint32_t maxChanges, uint64_t* outDroppedCount)
+{
+    if (!data || !inOutIndex || !outChanges) return 0;
+
+    return EvictionHelper_ReadRing(&data->BudgetChanges, inOutIndex, outChanges, maxChanges, outDroppedCount);
+}
+
+// Both implementations must agree on the layout so controllers on either OS can read the same fields
+// Update these together with a deliberate layout change, every helper and controller has to be rebuilt then.
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "Shared memory atomics must be lock free to work across processes");
+static_assert(sizeof(EvictionHelperSnapshot) == 120, "EvictionHelperSnapshot layout changed");
+static_assert(sizeof(EvictionHelperCommand) == 40, "EvictionHelperCommand layout changed");
+static_assert(offsetof(EvictionHelperCommandRing, ReadIndex) == 64, "EvictionHelperCommandRing layout changed");
+static_assert(offsetof(EvictionHelperCommandRing, CompletedSequence) == 128, "EvictionHelperCommandRing layout changed");
+static_assert(sizeof(EvictionHelperCommandRing) == 10432, "EvictionHelperCommandRing layout changed");
+static_assert(sizeof(EvictionHelperTelemetrySample) == 112, "EvictionHelperTelemetrySample layout changed");
+static_assert(sizeof(EvictionHelperTelemetryRing) == 491584, "EvictionHelperTelemetryRing layout changed");
+static_assert(sizeof(EvictionHelperMemorySample) == 88, "EvictionHelperMemorySample layout changed");
+static_assert(sizeof(EvictionHelperMemorySampleRing) == 786496, "EvictionHelperMemorySampleRing layout changed");
+static_assert(sizeof(EvictionHelperBudgetChange) == 72, "EvictionHelperBudgetChange layout changed");
+static_assert(sizeof(EvictionHelperBudgetChangeRing) == 20544, "EvictionHelperBudgetChangeRing layout changed");
+static_assert(sizeof(EvictionHelperPoolDesc) == 128, "EvictionHelperPoolDesc layout changed");
+static_assert(sizeof(EvictionHelperHeapDesc) == 48, "EvictionHelperHeapDesc layout changed");
+static_assert(sizeof(EvictionHelperHeapFragmentation) == 48, "EvictionHelperHeapFragmentation layout changed");
+static_assert(offsetof(EvictionHelperSharedData, LocalBudget) == 64, "EvictionHelperSharedData layout changed");
+static_assert(offsetof(EvictionHelperSharedData, FrameCount) == 136, "EvictionHelperSharedData layout changed");
+static_assert(offsetof(EvictionHelperSharedData, SnapshotSequence) == 144, "EvictionHelperSharedData layout changed");
+static_assert(offsetof(EvictionHelperSharedData, Snapshot) == 152, "EvictionHelperSharedData layout changed");
+static_assert(offsetof(EvictionHelperSharedData, CommandRing) == 320, "EvictionHelperSharedData layout changed");
+static_assert(offsetof(EvictionHelperSharedData, WakeCounter) == 10752, "EvictionHelperSharedData layout changed");
+static_assert(offsetof(EvictionHelperSharedData, Telemetry) == 10816, "EvictionHelperSharedData layout changed");
+static_assert(offsetof(EvictionHelperSharedData, TargetHostMemoryUsageMB) == 502400, "EvictionHelperSharedData layout changed");
+static_assert(offsetof(EvictionHelperSharedData, NamedPools) == 502864, "EvictionHelperSharedData layout changed");
+static_assert(offsetof(EvictionHelperSharedData, Heaps) == 504920, "EvictionHelperSharedData layout changed");
+static_assert(offsetof(EvictionHelperSharedData, HeapFragmentation) == 517232, "EvictionHelperSharedData layout changed");
+static_assert(offsetof(EvictionHelperSharedData, MemorySamples) == 519936, "EvictionHelperSharedData layout changed");
+static_assert(offsetof(EvictionHelperSharedData, FrameRate) == 1306432, "EvictionHelperSharedData layout changed");
+static_assert(offsetof(EvictionHelperSharedData, BudgetGeneration) == 1306680, "EvictionHelperSharedData layout changed");
+static_assert(offsetof(EvictionHelperSharedData, BudgetChanges) == 1306752, "EvictionHelperSharedData layout changed");
+static_assert(sizeof(EvictionHelperSharedData) == 1327296, "EvictionHelperSharedData layout changed");
+
+#ifdef _WIN32
+
 // Helper struct for managing shared memory handle and pointer
 struct EvictionHelperSharedMemory
 {
     HANDLE hMapFile;
     EvictionHelperSharedData* pData;
+    HANDLE hWakeEvent;          // See EvictionHelper_SignalHelper(), NULL if it could not be created/opened
+    HANDLE hBudgetEvents[2];    // See EvictionHelper_WaitForBudgetChange(), NULL if they could not be created/opened
 };
 
+// Name of an event that belongs to a mapping, the default mapping (mappingName NULL) uses defaultName
+inline void EvictionHelper_GetEventName(char* outName, size_t size, const char* mappingName, const char* defaultName, const char* suffix)
+{
+    if (mappingName)
+    {
+        snprintf(outName, size, "%s%s", mappingName, suffix);
+    }
+    else
+    {
+        snprintf(outName, size, "%s", defaultName);
+    }
+}
+
 // Create shared memory (call from eviction-helper)
+// name is the name of the mapping, NULL for EVICTION_HELPER_SHARED_MEMORY_NAME. flags only apply to the POSIX
+// implementation. Fails if the mapping already exists, i.e. another helper is running.
 // Returns true on success, false on failure
-inline bool EvictionHelper_CreateSharedMemory(EvictionHelperSharedMemory* outSharedMem)
+inline bool EvictionHelper_CreateSharedMemoryEx(EvictionHelperSharedMemory* outSharedMem, const char* name, uint32_t flags)
 {
+    (void)flags;
     if (!outSharedMem) return false;
 
+    outSharedMem->pData = NULL;
+    outSharedMem->hWakeEvent = NULL;
+    outSharedMem->hBudgetEvents[0] = NULL;
+    outSharedMem->hBudgetEvents[1] = NULL;
     outSharedMem->hMapFile = CreateFileMappingA(
         INVALID_HANDLE_VALUE,
         NULL,
         PAGE_READWRITE,
         0,
         sizeof(EvictionHelperSharedData),
-        EVICTION_HELPER_SHARED_MEMORY_NAME
+        name ? name : EVICTION_HELPER_SHARED_MEMORY_NAME
     );
 
     if (outSharedMem->hMapFile == NULL)
@@ -92,6 +1004,14 @@ inline bool EvictionHelper_CreateSharedMemory(EvictionHelperSharedMemory* outSha
         return false;
     }
 
+    // Zeroing a mapping that another helper is writing would break its snapshots and rings
+    if (GetLastError() == ERROR_ALREADY_EXISTS)
+    {
+        CloseHandle(outSharedMem->hMapFile);
+        outSharedMem->hMapFile = NULL;
+        return false;
+    }
+
     outSharedMem->pData = (EvictionHelperSharedData*)MapViewOfFile(
         outSharedMem->hMapFile,
         FILE_MAP_ALL_ACCESS,
@@ -108,20 +1028,34 @@ inline bool EvictionHelper_CreateSharedMemory(EvictionHelperSharedMemory* outSha
     }
 
     // Zero initialize
-    memset(outSharedMem->pData, 0, sizeof(EvictionHelperSharedData));
+    memset((void*)outSharedMem->pData, 0, sizeof(EvictionHelperSharedData));
+
+    char eventName[256];
+    EvictionHelper_GetEventName(eventName, sizeof(eventName), name, EVICTION_HELPER_WAKE_EVENT_NAME, "WakeEvent");
+    outSharedMem->hWakeEvent = CreateEventA(NULL, FALSE, FALSE, eventName);
+    EvictionHelper_GetEventName(eventName, sizeof(eventName), name, EVICTION_HELPER_BUDGET_EVENT_NAME_0, "BudgetEvent0");
+    outSharedMem->hBudgetEvents[0] = CreateEventA(NULL, TRUE, FALSE, eventName);
+    EvictionHelper_GetEventName(eventName, sizeof(eventName), name, EVICTION_HELPER_BUDGET_EVENT_NAME_1, "BudgetEvent1");
+    outSharedMem->hBudgetEvents[1] = CreateEventA(NULL, TRUE, FALSE, eventName);
     return true;
 }
 
 // Open existing shared memory (call from controlling application)
+// name is the name the helper created the mapping with, NULL for EVICTION_HELPER_SHARED_MEMORY_NAME
 // Returns true on success, false on failure (e.g., eviction-helper not running)
-inline bool EvictionHelper_OpenSharedMemory(EvictionHelperSharedMemory* outSharedMem)
+inline bool EvictionHelper_OpenSharedMemoryEx(EvictionHelperSharedMemory* outSharedMem, const char* name, uint32_t flags)
 {
+    (void)flags;
     if (!outSharedMem) return false;
 
+    outSharedMem->pData = NULL;
+    outSharedMem->hWakeEvent = NULL;
+    outSharedMem->hBudgetEvents[0] = NULL;
+    outSharedMem->hBudgetEvents[1] = NULL;
     outSharedMem->hMapFile = OpenFileMappingA(
         FILE_MAP_ALL_ACCESS,
         FALSE,
-        EVICTION_HELPER_SHARED_MEMORY_NAME
+        name ? name : EVICTION_HELPER_SHARED_MEMORY_NAME
     );
 
     if (outSharedMem->hMapFile == NULL)
@@ -144,9 +1078,26 @@ inline bool EvictionHelper_OpenSharedMemory(EvictionHelperSharedMemory* outShare
         return false;
     }
 
+    char eventName[256];
+    EvictionHelper_GetEventName(eventName, sizeof(eventName), name, EVICTION_HELPER_WAKE_EVENT_NAME, "WakeEvent");
+    outSharedMem->hWakeEvent = OpenEventA(EVENT_MODIFY_STATE | SYNCHRONIZE, FALSE, eventName);
+    EvictionHelper_GetEventName(eventName, sizeof(eventName), name, EVICTION_HELPER_BUDGET_EVENT_NAME_0, "BudgetEvent0");
+    outSharedMem->hBudgetEvents[0] = OpenEventA(SYNCHRONIZE, FALSE, eventName);
+    EvictionHelper_GetEventName(eventName, sizeof(eventName), name, EVICTION_HELPER_BUDGET_EVENT_NAME_1, "BudgetEvent1");
+    outSharedMem->hBudgetEvents[1] = OpenEventA(SYNCHRONIZE, FALSE, eventName);
     return true;
 }
 
+inline bool EvictionHelper_CreateSharedMemory(EvictionHelperSharedMemory* outSharedMem)
+{
+    return EvictionHelper_CreateSharedMemoryEx(outSharedMem, NULL, EVICTION_HELPER_MAPPING_DEFAULT);
+}
+
+inline bool EvictionHelper_OpenSharedMemory(EvictionHelperSharedMemory* outSharedMem)
+{
+    return EvictionHelper_OpenSharedMemoryEx(outSharedMem, NULL, EVICTION_HELPER_MAPPING_DEFAULT);
+}
+
 // Close shared memory (call from both eviction-helper and controlling application)
 inline void EvictionHelper_CloseSharedMemory(EvictionHelperSharedMemory* sharedMem)
 {
@@ -163,4 +1114,442 @@ inline void EvictionHelper_CloseSharedMemory(EvictionHelperSharedMemory* sharedM
         CloseHandle(sharedMem->hMapFile);
         sharedMem->hMapFile = NULL;
     }
+
+    if (sharedMem->hWakeEvent)
+    {
+        CloseHandle(sharedMem->hWakeEvent);
+        sharedMem->hWakeEvent = NULL;
+    }
+
+    for (int i = 0; i < 2; i++)
+    {
+        if (sharedMem->hBudgetEvents[i])
+        {
+            CloseHandle(sharedMem->hBudgetEvents[i]);
+            sharedMem->hBudgetEvents[i] = NULL;
+        }
+    }
+}
+
+#else // POSIX
+
+// Helper struct for managing shared memory mapping and pointer
+// The file descriptor is closed right after mmap, the mapping keeps the object alive
+struct EvictionHelperSharedMemory
+{
+    EvictionHelperSharedData* pData;
+    size_t MappedSize;
+    uint32_t IsOwner;           // Set for the creating process, which unlinks the name on close
+    uint32_t IsHugeTlbFs;       // Set when the mapping lives on hugetlbfs instead of /dev/shm
+    int LockFd;                 // Creator only, holds the flock() that marks the mapping as in use, -1 otherwise
+    char Name[64];              // shm_open() name, the hugetlbfs file is EVICTION_HELPER_HUGETLBFS_DIR followed by it
+};
+
+// Set the name of the mapping, NULL for EVICTION_HELPER_SHARED_MEMORY_NAME
+// Returns false if the name does not start with '/' or is too long
+inline bool EvictionHelper_SetSharedMemoryName(EvictionHelperSharedMemory* sharedMem, const char* name)
+{
+    if (!name) name = EVICTION_HELPER_SHARED_MEMORY_NAME;
+
+    size_t length = strlen(name);
+    if (name[0] != '/' || length >= sizeof(sharedMem->Name))
+    {
+        return false;
+    }
+    memcpy(sharedMem->Name, name, length + 1);
+    return true;
+}
+
+// Open the shm object or the hugetlbfs file of the mapping, -1 if it cannot be opened
+inline int EvictionHelper_OpenSharedMemoryFd(const EvictionHelperSharedMemory* sharedMem, bool hugeTlbFs, int openFlags)
+{
+    if (!hugeTlbFs)
+    {
+        return shm_open(sharedMem->Name, openFlags, 0600);
+    }
+
+    char path[sizeof(EVICTION_HELPER_HUGETLBFS_DIR) + sizeof(sharedMem->Name)];
+    snprintf(path, sizeof(path), "%s%s", EVICTION_HELPER_HUGETLBFS_DIR, sharedMem->Name);
+    return open(path, openFlags | O_CLOEXEC, 0600);
+}
+
+// Remove the name of the backing the mapping lives on
+inline void EvictionHelper_UnlinkSharedMemory(const EvictionHelperSharedMemory* sharedMem)
+{
+    if (sharedMem->IsHugeTlbFs)
+    {
+        char path[sizeof(EVICTION_HELPER_HUGETLBFS_DIR) + sizeof(sharedMem->Name)];
+        snprintf(path, sizeof(path), "%s%s", EVICTION_HELPER_HUGETLBFS_DIR, sharedMem->Name);
+        unlink(path);
+    }
+    else
+    {
+        shm_unlink(sharedMem->Name);
+    }
+}
+
+// True if the creator of the mapping behind fd still holds its lock, i.e. the helper is running
+// A mapping left behind by a helper that crashed is not locked.
+inline bool EvictionHelper_IsSharedMemoryFdLocked(int fd)
+{
+    if (flock(fd, LOCK_SH | LOCK_NB) == 0)
+    {
+        flock(fd, LOCK_UN);
+        return false;
+    }
+    return errno == EWOULDBLOCK;
+}
+
+// Size of the mapping, rounded up to the page granularity of the backing store
+inline size_t EvictionHelper_GetMappingSize(bool hugeTlbFs)
+{
+    size_t pageSize = hugeTlbFs ? (size_t)EVICTION_HELPER_HUGE_PAGE_SIZE : (size_t)sysconf(_SC_PAGESIZE);
+    return (sizeof(EvictionHelperSharedData) + pageSize - 1) / pageSize * pageSize;
+}
+
+// Map an already opened shared memory file descriptor, closes the descriptor in all cases
+inline bool EvictionHelper_MapSharedMemoryFd(EvictionHelperSharedMemory* outSharedMem, int fd, size_t mappedSize, uint32_t flags)
+{
+    int mmapFlags = MAP_SHARED;
+#ifdef MAP_POPULATE
+    if (flags & EVICTION_HELPER_MAPPING_POPULATE)
+    {
+        mmapFlags |= MAP_POPULATE;
+    }
+#endif
+
+    void* mapping = mmap(NULL, mappedSize, PROT_READ | PROT_WRITE, mmapFlags, fd, 0);
+    close(fd);
+
+    if (mapping == MAP_FAILED)
+    {
+        return false;
+    }
+
+#ifdef MADV_HUGEPAGE
+    // Transparent huge pages for tmpfs backed mappings (requires shmem_enabled=advise or always)
+    if ((flags & EVICTION_HELPER_MAPPING_HUGE_PAGES) && !outSharedMem->IsHugeTlbFs)
+    {
+        madvise(mapping, mappedSize, MADV_HUGEPAGE);
+    }
+#endif
+
+    outSharedMem->pData = (EvictionHelperSharedData*)mapping;
+    outSharedMem->MappedSize = mappedSize;
+    return true;
+}
+
+// Create, lock, size and map one backing of the mapping
+// Returns 1 on success, 0 if the backing cannot hold the mapping (it is removed again) and -1 if a running helper
+// holds it
+inline int EvictionHelper_CreateSharedMemoryBacking(EvictionHelperSharedMemory* outSharedMem, bool hugeTlbFs, uint32_t flags)
+{
+    int fd = EvictionHelper_OpenSharedMemoryFd(outSharedMem, hugeTlbFs, O_CREAT | O_RDWR);
+    if (fd < 0)
+    {
+        return 0;
+    }
+
+    // The lock lives as long as the duplicated descriptor, which is closed with the mapping
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    outSharedMem->IsHugeTlbFs = hugeTlbFs ? 1 : 0;
+    size_t mappedSize = EvictionHelper_GetMappingSize(hugeTlbFs);
+    int lockFd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    bool mapped = false;
+    if (lockFd >= 0 && ftruncate(fd, (off_t)mappedSize) == 0)
+    {
+        mapped = EvictionHelper_MapSharedMemoryFd(outSharedMem, fd, mappedSize, flags);
+    }
+    else
+    {
+        close(fd);
+    }
+
+    if (!mapped)
+    {
+        // E.g. hugetlbfs without free huge pages, do not leave the file behind
+        EvictionHelper_UnlinkSharedMemory(outSharedMem);
+        if (lockFd >= 0)
+        {
+            close(lockFd);
+        }
+        outSharedMem->IsHugeTlbFs = 0;
+        return 0;
+    }
+
+    outSharedMem->LockFd = lockFd;
+    return 1;
+}
+
+// Create shared memory (call from eviction-helper)
+// name is the shm_open() name of the mapping, NULL for EVICTION_HELPER_SHARED_MEMORY_NAME
+// flags is a combination of EVICTION_HELPER_MAPPING_* values
+// Fails while another helper has the mapping of the same name, a mapping left behind by a helper that crashed is reused
+// Returns true on success, false on failure
+inline bool EvictionHelper_CreateSharedMemoryEx(EvictionHelperSharedMemory* outSharedMem, const char* name, uint32_t flags)
+{
+    if (!outSharedMem) return false;
+
+    memset(outSharedMem, 0, sizeof(EvictionHelperSharedMemory));
+    outSharedMem->LockFd = -1;
+    if (!EvictionHelper_SetSharedMemoryName(outSharedMem, name))
+    {
+        return false;
+    }
+
+    // A running helper may use the other backing, zeroing a live mapping would break its snapshots and rings
+    for (int hugeTlbFs = 0; hugeTlbFs < 2; hugeTlbFs++)
+    {
+        int fd = EvictionHelper_OpenSharedMemoryFd(outSharedMem, hugeTlbFs != 0, O_RDWR);
+        if (fd >= 0)
+        {
+            bool locked = EvictionHelper_IsSharedMemoryFdLocked(fd);
+            close(fd);
+            if (locked)
+            {
+                return false;
+            }
+        }
+    }
+
+    // Explicit huge pages need a file on hugetlbfs, fall back to shm_open if it is not mounted or out of huge pages
+    int result = 0;
+    if (flags & EVICTION_HELPER_MAPPING_HUGE_PAGES)
+    {
+        result = EvictionHelper_CreateSharedMemoryBacking(outSharedMem, true, flags);
+    }
+    if (result == 0)
+    {
+        result = EvictionHelper_CreateSharedMemoryBacking(outSharedMem, false, flags);
+    }
+    if (result != 1)
+    {
+        return false;
+    }
+    outSharedMem->IsOwner = 1;
+
+    // Zero initialize
+    memset((void*)outSharedMem->pData, 0, sizeof(EvictionHelperSharedData));
+    return true;
+}
+
+// Open existing shared memory (call from controlling application)
+// name is the name the helper created the mapping with, NULL for EVICTION_HELPER_SHARED_MEMORY_NAME
+// Returns true on success, false on failure (e.g., eviction-helper not running)
+inline bool EvictionHelper_OpenSharedMemoryEx(EvictionHelperSharedMemory* outSharedMem, const char* name, uint32_t flags)
+{
+    if (!outSharedMem) return false;
+
+    memset(outSharedMem, 0, sizeof(EvictionHelperSharedMemory));
+    outSharedMem->LockFd = -1;
+    if (!EvictionHelper_SetSharedMemoryName(outSharedMem, name))
+    {
+        return false;
+    }
+
+    // The helper may have placed the mapping on hugetlbfs. If both exist, one of them was left behind by a helper that
+    // crashed, so take the one the running helper holds, otherwise the shm object.
+    int fds[2] = { EvictionHelper_OpenSharedMemoryFd(outSharedMem, false, O_RDWR), EvictionHelper_OpenSharedMemoryFd(outSharedMem, true, O_RDWR) };
+    int chosen = (fds[0] >= 0) ? 0 : 1;
+    if (fds[0] >= 0 && fds[1] >= 0 && !EvictionHelper_IsSharedMemoryFdLocked(fds[0]) && EvictionHelper_IsSharedMemoryFdLocked(fds[1]))
+    {
+        chosen = 1;
+    }
+    if (fds[1 - chosen] >= 0)
+    {
+        close(fds[1 - chosen]);
+    }
+
+    int fd = fds[chosen];
+    if (fd < 0)
+    {
+        return false;
+    }
+    outSharedMem->IsHugeTlbFs = (uint32_t)chosen;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(EvictionHelperSharedData))
+    {
+        close(fd);
+        return false;
+    }
+
+    return EvictionHelper_MapSharedMemoryFd(outSharedMem, fd, (size_t)st.st_size, flags);
+}
+
+inline bool EvictionHelper_CreateSharedMemory(EvictionHelperSharedMemory* outSharedMem)
+{
+    return EvictionHelper_CreateSharedMemoryEx(outSharedMem, NULL, EVICTION_HELPER_MAPPING_DEFAULT);
+}
+
+inline bool EvictionHelper_OpenSharedMemory(EvictionHelperSharedMemory* outSharedMem)
+{
+    return EvictionHelper_OpenSharedMemoryEx(outSharedMem, NULL, EVICTION_HELPER_MAPPING_DEFAULT);
+}
+
+// Close shared memory (call from both eviction-helper and controlling application)
+inline void EvictionHelper_CloseSharedMemory(EvictionHelperSharedMemory* sharedMem)
+{
+    if (!sharedMem) return;
+
+    if (sharedMem->pData)
+    {
+        munmap(sharedMem->pData, sharedMem->MappedSize);
+        sharedMem->pData = NULL;
+    }
+
+    // Remove the name so a stale mapping does not outlive the helper, before the lock is released so a new helper
+    // never loses its name to the old one
+    if (sharedMem->IsOwner)
+    {
+        EvictionHelper_UnlinkSharedMemory(sharedMem);
+        sharedMem->IsOwner = 0;
+    }
+
+    if (sharedMem->LockFd >= 0)
+    {
+        close(sharedMem->LockFd);
+        sharedMem->LockFd = -1;
+    }
+}
+
+#endif
+
+// Wake eviction-helper so it applies changed inputs or queued commands immediately
+// Call from controlling application after writing inputs or pushing commands
+inline void EvictionHelper_SignalHelper(const EvictionHelperSharedMemory* sharedMem)
+{
+    if (!sharedMem || !sharedMem->pData) return;
+
+    sharedMem->pData->WakeCounter.fetch_add(1, std::memory_order_release);
+#if defined(_WIN32)
+    if (sharedMem->hWakeEvent)
+    {
+        SetEvent(sharedMem->hWakeEvent);
+    }
+#elif defined(__linux__)
+    syscall(SYS_futex, (uint32_t*)&sharedMem->pData->WakeCounter, FUTEX_WAKE, 1, NULL, NULL, 0);
+#endif
+}
+
+// Wait until the wake counter differs from lastWakeCounter or the timeout expires (call from eviction-helper)
+// Returns the current wake counter
+inline uint32_t EvictionHelper_WaitForSignal(const EvictionHelperSharedMemory* sharedMem, uint32_t lastWakeCounter, uint64_t timeoutNs)
+{
+    uint32_t counter = sharedMem->pData->WakeCounter.load(std::memory_order_acquire);
+    if (counter != lastWakeCounter || timeoutNs == 0)
+    {
+        return counter;
+    }
+
+#if defined(_WIN32)
+    DWORD timeoutMs = (DWORD)((timeoutNs + 999999ULL) / 1000000ULL);
+    if (sharedMem->hWakeEvent)
+    {
+        WaitForSingleObject(sharedMem->hWakeEvent, timeoutMs);
+    }
+    else
+    {
+        Sleep(timeoutMs);
+    }
+#elif defined(__linux__)
+    // Shared (non-private) futex so the wake can come from another process
+    struct timespec timeout;
+    timeout.tv_sec = (time_t)(timeoutNs / 1000000000ULL);
+    timeout.tv_nsec = (long)(timeoutNs % 1000000000ULL);
+    syscall(SYS_futex, (uint32_t*)&sharedMem->pData->WakeCounter, FUTEX_WAIT, lastWakeCounter, &timeout, NULL, 0);
+#else
+    struct timespec timeout;
+    timeout.tv_sec = (time_t)(timeoutNs / 1000000000ULL);
+    timeout.tv_nsec = (long)(timeoutNs % 1000000000ULL);
+    nanosleep(&timeout, NULL);
+#endif
+
+    return sharedMem->pData->WakeCounter.load(std::memory_order_acquire);
+}
+
+// Append a budget change, increment BudgetGeneration and wake every waiting controller (call from the budget watcher
+// of eviction-helper only). Sets change->Generation.
+inline void EvictionHelper_PublishBudgetChange(const EvictionHelperSharedMemory* sharedMem, EvictionHelperBudgetChange* change)
+{
+    EvictionHelperSharedData* data = sharedMem->pData;
+    uint32_t generation = data->BudgetGeneration.load(std::memory_order_relaxed) + 1;
+    change->Generation = generation;
+    EvictionHelper_WriteRing(&data->BudgetChanges, change);
+
+#if defined(_WIN32)
+    // Waiters for the next generation wait on the other event, reset it before they can see this generation
+    if (sharedMem->hBudgetEvents[(generation + 1) & 1])
+    {
+        ResetEvent(sharedMem->hBudgetEvents[(generation + 1) & 1]);
+    }
+    data->BudgetGeneration.store(generation, std::memory_order_release);
+    if (sharedMem->hBudgetEvents[generation & 1])
+    {
+        SetEvent(sharedMem->hBudgetEvents[generation & 1]);
+    }
+#elif defined(__linux__)
+    data->BudgetGeneration.store(generation, std::memory_order_release);
+    syscall(SYS_futex, (uint32_t*)&data->BudgetGeneration, FUTEX_WAKE, 0x7fffffff, NULL, NULL, 0);
+#else
+    data->BudgetGeneration.store(generation, std::memory_order_release);
+#endif
+}
+
+// Wait until BudgetGeneration differs from lastGeneration or the timeout expires (call from controlling application)
+// Any number of controllers can wait at the same time, all of them wake on the next change. May return early, callers
+// loop until the generation changed or their own deadline passed.
+// Returns the current budget generation
+inline uint32_t EvictionHelper_WaitForBudgetChange(const EvictionHelperSharedMemory* sharedMem, uint32_t lastGeneration, uint64_t timeoutNs)
+{
+    uint32_t generation = sharedMem->pData->BudgetGeneration.load(std::memory_order_acquire);
+    if (generation != lastGeneration || timeoutNs == 0)
+    {
+        return generation;
+    }
+
+#if defined(_WIN32)
+    // The event of the next generation is reset again by the publish after it. If two changes are published between a
+    // check of the generation and the wait, the wait would sleep through both, so the generation is checked again
+    // right before every wait and every wait is limited to EVICTION_HELPER_BUDGET_WAIT_SLICE_MS.
+    HANDLE event = sharedMem->hBudgetEvents[(lastGeneration + 1) & 1];
+    uint64_t deadlineNs = EvictionHelper_GetTimestampNs() + timeoutNs;
+    while (true)
+    {
+        generation = sharedMem->pData->BudgetGeneration.load(std::memory_order_acquire);
+        uint64_t nowNs = EvictionHelper_GetTimestampNs();
+        if (generation != lastGeneration || nowNs >= deadlineNs)
+        {
+            break;
+        }
+
+        uint64_t waitMs = (deadlineNs - nowNs + 999999ULL) / 1000000ULL;
+        DWORD timeoutMs = (DWORD)(waitMs < EVICTION_HELPER_BUDGET_WAIT_SLICE_MS ? waitMs : EVICTION_HELPER_BUDGET_WAIT_SLICE_MS);
+        if (event)
+        {
+            WaitForSingleObject(event, timeoutMs);
+        }
+        else
+        {
+            Sleep(timeoutMs);
+        }
+    }
+#elif defined(__linux__)
+    struct timespec timeout;
+    timeout.tv_sec = (time_t)(timeoutNs / 1000000000ULL);
+    timeout.tv_nsec = (long)(timeoutNs % 1000000000ULL);
+    syscall(SYS_futex, (uint32_t*)&sharedMem->pData->BudgetGeneration, FUTEX_WAIT, lastGeneration, &timeout, NULL, 0);
+#else
+    struct timespec timeout;
+    timeout.tv_sec = (time_t)(timeoutNs / 1000000000ULL);
+    timeout.tv_nsec = (long)(timeoutNs % 1000000000ULL);
+    nanosleep(&timeout, NULL);
+#endif
+
+    return sharedMem->pData->BudgetGeneration.load(std::memory_order_acquire);
 }
@@ -0,0 +1,493 @@
+#pragma once
+
+#include "eviction_helper_device.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Simulated residency device for running the helper without a GPU
+// Models a local budget, a residency priority and a last-touched frame per resource. At the end of each
+// frame the lowest-priority, least-recently-used resources are evicted to the non-local segment until
+// local usage fits the budget again. Touching an evicted resource pages it back in.
+// Creation fails once local and non-local budget are both used up.
+// Signaled frames complete a fixed number of frames later, like a GPU with frames in flight. Destroying a
+// resource before the last frame that touched it has completed is counted, see GetInFlightDestroyCount().
+// Explicit Evict() and MakeResident() move resources between the segments at a configurable paging bandwidth,
+// EnqueueMakeResident() completes its residency fence once the same transfer time has passed.
+// All methods are thread safe, so resources can be created by the allocation worker.
+class EvictionHelperSimDevice : public EvictionHelperDevice
+{
+public:
+	EvictionHelperSimDevice(uint64_t localBudgetBytes, uint64_t nonLocalBudgetBytes)
+		: m_LocalBudget(localBudgetBytes)
+		, m_NonLocalBudget(nonLocalBudgetBytes)
+	{
+	}
+
+	// Change the local budget, e.g. to simulate the OS cutting it, takes effect at the end of the next frame
+	// Raises a budget change notification right away, like the OS does.
+	void SetLocalBudget(uint64_t bytes)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_LocalBudget = bytes;
+		RaiseBudgetChangeLocked();
+	}
+
+	void SetNonLocalBudget(uint64_t bytes)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_NonLocalBudget = bytes;
+		RaiseBudgetChangeLocked();
+	}
+
+	// Raise a budget change notification without changing the budget, the OS sends those too
+	void RaiseBudgetChangeNotification()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		RaiseBudgetChangeLocked();
+	}
+
+	// Number of later Signal() calls before a signaled frame completes, 0 completes frames immediately
+	void SetFrameLatency(uint32_t frames)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_FrameLatency = frames;
+	}
+
+	// Make every CreateResource() call take this long, to model the cost of creating committed resources
+	void SetCreationLatency(uint64_t nanoseconds)
+	{
+		m_CreationLatencyNs = nanoseconds;
+	}
+
+	// Make every priority call take this long regardless of its size, to model the kernel transition
+	void SetPriorityCallLatency(uint64_t nanoseconds)
+	{
+		m_PriorityCallLatencyNs = nanoseconds;
+	}
+
+	// Bandwidth of explicit Evict() and MakeResident() calls, they block for the time the transfer takes
+	// 0 = paging is instant
+	void SetPagingBandwidth(uint64_t bytesPerSecond)
+	{
+		m_PagingBytesPerSecond = bytesPerSecond;
+	}
+
+	EvictionHelperResource CreateResource(uint32_t kind, uint64_t sizeBytes, int priority) override
+	{
+		if(m_CreationLatencyNs > 0)
+		{
+			std::this_thread::sleep_for(std::chrono::nanoseconds(m_CreationLatencyNs));
+		}
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if(m_ResidentBytes + m_EvictedBytes + sizeBytes > m_LocalBudget + m_NonLocalBudget)
+			return 0;
+
+		SimResource resource;
+		resource.SizeBytes			= sizeBytes;
+		resource.Kind				= kind;
+		resource.Priority			= priority;
+		resource.LastTouchedFrame	= m_Frame;
+		resource.LastUsedFenceValue	= 0;
+		resource.Resident			= true;
+		resource.Alive				= true;
+		m_ResidentBytes += sizeBytes;
+
+		if(!m_FreeSlots.empty())
+		{
+			uint32_t slot = m_FreeSlots.back();
+			m_FreeSlots.pop_back();
+			m_Resources[slot] = resource;
+			return slot + 1;
+		}
+		m_Resources.push_back(resource);
+		return m_Resources.size();
+	}
+
+	void DestroyResource(EvictionHelperResource handle) override
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		SimResource* resource = Get(handle);
+		if(!resource)
+			return;
+
+		if(resource->LastUsedFenceValue > m_CompletedFenceValue)
+			m_InFlightDestroyCount++;
+
+		if(resource->Resident)
+			m_ResidentBytes -= resource->SizeBytes;
+		else
+			m_EvictedBytes -= resource->SizeBytes;
+		resource->Alive = false;
+		m_FreeSlots.push_back(static_cast<uint32_t>(handle - 1));
+	}
+
+	void SetResidencyPriority(EvictionHelperResource handle, int priority) override
+	{
+		SetResidencyPriorities(&handle, 1, priority);
+	}
+
+	// Counted as one call, like a single ID3D12Device1::SetResidencyPriority() with arrays
+	void SetResidencyPriorities(const EvictionHelperResource* handles, uint32_t count, int priority) override
+	{
+		if(m_PriorityCallLatencyNs > 0)
+		{
+			std::this_thread::sleep_for(std::chrono::nanoseconds(m_PriorityCallLatencyNs));
+		}
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		for(uint32_t i = 0; i < count; i++)
+		{
+			SimResource* resource = Get(handles[i]);
+			if(resource)
+				resource->Priority = priority;
+		}
+		m_PriorityCallCount++;
+		m_PriorityObjectCount += count;
+	}
+
+	// Counted like evictions to fit the budget
+	bool Evict(const EvictionHelperResource* handles, uint32_t count) override
+	{
+		uint64_t bytes = 0;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			for(uint32_t i = 0; i < count; i++)
+			{
+				SimResource* resource = Get(handles[i]);
+				if(!resource || !resource->Resident)
+					continue;
+
+				resource->Resident = false;
+				m_ResidentBytes -= resource->SizeBytes;
+				m_EvictedBytes += resource->SizeBytes;
+				m_EvictionCount++;
+				bytes += resource->SizeBytes;
+			}
+		}
+		std::this_thread::sleep_for(GetPagingTime(bytes));
+		return true;
+	}
+
+	bool MakeResident(const EvictionHelperResource* handles, uint32_t count) override
+	{
+		std::this_thread::sleep_for(GetPagingTime(PageIn(handles, count)));
+		return true;
+	}
+
+	// Resources count as resident right away, the fence completes once the transfer time has passed
+	// Transfers are queued behind each other like on a single copy engine
+	uint64_t EnqueueMakeResident(const EvictionHelperResource* handles, uint32_t count) override
+	{
+		std::chrono::nanoseconds			  transferTime = GetPagingTime(PageIn(handles, count));
+		std::chrono::steady_clock::time_point now		   = std::chrono::steady_clock::now();
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		PendingResidency			pending;
+		pending.FenceValue	   = ++m_ResidencySignaledValue;
+		pending.CompletionTime = std::max(now, m_ResidencyQueueEnd) + transferTime;
+		m_ResidencyQueueEnd	   = pending.CompletionTime;
+		m_PendingResidency.push_back(pending);
+		return pending.FenceValue;
+	}
+
+	uint64_t GetCompletedResidencyFenceValue() override
+	{
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		while(!m_PendingResidency.empty() && m_PendingResidency.front().CompletionTime <= now)
+		{
+			m_ResidencyCompletedValue = m_PendingResidency.front().FenceValue;
+			m_PendingResidency.pop_front();
+		}
+		return m_ResidencyCompletedValue;
+	}
+
+	void BeginFrame(uint64_t frameIndex) override
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Frame = frameIndex;
+	}
+
+	void TouchResource(EvictionHelperResource handle) override
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		SimResource* resource = Get(handle);
+		if(!resource)
+			return;
+
+		resource->LastTouchedFrame	 = m_Frame;
+		resource->LastUsedFenceValue = m_SignaledFenceValue + 1;
+		if(!resource->Resident)
+		{
+			// Page fault: bring it back, the budget is enforced at the end of the frame
+			resource->Resident = true;
+			m_EvictedBytes -= resource->SizeBytes;
+			m_ResidentBytes += resource->SizeBytes;
+			m_PageInCount++;
+			m_PageInBytes += resource->SizeBytes;
+		}
+	}
+
+	void EndFrame() override
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		EnforceBudget();
+	}
+
+	void WaitForIdle() override
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_CompletedFenceValue = m_SignaledFenceValue;
+	}
+
+	uint64_t Signal() override
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_SignaledFenceValue++;
+		if(m_SignaledFenceValue > m_FrameLatency)
+			m_CompletedFenceValue = std::max(m_CompletedFenceValue, m_SignaledFenceValue - m_FrameLatency);
+		return m_SignaledFenceValue;
+	}
+
+	uint64_t GetCompletedFenceValue() override
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_CompletedFenceValue;
+	}
+
+	void QueryMemoryInfo(EvictionHelperMemoryInfo* outLocal, EvictionHelperMemoryInfo* outNonLocal) override
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		outLocal->Budget				  = m_LocalBudget;
+		outLocal->CurrentUsage			  = m_ResidentBytes;
+		outLocal->AvailableForReservation = m_LocalBudget / 2;
+		outLocal->CurrentReservation	  = 0;
+
+		outNonLocal->Budget					 = m_NonLocalBudget;
+		outNonLocal->CurrentUsage			 = m_EvictedBytes;
+		outNonLocal->AvailableForReservation = m_NonLocalBudget / 2;
+		outNonLocal->CurrentReservation		 = 0;
+	}
+
+	bool IsResident(EvictionHelperResource handle) const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		const SimResource* resource = Get(handle);
+		return resource && resource->Resident;
+	}
+
+	// EVICTION_HELPER_PRIORITY_* of a resource, -1 for an invalid handle
+	int GetResidencyPriority(EvictionHelperResource handle) const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		const SimResource* resource = Get(handle);
+		return resource ? resource->Priority : -1;
+	}
+
+	uint64_t GetEvictionCount() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_EvictionCount;
+	}
+
+	uint64_t GetPageInCount() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_PageInCount;
+	}
+
+	uint64_t GetPageInBytes() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_PageInBytes;
+	}
+
+	// Priority calls made and resources changed by them
+	uint64_t GetPriorityCallCount() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_PriorityCallCount;
+	}
+
+	uint64_t GetPriorityObjectCount() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_PriorityObjectCount;
+	}
+
+	// Resources destroyed while a frame that touched them was still in flight
+	uint64_t GetInFlightDestroyCount() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_InFlightDestroyCount;
+	}
+
+	// Notifications are raised by SetLocalBudget(), SetNonLocalBudget() and RaiseBudgetChangeNotification()
+	// Pending notifications are merged into one, like an auto-reset event.
+	bool SupportsBudgetChangeNotifications() override
+	{
+		return true;
+	}
+
+	bool WaitForBudgetChange(uint64_t timeoutNs) override
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_BudgetChangeCondition.wait_for(lock, std::chrono::nanoseconds(timeoutNs), [this] { return m_BudgetChangePending || m_BudgetWaitCanceled; });
+		bool changed		  = m_BudgetChangePending;
+		m_BudgetChangePending = false;
+		m_BudgetWaitCanceled  = false;
+		return changed;
+	}
+
+	void CancelBudgetChangeWait() override
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_BudgetWaitCanceled = true;
+		m_BudgetChangeCondition.notify_all();
+	}
+
+private:
+	struct PendingResidency
+	{
+		uint64_t							  FenceValue;
+		std::chrono::steady_clock::time_point CompletionTime;
+	};
+
+	struct SimResource
+	{
+		uint64_t SizeBytes;
+		uint32_t Kind;
+		int		 Priority;
+		uint64_t LastTouchedFrame;
+		uint64_t LastUsedFenceValue;
+		bool	 Resident;
+		bool	 Alive;
+	};
+
+	SimResource* Get(EvictionHelperResource handle)
+	{
+		if(handle == 0 || handle > m_Resources.size() || !m_Resources[handle - 1].Alive)
+			return nullptr;
+		return &m_Resources[handle - 1];
+	}
+
+	const SimResource* Get(EvictionHelperResource handle) const
+	{
+		return const_cast<EvictionHelperSimDevice*>(this)->Get(handle);
+	}
+
+	// Wake WaitForBudgetChange(), caller holds m_Mutex
+	void RaiseBudgetChangeLocked()
+	{
+		m_BudgetChangePending = true;
+		m_BudgetChangeCondition.notify_all();
+	}
+
+	// Bring evicted resources back, returns the bytes paged in
+	uint64_t PageIn(const EvictionHelperResource* handles, uint32_t count)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		uint64_t					bytes = 0;
+		for(uint32_t i = 0; i < count; i++)
+		{
+			SimResource* resource = Get(handles[i]);
+			if(!resource || resource->Resident)
+				continue;
+
+			resource->Resident = true;
+			m_EvictedBytes -= resource->SizeBytes;
+			m_ResidentBytes += resource->SizeBytes;
+			m_PageInCount++;
+			m_PageInBytes += resource->SizeBytes;
+			bytes += resource->SizeBytes;
+		}
+		return bytes;
+	}
+
+	std::chrono::nanoseconds GetPagingTime(uint64_t bytes) const
+	{
+		uint64_t bytesPerSecond = m_PagingBytesPerSecond;
+		if(bytesPerSecond == 0)
+			return std::chrono::nanoseconds(0);
+		return std::chrono::nanoseconds(static_cast<int64_t>(static_cast<double>(bytes) * 1000000000.0 / static_cast<double>(bytesPerSecond)));
+	}
+
+	// Evict until local usage fits the budget
+	// Resources used by the current frame go last, then lowest priority first, then least recently used first
+	void EnforceBudget()
+	{
+		if(m_ResidentBytes <= m_LocalBudget)
+			return;
+
+		m_Candidates.clear();
+		for(uint32_t i = 0; i < m_Resources.size(); i++)
+		{
+			if(m_Resources[i].Alive && m_Resources[i].Resident)
+				m_Candidates.push_back(i);
+		}
+
+		uint64_t frame = m_Frame;
+		std::sort(m_Candidates.begin(), m_Candidates.end(), [this, frame](uint32_t a, uint32_t b) {
+			const SimResource& ra = m_Resources[a];
+			const SimResource& rb = m_Resources[b];
+			bool			   ua = ra.LastTouchedFrame == frame;
+			bool			   ub = rb.LastTouchedFrame == frame;
+			if(ua != ub)
+				return ub;
+			if(ra.Priority != rb.Priority)
+				return ra.Priority < rb.Priority;
+			return ra.LastTouchedFrame < rb.LastTouchedFrame;
+		});
+
+		for(uint32_t index : m_Candidates)
+		{
+			if(m_ResidentBytes <= m_LocalBudget)
+				break;
+
+			SimResource& resource = m_Resources[index];
+			resource.Resident	  = false;
+			m_ResidentBytes -= resource.SizeBytes;
+			m_EvictedBytes += resource.SizeBytes;
+			m_EvictionCount++;
+		}
+	}
+
+	mutable std::mutex					  m_Mutex;
+	std::vector<SimResource>			  m_Resources;
+	std::vector<uint32_t>				  m_FreeSlots;
+	std::vector<uint32_t>				  m_Candidates;
+	std::deque<PendingResidency>		  m_PendingResidency;
+	std::chrono::steady_clock::time_point m_ResidencyQueueEnd;
+	uint64_t							  m_ResidencySignaledValue	= 0;
+	uint64_t							  m_ResidencyCompletedValue	= 0;
+	uint64_t							  m_LocalBudget;
+	uint64_t							  m_NonLocalBudget;
+	uint64_t							  m_Frame					= 0;
+	uint64_t							  m_ResidentBytes			= 0;
+	uint64_t							  m_EvictedBytes			= 0;
+	uint64_t							  m_EvictionCount			= 0;
+	uint64_t							  m_PageInCount				= 0;
+	uint64_t							  m_PageInBytes				= 0;
+	uint64_t							  m_SignaledFenceValue		= 0;
+	uint64_t							  m_CompletedFenceValue		= 0;
+	uint64_t							  m_InFlightDestroyCount	= 0;
+	uint64_t							  m_PriorityCallCount		= 0;
+	uint64_t							  m_PriorityObjectCount		= 0;
+	uint32_t							  m_FrameLatency			= 2;
+	std::atomic<uint64_t>				  m_CreationLatencyNs{ 0 };
+	std::atomic<uint64_t>				  m_PriorityCallLatencyNs{ 0 };
+	std::atomic<uint64_t>				  m_PagingBytesPerSecond{ 0 };
+	std::condition_variable				  m_BudgetChangeCondition;
+	bool								  m_BudgetChangePending		= false;
+	bool								  m_BudgetWaitCanceled		= false;
+};
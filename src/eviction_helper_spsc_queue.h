@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Bounded lock-free single-producer/single-consumer queue for handing items between two threads
+// Push() may only be called from one thread and Pop() from one other thread. Capacity must be a power of two.
+template <typename T, uint32_t Capacity>
+class EvictionHelperSpscQueue
+{
+	static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+	EvictionHelperSpscQueue()
+		: m_Items(Capacity)
+	{
+	}
+
+	// Returns false if the queue is full
+	bool Push(const T& item)
+	{
+		uint64_t write = m_WriteIndex.load(std::memory_order_relaxed);
+		if(write - m_ReadIndex.load(std::memory_order_acquire) >= Capacity)
+			return false;
+
+		m_Items[static_cast<size_t>(write & (Capacity - 1))] = item;
+		m_WriteIndex.store(write + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Returns false if the queue is empty
+	bool Pop(T* outItem)
+	{
+		uint64_t read = m_ReadIndex.load(std::memory_order_relaxed);
+		if(read == m_WriteIndex.load(std::memory_order_acquire))
+			return false;
+
+		*outItem = m_Items[static_cast<size_t>(read & (Capacity - 1))];
+		m_ReadIndex.store(read + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool IsEmpty() const
+	{
+		return m_ReadIndex.load(std::memory_order_acquire) == m_WriteIndex.load(std::memory_order_acquire);
+	}
+
+private:
+	alignas(64) std::atomic<uint64_t> m_WriteIndex{ 0 };
+	alignas(64) std::atomic<uint64_t> m_ReadIndex{ 0 };
+	std::vector<T> m_Items;
+};
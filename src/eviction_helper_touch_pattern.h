@@ -0,0 +1,136 @@
+#pragma once
+
+#include "eviction_helper_random.h"
+#include "eviction_helper_shared.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+constexpr float TOUCH_PATTERN_DEFAULT_ZIPF_EXPONENT = 1.0f;
+
+// Picks the resources of a pool that are touched in a frame
+// Replaces touching everything, a 100% per-frame working set, with a round-robin window, a uniformly random subset
+// or a hot/cold Zipf distribution in which low indices are hot. The random patterns use their own generator, so the
+// same seed always produces the same sequence of frames on every backend.
+// Indices refer to whatever list of resources the caller keeps, the pattern does not know about devices.
+class EvictionHelperTouchPattern
+{
+public:
+	explicit EvictionHelperTouchPattern(uint64_t seed = 0)
+	{
+		Reset(seed);
+	}
+
+	// Restart the sequence from a seed
+	void Reset(uint64_t seed)
+	{
+		m_Random.Seed(seed);
+		m_Cursor = 0;
+		m_Permutation.clear();
+	}
+
+	// Fill outIndices with the indices in [0, resourceCount) to touch this frame
+	// percent is the share of the resources touched per frame. ZIPF touches that many on average, the hottest
+	// resources every frame and the coldest rarely.
+	void Generate(uint32_t pattern, uint32_t resourceCount, uint32_t percent, float zipfExponent, std::vector<uint32_t>* outIndices)
+	{
+		outIndices->clear();
+		if(resourceCount == 0)
+			return;
+
+		uint32_t touchCount = static_cast<uint32_t>((static_cast<uint64_t>(resourceCount) * std::min(percent, 100u) + 99) / 100);
+		switch(pattern)
+		{
+		case EVICTION_HELPER_TOUCH_ROUND_ROBIN:
+			m_Cursor %= resourceCount;
+			for(uint32_t i = 0; i < touchCount; i++)
+			{
+				outIndices->push_back((m_Cursor + i) % resourceCount);
+			}
+			m_Cursor = (m_Cursor + touchCount) % resourceCount;
+			break;
+		case EVICTION_HELPER_TOUCH_RANDOM:
+			// Partial Fisher-Yates shuffle, the first touchCount entries are a uniformly random subset
+			if(m_Permutation.size() != resourceCount)
+			{
+				m_Permutation.resize(resourceCount);
+				for(uint32_t i = 0; i < resourceCount; i++)
+					m_Permutation[i] = i;
+			}
+			for(uint32_t i = 0; i < touchCount; i++)
+			{
+				uint32_t j = i + static_cast<uint32_t>(m_Random.Next() % (resourceCount - i));
+				std::swap(m_Permutation[i], m_Permutation[j]);
+				outIndices->push_back(m_Permutation[i]);
+			}
+			break;
+		case EVICTION_HELPER_TOUCH_ZIPF:
+			UpdateZipfProbabilities(resourceCount, touchCount, (zipfExponent > 0.0f) ? zipfExponent : TOUCH_PATTERN_DEFAULT_ZIPF_EXPONENT);
+			for(uint32_t i = 0; i < resourceCount; i++)
+			{
+				if(m_Random.NextUnit() < m_ZipfProbabilities[i])
+					outIndices->push_back(i);
+			}
+			break;
+		case EVICTION_HELPER_TOUCH_NONE:
+			break;
+		case EVICTION_HELPER_TOUCH_ALL:
+		default:
+			for(uint32_t i = 0; i < resourceCount; i++)
+			{
+				outIndices->push_back(i);
+			}
+			break;
+		}
+	}
+
+private:
+	// Per-resource touch probabilities min(1, scale / (i + 1)^exponent), with the scale chosen so that touchCount
+	// resources are touched on average. Only recomputed when one of the inputs changes.
+	void UpdateZipfProbabilities(uint32_t resourceCount, uint32_t touchCount, float exponent)
+	{
+		if(m_ZipfProbabilities.size() == resourceCount && m_ZipfTouchCount == touchCount && m_ZipfExponent == exponent)
+			return;
+
+		m_ZipfTouchCount = touchCount;
+		m_ZipfExponent	 = exponent;
+		m_ZipfWeights.resize(resourceCount);
+		m_ZipfProbabilities.resize(resourceCount);
+		for(uint32_t i = 0; i < resourceCount; i++)
+		{
+			m_ZipfWeights[i] = 1.0 / std::pow(static_cast<double>(i) + 1.0, static_cast<double>(exponent));
+		}
+
+		// The expected count grows monotonically with the scale, bisect between 0 and the scale that touches all
+		double low	= 0.0;
+		double high = 1.0 / m_ZipfWeights[resourceCount - 1];
+		for(int iteration = 0; iteration < 64; iteration++)
+		{
+			double scale	= 0.5 * (low + high);
+			double expected = 0.0;
+			for(double weight : m_ZipfWeights)
+			{
+				expected += std::min(1.0, weight * scale);
+			}
+			if(expected < touchCount)
+				low = scale;
+			else
+				high = scale;
+		}
+
+		for(uint32_t i = 0; i < resourceCount; i++)
+		{
+			m_ZipfProbabilities[i] = std::min(1.0, m_ZipfWeights[i] * high);
+		}
+	}
+
+	EvictionHelperRandom  m_Random;
+	uint32_t			  m_Cursor;
+	std::vector<uint32_t> m_Permutation;
+	std::vector<double>	  m_ZipfWeights;
+	std::vector<double>	  m_ZipfProbabilities;
+	uint32_t			  m_ZipfTouchCount = 0;
+	float				  m_ZipfExponent   = 0.0f;
+};
@@ -0,0 +1,543 @@
+#pragma once
+
+#include "eviction_helper_device.h"
+#include "eviction_helper_shared.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Allocation trace file: an EvictionHelperTraceHeader followed by EventCount fixed-size events sorted by TimeNs
+// Fixed-size events let the reader map the file and walk it without parsing or copying.
+#define EVICTION_HELPER_TRACE_MAGIC	  0x52544845 // "EHTR"
+#define EVICTION_HELPER_TRACE_VERSION 1
+
+// Event types
+#define EVICTION_HELPER_TRACE_ALLOC		   0 // Create resource Id with SizeBytes, Kind and Priority
+#define EVICTION_HELPER_TRACE_FREE		   1 // Destroy resource Id
+#define EVICTION_HELPER_TRACE_SET_PRIORITY 2 // Change the residency priority of resource Id to Priority
+
+struct EvictionHelperTraceHeader
+{
+	uint32_t Magic;		 // EVICTION_HELPER_TRACE_MAGIC
+	uint32_t Version;	 // EVICTION_HELPER_TRACE_VERSION
+	uint32_t HeaderSize; // sizeof(EvictionHelperTraceHeader), events start here
+	uint32_t EventSize;	 // sizeof(EvictionHelperTraceEvent)
+	uint64_t EventCount; // 0 if the recording was not closed, the events up to the end of the file are read then
+	uint64_t DurationNs; // Time of the last event
+};
+
+struct EvictionHelperTraceEvent
+{
+	uint64_t TimeNs;	// Since the start of the trace
+	uint64_t SizeBytes; // ALLOC only
+	uint32_t Id;		// Chosen by the writer, unique among the live resources
+	uint8_t	 Type;		// EVICTION_HELPER_TRACE_*
+	uint8_t	 Kind;		// EVICTION_HELPER_RESOURCE_*, ALLOC only
+	uint8_t	 Priority;	// EVICTION_HELPER_PRIORITY_*, ALLOC and SET_PRIORITY
+	uint8_t	 _padding;
+};
+
+static_assert(sizeof(EvictionHelperTraceHeader) == 32, "Trace header layout changed");
+static_assert(sizeof(EvictionHelperTraceEvent) == 24, "Trace event layout changed");
+
+// Read-only memory mapping of a trace file, read front to back with Next()
+// Only the pages around the read position are touched, so traces larger than memory can be replayed. On Linux the
+// pages behind the read position are dropped every TRACE_READER_RELEASE_BYTES to keep the resident set small.
+class EvictionHelperTraceReader
+{
+public:
+	static constexpr uint64_t TRACE_READER_RELEASE_BYTES = 64ULL * 1024ULL * 1024ULL;
+
+	EvictionHelperTraceReader() = default;
+
+	~EvictionHelperTraceReader()
+	{
+		Close();
+	}
+
+	EvictionHelperTraceReader(const EvictionHelperTraceReader&)			   = delete;
+	EvictionHelperTraceReader& operator=(const EvictionHelperTraceReader&) = delete;
+
+	// Map a trace file, false if it cannot be opened or has no valid header
+	bool Open(const char* path)
+	{
+		Close();
+
+#ifdef _WIN32
+		m_File = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if(m_File == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER fileSize = {};
+		if(!GetFileSizeEx(m_File, &fileSize) || static_cast<uint64_t>(fileSize.QuadPart) < sizeof(EvictionHelperTraceHeader))
+		{
+			Close();
+			return false;
+		}
+		m_MappingHandle = CreateFileMappingA(m_File, NULL, PAGE_READONLY, 0, 0, NULL);
+		m_Mapping		= m_MappingHandle ? static_cast<const uint8_t*>(MapViewOfFile(m_MappingHandle, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+		m_MappedSize	= static_cast<uint64_t>(fileSize.QuadPart);
+#else
+		int fd = open(path, O_RDONLY);
+		if(fd < 0)
+			return false;
+
+		struct stat fileStat;
+		if(fstat(fd, &fileStat) != 0 || static_cast<uint64_t>(fileStat.st_size) < sizeof(EvictionHelperTraceHeader))
+		{
+			close(fd);
+			return false;
+		}
+		void* mapping = mmap(NULL, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if(mapping != MAP_FAILED)
+		{
+			madvise(mapping, static_cast<size_t>(fileStat.st_size), MADV_SEQUENTIAL);
+			m_Mapping	 = static_cast<const uint8_t*>(mapping);
+			m_MappedSize = static_cast<uint64_t>(fileStat.st_size);
+		}
+#endif
+		if(!m_Mapping)
+		{
+			Close();
+			return false;
+		}
+
+		const EvictionHelperTraceHeader* header = reinterpret_cast<const EvictionHelperTraceHeader*>(m_Mapping);
+		if(header->Magic != EVICTION_HELPER_TRACE_MAGIC || header->Version != EVICTION_HELPER_TRACE_VERSION || header->HeaderSize < sizeof(EvictionHelperTraceHeader) ||
+		   header->EventSize != sizeof(EvictionHelperTraceEvent) || header->HeaderSize > m_MappedSize)
+		{
+			Close();
+			return false;
+		}
+
+		// A recording that was not closed has no event count, a truncated file fewer events than the header says
+		uint64_t eventsInFile = (m_MappedSize - header->HeaderSize) / sizeof(EvictionHelperTraceEvent);
+		m_Events			  = reinterpret_cast<const EvictionHelperTraceEvent*>(m_Mapping + header->HeaderSize);
+		m_EventCount		  = (header->EventCount > 0) ? std::min(header->EventCount, eventsInFile) : eventsInFile;
+		m_DurationNs		  = (m_EventCount > 0) ? std::max(header->DurationNs, m_Events[m_EventCount - 1].TimeNs) : 0;
+		m_Position			  = 0;
+		m_ReleasedBytes		  = 0;
+		return true;
+	}
+
+	void Close()
+	{
+#ifdef _WIN32
+		if(m_Mapping)
+			UnmapViewOfFile(m_Mapping);
+		if(m_MappingHandle)
+			CloseHandle(m_MappingHandle);
+		if(m_File != INVALID_HANDLE_VALUE)
+			CloseHandle(m_File);
+		m_MappingHandle = NULL;
+		m_File			= INVALID_HANDLE_VALUE;
+#else
+		if(m_Mapping)
+			munmap(const_cast<uint8_t*>(m_Mapping), static_cast<size_t>(m_MappedSize));
+#endif
+		m_Mapping	 = nullptr;
+		m_MappedSize = 0;
+		m_Events	 = nullptr;
+		m_EventCount = 0;
+		m_DurationNs = 0;
+		m_Position	 = 0;
+	}
+
+	bool IsOpen() const
+	{
+		return m_Mapping != nullptr;
+	}
+
+	uint64_t GetEventCount() const
+	{
+		return m_EventCount;
+	}
+
+	uint64_t GetDurationNs() const
+	{
+		return m_DurationNs;
+	}
+
+	// Index of the event Next() returns
+	uint64_t GetPosition() const
+	{
+		return m_Position;
+	}
+
+	// The next event without consuming it, nullptr at the end
+	const EvictionHelperTraceEvent* Peek() const
+	{
+		return (m_Position < m_EventCount) ? &m_Events[m_Position] : nullptr;
+	}
+
+	// The next event, nullptr at the end. The pointer is valid until the next call.
+	const EvictionHelperTraceEvent* Next()
+	{
+		const EvictionHelperTraceEvent* event = Peek();
+		if(!event)
+			return nullptr;
+
+		m_Position++;
+#ifndef _WIN32
+		uint64_t readBytes = reinterpret_cast<const uint8_t*>(event) - m_Mapping;
+		if(readBytes - m_ReleasedBytes >= TRACE_READER_RELEASE_BYTES)
+		{
+			uint64_t pageSize	  = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+			uint64_t releaseBytes = readBytes / pageSize * pageSize;
+			madvise(const_cast<uint8_t*>(m_Mapping), static_cast<size_t>(releaseBytes), MADV_DONTNEED);
+			m_ReleasedBytes = releaseBytes;
+		}
+#endif
+		return event;
+	}
+
+	void Rewind()
+	{
+		m_Position		= 0;
+		m_ReleasedBytes = 0;
+	}
+
+private:
+#ifdef _WIN32
+	HANDLE m_File		   = INVALID_HANDLE_VALUE;
+	HANDLE m_MappingHandle = NULL;
+#endif
+	const uint8_t*					m_Mapping		= nullptr;
+	uint64_t						m_MappedSize	= 0;
+	const EvictionHelperTraceEvent* m_Events		= nullptr;
+	uint64_t						m_EventCount	= 0;
+	uint64_t						m_DurationNs	= 0;
+	uint64_t						m_Position		= 0;
+	uint64_t						m_ReleasedBytes = 0;
+};
+
+// Writes a trace file, thread safe
+// Record() stamps events with the time since Open() and hands out the ids, Write() takes finished events, for example
+// when converting allocation logs. Write() expects the events sorted by TimeNs.
+class EvictionHelperTraceWriter
+{
+public:
+	~EvictionHelperTraceWriter()
+	{
+		Close();
+	}
+
+	bool Open(const char* path)
+	{
+		Close();
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_File = fopen(path, "wb");
+		if(!m_File)
+			return false;
+		setvbuf(m_File, nullptr, _IOFBF, 1 << 20);
+
+		// Written again with the event count by Close()
+		EvictionHelperTraceHeader header = {};
+		header.Magic					 = EVICTION_HELPER_TRACE_MAGIC;
+		header.Version					 = EVICTION_HELPER_TRACE_VERSION;
+		header.HeaderSize				 = sizeof(EvictionHelperTraceHeader);
+		header.EventSize				 = sizeof(EvictionHelperTraceEvent);
+		fwrite(&header, sizeof(header), 1, m_File);
+		m_StartNs	 = EvictionHelper_GetTimestampNs();
+		m_EventCount = 0;
+		m_DurationNs = 0;
+		m_NextId	 = 1;
+		return true;
+	}
+
+	// Patch the header with the event count and close the file
+	void Close()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if(!m_File)
+			return;
+
+		EvictionHelperTraceHeader header = {};
+		header.Magic					 = EVICTION_HELPER_TRACE_MAGIC;
+		header.Version					 = EVICTION_HELPER_TRACE_VERSION;
+		header.HeaderSize				 = sizeof(EvictionHelperTraceHeader);
+		header.EventSize				 = sizeof(EvictionHelperTraceEvent);
+		header.EventCount				 = m_EventCount;
+		header.DurationNs				 = m_DurationNs;
+		fseek(m_File, 0, SEEK_SET);
+		fwrite(&header, sizeof(header), 1, m_File);
+		fclose(m_File);
+		m_File = nullptr;
+	}
+
+	bool IsOpen() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_File != nullptr;
+	}
+
+	uint64_t GetEventCount() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_EventCount;
+	}
+
+	// Id for a resource that has not been recorded yet
+	uint32_t NewId()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_NextId++;
+	}
+
+	// Append an event stamped with the current time, the time is taken under the lock so events from
+	// different threads stay sorted
+	void Record(uint8_t type, uint32_t id, uint8_t kind, uint64_t sizeBytes, int priority)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if(!m_File)
+			return;
+
+		EvictionHelperTraceEvent event = {};
+		event.TimeNs				   = EvictionHelper_GetTimestampNs() - m_StartNs;
+		event.SizeBytes				   = sizeBytes;
+		event.Id					   = id;
+		event.Type					   = type;
+		event.Kind					   = kind;
+		event.Priority				   = static_cast<uint8_t>(priority);
+		WriteLocked(event);
+	}
+
+	void Write(const EvictionHelperTraceEvent& event)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if(m_File)
+			WriteLocked(event);
+	}
+
+private:
+	void WriteLocked(const EvictionHelperTraceEvent& event)
+	{
+		fwrite(&event, sizeof(event), 1, m_File);
+		m_EventCount++;
+		m_DurationNs = std::max(m_DurationNs, event.TimeNs);
+	}
+
+	mutable std::mutex m_Mutex;
+	FILE*			   m_File		= nullptr;
+	uint64_t		   m_StartNs	= 0;
+	uint64_t		   m_EventCount = 0;
+	uint64_t		   m_DurationNs = 0;
+	uint32_t		   m_NextId		= 1;
+};
+
+// Device that forwards everything to another device and records its resource activity into a trace
+// It always knows the live resources, so a recording started late begins with an ALLOC for each of them and
+// replays into the same footprint. Several recording devices can share one writer.
+class EvictionHelperTraceRecordingDevice : public EvictionHelperDevice
+{
+public:
+	explicit EvictionHelperTraceRecordingDevice(EvictionHelperDevice* device)
+		: m_Device(device)
+	{
+	}
+
+	EvictionHelperDevice* GetDevice() const
+	{
+		return m_Device;
+	}
+
+	// Record into writer from now on, which must be open
+	void StartRecording(EvictionHelperTraceWriter* writer)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Writer = writer;
+		for(auto& entry : m_Resources)
+		{
+			LiveResource& resource = entry.second;
+			resource.Id			   = writer->NewId();
+			writer->Record(EVICTION_HELPER_TRACE_ALLOC, resource.Id, resource.Kind, resource.SizeBytes, resource.Priority);
+		}
+	}
+
+	void StopRecording()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Writer = nullptr;
+	}
+
+	EvictionHelperResource CreateResource(uint32_t kind, uint64_t sizeBytes, int priority) override
+	{
+		return CreateGroupedResource(kind, sizeBytes, priority, 0);
+	}
+
+	EvictionHelperResource CreateGroupedResource(uint32_t kind, uint64_t sizeBytes, int priority, uint64_t placementGroup) override
+	{
+		EvictionHelperResource handle = m_Device->CreateGroupedResource(kind, sizeBytes, priority, placementGroup);
+		if(!handle)
+			return 0;
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		LiveResource& resource = m_Resources[handle];
+		resource.SizeBytes	   = sizeBytes;
+		resource.Kind		   = static_cast<uint8_t>(kind);
+		resource.Priority	   = priority;
+		resource.Id			   = 0;
+		if(m_Writer)
+		{
+			resource.Id = m_Writer->NewId();
+			m_Writer->Record(EVICTION_HELPER_TRACE_ALLOC, resource.Id, resource.Kind, sizeBytes, priority);
+		}
+		return handle;
+	}
+
+	void DestroyResource(EvictionHelperResource handle) override
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			auto						it = m_Resources.find(handle);
+			if(it != m_Resources.end())
+			{
+				if(m_Writer && it->second.Id)
+					m_Writer->Record(EVICTION_HELPER_TRACE_FREE, it->second.Id, it->second.Kind, 0, it->second.Priority);
+				m_Resources.erase(it);
+			}
+		}
+		m_Device->DestroyResource(handle);
+	}
+
+	void SetResidencyPriority(EvictionHelperResource handle, int priority) override
+	{
+		SetResidencyPriorities(&handle, 1, priority);
+	}
+
+	void SetResidencyPriorities(const EvictionHelperResource* handles, uint32_t count, int priority) override
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			for(uint32_t i = 0; i < count; i++)
+			{
+				auto it = m_Resources.find(handles[i]);
+				if(it == m_Resources.end())
+					continue;
+
+				it->second.Priority = priority;
+				if(m_Writer && it->second.Id)
+					m_Writer->Record(EVICTION_HELPER_TRACE_SET_PRIORITY, it->second.Id, it->second.Kind, 0, priority);
+			}
+		}
+		m_Device->SetResidencyPriorities(handles, count, priority);
+	}
+
+	void SetPlacementHeapSize(uint64_t heapSizeBytes) override
+	{
+		m_Device->SetPlacementHeapSize(heapSizeBytes);
+	}
+
+	bool Evict(const EvictionHelperResource* handles, uint32_t count) override
+	{
+		return m_Device->Evict(handles, count);
+	}
+
+	bool MakeResident(const EvictionHelperResource* handles, uint32_t count) override
+	{
+		return m_Device->MakeResident(handles, count);
+	}
+
+	uint64_t EnqueueMakeResident(const EvictionHelperResource* handles, uint32_t count) override
+	{
+		return m_Device->EnqueueMakeResident(handles, count);
+	}
+
+	uint64_t GetCompletedResidencyFenceValue() override
+	{
+		return m_Device->GetCompletedResidencyFenceValue();
+	}
+
+	void BeginFrame(uint64_t frameIndex) override
+	{
+		m_Device->BeginFrame(frameIndex);
+	}
+
+	void TouchResource(EvictionHelperResource handle) override
+	{
+		m_Device->TouchResource(handle);
+	}
+
+	void TouchResourcePartial(EvictionHelperResource handle, float coverage) override
+	{
+		m_Device->TouchResourcePartial(handle, coverage);
+	}
+
+	void EndFrame() override
+	{
+		m_Device->EndFrame();
+	}
+
+	void WaitForIdle() override
+	{
+		m_Device->WaitForIdle();
+	}
+
+	uint64_t Signal() override
+	{
+		return m_Device->Signal();
+	}
+
+	uint64_t GetCompletedFenceValue() override
+	{
+		return m_Device->GetCompletedFenceValue();
+	}
+
+	void QueryMemoryInfo(EvictionHelperMemoryInfo* outLocal, EvictionHelperMemoryInfo* outNonLocal) override
+	{
+		m_Device->QueryMemoryInfo(outLocal, outNonLocal);
+	}
+
+	bool SupportsBudgetChangeNotifications() override
+	{
+		return m_Device->SupportsBudgetChangeNotifications();
+	}
+
+	bool WaitForBudgetChange(uint64_t timeoutNs) override
+	{
+		return m_Device->WaitForBudgetChange(timeoutNs);
+	}
+
+	void CancelBudgetChangeWait() override
+	{
+		m_Device->CancelBudgetChangeWait();
+	}
+
+private:
+	struct LiveResource
+	{
+		uint64_t SizeBytes;
+		uint8_t	 Kind;
+		int		 Priority;
+		uint32_t Id; // 0 if not recorded
+	};
+
+	EvictionHelperDevice* m_Device;
+
+	std::mutex												 m_Mutex;
+	std::unordered_map<EvictionHelperResource, LiveResource> m_Resources;
+	EvictionHelperTraceWriter*								 m_Writer = nullptr;
+};
+
+// Write events from another source into a trace file, sorted by time
+// Use this to convert allocation logs: an allocation with a free time becomes an ALLOC and a FREE event.
+inline bool EvictionHelperTrace_WriteFile(const char* path, std::vector<EvictionHelperTraceEvent> events)
+{
+	std::stable_sort(events.begin(), events.end(), [](const EvictionHelperTraceEvent& a, const EvictionHelperTraceEvent& b) { return a.TimeNs < b.TimeNs; });
+
+	EvictionHelperTraceWriter writer;
+	if(!writer.Open(path))
+		return false;
+	for(const EvictionHelperTraceEvent& event : events)
+	{
+		writer.Write(event);
+	}
+	writer.Close();
+	return true;
+}
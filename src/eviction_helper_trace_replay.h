@@ -0,0 +1,330 @@
+#pragma once
+
+#include "eviction_helper_device.h"
+#include "eviction_helper_shared.h"
+#include "eviction_helper_trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+// Events issued per step when replaying as fast as possible, so a frame without the replay thread stays short
+constexpr uint32_t TRACE_REPLAY_MAX_EVENTS_PER_STEP = 4096;
+
+// What to replay and how fast, set by the owner every frame
+struct EvictionHelperTraceReplayConfig
+{
+	std::string			  Path;
+	bool				  Playing;	  // Switching it on starts from the beginning, off releases all replayed resources
+	double				  Speed;	  // 1 = original speed, 2 = twice as fast, 0 = as fast as possible
+	EvictionHelperDevice* VRAMDevice; // Render targets and heaps
+	EvictionHelperDevice* HostDevice; // EVICTION_HELPER_RESOURCE_HOST_MEMORY
+};
+
+struct EvictionHelperTraceReplayStats
+{
+	uint32_t State; // EVICTION_HELPER_TRACE_STATE_*
+	uint32_t ResourceCount;
+	uint64_t EventCount;
+	uint64_t IssuedEventCount;
+	uint64_t SkippedEventCount; // Unknown resource kinds, ids that are not live or already live
+	uint64_t FailedAllocCount;
+	uint64_t AllocatedBytes;
+	uint64_t PositionNs; // Trace time reached
+	uint64_t DurationNs;
+	uint64_t DriftNs; // Of the last event
+	uint64_t MaxDriftNs;
+	uint64_t TotalDriftNs;
+	uint64_t AllocMaxNs;
+	uint64_t FreeMaxNs;
+	uint64_t AllocLatencyHistogram[EVICTION_HELPER_LATENCY_BUCKETS];
+	uint64_t FreeLatencyHistogram[EVICTION_HELPER_LATENCY_BUCKETS];
+	uint64_t DriftHistogram[EVICTION_HELPER_LATENCY_BUCKETS];
+};
+
+// Replays an allocation trace: creates, destroys and reprioritizes resources at the times the trace says
+// Each event is due once the replay clock, the time since the start scaled by Speed, reaches its TimeNs. Drift is
+// how much later than that it was issued, in real time: a slow device or a coarse frame shows up as drift, the
+// latency histograms show the cost of the calls themselves.
+// With Start() the events are issued on their own thread against the real time. Without it Advance() issues them on
+// the calling thread against the time passed in, which makes replays on the simulated device deterministic.
+// Replayed resources are never used by GPU work, so they are destroyed right away.
+class EvictionHelperTraceReplay
+{
+public:
+	EvictionHelperTraceReplay()
+	{
+		m_Config = {};
+		m_Stats	 = {};
+	}
+
+	~EvictionHelperTraceReplay()
+	{
+		Stop();
+	}
+
+	EvictionHelperTraceReplay(const EvictionHelperTraceReplay&)			   = delete;
+	EvictionHelperTraceReplay& operator=(const EvictionHelperTraceReplay&) = delete;
+
+	void Start()
+	{
+		m_StopRequested = false;
+		m_Thread		= std::thread(&EvictionHelperTraceReplay::Run, this);
+	}
+
+	// Stop the thread, the resources stay alive until Release()
+	void Stop()
+	{
+		if(!m_Thread.joinable())
+			return;
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_StopRequested = true;
+		}
+		m_WakeCondition.notify_one();
+		m_Thread.join();
+	}
+
+	bool IsRunning() const
+	{
+		return m_Thread.joinable();
+	}
+
+	// Any thread, takes effect with the next step
+	// Starting playback, or changing the path or the devices, restarts the replay with new counters. A start is
+	// counted here, so switching playback off and on again restarts even if no step ran in between.
+	void SetConfig(const EvictionHelperTraceReplayConfig& config)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if(config.Playing && !m_Config.Playing)
+		{
+			m_StartCount++;
+			m_Stats		  = {};
+			m_Stats.State = EVICTION_HELPER_TRACE_STATE_PLAYING;
+		}
+		m_Config = config;
+	}
+
+	// Any thread
+	void GetStats(EvictionHelperTraceReplayStats* outStats) const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		*outStats = m_Stats;
+	}
+
+	// Issue the events that are due after dtSeconds, only valid while the thread is not running
+	void Advance(double dtSeconds)
+	{
+		Step(dtSeconds, false);
+	}
+
+	// Destroy all replayed resources, only valid while the thread is not running
+	void Release()
+	{
+		for(auto& entry : m_Resources)
+		{
+			entry.second.Device->DestroyResource(entry.second.Handle);
+		}
+		m_Resources.clear();
+		m_AllocatedBytes = 0;
+	}
+
+private:
+	struct Resource
+	{
+		EvictionHelperResource Handle;
+		EvictionHelperDevice*  Device;
+		uint64_t			   SizeBytes;
+	};
+
+	void Run()
+	{
+		auto last = std::chrono::steady_clock::now();
+		while(true)
+		{
+			{
+				// As fast as possible only yields to Stop() between steps
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				bool						 busy = m_Config.Playing && m_Config.Speed <= 0.0 && m_Stats.State == EVICTION_HELPER_TRACE_STATE_PLAYING;
+				m_WakeCondition.wait_for(lock, std::chrono::milliseconds(busy ? 0 : 1), [this] { return m_StopRequested; });
+				if(m_StopRequested)
+					return;
+			}
+
+			auto now = std::chrono::steady_clock::now();
+			Step(std::chrono::duration<double>(now - last).count(), true);
+			last = now;
+		}
+	}
+
+	// With realTime the replay clock also moves by the time spent issuing the events of this step
+	void Step(double dtSeconds, bool realTime)
+	{
+		EvictionHelperTraceReplayConfig config;
+		uint64_t						startCount;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			config	   = m_Config;
+			startCount = m_StartCount;
+		}
+
+		if(config.Playing != m_Playing || startCount != m_SeenStartCount || config.Path != m_Path || config.VRAMDevice != m_VRAMDevice || config.HostDevice != m_HostDevice)
+		{
+			// Start over, either stopped or from the first event
+			Release();
+			m_Reader.Close();
+			m_Playing		 = config.Playing;
+			m_SeenStartCount = startCount;
+			m_Path			 = config.Path;
+			m_VRAMDevice	 = config.VRAMDevice;
+			m_HostDevice	 = config.HostDevice;
+			m_ClockNs		 = 0.0;
+
+			bool opened = m_Playing && m_VRAMDevice && m_HostDevice && m_Reader.Open(m_Path.c_str());
+
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Stats			   = {};
+			m_Stats.State	   = !m_Playing ? EVICTION_HELPER_TRACE_STATE_IDLE : (opened ? EVICTION_HELPER_TRACE_STATE_PLAYING : EVICTION_HELPER_TRACE_STATE_FAILED);
+			m_Stats.EventCount = m_Reader.GetEventCount();
+			m_Stats.DurationNs = m_Reader.GetDurationNs();
+		}
+		if(!m_Reader.IsOpen())
+			return;
+
+		bool asFastAsPossible = config.Speed <= 0.0;
+		m_ClockNs += dtSeconds * 1000000000.0 * config.Speed;
+
+		auto	 stepStart	 = std::chrono::steady_clock::now();
+		double	 stepClockNs = m_ClockNs;
+		uint32_t issued		 = 0;
+		while(const EvictionHelperTraceEvent* event = m_Reader.Peek())
+		{
+			if(asFastAsPossible)
+			{
+				if(issued == TRACE_REPLAY_MAX_EVENTS_PER_STEP)
+					break;
+				m_ClockNs = std::max(m_ClockNs, static_cast<double>(event->TimeNs));
+			}
+			else if(realTime)
+			{
+				m_ClockNs = stepClockNs + std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - stepStart).count() * config.Speed;
+			}
+			if(static_cast<double>(event->TimeNs) > m_ClockNs)
+				break;
+
+			uint64_t driftNs = asFastAsPossible ? 0 : static_cast<uint64_t>((m_ClockNs - static_cast<double>(event->TimeNs)) / config.Speed);
+			Issue(*m_Reader.Next(), driftNs);
+			issued++;
+		}
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stats.PositionNs = static_cast<uint64_t>(std::min(m_ClockNs, static_cast<double>(m_Reader.GetDurationNs())));
+		if(!m_Reader.Peek())
+			m_Stats.State = EVICTION_HELPER_TRACE_STATE_FINISHED;
+	}
+
+	void Issue(const EvictionHelperTraceEvent& event, uint64_t driftNs)
+	{
+		auto	 it		  = m_Resources.find(event.Id);
+		bool	 live	  = it != m_Resources.end();
+		bool	 skipped  = false;
+		bool	 failed	  = false;
+		uint64_t allocNs  = 0;
+		uint64_t freeNs	  = 0;
+		int		 priority = std::min<int>(event.Priority, EVICTION_HELPER_PRIORITY_MAXIMUM);
+		switch(event.Type)
+		{
+		case EVICTION_HELPER_TRACE_ALLOC:
+			if(live || event.Kind > EVICTION_HELPER_RESOURCE_BUFFER_HEAP || event.SizeBytes == 0)
+			{
+				skipped = true;
+			}
+			else
+			{
+				EvictionHelperDevice*  device	= (event.Kind == EVICTION_HELPER_RESOURCE_HOST_MEMORY) ? m_HostDevice : m_VRAMDevice;
+				auto				   start	= std::chrono::steady_clock::now();
+				EvictionHelperResource resource = device->CreateResource(event.Kind, event.SizeBytes, priority);
+				allocNs							= static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+				failed							= !resource;
+				if(resource)
+				{
+					m_Resources[event.Id] = { resource, device, event.SizeBytes };
+					m_AllocatedBytes += event.SizeBytes;
+				}
+			}
+			break;
+		case EVICTION_HELPER_TRACE_FREE:
+			if(!live)
+			{
+				skipped = true;
+			}
+			else
+			{
+				Resource resource = it->second;
+				m_Resources.erase(it);
+				m_AllocatedBytes -= resource.SizeBytes;
+				auto start = std::chrono::steady_clock::now();
+				resource.Device->DestroyResource(resource.Handle);
+				freeNs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+			}
+			break;
+		case EVICTION_HELPER_TRACE_SET_PRIORITY:
+			if(live)
+				it->second.Device->SetResidencyPriority(it->second.Handle, priority);
+			else
+				skipped = true;
+			break;
+		default:
+			skipped = true;
+			break;
+		}
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stats.IssuedEventCount++;
+		m_Stats.SkippedEventCount += skipped ? 1 : 0;
+		m_Stats.FailedAllocCount += failed ? 1 : 0;
+		m_Stats.AllocatedBytes = m_AllocatedBytes;
+		m_Stats.ResourceCount  = static_cast<uint32_t>(m_Resources.size());
+		m_Stats.DriftNs		   = driftNs;
+		m_Stats.MaxDriftNs	   = std::max(m_Stats.MaxDriftNs, driftNs);
+		m_Stats.TotalDriftNs += driftNs;
+		m_Stats.DriftHistogram[EvictionHelper_GetLatencyBucket(driftNs)]++;
+		if(event.Type == EVICTION_HELPER_TRACE_ALLOC && !skipped)
+		{
+			m_Stats.AllocMaxNs = std::max(m_Stats.AllocMaxNs, allocNs);
+			m_Stats.AllocLatencyHistogram[EvictionHelper_GetLatencyBucket(allocNs)]++;
+		}
+		else if(event.Type == EVICTION_HELPER_TRACE_FREE && !skipped)
+		{
+			m_Stats.FreeMaxNs = std::max(m_Stats.FreeMaxNs, freeNs);
+			m_Stats.FreeLatencyHistogram[EvictionHelper_GetLatencyBucket(freeNs)]++;
+		}
+	}
+
+	// Shared with the owner, guarded by m_Mutex
+	mutable std::mutex				m_Mutex;
+	std::condition_variable			m_WakeCondition;
+	EvictionHelperTraceReplayConfig m_Config;
+	EvictionHelperTraceReplayStats	m_Stats;
+	uint64_t						m_StartCount	= 0;
+	bool							m_StopRequested = false;
+
+	// Only used by the thread issuing the events
+	EvictionHelperTraceReader				m_Reader;
+	std::unordered_map<uint32_t, Resource>	m_Resources;
+	std::string								m_Path;
+	EvictionHelperDevice*					m_VRAMDevice	 = nullptr;
+	EvictionHelperDevice*					m_HostDevice	 = nullptr;
+	bool									m_Playing		 = false;
+	uint64_t								m_SeenStartCount = 0;
+	double									m_ClockNs		 = 0.0;
+	uint64_t								m_AllocatedBytes = 0;
+
+	std::thread m_Thread;
+};
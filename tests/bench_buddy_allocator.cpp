@@ -0,0 +1,80 @@
+// Allocation throughput of the buddy suballocator: fixed-size render targets filling a 64 GB heap range, and a mix of
+// sizes with random frees that keeps the tree fragmented
+// Run without arguments for the full measurement, --quick is the smoke test run by ctest.
+
+#include "test_common.h"
+
+#include "eviction_helper_buddy_allocator.h"
+
+#include <random>
+
+static const uint64_t KB = 1024ULL;
+static const uint64_t GB = 1024ULL * 1024ULL * 1024ULL;
+
+static void Report(const char* name, uint64_t operations, uint64_t elapsedNs)
+{
+	printf("%-40s %10.2f M operations/s, %7.1f ns each\n", name, operations * 1000.0 / elapsedNs, (double)elapsedNs / operations);
+}
+
+// Fill the whole range with one block size and free it again, every allocation walks the full depth of the tree
+static void BenchFill(uint64_t blockSize, int rounds)
+{
+	EvictionHelperBuddyAllocator allocator(64 * GB, 64 * KB);
+	std::vector<uint64_t>		 offsets(static_cast<size_t>(allocator.GetCapacity() / blockSize));
+
+	uint64_t startNs = EvictionHelper_GetTimestampNs();
+	for(int round = 0; round < rounds; round++)
+	{
+		for(uint64_t& offset : offsets)
+			CHECK(allocator.Allocate(blockSize, &offset));
+		for(uint64_t offset : offsets)
+			allocator.Free(offset);
+	}
+	uint64_t elapsedNs = EvictionHelper_GetTimestampNs() - startNs;
+	CHECK(allocator.IsEmpty());
+
+	char name[64];
+	snprintf(name, sizeof(name), "fill with %llu KB blocks", (unsigned long long)(blockSize / KB));
+	Report(name, 2ULL * rounds * offsets.size(), elapsedNs);
+}
+
+// Random sizes from 64 KB to 32 MB, allocating and freeing at random around half occupancy
+static void BenchMixed(int operations)
+{
+	EvictionHelperBuddyAllocator allocator(64 * GB, 64 * KB);
+	std::vector<uint64_t>		 live;
+	std::mt19937_64				 rng(7);
+
+	// Sizes and choices are drawn up front so the timed loop only measures the allocator
+	std::vector<uint64_t> sizes(static_cast<size_t>(operations));
+	for(uint64_t& size : sizes)
+		size = (64 * KB) << (rng() % 10);
+
+	uint64_t startNs = EvictionHelper_GetTimestampNs();
+	for(int i = 0; i < operations; i++)
+	{
+		if(live.empty() || allocator.GetUsedBytes() < allocator.GetCapacity() / 2)
+		{
+			uint64_t offset = 0;
+			if(allocator.Allocate(sizes[i], &offset))
+				live.push_back(offset);
+		}
+		else
+		{
+			size_t index = static_cast<size_t>(sizes[i] >> 16) % live.size();
+			allocator.Free(live[index]);
+			live[index] = live.back();
+			live.pop_back();
+		}
+	}
+	Report("mixed sizes, half full", static_cast<uint64_t>(operations), EvictionHelper_GetTimestampNs() - startNs);
+}
+
+int main(int argc, char** argv)
+{
+	bool quick = IsQuickRun(argc, argv);
+	BenchFill(16 * 1024 * KB, quick ? 2 : 200);
+	BenchFill(64 * KB, quick ? 1 : 10);
+	BenchMixed(quick ? 100000 : 10000000);
+	return TestResult();
+}
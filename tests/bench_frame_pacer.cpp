@@ -0,0 +1,85 @@
+// Pacing accuracy and CPU time of the frame pacer on Linux: absolute clock_nanosleep() waits with spin tails of 0, 200 us
+// and 1 ms, against the old loop that slept whole milliseconds and spun the remainder
+// Run without arguments for the full measurement, --quick is the smoke test run by ctest.
+
+#include "test_common.h"
+
+#include "eviction_helper_frame_pacer.h"
+
+#include <thread>
+
+static void Report(const char* name, std::vector<uint64_t>& latesNs, uint64_t cpuNs, uint64_t wallNs)
+{
+	printf("%-40s %5.2f%% of a core\n", name, 100.0 * cpuNs / wallNs);
+	PrintPercentilesUs("  late", latesNs);
+}
+
+static void BenchPacer(const char* name, uint32_t framesPerSecond, uint64_t spinTailNs, int frames)
+{
+	EvictionHelperFramePacer pacer;
+	pacer.SetFrameRate(framesPerSecond);
+	pacer.SetSpinTail(spinTailNs);
+
+	std::vector<uint64_t> latesNs;
+	uint64_t			  cpuNs	  = GetProcessCpuTimeNs();
+	uint64_t			  startNs = EvictionHelper_GetTimestampNs();
+	pacer.BeginFrame(startNs);
+	for(int i = 0; i < frames; i++)
+	{
+		uint64_t deadlineNs = pacer.GetNextFrameNs();
+		pacer.WaitUntil(deadlineNs, nullptr, 0);
+		uint64_t nowNs = EvictionHelper_GetTimestampNs();
+		latesNs.push_back(nowNs - deadlineNs);
+		pacer.BeginFrame(nowNs);
+	}
+	uint64_t wallNs = EvictionHelper_GetTimestampNs() - startNs;
+	cpuNs			= GetProcessCpuTimeNs() - cpuNs;
+
+	const EvictionHelperFramePacerStats& stats = pacer.GetStats();
+	CHECK(stats.FrameTimeP50Ns > 0);
+	printf("%s: frame time p50 %.2f us, p99 %.2f us, max %.2f us\n", name, stats.FrameTimeP50Ns / 1e3, stats.FrameTimeP99Ns / 1e3, stats.FrameTimeMaxNs / 1e3);
+	Report(name, latesNs, cpuNs, wallNs);
+}
+
+// The loop before the pacer: sleep the whole milliseconds left, then go around the loop until the deadline
+static void BenchMillisecondSleep(const char* name, uint32_t framesPerSecond, int frames)
+{
+	uint64_t intervalNs = 1000000000ULL / framesPerSecond;
+
+	std::vector<uint64_t> latesNs;
+	uint64_t			  cpuNs		 = GetProcessCpuTimeNs();
+	uint64_t			  startNs	 = EvictionHelper_GetTimestampNs();
+	uint64_t			  deadlineNs = startNs + intervalNs;
+	for(int i = 0; i < frames; i++)
+	{
+		uint64_t nowNs = EvictionHelper_GetTimestampNs();
+		while(nowNs < deadlineNs)
+		{
+			uint64_t sleepMs = (deadlineNs - nowNs) / 1000000ULL;
+			if(sleepMs)
+				std::this_thread::sleep_for(std::chrono::milliseconds(sleepMs));
+			nowNs = EvictionHelper_GetTimestampNs();
+		}
+		latesNs.push_back(nowNs - deadlineNs);
+		deadlineNs += intervalNs;
+	}
+	uint64_t wallNs = EvictionHelper_GetTimestampNs() - startNs;
+	cpuNs			= GetProcessCpuTimeNs() - cpuNs;
+	Report(name, latesNs, cpuNs, wallNs);
+}
+
+int main(int argc, char** argv)
+{
+	bool quick	 = IsQuickRun(argc, argv);
+	int	 seconds = quick ? 1 : 10;
+
+	BenchMillisecondSleep("30 FPS, millisecond sleep and spin", 30, 30 * seconds);
+	BenchPacer("30 FPS, sleep only", 30, 0, 30 * seconds);
+	BenchPacer("30 FPS, 200 us spin tail", 30, 200000, 30 * seconds);
+	BenchPacer("30 FPS, 1 ms spin tail", 30, 1000000, 30 * seconds);
+
+	BenchMillisecondSleep("240 FPS, millisecond sleep and spin", 240, 240 * seconds);
+	BenchPacer("240 FPS, sleep only", 240, 0, 240 * seconds);
+	BenchPacer("240 FPS, 200 us spin tail", 240, 200000, 240 * seconds);
+	return TestResult();
+}
@@ -0,0 +1,94 @@
+// Cost of the memory sampler: a single query of each provider, /proc/meminfo kept open versus opened for every query,
+// and the CPU time and lateness of the sampler thread at 100 Hz and 1 kHz
+// Run without arguments for the full measurement, --quick is the smoke test run by ctest.
+
+#include "test_common.h"
+
+#include "eviction_helper_memory_sampler.h"
+#include "eviction_helper_sim_device.h"
+
+#include <thread>
+
+static const uint64_t MB = 1024ULL * 1024ULL;
+
+static void BenchQuery(const char* name, EvictionHelperMemoryInfoProvider* provider, int iterations)
+{
+	std::vector<uint64_t> samples;
+	for(int i = 0; i < iterations; i++)
+	{
+		EvictionHelperMemoryInfo local;
+		EvictionHelperMemoryInfo nonLocal;
+		uint64_t				 startNs = EvictionHelper_GetTimestampNs();
+		provider->QueryMemoryInfo(&local, &nonLocal);
+		samples.push_back(EvictionHelper_GetTimestampNs() - startNs);
+	}
+	PrintPercentilesUs(name, samples);
+}
+
+// HostMemory_QuerySystemMemory() opens and closes /proc/meminfo every time
+static void BenchQuerySystemMemory(int iterations)
+{
+	std::vector<uint64_t> samples;
+	for(int i = 0; i < iterations; i++)
+	{
+		uint64_t totalBytes		= 0;
+		uint64_t availableBytes = 0;
+		uint64_t swapTotalBytes = 0;
+		uint64_t swapUsedBytes	= 0;
+		uint64_t startNs		= EvictionHelper_GetTimestampNs();
+		HostMemory_QuerySystemMemory(&totalBytes, &availableBytes, &swapTotalBytes, &swapUsedBytes);
+		samples.push_back(EvictionHelper_GetTimestampNs() - startNs);
+	}
+	PrintPercentilesUs("query, /proc/meminfo reopened", samples);
+}
+
+// Sampler thread on its own for a while, reports the share of a core it used and the lateness of its samples
+static void BenchSampler(const char* name, EvictionHelperMemoryInfoProvider* provider, uint32_t rateHz, uint32_t milliseconds)
+{
+	TestSharedMemory			sharedMem;
+	EvictionHelperMemorySampler sampler;
+
+	uint64_t cpuNs	 = GetProcessCpuTimeNs();
+	uint64_t startNs = EvictionHelper_GetTimestampNs();
+	sampler.Start(provider, sharedMem.Data(), rateHz);
+	std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+	sampler.Stop();
+	uint64_t wallNs = EvictionHelper_GetTimestampNs() - startNs;
+	cpuNs			= GetProcessCpuTimeNs() - cpuNs;
+
+	EvictionHelperMemorySamplerStats stats;
+	sampler.GetStats(&stats);
+	CHECK(stats.SampleCount > 0);
+
+	std::vector<EvictionHelperMemorySample> samples(EVICTION_HELPER_MEMORY_SAMPLE_RING_SIZE);
+	uint64_t								index	= 0;
+	uint64_t								dropped = 0;
+	uint32_t								count	= EvictionHelper_ReadMemorySamples(sharedMem.Data(), &index, samples.data(), EVICTION_HELPER_MEMORY_SAMPLE_RING_SIZE, &dropped);
+	std::vector<uint64_t>					latesNs;
+	for(uint32_t i = 0; i < count; i++)
+		latesNs.push_back(samples[i].LateNs);
+
+	printf("%-40s %8.1f Hz achieved, %5.2f%% of a core, mean query %.2f us\n", name, stats.SampleCount * 1e9 / wallNs, 100.0 * cpuNs / wallNs,
+		   stats.TotalQueryNs / 1000.0 / stats.SampleCount);
+	PrintPercentilesUs("  late", latesNs);
+}
+
+int main(int argc, char** argv)
+{
+	bool	 quick		  = IsQuickRun(argc, argv);
+	int		 iterations	  = quick ? 1000 : 100000;
+	uint32_t milliseconds = quick ? 200 : 5000;
+
+	EvictionHelperSimDevice				   device(8192 * MB, 16384 * MB);
+	EvictionHelperDeviceMemoryInfoProvider deviceProvider(&device);
+	EvictionHelperSystemMemoryInfoProvider systemProvider;
+
+	BenchQuery("query, simulated device", &deviceProvider, iterations);
+	BenchQuery("query, /proc/meminfo kept open", &systemProvider, iterations / 10);
+	BenchQuerySystemMemory(iterations / 10);
+
+	BenchSampler("simulated device at 100 Hz", &deviceProvider, 100, milliseconds);
+	BenchSampler("simulated device at 1 kHz", &deviceProvider, 1000, milliseconds);
+	BenchSampler("/proc/meminfo at 1 kHz", &systemProvider, 1000, milliseconds);
+	return TestResult();
+}
@@ -0,0 +1,115 @@
+// Round-trip latency between a controller and a helper process over the POSIX mapping, and first-touch cost of the
+// mapping flags. Run without arguments for the full measurement, --quick is the smoke test run by ctest.
+
+#include "test_common.h"
+
+#include <sched.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Time to write every page of a freshly created mapping, MAP_POPULATE moves the page faults into the create call
+static void BenchFirstTouch(const char* name, uint32_t flags, int iterations)
+{
+	std::vector<uint64_t> createNs;
+	std::vector<uint64_t> touchNs;
+	for(int i = 0; i < iterations; i++)
+	{
+		EvictionHelperSharedMemory sharedMem;
+		uint64_t				   start = EvictionHelper_GetTimestampNs();
+		if(!EvictionHelper_CreateSharedMemoryEx(&sharedMem, GetTestSharedMemoryName(), flags))
+		{
+			printf("%s: create failed\n", name);
+			g_TestFailures++;
+			return;
+		}
+		uint64_t created = EvictionHelper_GetTimestampNs();
+
+		volatile uint8_t* bytes	   = (volatile uint8_t*)sharedMem.pData;
+		size_t			  pageSize = (size_t)sysconf(_SC_PAGESIZE);
+		for(size_t offset = 0; offset < sizeof(EvictionHelperSharedData); offset += pageSize)
+			bytes[offset] = 1;
+		uint64_t touched = EvictionHelper_GetTimestampNs();
+
+		createNs.push_back(created - start);
+		touchNs.push_back(touched - created);
+		EvictionHelper_CloseSharedMemory(&sharedMem);
+	}
+
+	std::string label = std::string(name) + " create";
+	PrintPercentilesUs(label.c_str(), createNs);
+	label = std::string(name) + " first touch";
+	PrintPercentilesUs(label.c_str(), touchNs);
+}
+
+// The controller bumps WakeCounter, the helper answers by storing the same value to CompletedSequence.
+// With blocking set the helper sleeps in EvictionHelper_WaitForSignal() (futex) instead of polling.
+static void BenchRoundTrip(const char* name, bool blocking, int iterations)
+{
+	EvictionHelperSharedMemory controller;
+	if(!EvictionHelper_CreateSharedMemoryEx(&controller, GetTestSharedMemoryName(), EVICTION_HELPER_MAPPING_DEFAULT))
+	{
+		printf("%s: create failed\n", name);
+		g_TestFailures++;
+		return;
+	}
+
+	EvictionHelperSharedData* data = controller.pData;
+	pid_t					  pid  = fork();
+	if(pid == 0)
+	{
+		EvictionHelperSharedMemory helper;
+		if(!EvictionHelper_OpenSharedMemoryEx(&helper, GetTestSharedMemoryName(), EVICTION_HELPER_MAPPING_DEFAULT))
+			_exit(2);
+
+		uint32_t last = 0;
+		while(last < (uint32_t)iterations)
+		{
+			uint32_t counter = blocking ? EvictionHelper_WaitForSignal(&helper, last, 100000000ULL) : helper.pData->WakeCounter.load(std::memory_order_acquire);
+			if(counter == last)
+			{
+				sched_yield();
+				continue;
+			}
+			last = counter;
+			helper.pData->CommandRing.CompletedSequence.store(counter, std::memory_order_release);
+		}
+		EvictionHelper_CloseSharedMemory(&helper);
+		_exit(0);
+	}
+
+	std::vector<uint64_t> samples;
+	samples.reserve(iterations);
+	for(int i = 1; i <= iterations; i++)
+	{
+		uint64_t start = EvictionHelper_GetTimestampNs();
+		if(blocking)
+			EvictionHelper_SignalHelper(&controller);
+		else
+			data->WakeCounter.fetch_add(1, std::memory_order_release);
+
+		while(data->CommandRing.CompletedSequence.load(std::memory_order_acquire) < (uint64_t)i)
+			sched_yield();
+		samples.push_back(EvictionHelper_GetTimestampNs() - start);
+	}
+
+	int status = 0;
+	waitpid(pid, &status, 0);
+	CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	EvictionHelper_CloseSharedMemory(&controller);
+	PrintPercentilesUs(name, samples);
+}
+
+int main(int argc, char** argv)
+{
+	bool quick			= IsQuickRun(argc, argv);
+	int	 touchRuns		= quick ? 3 : 50;
+	int	 roundTripCount = quick ? 2000 : 200000;
+
+	BenchFirstTouch("default", EVICTION_HELPER_MAPPING_DEFAULT, touchRuns);
+	BenchFirstTouch("populate", EVICTION_HELPER_MAPPING_POPULATE, touchRuns);
+	BenchFirstTouch("huge pages + populate", EVICTION_HELPER_MAPPING_HUGE_PAGES | EVICTION_HELPER_MAPPING_POPULATE, touchRuns);
+
+	BenchRoundTrip("round trip, polling", false, roundTripCount);
+	BenchRoundTrip("round trip, futex wake", true, roundTripCount);
+	return TestResult();
+}
@@ -0,0 +1,133 @@
+// Latency from a controller write to the applied state in a helper process running EvictionHelper_RunService() on the
+// simulated device. Compares commands and signaled input writes with input writes that wait for the next frame.
+// Run without arguments for the full measurement, --quick is the smoke test run by ctest.
+
+#include "test_common.h"
+
+#include "eviction_helper_core.h"
+#include "eviction_helper_service.h"
+#include "eviction_helper_sim_device.h"
+
+#include <csignal>
+
+#include <sched.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Helper process, allocates on the frame thread so an applied target is visible as soon as it is published
+static int RunHelper()
+{
+	EvictionHelperSharedMemory sharedMem;
+	if(!EvictionHelper_CreateSharedMemoryEx(&sharedMem, GetTestSharedMemoryName(), EVICTION_HELPER_MAPPING_DEFAULT))
+		return 2;
+
+	EvictionHelperSimDevice	 device(8ULL << 30, 16ULL << 30);
+	EvictionHelperHostDevice hostDevice;
+	{
+		EvictionHelperCore core(&sharedMem, &device, &hostDevice, false);
+		core.InitializeDefaults();
+		__atomic_store_n(&sharedMem.pData->IsRunning, 1u, __ATOMIC_RELEASE);
+		EvictionHelper_RunService(&sharedMem, &core, nullptr);
+		core.Shutdown();
+	}
+
+	sharedMem.pData->IsRunning = 0;
+	EvictionHelper_CloseSharedMemory(&sharedMem);
+	return 0;
+}
+
+static bool WaitForAllocation(const EvictionHelperSharedData* data, uint64_t bytes, uint64_t timeoutNs)
+{
+	uint64_t deadline = EvictionHelper_GetTimestampNs() + timeoutNs;
+	while(__atomic_load_n(&data->CurrentUnusedVRAMAllocationBytes, __ATOMIC_ACQUIRE) != bytes)
+	{
+		if(EvictionHelper_GetTimestampNs() >= deadline)
+			return false;
+		sched_yield();
+	}
+	return true;
+}
+
+// Priority flips through the command ring, the helper completes them as soon as it wakes
+static void BenchCommand(EvictionHelperSharedMemory* controller, int iterations)
+{
+	std::vector<uint64_t> samples;
+	for(int i = 0; i < iterations; i++)
+	{
+		int		 priority = (i & 1) ? EVICTION_HELPER_PRIORITY_NORMAL : EVICTION_HELPER_PRIORITY_LOW;
+		uint64_t start	  = EvictionHelper_GetTimestampNs();
+		uint64_t sequence = EvictionHelper_PushCommand(controller->pData, EVICTION_HELPER_COMMAND_SET_PRIORITY, EVICTION_HELPER_POOL_UNUSED, priority, 0);
+		EvictionHelper_SignalHelper(controller);
+		bool completed = EvictionHelper_WaitForCommand(controller->pData, sequence, 1000);
+		CHECK(completed);
+		if(completed)
+			samples.push_back(EvictionHelper_GetTimestampNs() - start);
+	}
+	PrintPercentilesUs("command, signaled", samples);
+}
+
+// Unused pool target written directly, applied once the helper sees the write, measured until the allocation is published
+static void BenchInputWrite(EvictionHelperSharedMemory* controller, bool signal, int iterations)
+{
+	std::vector<uint64_t> samples;
+	for(int i = 0; i < iterations; i++)
+	{
+		int		 targetMB = (i & 1) ? 0 : 16;
+		uint64_t start	  = EvictionHelper_GetTimestampNs();
+		__atomic_store_n(&controller->pData->TargetUnusedVRAMUsageMB, targetMB, __ATOMIC_RELEASE);
+		if(signal)
+			EvictionHelper_SignalHelper(controller);
+		bool applied = WaitForAllocation(controller->pData, (uint64_t)targetMB << 20, 1000000000ULL);
+		CHECK(applied);
+		if(applied)
+			samples.push_back(EvictionHelper_GetTimestampNs() - start);
+	}
+	PrintPercentilesUs(signal ? "input write, signaled" : "input write, next frame", samples);
+}
+
+int main(int argc, char** argv)
+{
+	bool quick		 = IsQuickRun(argc, argv);
+	int	 iterations	 = quick ? 200 : 20000;
+	int	 frameWrites = quick ? 6 : 120;
+
+	// The helper process creates the mapping under the name of this process
+	GetTestSharedMemoryName();
+	pid_t pid = fork();
+	if(pid == 0)
+		_exit(RunHelper());
+
+	// The helper creates the mapping, wait until it is running
+	EvictionHelperSharedMemory controller = {};
+	uint64_t				   deadline	  = EvictionHelper_GetTimestampNs() + 10000000000ULL;
+	while(EvictionHelper_GetTimestampNs() < deadline)
+	{
+		if(controller.pData || EvictionHelper_OpenSharedMemoryEx(&controller, GetTestSharedMemoryName(), EVICTION_HELPER_MAPPING_DEFAULT))
+		{
+			if(__atomic_load_n(&controller.pData->IsRunning, __ATOMIC_ACQUIRE) == 1)
+				break;
+		}
+		usleep(1000);
+	}
+	CHECK(controller.pData && controller.pData->IsRunning == 1);
+
+	if(controller.pData)
+	{
+		BenchCommand(&controller, iterations);
+		BenchInputWrite(&controller, true, iterations / 10);
+		BenchInputWrite(&controller, false, frameWrites);
+
+		controller.pData->RequestShutdown = 1;
+		EvictionHelper_SignalHelper(&controller);
+	}
+	else
+	{
+		kill(pid, SIGKILL);
+	}
+
+	int status = 0;
+	waitpid(pid, &status, 0);
+	CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	EvictionHelper_CloseSharedMemory(&controller);
+	return TestResult();
+}
@@ -0,0 +1,149 @@
+// Buddy suballocator: block sizes and alignment, splitting and merging, exhaustion, and a randomized run against a
+// reference map that checks for overlaps and exact used-byte accounting
+
+#include "test_common.h"
+
+#include "eviction_helper_buddy_allocator.h"
+#include "eviction_helper_device.h"
+
+#include <iterator>
+#include <map>
+#include <random>
+
+static const uint64_t KB = 1024ULL;
+static const uint64_t MB = 1024ULL * 1024ULL;
+
+static void TestRounding()
+{
+	// Capacity rounds down, the minimum block size rounds up
+	EvictionHelperBuddyAllocator allocator(600 * MB, 48 * KB);
+	CHECK_EQ(allocator.GetCapacity(), 512 * MB);
+	CHECK_EQ(allocator.GetLargestFreeBlock(), 512 * MB);
+	CHECK_EQ(allocator.GetBlockSize(1), 64 * KB);
+	CHECK_EQ(allocator.GetBlockSize(64 * KB), 64 * KB);
+	CHECK_EQ(allocator.GetBlockSize(64 * KB + 1), 128 * KB);
+	CHECK_EQ(allocator.GetBlockSize(RT_SIZE), RT_SIZE);
+	CHECK(allocator.IsEmpty());
+
+	// Freeing in an empty allocator does nothing
+	allocator.Free(0);
+	CHECK(allocator.IsEmpty());
+}
+
+// Blocks are packed from the start and aligned to their size, freeing both buddies merges them again
+static void TestSplitAndMerge()
+{
+	EvictionHelperBuddyAllocator allocator(256 * MB, 64 * KB);
+
+	uint64_t small = 1;
+	uint64_t large = 1;
+	uint64_t next  = 1;
+	CHECK(allocator.Allocate(64 * KB, &small));
+	CHECK(allocator.Allocate(RT_SIZE, &large));
+	CHECK(allocator.Allocate(64 * KB, &next));
+	CHECK_EQ(small, 0u);
+	CHECK_EQ(large, RT_SIZE);
+	CHECK_EQ(next, 64 * KB);
+	CHECK_EQ(allocator.GetUsedBytes(), RT_SIZE + 128 * KB);
+	CHECK_EQ(allocator.GetLargestFreeBlock(), 128 * MB);
+
+	allocator.Free(small);
+	allocator.Free(next);
+	allocator.Free(large);
+	CHECK(allocator.IsEmpty());
+	CHECK_EQ(allocator.GetLargestFreeBlock(), 256 * MB);
+
+	// The whole heap is available as one block again
+	uint64_t whole = 1;
+	CHECK(allocator.Allocate(256 * MB, &whole));
+	CHECK_EQ(whole, 0u);
+	CHECK_EQ(allocator.GetLargestFreeBlock(), 0u);
+}
+
+static void TestExhaustion()
+{
+	EvictionHelperBuddyAllocator allocator(128 * MB, 64 * KB);
+
+	std::vector<uint64_t> offsets;
+	uint64_t			  offset = 0;
+	while(allocator.Allocate(RT_SIZE, &offset))
+		offsets.push_back(offset);
+	CHECK_EQ(offsets.size(), 8u);
+	CHECK(!allocator.Allocate(1, &offset));
+	CHECK(!allocator.Allocate(256 * MB, &offset));
+
+	// One hole fits one render target, not two
+	allocator.Free(offsets[3]);
+	CHECK(!allocator.Allocate(2 * RT_SIZE, &offset));
+	CHECK(allocator.Allocate(RT_SIZE, &offset));
+	CHECK_EQ(offset, offsets[3]);
+
+	CHECK_EQ(allocator.GetUsedBytes(), 128 * MB);
+}
+
+static void TestRandomized()
+{
+	EvictionHelperBuddyAllocator allocator(1024 * MB, 64 * KB);
+	std::map<uint64_t, uint64_t> live; // Offset to block size
+	std::mt19937_64				 rng(1);
+	int							 failedCount = 0;
+
+	for(int i = 0; i < 200000; i++)
+	{
+		if(live.empty() || (rng() & 1))
+		{
+			uint64_t size = (64 * KB) << (rng() % 10);
+			size -= rng() % (size / 2);
+
+			uint64_t offset = 0;
+			if(!allocator.Allocate(size, &offset))
+			{
+				failedCount++;
+				continue;
+			}
+
+			uint64_t blockSize = allocator.GetBlockSize(size);
+			CHECK_EQ(offset % blockSize, 0u);
+			CHECK(offset + blockSize <= allocator.GetCapacity());
+
+			auto next = live.lower_bound(offset);
+			CHECK(next == live.end() || next->first >= offset + blockSize);
+			if(next != live.begin())
+			{
+				auto prev = std::prev(next);
+				CHECK(prev->first + prev->second <= offset);
+			}
+			live[offset] = blockSize;
+		}
+		else
+		{
+			auto it = live.begin();
+			std::advance(it, rng() % live.size());
+			allocator.Free(it->first);
+			live.erase(it);
+		}
+
+		if(i % 1000 == 0)
+		{
+			uint64_t usedBytes = 0;
+			for(const auto& entry : live)
+				usedBytes += entry.second;
+			CHECK_EQ(allocator.GetUsedBytes(), usedBytes);
+		}
+	}
+	printf("%zu blocks live, %d allocations did not fit\n", live.size(), failedCount);
+
+	for(const auto& entry : live)
+		allocator.Free(entry.first);
+	CHECK(allocator.IsEmpty());
+	CHECK_EQ(allocator.GetLargestFreeBlock(), 1024 * MB);
+}
+
+int main()
+{
+	RUN_TEST(TestRounding);
+	RUN_TEST(TestSplitAndMerge);
+	RUN_TEST(TestExhaustion);
+	RUN_TEST(TestRandomized);
+	return TestResult();
+}
@@ -0,0 +1,155 @@
+// Closed-loop budget control: setpoints, the PI controller on an ideal plant, and convergence time and overshoot of
+// the core against the simulated device, including a budget cut while the loop is holding
+
+#include "test_common.h"
+
+#include "eviction_helper_core.h"
+#include "eviction_helper_sim_device.h"
+
+#include <cmath>
+
+#define FRAME_TIME_NS 33333333ULL
+
+static const uint64_t MB = 1024ULL * 1024ULL;
+
+static void RunFrame(EvictionHelperCore* core)
+{
+	core->ProcessCommands();
+	core->BeginFrame(FRAME_TIME_NS);
+	core->TouchActiveMemory();
+	core->EndFrame(FRAME_TIME_NS);
+}
+
+static void TestSetpoint()
+{
+	CHECK_EQ(BudgetController_ComputeSetpoint(EVICTION_HELPER_BUDGET_CONTROL_PERCENT, 95, 0, 1000 * MB), 950 * MB);
+	CHECK_EQ(BudgetController_ComputeSetpoint(EVICTION_HELPER_BUDGET_CONTROL_PERCENT, -5, 0, 1000 * MB), 0u);
+	CHECK_EQ(BudgetController_ComputeSetpoint(EVICTION_HELPER_BUDGET_CONTROL_HEADROOM, 0, 512, 4096 * MB), 3584 * MB);
+	CHECK_EQ(BudgetController_ComputeSetpoint(EVICTION_HELPER_BUDGET_CONTROL_HEADROOM, 0, 8192, 4096 * MB), 0u);
+	CHECK_EQ(BudgetController_ComputeSetpoint(EVICTION_HELPER_BUDGET_CONTROL_OFF, 95, 512, 4096 * MB), 0u);
+}
+
+// Plant that reaches the requested size within one frame, usage is the output plus a fixed offset from other processes
+static void TestIdealPlant()
+{
+	BudgetController controller;
+	controller.Reset(0.0);
+
+	const double dt		  = FRAME_TIME_NS / 1e9;
+	const double setpoint = 3000.0 * MB;
+	const double offset	  = 500.0 * MB;
+	double		 usage	  = offset;
+	double		 maxUsage = 0.0;
+	int			 settled  = -1;
+	for(int frame = 0; frame < 300; frame++)
+	{
+		usage	 = controller.Update(setpoint, usage, dt, 0.0, 8192.0 * MB) + offset;
+		maxUsage = std::max(maxUsage, usage);
+		if(settled < 0 && std::fabs(setpoint - usage) < BUDGET_CONTROL_DEFAULT_DEADBAND)
+			settled = frame;
+	}
+	printf("ideal plant: settled after %d frames, overshoot %.1f MB\n", settled, (maxUsage - setpoint) / MB);
+	CHECK(settled >= 0 && settled < 60);
+	CHECK(maxUsage - setpoint < 0.05 * setpoint);
+	CHECK(std::fabs(setpoint - usage) < BUDGET_CONTROL_DEFAULT_DEADBAND);
+}
+
+// Output pinned at the upper limit for a long time must come off it as soon as the error changes sign
+static void TestAntiWindup()
+{
+	BudgetController controller;
+	controller.Reset(0.0);
+
+	const double dt		= FRAME_TIME_NS / 1e9;
+	const double maxOut = 1000.0 * MB;
+	for(int frame = 0; frame < 1000; frame++)
+		controller.Update(4000.0 * MB, 0.0, dt, 0.0, maxOut);
+	CHECK_EQ(controller.GetOutputBytes(), maxOut);
+
+	// Measured usage now far above the setpoint, a wound-up integrator would hold the output at the limit
+	double output = controller.Update(100.0 * MB, 1000.0 * MB, dt, 0.0, maxOut);
+	CHECK(output < maxOut);
+}
+
+struct ControlRun
+{
+	int		FramesToSettle; // -1 if it did not settle
+	int64_t OvershootBytes; // Furthest usage went past the setpoint, in the direction opposite to the initial error
+};
+
+// Usage is quantized to render targets, so the loop counts as settled once it is within one render target of the deadband
+static const double SettleToleranceBytes = BUDGET_CONTROL_DEFAULT_DEADBAND + RT_SIZE;
+
+// Run the core until usage stays within the tolerance of the setpoint for a second
+static ControlRun RunUntilSettled(EvictionHelperCore* core, EvictionHelperSharedData* data, int maxFrames)
+{
+	ControlRun run			= { -1, 0 };
+	int		   stableCount	= 0;
+	int64_t	   initialError = 0;
+	for(int frame = 0; frame < maxFrames && stableCount < 30; frame++)
+	{
+		RunFrame(core);
+
+		int64_t error = data->BudgetControlErrorBytes;
+		if(frame == 0)
+			initialError = error;
+		run.OvershootBytes = std::max(run.OvershootBytes, initialError >= 0 ? -error : error);
+
+		bool settled = std::fabs((double)error) < SettleToleranceBytes;
+		if(!settled)
+			run.FramesToSettle = -1;
+		else if(run.FramesToSettle < 0)
+			run.FramesToSettle = frame;
+		stableCount = settled ? stableCount + 1 : 0;
+	}
+	return run;
+}
+
+static void TestSimulatedBudget()
+{
+	TestSharedMemory		 sharedMem;
+	EvictionHelperSimDevice	 device(4096 * MB, 8192 * MB);
+	EvictionHelperHostDevice hostDevice;
+	EvictionHelperCore		 core(sharedMem.Get(), &device, &hostDevice, false);
+	core.InitializeDefaults();
+
+	// Other memory in the segment the controller has to work around
+	EvictionHelperSharedData* data = sharedMem.Data();
+	data->TargetUnusedVRAMUsageMB  = 512;
+	data->BudgetControlMode		   = EVICTION_HELPER_BUDGET_CONTROL_PERCENT;
+	data->BudgetControlPercent	   = 90;
+	data->BudgetControlPool		   = EVICTION_HELPER_POOL_ACTIVE;
+
+	ControlRun start = RunUntilSettled(&core, data, 600);
+	printf("simulated budget: settled after %d frames, overshoot %lld MB\n", start.FramesToSettle, (long long)(start.OvershootBytes / (int64_t)MB));
+	CHECK(start.FramesToSettle >= 0 && start.FramesToSettle < 90);
+	CHECK(start.OvershootBytes < (int64_t)(5 * 4096 * MB / 100));
+	CHECK_EQ(data->BudgetControlSetpointBytes, 4096 * MB * 90 / 100);
+
+	// The OS cuts the budget, the loop has to give memory back without going far below the new setpoint
+	device.SetLocalBudget(3072 * MB);
+	ControlRun cut = RunUntilSettled(&core, data, 600);
+	printf("budget cut: settled after %d frames, overshoot %lld MB\n", cut.FramesToSettle, (long long)(cut.OvershootBytes / (int64_t)MB));
+	CHECK(cut.FramesToSettle >= 0 && cut.FramesToSettle < 90);
+	CHECK(cut.OvershootBytes < (int64_t)(5 * 3072 * MB / 100));
+	CHECK_EQ(data->BudgetControlSetpointBytes, 3072 * MB * 90 / 100);
+	CHECK(data->LocalCurrentUsage <= data->LocalBudget);
+
+	// Headroom mode on the same loop
+	data->BudgetControlMode		  = EVICTION_HELPER_BUDGET_CONTROL_HEADROOM;
+	data->BudgetControlHeadroomMB = 1024;
+	ControlRun headroom			  = RunUntilSettled(&core, data, 600);
+	CHECK(headroom.FramesToSettle >= 0);
+	CHECK_EQ(data->BudgetControlSetpointBytes, 2048 * MB);
+
+	core.Shutdown();
+}
+
+int main()
+{
+	RUN_TEST(TestSetpoint);
+	RUN_TEST(TestIdealPlant);
+	RUN_TEST(TestAntiWindup);
+	RUN_TEST(TestSimulatedBudget);
+	return TestResult();
+}
@@ -0,0 +1,193 @@
+// Budget watcher: the simulated device raising budget change notifications, the watcher waking, querying and recording
+// every change with its timestamp, controllers waiting on BudgetGeneration, and the per-frame poll on a device without
+// notifications
+
+#include "test_common.h"
+
+#include "eviction_helper_budget_watcher.h"
+#include "eviction_helper_core.h"
+#include "eviction_helper_sim_device.h"
+
+#include <thread>
+
+static const uint64_t MB = 1024ULL * 1024ULL;
+
+// Wait up to a second for BudgetGeneration to move past lastGeneration
+static uint32_t WaitForGeneration(const EvictionHelperSharedMemory* sharedMem, uint32_t lastGeneration)
+{
+	uint64_t deadlineNs = EvictionHelper_GetTimestampNs() + 1000000000ULL;
+	uint32_t generation = lastGeneration;
+	while(generation == lastGeneration && EvictionHelper_GetTimestampNs() < deadlineNs)
+		generation = EvictionHelper_WaitForBudgetChange(sharedMem, lastGeneration, deadlineNs - EvictionHelper_GetTimestampNs());
+	CHECK(generation != lastGeneration);
+	return generation;
+}
+
+static std::vector<EvictionHelperBudgetChange> ReadChanges(const EvictionHelperSharedData* data, uint64_t* inOutIndex)
+{
+	std::vector<EvictionHelperBudgetChange> changes(EVICTION_HELPER_BUDGET_CHANGE_RING_SIZE);
+	uint64_t								dropped = 0;
+	uint32_t								count	= EvictionHelper_ReadBudgetChanges(data, inOutIndex, changes.data(), EVICTION_HELPER_BUDGET_CHANGE_RING_SIZE, &dropped);
+	CHECK_EQ(dropped, 0u);
+	changes.resize(count);
+	return changes;
+}
+
+// A budget cut and its recovery, both recorded from notifications without a single frame in between
+static void TestNotifications()
+{
+	TestSharedMemory			sharedMem;
+	EvictionHelperSimDevice		device(8192 * MB, 16384 * MB);
+	EvictionHelperBudgetWatcher watcher;
+	EvictionHelperSharedData*	data = sharedMem.Data();
+	CHECK(watcher.Start(&device, sharedMem.Get()));
+	CHECK(watcher.IsRunning());
+
+	// The initial budget is published by Start()
+	uint64_t								index	= 0;
+	std::vector<EvictionHelperBudgetChange> changes = ReadChanges(data, &index);
+	CHECK_EQ(data->BudgetGeneration.load(), 1u);
+	CHECK_EQ(changes.size(), 1u);
+	CHECK_EQ(changes[0].Generation, 1u);
+	CHECK_EQ(changes[0].Source, (uint32_t)EVICTION_HELPER_BUDGET_SOURCE_POLL);
+	CHECK_EQ(changes[0].LocalBudget, 8192 * MB);
+	CHECK_EQ(changes[0].PreviousLocalBudget, 0u);
+
+	uint64_t cutNs = EvictionHelper_GetTimestampNs();
+	device.SetLocalBudget(3072 * MB);
+	uint32_t generation = WaitForGeneration(sharedMem.Get(), 1);
+	uint64_t cutWakeNs	= EvictionHelper_GetTimestampNs() - cutNs;
+	uint64_t recoverNs	= EvictionHelper_GetTimestampNs();
+	device.SetLocalBudget(8192 * MB);
+	generation = WaitForGeneration(sharedMem.Get(), generation);
+	printf("controller woke %.1f us after the cut, %.1f us after the recovery\n", cutWakeNs / 1e3, (EvictionHelper_GetTimestampNs() - recoverNs) / 1e3);
+	CHECK_EQ(generation, 3u);
+	CHECK(cutWakeNs < 100000000ULL);
+
+	changes = ReadChanges(data, &index);
+	CHECK_EQ(changes.size(), 2u);
+	CHECK_EQ(changes[0].Generation, 2u);
+	CHECK_EQ(changes[0].Source, (uint32_t)EVICTION_HELPER_BUDGET_SOURCE_NOTIFICATION);
+	CHECK_EQ(changes[0].LocalBudget, 3072 * MB);
+	CHECK_EQ(changes[0].PreviousLocalBudget, 8192 * MB);
+	CHECK_EQ(changes[0].NonLocalBudget, 16384 * MB);
+	CHECK(changes[0].TimestampNs >= cutNs && changes[0].TimestampNs < recoverNs);
+	CHECK_EQ(changes[1].Generation, 3u);
+	CHECK_EQ(changes[1].LocalBudget, 8192 * MB);
+	CHECK_EQ(changes[1].PreviousLocalBudget, 3072 * MB);
+	CHECK(changes[1].TimestampNs >= recoverNs);
+
+	// A notification that does not change the budget is counted but not published
+	device.RaiseBudgetChangeNotification();
+	EvictionHelperBudgetWatcherStats stats;
+	for(int i = 0; i < 1000; i++)
+	{
+		watcher.GetStats(&stats);
+		if(stats.NotificationCount == 3)
+			break;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	CHECK_EQ(stats.NotificationCount, 3u);
+	CHECK_EQ(stats.ChangeCount, 3u);
+	CHECK(stats.LatencyMaxNs > 0);
+	CHECK_EQ(data->BudgetGeneration.load(), 3u);
+
+	// Nobody waits past the timeout without a change
+	uint64_t startNs = EvictionHelper_GetTimestampNs();
+	CHECK_EQ(EvictionHelper_WaitForBudgetChange(sharedMem.Get(), 3, 20000000ULL), 3u);
+	CHECK(EvictionHelper_GetTimestampNs() - startNs < 500000000ULL);
+
+	startNs = EvictionHelper_GetTimestampNs();
+	watcher.Stop();
+	CHECK(!watcher.IsRunning());
+	CHECK(EvictionHelper_GetTimestampNs() - startNs < 100000000ULL);
+}
+
+// Every waiting controller wakes on the same change
+static void TestManyWaiters()
+{
+	TestSharedMemory			sharedMem;
+	EvictionHelperSimDevice		device(8192 * MB, 16384 * MB);
+	EvictionHelperBudgetWatcher watcher;
+	watcher.Start(&device, sharedMem.Get());
+
+	std::atomic<uint32_t>	 woken{ 0 };
+	std::vector<std::thread> waiters;
+	for(int i = 0; i < 4; i++)
+	{
+		waiters.emplace_back([&sharedMem, &woken] {
+			if(WaitForGeneration(sharedMem.Get(), 1) == 2)
+				woken++;
+		});
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	device.SetNonLocalBudget(4096 * MB);
+	for(std::thread& waiter : waiters)
+		waiter.join();
+	CHECK_EQ(woken.load(), 4u);
+
+	// Changes published back to back while nobody waits are all seen by the next wait
+	for(int i = 0; i < 8; i++)
+	{
+		uint32_t generation = sharedMem.Data()->BudgetGeneration.load();
+		device.SetNonLocalBudget((5000 + i) * MB);
+		CHECK_EQ(WaitForGeneration(sharedMem.Get(), generation), generation + 1);
+	}
+	CHECK_EQ(EvictionHelper_WaitForBudgetChange(sharedMem.Get(), 2, 1000000000ULL), 10u);
+}
+
+// The host device has no notifications, the core publishes changes from its per-frame query
+static void TestPollFallback()
+{
+	TestSharedMemory		 sharedMem;
+	EvictionHelperHostDevice vramDevice;
+	EvictionHelperHostDevice hostDevice;
+	EvictionHelperCore		 core(sharedMem.Get(), &vramDevice, &hostDevice, false);
+	core.InitializeDefaults();
+	EvictionHelperSharedData* data = sharedMem.Data();
+
+	core.BeginFrame(33000000);
+	core.EndFrame(33000000);
+	CHECK_EQ(data->BudgetWatcherState, (uint32_t)EVICTION_HELPER_BUDGET_WATCHER_POLLING);
+	CHECK(data->BudgetGeneration.load() >= 1u);
+	CHECK_EQ(data->BudgetNotificationCount, 0u);
+
+	uint64_t								index	= 0;
+	std::vector<EvictionHelperBudgetChange> changes = ReadChanges(data, &index);
+	CHECK(!changes.empty());
+	for(const EvictionHelperBudgetChange& change : changes)
+		CHECK_EQ(change.Source, (uint32_t)EVICTION_HELPER_BUDGET_SOURCE_POLL);
+	CHECK(changes.back().LocalBudget > 0);
+	core.Shutdown();
+}
+
+// On the simulated device the core runs the watcher thread and publishes its counters every frame
+static void TestCoreNotified()
+{
+	TestSharedMemory		 sharedMem;
+	EvictionHelperSimDevice	 device(8192 * MB, 16384 * MB);
+	EvictionHelperHostDevice hostDevice;
+	EvictionHelperCore		 core(sharedMem.Get(), &device, &hostDevice, false);
+	core.InitializeDefaults();
+	EvictionHelperSharedData* data = sharedMem.Data();
+
+	uint32_t generation = data->BudgetGeneration.load();
+	device.SetLocalBudget(2048 * MB);
+	generation = WaitForGeneration(sharedMem.Get(), generation);
+	core.BeginFrame(33000000);
+	core.EndFrame(33000000);
+	CHECK_EQ(data->BudgetWatcherState, (uint32_t)EVICTION_HELPER_BUDGET_WATCHER_NOTIFIED);
+	CHECK_EQ(data->BudgetNotificationCount, 1u);
+	CHECK(data->BudgetChangeLatencyMaxNs > 0);
+	CHECK_EQ(data->BudgetGeneration.load(), generation);
+	core.Shutdown();
+}
+
+int main()
+{
+	RUN_TEST(TestNotifications);
+	RUN_TEST(TestManyWaiters);
+	RUN_TEST(TestPollFallback);
+	RUN_TEST(TestCoreNotified);
+	return TestResult();
+}
@@ -0,0 +1,322 @@
+// Churn workload: histogram files, the size distributions, holding the total around the set point at the requested
+// rate, reproducible runs on the simulated device, the core publishing the counters for both backends, and the
+// churn thread against real host memory
+
+#include "test_common.h"
+
+#include "eviction_helper_churn.h"
+#include "eviction_helper_core.h"
+#include "eviction_helper_sim_device.h"
+
+#include <cstring>
+
+static const uint64_t KB = 1024ULL;
+static const uint64_t MB = 1024ULL * 1024ULL;
+
+#define FRAME_TIME_NS 16000000ULL
+
+static const char* HISTOGRAM_PATH = "test_churn_histogram.txt";
+
+static void WriteHistogram(const char* contents)
+{
+	FILE* file = fopen(HISTOGRAM_PATH, "w");
+	CHECK(file != nullptr);
+	fputs(contents, file);
+	fclose(file);
+}
+
+static EvictionHelperChurnConfig MakeConfig(EvictionHelperDevice* device, uint32_t distribution)
+{
+	EvictionHelperChurnConfig config = {};
+	config.Device					 = device;
+	config.Kind						 = EVICTION_HELPER_RESOURCE_HEAP;
+	config.Distribution				 = distribution;
+	config.OpsPerSecond				 = 2000.0;
+	config.TargetBytes				 = 1024 * MB;
+	config.MinSizeBytes				 = 64 * KB;
+	config.MaxSizeBytes				 = 64 * MB;
+	config.SizeAlignment			 = 64 * KB;
+	config.Seed						 = 7;
+	config.Priority					 = EVICTION_HELPER_PRIORITY_NORMAL;
+	return config;
+}
+
+static uint64_t SumHistogram(const uint64_t* histogram)
+{
+	uint64_t sum = 0;
+	for(uint32_t i = 0; i < EVICTION_HELPER_LATENCY_BUCKETS; i++)
+		sum += histogram[i];
+	return sum;
+}
+
+// Comments and malformed lines are skipped, sizes are in KB
+static void TestLoadHistogram()
+{
+	WriteHistogram("# size weight\n256 10\n4096 3\nbad\n-1 5\n65536 1\n");
+	std::vector<EvictionHelperChurnBin> bins;
+	CHECK(EvictionHelperChurn_LoadHistogram(HISTOGRAM_PATH, &bins));
+	CHECK_EQ(bins.size(), 3u);
+	CHECK_EQ(bins[0].SizeBytes, 256 * KB);
+	CHECK_EQ(bins[1].SizeBytes, 4096 * KB);
+	CHECK_EQ(bins[2].SizeBytes, 65536 * KB);
+	CHECK_EQ(bins[0].Weight, 10.0);
+
+	WriteHistogram("# nothing\n");
+	CHECK(!EvictionHelperChurn_LoadHistogram(HISTOGRAM_PATH, &bins));
+	CHECK(bins.empty());
+	remove(HISTOGRAM_PATH);
+	CHECK(!EvictionHelperChurn_LoadHistogram(HISTOGRAM_PATH, &bins));
+}
+
+// 60 seconds at 2000 ops/s on the frame clock: the total settles around the target and every operation is counted
+static void TestSetPoint()
+{
+	EvictionHelperSimDevice device(8192 * MB, 8192 * MB);
+	EvictionHelperChurn		churn;
+	churn.SetConfig(MakeConfig(&device, EVICTION_HELPER_CHURN_LOG_UNIFORM));
+
+	// Once settled the total stays within the control band around the target, plus one resource of the largest size
+	const uint64_t			 band = 1024 * MB / 10;
+	EvictionHelperChurnStats stats;
+	uint64_t				 minBytes = UINT64_MAX;
+	uint64_t				 maxBytes = 0;
+	for(int frame = 0; frame < 3750; frame++)
+	{
+		churn.Advance(FRAME_TIME_NS / 1e9);
+		churn.GetStats(&stats);
+		if(frame >= 1000)
+		{
+			minBytes = std::min(minBytes, stats.AllocatedBytes);
+			maxBytes = std::max(maxBytes, stats.AllocatedBytes);
+		}
+	}
+	printf("log-uniform: %llu to %llu MB around 1024 MB, %u resources, %llu allocs, %llu frees\n", (unsigned long long)(minBytes / MB), (unsigned long long)(maxBytes / MB),
+		   stats.ResourceCount, (unsigned long long)stats.AllocCount, (unsigned long long)stats.FreeCount);
+	CHECK(minBytes > 1024 * MB - band - 64 * MB);
+	CHECK(maxBytes < 1024 * MB + band + 64 * MB);
+
+	// 3750 frames of 16 ms are 60 s
+	uint64_t ops = stats.AllocCount + stats.FreeCount + stats.FailedAllocCount;
+	CHECK(ops >= 119999 && ops <= 120000);
+	CHECK_EQ(stats.FailedAllocCount, 0u);
+	CHECK_EQ(stats.AllocCount - stats.FreeCount, stats.ResourceCount);
+	CHECK_EQ(SumHistogram(stats.AllocLatencyHistogram), stats.AllocCount);
+	CHECK_EQ(SumHistogram(stats.FreeLatencyHistogram), stats.FreeCount);
+
+	EvictionHelperMemoryInfo local;
+	EvictionHelperMemoryInfo nonLocal;
+	device.QueryMemoryInfo(&local, &nonLocal);
+	CHECK_EQ(local.CurrentUsage + nonLocal.CurrentUsage, stats.AllocatedBytes);
+
+	// Stopping releases everything and clears the counters
+	EvictionHelperChurnConfig config = MakeConfig(&device, EVICTION_HELPER_CHURN_LOG_UNIFORM);
+	config.OpsPerSecond				 = 0.0;
+	churn.SetConfig(config);
+	churn.Advance(FRAME_TIME_NS / 1e9);
+	churn.GetStats(&stats);
+	CHECK_EQ(stats.AllocatedBytes, 0u);
+	CHECK_EQ(stats.AllocCount, 0u);
+	device.QueryMemoryInfo(&local, &nonLocal);
+	CHECK_EQ(local.CurrentUsage + nonLocal.CurrentUsage, 0u);
+}
+
+static EvictionHelperChurnStats RunSeed(uint32_t seed)
+{
+	EvictionHelperSimDevice	  device(8192 * MB, 8192 * MB);
+	EvictionHelperChurn		  churn;
+	EvictionHelperChurnConfig config = MakeConfig(&device, EVICTION_HELPER_CHURN_LOG_UNIFORM);
+	config.Seed						 = seed;
+	churn.SetConfig(config);
+	for(int frame = 0; frame < 500; frame++)
+		churn.Advance(FRAME_TIME_NS / 1e9);
+
+	EvictionHelperChurnStats stats;
+	churn.GetStats(&stats);
+	churn.Release();
+	return stats;
+}
+
+static void TestReproducible()
+{
+	EvictionHelperChurnStats first	= RunSeed(7);
+	EvictionHelperChurnStats second = RunSeed(7);
+	EvictionHelperChurnStats other	= RunSeed(8);
+	CHECK_EQ(first.AllocatedBytes, second.AllocatedBytes);
+	CHECK_EQ(first.AllocCount, second.AllocCount);
+	CHECK_EQ(first.FreeCount, second.FreeCount);
+	CHECK(first.AllocatedBytes != other.AllocatedBytes);
+}
+
+// Sizes stay within their mode, the histogram only produces its own sizes
+static void TestDistributions()
+{
+	EvictionHelperSimDevice	  device(8192 * MB, 8192 * MB);
+	EvictionHelperChurn		  churn;
+	EvictionHelperChurnStats  stats;
+	EvictionHelperChurnConfig config = MakeConfig(&device, EVICTION_HELPER_CHURN_BIMODAL);
+
+	// Only the small mode, at most twice the minimum
+	config.LargePercent = 0;
+	config.TargetBytes	= 64 * MB;
+	churn.SetConfig(config);
+	for(int frame = 0; frame < 200; frame++)
+		churn.Advance(FRAME_TIME_NS / 1e9);
+	churn.GetStats(&stats);
+	CHECK(stats.ResourceCount > 0);
+	CHECK(stats.AllocatedBytes >= stats.ResourceCount * 64 * KB);
+	CHECK(stats.AllocatedBytes <= stats.ResourceCount * 128 * KB);
+
+	// Only the large mode, at least half the maximum, a new seed restarts the counters
+	config.LargePercent = 100;
+	config.TargetBytes	= 1024 * MB;
+	config.Seed			= 8;
+	churn.SetConfig(config);
+	for(int frame = 0; frame < 200; frame++)
+		churn.Advance(FRAME_TIME_NS / 1e9);
+	churn.GetStats(&stats);
+	CHECK(stats.ResourceCount > 0);
+	CHECK(stats.AllocatedBytes >= stats.ResourceCount * 32 * MB);
+	CHECK(stats.AllocatedBytes <= stats.ResourceCount * 64 * MB);
+
+	// One bin of 320 KB, every resource has exactly that size
+	churn.SetHistogram({ { 320 * KB, 1.0 } });
+	config.Distribution = EVICTION_HELPER_CHURN_HISTOGRAM;
+	config.TargetBytes	= 64 * MB;
+	config.Seed			= 9;
+	churn.SetConfig(config);
+	for(int frame = 0; frame < 200; frame++)
+		churn.Advance(FRAME_TIME_NS / 1e9);
+	churn.GetStats(&stats);
+	CHECK(stats.ResourceCount > 0);
+	CHECK_EQ(stats.AllocatedBytes, stats.ResourceCount * 320 * KB);
+	churn.Release();
+}
+
+// The core drives churn from the shared memory inputs, first on the simulated device and then in host memory
+static void TestCoreChurn()
+{
+	TestSharedMemory		 sharedMem;
+	EvictionHelperSimDevice	 device(16384 * MB, 16384 * MB);
+	EvictionHelperHostDevice hostDevice;
+	EvictionHelperCore		 core(sharedMem.Get(), &device, &hostDevice, false);
+	core.InitializeDefaults();
+
+	EvictionHelperSharedData* data		= sharedMem.Data();
+	data->TargetVRAMUsageMB				= 0;
+	data->TargetUnusedVRAMUsageMB		= 0;
+	data->TargetHostMemoryUsageMB		= 0;
+	data->TargetUnusedHostMemoryUsageMB = 0;
+	data->ChurnOpsPerSecond				= 2000;
+	data->ChurnTargetMB					= 512;
+	data->ChurnSeed						= 7;
+
+	float achievedMin = 1e9f;
+	float achievedMax = 0.0f;
+	for(int frame = 0; frame < 600; frame++)
+	{
+		core.ProcessCommands();
+		core.BeginFrame(FRAME_TIME_NS);
+		core.TouchActiveMemory();
+		core.EndFrame(FRAME_TIME_NS);
+		if(frame > 0)
+		{
+			achievedMin = std::min(achievedMin, data->ChurnAchievedOpsPerSecond);
+			achievedMax = std::max(achievedMax, data->ChurnAchievedOpsPerSecond);
+		}
+	}
+	printf("render targets: %llu MB in %u, %.0f to %.0f ops/s, alloc max %.3f ms, free max %.3f ms\n", (unsigned long long)(data->ChurnAllocatedBytes / MB), data->ChurnResourceCount,
+		   achievedMin, achievedMax, data->ChurnAllocMaxNs / 1e6, data->ChurnFreeMaxNs / 1e6);
+
+	// 32 operations per 16 ms frame, fractions carry over to the next frame
+	CHECK(achievedMin >= 1990.0f && achievedMax <= 2070.0f);
+	CHECK(data->ChurnAllocatedBytes > 256 * MB && data->ChurnAllocatedBytes < 768 * MB);
+	CHECK_EQ(data->ChurnAllocatedBytes % (RT_WIDTH * 4), 0u);
+
+	// LocalCurrentUsage is published before the frame's churn operations, the device has the current total
+	EvictionHelperMemoryInfo local;
+	EvictionHelperMemoryInfo nonLocal;
+	device.QueryMemoryInfo(&local, &nonLocal);
+	CHECK_EQ(local.CurrentUsage + nonLocal.CurrentUsage, data->ChurnAllocatedBytes);
+	CHECK_EQ(SumHistogram(data->ChurnAllocLatencyHistogram), data->ChurnAllocCount);
+	CHECK_EQ(SumHistogram(data->ChurnFreeLatencyHistogram), data->ChurnFreeCount);
+
+	// Host memory with sizes from a histogram file, the render targets are released on the switch
+	WriteHistogram("# size weight\n256 10\n1024 3\n");
+	snprintf(data->ChurnHistogramPath, sizeof(data->ChurnHistogramPath), "%s", HISTOGRAM_PATH);
+	data->ChurnDistribution = EVICTION_HELPER_CHURN_HISTOGRAM;
+	data->ChurnKind			= EVICTION_HELPER_POOL_KIND_HOST_MEMORY;
+	data->ChurnTargetMB		= 32;
+	for(int frame = 0; frame < 200; frame++)
+	{
+		core.ProcessCommands();
+		core.BeginFrame(FRAME_TIME_NS);
+		core.TouchActiveMemory();
+		core.EndFrame(FRAME_TIME_NS);
+	}
+	CHECK_EQ(data->ChurnHistogramBinCount, 2u);
+	CHECK(data->ChurnResourceCount > 0);
+	CHECK(data->ChurnAllocatedBytes > 16 * MB && data->ChurnAllocatedBytes < 48 * MB);
+	CHECK_EQ(data->ChurnAllocatedBytes % (256 * KB), 0u);
+	CHECK_EQ(data->ChurnAllocCount - data->ChurnFreeCount, data->ChurnResourceCount);
+	device.QueryMemoryInfo(&local, &nonLocal);
+	CHECK_EQ(local.CurrentUsage + nonLocal.CurrentUsage, 0u);
+
+	data->ChurnOpsPerSecond = 0;
+	core.ProcessCommands();
+	core.BeginFrame(FRAME_TIME_NS);
+	core.TouchActiveMemory();
+	core.EndFrame(FRAME_TIME_NS);
+	CHECK_EQ(data->ChurnAllocatedBytes, 0u);
+	CHECK_EQ(data->ChurnResourceCount, 0u);
+	core.Shutdown();
+	remove(HISTOGRAM_PATH);
+}
+
+// The churn thread paced by the real time against host memory
+static void TestThreadHostMemory()
+{
+	EvictionHelperHostDevice  hostDevice;
+	EvictionHelperChurn		  churn;
+	EvictionHelperChurnConfig config = MakeConfig(&hostDevice, EVICTION_HELPER_CHURN_LOG_UNIFORM);
+	config.Kind						 = EVICTION_HELPER_RESOURCE_HOST_MEMORY;
+	config.TargetBytes				 = 64 * MB;
+	config.MaxSizeBytes				 = 1 * MB;
+	churn.SetConfig(config);
+
+	uint64_t startNs = EvictionHelper_GetTimestampNs();
+	churn.Start();
+	CHECK(churn.IsRunning());
+	std::this_thread::sleep_for(std::chrono::milliseconds(500));
+	churn.Stop();
+	double seconds = (EvictionHelper_GetTimestampNs() - startNs) / 1e9;
+
+	EvictionHelperChurnStats stats;
+	churn.GetStats(&stats);
+	uint64_t ops = stats.AllocCount + stats.FreeCount;
+	printf("host thread: %.0f ops/s, %llu MB in %u, alloc max %.3f ms, free max %.3f ms\n", ops / seconds, (unsigned long long)(stats.AllocatedBytes / MB), stats.ResourceCount,
+		   stats.AllocMaxNs / 1e6, stats.FreeMaxNs / 1e6);
+	CHECK(!churn.IsRunning());
+	CHECK_EQ(stats.FailedAllocCount, 0u);
+	CHECK(ops > 200 && ops <= (uint64_t)(2000 * seconds) + 1);
+	CHECK(stats.AllocatedBytes > 0 && stats.AllocatedBytes < 64 * MB + 8 * MB);
+	CHECK(stats.AllocMaxNs > 0);
+
+	// Resources outlive the thread until released
+	churn.GetStats(&stats);
+	CHECK(stats.ResourceCount > 0);
+	churn.Release();
+	churn.GetStats(&stats);
+	CHECK_EQ(stats.ResourceCount, 0u);
+	CHECK_EQ(stats.AllocatedBytes, 0u);
+}
+
+int main()
+{
+	RUN_TEST(TestLoadHistogram);
+	RUN_TEST(TestSetPoint);
+	RUN_TEST(TestReproducible);
+	RUN_TEST(TestDistributions);
+	RUN_TEST(TestCoreChurn);
+	RUN_TEST(TestThreadHostMemory);
+	return TestResult();
+}
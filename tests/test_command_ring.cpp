@@ -0,0 +1,227 @@
+// Command ring: ordering, full ring, wraparound, completion waits, a producer process on the POSIX mapping, and the
+// core applying every command of a fast sequence instead of only the last one
+
+#include "test_common.h"
+
+#include "eviction_helper_core.h"
+#include "eviction_helper_sim_device.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Simulated device that counts resource creations, to see intermediate targets that were applied
+class CountingSimDevice : public EvictionHelperSimDevice
+{
+public:
+	CountingSimDevice()
+		: EvictionHelperSimDevice(8ULL << 30, 16ULL << 30)
+	{
+	}
+
+	EvictionHelperResource CreateResource(uint32_t kind, uint64_t sizeBytes, int priority) override
+	{
+		m_CreateCount++;
+		return EvictionHelperSimDevice::CreateResource(kind, sizeBytes, priority);
+	}
+
+	uint64_t GetCreateCount() const { return m_CreateCount; }
+
+private:
+	std::atomic<uint64_t> m_CreateCount{ 0 };
+};
+
+static void TestOrder()
+{
+	TestSharedMemory sharedMem;
+	for(int i = 0; i < 10; i++)
+		CHECK_EQ(EvictionHelper_PushCommand(sharedMem.Data(), EVICTION_HELPER_COMMAND_SET_TARGET, i % 4, i * 100, 0), (uint64_t)i + 1);
+
+	EvictionHelperCommand command = {};
+	for(int i = 0; i < 10; i++)
+	{
+		CHECK(EvictionHelper_PeekCommand(sharedMem.Data(), &command));
+		CHECK_EQ(command.Sequence, (uint64_t)i + 1);
+		CHECK_EQ(command.Type, (uint32_t)EVICTION_HELPER_COMMAND_SET_TARGET);
+		CHECK_EQ(command.Target, (uint32_t)(i % 4));
+		CHECK_EQ(command.Value, (int64_t)i * 100);
+		CHECK(command.TimestampNs > 0);
+
+		// Peek does not consume
+		EvictionHelperCommand again = {};
+		CHECK(EvictionHelper_PeekCommand(sharedMem.Data(), &again));
+		CHECK_EQ(again.Sequence, command.Sequence);
+
+		CHECK(!EvictionHelper_IsCommandComplete(sharedMem.Data(), command.Sequence));
+		EvictionHelper_CompleteCommand(sharedMem.Data(), &command);
+		CHECK(EvictionHelper_IsCommandComplete(sharedMem.Data(), command.Sequence));
+	}
+	CHECK(!EvictionHelper_PeekCommand(sharedMem.Data(), &command));
+}
+
+static void TestFullRing()
+{
+	TestSharedMemory sharedMem;
+	for(uint64_t i = 0; i < EVICTION_HELPER_COMMAND_RING_SIZE; i++)
+		CHECK_EQ(EvictionHelper_PushCommand(sharedMem.Data(), EVICTION_HELPER_COMMAND_BARRIER, 0, 0, 0), i + 1);
+	CHECK_EQ(EvictionHelper_PushCommand(sharedMem.Data(), EVICTION_HELPER_COMMAND_BARRIER, 0, 0, 0), 0u);
+
+	// One completed command frees one slot
+	EvictionHelperCommand command = {};
+	CHECK(EvictionHelper_PeekCommand(sharedMem.Data(), &command));
+	EvictionHelper_CompleteCommand(sharedMem.Data(), &command);
+	CHECK_EQ(EvictionHelper_PushCommand(sharedMem.Data(), EVICTION_HELPER_COMMAND_BARRIER, 0, 0, 0), (uint64_t)EVICTION_HELPER_COMMAND_RING_SIZE + 1);
+	CHECK_EQ(EvictionHelper_PushCommand(sharedMem.Data(), EVICTION_HELPER_COMMAND_BARRIER, 0, 0, 0), 0u);
+}
+
+static void TestWraparound()
+{
+	TestSharedMemory	  sharedMem;
+	uint64_t			  expected = 1;
+	EvictionHelperCommand command  = {};
+	for(int round = 0; round < 20; round++)
+	{
+		// Batches that do not divide the ring size, so the indices wrap at every slot
+		for(int i = 0; i < 37; i++)
+			CHECK(EvictionHelper_PushCommand(sharedMem.Data(), EVICTION_HELPER_COMMAND_SET_PRIORITY, 0, (int64_t)(expected + i), 0) != 0);
+		while(EvictionHelper_PeekCommand(sharedMem.Data(), &command))
+		{
+			CHECK_EQ(command.Sequence, expected);
+			CHECK_EQ(command.Value, (int64_t)expected);
+			EvictionHelper_CompleteCommand(sharedMem.Data(), &command);
+			expected++;
+		}
+	}
+	CHECK_EQ(expected, 20u * 37u + 1u);
+}
+
+static void TestWaitForCommand()
+{
+	TestSharedMemory sharedMem;
+	uint64_t		 sequence = EvictionHelper_PushCommand(sharedMem.Data(), EVICTION_HELPER_COMMAND_BARRIER, 0, 0, 0);
+
+	uint64_t start = EvictionHelper_GetTimestampNs();
+	CHECK(!EvictionHelper_WaitForCommand(sharedMem.Data(), sequence, 5));
+	CHECK(EvictionHelper_GetTimestampNs() - start >= 5000000ULL);
+
+	EvictionHelperCommand command = {};
+	CHECK(EvictionHelper_PeekCommand(sharedMem.Data(), &command));
+	EvictionHelper_CompleteCommand(sharedMem.Data(), &command);
+	CHECK(EvictionHelper_WaitForCommand(sharedMem.Data(), sequence, 0));
+}
+
+// A controller process pushes far more commands than fit into the ring, the helper process side drains them
+static void TestProducerProcess()
+{
+	const int commandCount = 100000;
+
+	EvictionHelperSharedMemory helper;
+	CHECK(EvictionHelper_CreateSharedMemoryEx(&helper, GetTestSharedMemoryName(), EVICTION_HELPER_MAPPING_DEFAULT));
+	if(!helper.pData)
+		return;
+
+	pid_t pid = fork();
+	if(pid == 0)
+	{
+		EvictionHelperSharedMemory controller;
+		if(!EvictionHelper_OpenSharedMemoryEx(&controller, GetTestSharedMemoryName(), EVICTION_HELPER_MAPPING_DEFAULT))
+			_exit(2);
+		for(int i = 0; i < commandCount; i++)
+		{
+			while(EvictionHelper_PushCommand(controller.pData, EVICTION_HELPER_COMMAND_SET_TARGET, i & 3, i, 0) == 0)
+				sched_yield();
+		}
+		EvictionHelper_CloseSharedMemory(&controller);
+		_exit(0);
+	}
+
+	int					  received	 = 0;
+	int					  outOfOrder = 0;
+	EvictionHelperCommand command	 = {};
+	uint64_t			  deadline	 = EvictionHelper_GetTimestampNs() + 60000000000ULL;
+	while(received < commandCount && EvictionHelper_GetTimestampNs() < deadline)
+	{
+		if(!EvictionHelper_PeekCommand(helper.pData, &command))
+		{
+			sched_yield();
+			continue;
+		}
+		if(command.Sequence != (uint64_t)received + 1 || command.Value != received || command.Target != (uint32_t)(received & 3))
+			outOfOrder++;
+		EvictionHelper_CompleteCommand(helper.pData, &command);
+		received++;
+	}
+
+	int status = 0;
+	waitpid(pid, &status, 0);
+	CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	CHECK_EQ(received, commandCount);
+	CHECK_EQ(outOfOrder, 0);
+	CHECK_EQ(helper.pData->CommandRing.CompletedSequence.load(), (uint64_t)commandCount);
+	EvictionHelper_CloseSharedMemory(&helper);
+}
+
+// "Ramp to 512 MB, drop to 0" between two frames must still create the 512 MB, a polled target would only see 0
+static void TestCoreAppliesEveryCommand()
+{
+	TestSharedMemory		 sharedMem;
+	CountingSimDevice		 device;
+	EvictionHelperHostDevice hostDevice;
+	EvictionHelperCore		 core(sharedMem.Get(), &device, &hostDevice, false);
+	core.InitializeDefaults();
+
+	EvictionHelper_PushCommand(sharedMem.Data(), EVICTION_HELPER_COMMAND_SET_TARGET, EVICTION_HELPER_POOL_ACTIVE, 512, 0);
+	EvictionHelper_PushCommand(sharedMem.Data(), EVICTION_HELPER_COMMAND_SET_PRIORITY, EVICTION_HELPER_POOL_UNUSED, EVICTION_HELPER_PRIORITY_LOW, 0);
+	uint64_t last = EvictionHelper_PushCommand(sharedMem.Data(), EVICTION_HELPER_COMMAND_SET_TARGET, EVICTION_HELPER_POOL_ACTIVE, 0, 0);
+	core.ProcessCommands();
+
+	CHECK(EvictionHelper_IsCommandComplete(sharedMem.Data(), last));
+	CHECK_EQ(device.GetCreateCount(), 512ULL * 1024 * 1024 / RT_SIZE);
+	CHECK_EQ(sharedMem.Data()->TargetVRAMUsageMB, 0);
+	CHECK_EQ(sharedMem.Data()->UnusedVRAMPriority, EVICTION_HELPER_PRIORITY_LOW);
+	CHECK_EQ(sharedMem.Data()->CurrentVRAMAllocationBytes, 0u);
+
+	// A delayed command waits for its time, later commands queue behind it
+	uint64_t delayed = EvictionHelper_PushCommand(sharedMem.Data(), EVICTION_HELPER_COMMAND_SET_TARGET, EVICTION_HELPER_POOL_UNUSED, 64, EvictionHelper_GetTimestampNs() + 3600000000000ULL);
+	uint64_t after	 = EvictionHelper_PushCommand(sharedMem.Data(), EVICTION_HELPER_COMMAND_BARRIER, 0, 0, 0);
+	core.ProcessCommands();
+	CHECK(!EvictionHelper_IsCommandComplete(sharedMem.Data(), delayed));
+	CHECK(!EvictionHelper_IsCommandComplete(sharedMem.Data(), after));
+	CHECK_EQ(sharedMem.Data()->TargetUnusedVRAMUsageMB, 0);
+
+	core.Shutdown();
+}
+
+// Priorities outside EVICTION_HELPER_PRIORITY_MINIMUM..MAXIMUM complete without changing the pool
+static void TestInvalidPriority()
+{
+	TestSharedMemory		 sharedMem;
+	CountingSimDevice		 device;
+	EvictionHelperHostDevice hostDevice;
+	EvictionHelperCore		 core(sharedMem.Get(), &device, &hostDevice, false);
+	core.InitializeDefaults();
+
+	EvictionHelperSharedData* data = sharedMem.Data();
+	EvictionHelper_PushCommand(data, EVICTION_HELPER_COMMAND_SET_PRIORITY, EVICTION_HELPER_POOL_ACTIVE, EVICTION_HELPER_PRIORITY_HIGH, 0);
+	EvictionHelper_PushCommand(data, EVICTION_HELPER_COMMAND_SET_PRIORITY, EVICTION_HELPER_POOL_ACTIVE, EVICTION_HELPER_PRIORITY_MAXIMUM + 1, 0);
+	EvictionHelper_PushCommand(data, EVICTION_HELPER_COMMAND_SET_PRIORITY, EVICTION_HELPER_POOL_ACTIVE, -1, 0);
+	EvictionHelper_PushCommand(data, EVICTION_HELPER_COMMAND_SET_PRIORITY, EVICTION_HELPER_POOL_ACTIVE, 1LL << 32, 0);
+	uint64_t last = EvictionHelper_PushCommand(data, EVICTION_HELPER_COMMAND_SET_PRIORITY, EVICTION_HELPER_POOL_HOST_UNUSED, 100, 0);
+	core.ProcessCommands();
+
+	CHECK(EvictionHelper_IsCommandComplete(data, last));
+	CHECK_EQ(data->ActiveVRAMPriority, EVICTION_HELPER_PRIORITY_HIGH);
+	CHECK(data->UnusedHostMemoryPriority >= EVICTION_HELPER_PRIORITY_MINIMUM && data->UnusedHostMemoryPriority <= EVICTION_HELPER_PRIORITY_MAXIMUM);
+	core.Shutdown();
+}
+
+int main()
+{
+	RUN_TEST(TestOrder);
+	RUN_TEST(TestFullRing);
+	RUN_TEST(TestWraparound);
+	RUN_TEST(TestWaitForCommand);
+	RUN_TEST(TestProducerProcess);
+	RUN_TEST(TestCoreAppliesEveryCommand);
+	RUN_TEST(TestInvalidPriority);
+	return TestResult();
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+// Minimal test harness shared by the tests and benchmarks, every file is its own executable run by ctest
+
+#include "eviction_helper_shared.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+static int g_TestFailures = 0;
+
+#define CHECK(expr)                                                                  \
+	do                                                                               \
+	{                                                                                \
+		if(!(expr))                                                                  \
+		{                                                                            \
+			fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #expr); \
+			g_TestFailures++;                                                        \
+		}                                                                            \
+	} while(0)
+
+#define CHECK_EQ(a, b)                                                                                                         \
+	do                                                                                                                         \
+	{                                                                                                                          \
+		auto checkA = (a);                                                                                                     \
+		auto checkB = (b);                                                                                                     \
+		if(!(checkA == checkB))                                                                                                \
+		{                                                                                                                      \
+			std::ostringstream checkStream;                                                                                    \
+			checkStream << checkA << " != " << checkB;                                                                         \
+			fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %s\n", __FILE__, __LINE__, #a, #b, checkStream.str().c_str()); \
+			g_TestFailures++;                                                                                                  \
+		}                                                                                                                      \
+	} while(0)
+
+#define RUN_TEST(fn) RunTest(#fn, fn)
+
+inline void RunTest(const char* name, void (*fn)())
+{
+	int failuresBefore = g_TestFailures;
+	printf("[ RUN  ] %s\n", name);
+	fflush(stdout);
+	fn();
+	printf("%s %s\n", g_TestFailures == failuresBefore ? "[   OK ]" : "[ FAIL ]", name);
+	fflush(stdout);
+}
+
+// Exit code for main()
+inline int TestResult()
+{
+	if(g_TestFailures)
+		printf("%d check(s) failed\n", g_TestFailures);
+	return g_TestFailures ? 1 : 0;
+}
+
+// Benchmarks run a short smoke version under ctest
+inline bool IsQuickRun(int argc, char** argv)
+{
+	for(int i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "--quick") == 0)
+			return true;
+	}
+	return false;
+}
+
+// Zeroed EvictionHelperSharedData on the heap, for tests that do not need a second process
+// Nothing is mapped, so this never collides with a helper running on the same machine.
+class TestSharedMemory
+{
+public:
+	TestSharedMemory()
+	{
+		m_Data = new(std::align_val_t(alignof(EvictionHelperSharedData))) EvictionHelperSharedData;
+		memset((void*)m_Data, 0, sizeof(EvictionHelperSharedData));
+		memset(&m_SharedMem, 0, sizeof(m_SharedMem));
+		m_SharedMem.pData = m_Data;
+	}
+
+	~TestSharedMemory()
+	{
+		::operator delete(m_Data, std::align_val_t(alignof(EvictionHelperSharedData)));
+	}
+
+	TestSharedMemory(const TestSharedMemory&)			 = delete;
+	TestSharedMemory& operator=(const TestSharedMemory&) = delete;
+
+	EvictionHelperSharedMemory* Get() { return &m_SharedMem; }
+	EvictionHelperSharedData*	Data() { return m_Data; }
+
+private:
+	EvictionHelperSharedData*  m_Data;
+	EvictionHelperSharedMemory m_SharedMem;
+};
+
+// Name of the mapping for tests that share it with a second process, unique per test process so these tests run in
+// parallel and next to a helper on the same machine. Call it before fork() so the child uses the name of the parent.
+inline const char* GetTestSharedMemoryName()
+{
+	static char name[64];
+	if(!name[0])
+		snprintf(name, sizeof(name), "/EvictionHelperTest.%d", (int)getpid());
+	return name;
+}
+
+// Process CPU time (user + system) in nanoseconds
+inline uint64_t GetProcessCpuTimeNs()
+{
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return ((uint64_t)usage.ru_utime.tv_sec + (uint64_t)usage.ru_stime.tv_sec) * 1000000000ULL + ((uint64_t)usage.ru_utime.tv_usec + (uint64_t)usage.ru_stime.tv_usec) * 1000ULL;
+}
+
+// Print p50/p99/max of a set of samples in microseconds, sorts the samples
+inline void PrintPercentilesUs(const char* name, std::vector<uint64_t>& samplesNs)
+{
+	if(samplesNs.empty())
+	{
+		printf("%-40s no samples\n", name);
+		return;
+	}
+	std::sort(samplesNs.begin(), samplesNs.end());
+	size_t count = samplesNs.size();
+	printf("%-40s n=%-8zu p50 %10.2f us  p99 %10.2f us  max %10.2f us\n", name, count, samplesNs[count / 2] / 1000.0, samplesNs[std::min(count - 1, count * 99 / 100)] / 1000.0,
+		   samplesNs[count - 1] / 1000.0);
+}
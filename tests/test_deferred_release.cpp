@@ -0,0 +1,232 @@
+// Deferred release queue against a mock fence: nothing is destroyed while a frame that used it is in flight, and the
+// bytes retired per frame follow the budget. Ends with the core shrinking a pool on the simulated device.
+
+#include "test_common.h"
+
+#include "eviction_helper_core.h"
+#include "eviction_helper_deferred_release.h"
+#include "eviction_helper_sim_device.h"
+
+#include <map>
+
+static const uint64_t MB = 1024ULL * 1024ULL;
+
+// Device whose fence only completes when the test says so
+// Every resource remembers the fence of the last frame that touched it, destroying it before that fence completed is
+// counted as a violation.
+class MockFenceDevice : public EvictionHelperDevice
+{
+public:
+	EvictionHelperResource CreateResource(uint32_t, uint64_t, int) override
+	{
+		EvictionHelperResource resource = ++m_LastHandle;
+		m_LastUsedFence[resource]		= 0;
+		return resource;
+	}
+
+	void DestroyResource(EvictionHelperResource resource) override
+	{
+		if(m_LastUsedFence[resource] > m_CompletedFence)
+			m_Violations++;
+		m_LastUsedFence.erase(resource);
+		m_DestroyCount++;
+	}
+
+	void SetResidencyPriority(EvictionHelperResource, int) override {}
+	void BeginFrame(uint64_t) override {}
+	void EndFrame() override {}
+
+	// Used by the frame that the next Signal() ends
+	void TouchResource(EvictionHelperResource resource) override
+	{
+		m_LastUsedFence[resource] = m_SignaledFence + 1;
+	}
+
+	void WaitForIdle() override
+	{
+		m_CompletedFence = m_SignaledFence;
+	}
+
+	uint64_t Signal() override
+	{
+		return ++m_SignaledFence;
+	}
+
+	uint64_t GetCompletedFenceValue() override
+	{
+		return m_CompletedFence;
+	}
+
+	void QueryMemoryInfo(EvictionHelperMemoryInfo* outLocal, EvictionHelperMemoryInfo* outNonLocal) override
+	{
+		*outLocal	 = {};
+		*outNonLocal = {};
+	}
+
+	void Complete(uint64_t fenceValue)
+	{
+		m_CompletedFence = fenceValue;
+	}
+
+	uint64_t GetDestroyCount() const
+	{
+		return m_DestroyCount;
+	}
+
+	uint64_t GetViolationCount() const
+	{
+		return m_Violations;
+	}
+
+private:
+	std::map<EvictionHelperResource, uint64_t> m_LastUsedFence;
+	EvictionHelperResource					   m_LastHandle		= 0;
+	uint64_t								   m_SignaledFence	= 0;
+	uint64_t								   m_CompletedFence = 0;
+	uint64_t								   m_DestroyCount	= 0;
+	uint64_t								   m_Violations		= 0;
+};
+
+// Resources released after frames 1 and 2 wait for exactly those frames, in release order
+static void TestWaitsForFence()
+{
+	MockFenceDevice					   device;
+	EvictionHelperAllocationWorker	   worker;
+	EvictionHelperDeferredReleaseQueue queue(&device);
+
+	std::vector<EvictionHelperResource> resources;
+	for(int i = 0; i < 8; i++)
+		resources.push_back(device.CreateResource(EVICTION_HELPER_RESOURCE_RENDER_TARGET, RT_SIZE, EVICTION_HELPER_PRIORITY_NORMAL));
+
+	// Frame 1 uses everything, half of it is released after it was submitted
+	for(EvictionHelperResource resource : resources)
+		device.TouchResource(resource);
+	queue.SignalFrame();
+	for(int i = 0; i < 4; i++)
+		queue.Push(resources[i], RT_SIZE);
+
+	// Frame 2 uses the rest, which is released after it
+	for(int i = 4; i < 8; i++)
+		device.TouchResource(resources[i]);
+	queue.SignalFrame();
+	for(int i = 4; i < 8; i++)
+		queue.Push(resources[i], RT_SIZE);
+	CHECK_EQ(queue.GetPendingBytes(), 8 * RT_SIZE);
+
+	CHECK_EQ(queue.Retire(&worker, 0), 0u);
+	worker.ExecutePending();
+	CHECK_EQ(device.GetDestroyCount(), 0u);
+
+	device.Complete(1);
+	CHECK_EQ(queue.Retire(&worker, 0), 4 * RT_SIZE);
+	worker.ExecutePending();
+	CHECK_EQ(device.GetDestroyCount(), 4u);
+	CHECK_EQ(queue.GetPendingBytes(), 4 * RT_SIZE);
+
+	device.Complete(2);
+	CHECK_EQ(queue.Retire(&worker, 0), 4 * RT_SIZE);
+	worker.ExecutePending();
+	CHECK_EQ(device.GetDestroyCount(), 8u);
+	CHECK(queue.IsEmpty());
+	CHECK_EQ(device.GetViolationCount(), 0u);
+}
+
+// 1 GB of completed releases with a 64 MB budget takes 16 frames of exactly 64 MB
+static void TestBudgetThroughput()
+{
+	MockFenceDevice					   device;
+	EvictionHelperAllocationWorker	   worker;
+	EvictionHelperDeferredReleaseQueue queue(&device);
+
+	queue.SignalFrame();
+	for(int i = 0; i < 64; i++)
+		queue.Push(device.CreateResource(EVICTION_HELPER_RESOURCE_RENDER_TARGET, RT_SIZE, EVICTION_HELPER_PRIORITY_NORMAL), RT_SIZE);
+	device.Complete(1);
+
+	int frames = 0;
+	while(!queue.IsEmpty() && frames < 100)
+	{
+		CHECK_EQ(queue.Retire(&worker, 64 * MB), 64 * MB);
+		worker.ExecutePending();
+		frames++;
+		CHECK_EQ(device.GetDestroyCount(), (uint64_t)frames * 4);
+	}
+	CHECK_EQ(frames, 16);
+
+	// A resource larger than the budget still goes, one per frame
+	queue.Push(device.CreateResource(EVICTION_HELPER_RESOURCE_HEAP, 512 * MB, EVICTION_HELPER_PRIORITY_NORMAL), 512 * MB);
+	queue.Push(device.CreateResource(EVICTION_HELPER_RESOURCE_HEAP, 512 * MB, EVICTION_HELPER_PRIORITY_NORMAL), 512 * MB);
+	CHECK_EQ(queue.Retire(&worker, 64 * MB), 512 * MB);
+	CHECK_EQ(queue.Retire(&worker, 64 * MB), 512 * MB);
+	worker.ExecutePending();
+	CHECK(queue.IsEmpty());
+	CHECK_EQ(device.GetViolationCount(), 0u);
+}
+
+// Flush() drains the device first, so it never destroys a referenced resource either
+static void TestFlush()
+{
+	MockFenceDevice					   device;
+	EvictionHelperDeferredReleaseQueue queue(&device);
+
+	EvictionHelperResource resource = device.CreateResource(EVICTION_HELPER_RESOURCE_RENDER_TARGET, RT_SIZE, EVICTION_HELPER_PRIORITY_NORMAL);
+	device.TouchResource(resource);
+	queue.SignalFrame();
+	queue.Push(resource, RT_SIZE);
+	queue.Flush();
+	CHECK_EQ(device.GetDestroyCount(), 1u);
+	CHECK_EQ(device.GetViolationCount(), 0u);
+	CHECK_EQ(queue.GetPendingBytes(), 0u);
+}
+
+// A 1 GB shrink of the active pool with two frames in flight: 128 MB per frame, and no destroy of a resource in flight
+static void TestCoreShrink()
+{
+	TestSharedMemory		 sharedMem;
+	EvictionHelperSimDevice	 device(4096 * MB, 4096 * MB);
+	EvictionHelperHostDevice hostDevice;
+	EvictionHelperCore		 core(sharedMem.Get(), &device, &hostDevice, false);
+	device.SetFrameLatency(2);
+	core.InitializeDefaults();
+
+	EvictionHelperSharedData* data = sharedMem.Data();
+	data->TargetVRAMUsageMB		   = 1024;
+	data->ReleaseBudgetMBPerFrame  = 128;
+	for(int frame = 0; frame < 4; frame++)
+	{
+		core.ProcessCommands();
+		core.BeginFrame(33333333ULL);
+		core.TouchActiveMemory();
+		core.EndFrame(33333333ULL);
+	}
+	CHECK_EQ(data->CurrentVRAMAllocationBytes, 1024 * MB);
+
+	data->TargetVRAMUsageMB = 0;
+	int		 frames			= 0;
+	uint64_t releasedBytes	= 0;
+	do
+	{
+		core.ProcessCommands();
+		core.BeginFrame(33333333ULL);
+		core.TouchActiveMemory();
+		core.EndFrame(33333333ULL);
+		CHECK(data->ReleasedBytesLastFrame <= 128 * MB);
+		releasedBytes += data->ReleasedBytesLastFrame;
+		frames++;
+	} while(data->ReleasePendingBytes > 0 && frames < 100);
+	printf("1024 MB released in %d frames\n", frames);
+
+	CHECK_EQ(releasedBytes, 1024 * MB);
+	CHECK(frames >= 8 && frames <= 8 + 3);
+	CHECK_EQ(device.GetInFlightDestroyCount(), 0u);
+	core.Shutdown();
+}
+
+int main()
+{
+	RUN_TEST(TestWaitsForFence);
+	RUN_TEST(TestBudgetThroughput);
+	RUN_TEST(TestFlush);
+	RUN_TEST(TestCoreShrink);
+	return TestResult();
+}
@@ -0,0 +1,167 @@
+// Frame pacer: the absolute timeline and frame time statistics on synthetic timestamps, real waits that never end early
+// with and without a spin tail, a signal ending a wait early, and the stats published to shared memory
+
+#include "test_common.h"
+
+#include "eviction_helper_frame_pacer.h"
+
+#include <thread>
+
+static const uint64_t MS = 1000000ULL;
+
+// 100 FPS on made up timestamps, nothing waits
+static void TestTimeline()
+{
+	EvictionHelperFramePacer pacer;
+	pacer.SetFrameRate(100);
+	CHECK_EQ(pacer.GetIntervalNs(), 10 * MS);
+	CHECK_EQ(pacer.GetNextFrameNs(), 0u);
+
+	uint64_t startNs = 1000 * MS;
+	CHECK_EQ(pacer.BeginFrame(startNs), 10 * MS);
+	CHECK_EQ(pacer.GetNextFrameNs(), startNs + 10 * MS);
+	CHECK(!pacer.IsFrameDue(startNs + 9 * MS));
+	CHECK(pacer.IsFrameDue(startNs + 10 * MS));
+
+	// A frame 4 ms late does not push back the next one
+	CHECK_EQ(pacer.BeginFrame(startNs + 14 * MS), 14 * MS);
+	CHECK_EQ(pacer.GetNextFrameNs(), startNs + 20 * MS);
+	CHECK_EQ(pacer.GetStats().LateMaxNs, 4 * MS);
+
+	// Missing a whole frame starts a new timeline instead of catching up back to back
+	CHECK_EQ(pacer.BeginFrame(startNs + 45 * MS), 31 * MS);
+	CHECK_EQ(pacer.GetNextFrameNs(), startNs + 55 * MS);
+	CHECK_EQ(pacer.GetStats().LateMaxNs, 25 * MS);
+
+	// A rate change counts from the last frame start, 0 is the default rate
+	pacer.SetFrameRate(50);
+	CHECK_EQ(pacer.GetNextFrameNs(), startNs + 65 * MS);
+	pacer.SetFrameRate(0);
+	CHECK_EQ(pacer.GetIntervalNs(), 1000000000ULL / FRAME_PACER_DEFAULT_FRAME_RATE);
+
+	// The percentiles only cover the last FRAME_PACER_WINDOW frames, the histogram covers all of them
+	pacer.SetFrameRate(100);
+	CHECK_EQ(pacer.GetNextFrameNs(), startNs + 55 * MS);
+	uint64_t nowNs = startNs + 45 * MS;
+	for(uint32_t i = 0; i < FRAME_PACER_WINDOW; i++)
+	{
+		nowNs += 10 * MS;
+		pacer.BeginFrame(nowNs);
+	}
+	const EvictionHelperFramePacerStats& stats = pacer.GetStats();
+	CHECK_EQ(stats.FrameTimeP50Ns, 10 * MS);
+	CHECK_EQ(stats.FrameTimeP99Ns, 10 * MS);
+	CHECK_EQ(stats.FrameTimeMaxNs, 10 * MS);
+	CHECK_EQ(stats.LateMaxNs, 0u);
+	uint64_t frames = 0;
+	for(uint32_t i = 0; i < EVICTION_HELPER_LATENCY_BUCKETS; i++)
+		frames += stats.FrameTimeHistogram[i];
+	CHECK_EQ(frames, FRAME_PACER_WINDOW + 3);
+	CHECK(stats.FrameTimeHistogram[EvictionHelper_GetLatencyBucket(10 * MS)] >= FRAME_PACER_WINDOW + 1);
+}
+
+// Run frames at 100 FPS with real waits, returns the frame times
+static std::vector<uint64_t> RunFrames(EvictionHelperFramePacer* pacer, int frames)
+{
+	std::vector<uint64_t> frameTimesNs;
+	pacer->BeginFrame(EvictionHelper_GetTimestampNs());
+	for(int i = 0; i < frames; i++)
+	{
+		CHECK(pacer->WaitUntil(pacer->GetNextFrameNs(), nullptr, 0));
+		uint64_t nowNs = EvictionHelper_GetTimestampNs();
+		CHECK(pacer->IsFrameDue(nowNs));
+		frameTimesNs.push_back(pacer->BeginFrame(nowNs));
+	}
+	return frameTimesNs;
+}
+
+// Real waits never end before their deadline, so 20 frames at 100 FPS take at least 200 ms, and a spin tail longer
+// than the interval never sleeps. How close the frames come to their deadlines depends on the scheduler and is
+// measured by bench_frame_pacer.
+static void TestWaitReachesDeadline()
+{
+	EvictionHelperFramePacer sleeper;
+	sleeper.SetFrameRate(100);
+	uint64_t			  startNs		= EvictionHelper_GetTimestampNs();
+	std::vector<uint64_t> sleepFramesNs = RunFrames(&sleeper, 20);
+	PrintPercentilesUs("frame time, sleep only", sleepFramesNs);
+	CHECK(EvictionHelper_GetTimestampNs() - startNs >= 200 * MS);
+	CHECK(sleeper.GetStats().SleepNs > 0);
+
+	EvictionHelperFramePacer spinner;
+	spinner.SetFrameRate(100);
+	spinner.SetSpinTail(20 * MS);
+	startNs							   = EvictionHelper_GetTimestampNs();
+	std::vector<uint64_t> spinFramesNs = RunFrames(&spinner, 5);
+	PrintPercentilesUs("frame time, spin only", spinFramesNs);
+	CHECK(EvictionHelper_GetTimestampNs() - startNs >= 50 * MS);
+	CHECK_EQ(spinner.GetStats().SleepNs, 0u);
+	CHECK(spinner.GetStats().SpinNs > 0);
+}
+
+// A signal ends a one second wait once the wake counter changes, WaitUntil() returning false shows the wait ended before
+// its deadline. How soon after the signal it ends is measured by bench_wake_latency.
+static void TestSignalEndsWait()
+{
+	TestSharedMemory		 sharedMem;
+	EvictionHelperFramePacer pacer;
+	pacer.SetSpinTail(200000);
+
+	// A signal before the wait ends it right away
+	uint32_t wakeCounter = sharedMem.Data()->WakeCounter.load();
+	EvictionHelper_SignalHelper(sharedMem.Get());
+	uint64_t startNs = EvictionHelper_GetTimestampNs();
+	CHECK(!pacer.WaitUntil(startNs + 1000 * MS, sharedMem.Get(), wakeCounter));
+
+	// The signal comes at least 20 ms after startNs, the wait cannot end before it
+	wakeCounter = sharedMem.Data()->WakeCounter.load();
+	startNs		= EvictionHelper_GetTimestampNs();
+	std::thread signaler([&sharedMem] {
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		EvictionHelper_SignalHelper(sharedMem.Get());
+	});
+	CHECK(!pacer.WaitUntil(startNs + 1000 * MS, sharedMem.Get(), wakeCounter));
+	uint64_t waitNs = EvictionHelper_GetTimestampNs() - startNs;
+	signaler.join();
+	printf("signal after 20 ms ended the wait after %.3f ms\n", waitNs / 1e6);
+	CHECK(waitNs >= 20 * MS);
+
+	// Without a signal the wait reaches its deadline
+	wakeCounter = sharedMem.Data()->WakeCounter.load();
+	startNs		= EvictionHelper_GetTimestampNs();
+	CHECK(pacer.WaitUntil(startNs + 20 * MS, sharedMem.Get(), wakeCounter));
+	CHECK(EvictionHelper_GetTimestampNs() >= startNs + 20 * MS);
+}
+
+static void TestUpdate()
+{
+	TestSharedMemory		  sharedMem;
+	EvictionHelperSharedData* data = sharedMem.Data();
+	data->FrameRate				   = 200;
+	data->FrameSpinTailUs		   = 300;
+
+	EvictionHelperFramePacer pacer;
+	pacer.Update(data);
+	CHECK_EQ(pacer.GetIntervalNs(), 5 * MS);
+	pacer.BeginFrame(100 * MS);
+	pacer.BeginFrame(105 * MS);
+	pacer.BeginFrame(112 * MS);
+	pacer.Update(data);
+	CHECK_EQ(data->FrameTimePercentile50Ns, 5 * MS);
+	CHECK_EQ(data->FrameTimeMaxNs, 7 * MS);
+	CHECK_EQ(data->FrameLateMaxNs, 2 * MS);
+
+	uint64_t frames = 0;
+	for(uint32_t i = 0; i < EVICTION_HELPER_LATENCY_BUCKETS; i++)
+		frames += data->FrameTimeHistogram[i];
+	CHECK_EQ(frames, 3u);
+}
+
+int main()
+{
+	RUN_TEST(TestTimeline);
+	RUN_TEST(TestWaitReachesDeadline);
+	RUN_TEST(TestSignalEndsWait);
+	RUN_TEST(TestUpdate);
+	return TestResult();
+}
@@ -0,0 +1,179 @@
+// Heap table: the first-fit fragmentation model on its own, and the core creating, resizing and releasing heaps of
+// mixed sizes on the simulated device with the report published to shared memory
+
+#include "test_common.h"
+
+#include "eviction_helper_core.h"
+#include "eviction_helper_fragmentation.h"
+#include "eviction_helper_sim_device.h"
+
+#include <cmath>
+
+static const uint64_t MB = 1024ULL * 1024ULL;
+
+#define CREATION_LATENCY_NS 200000ULL
+
+static void TestFragmentationModel()
+{
+	EvictionHelperFragmentationModel model;
+	uint64_t						 a = model.Allocate(16 * MB);
+	uint64_t						 b = model.Allocate(32 * MB);
+	uint64_t						 c = model.Allocate(64 * MB);
+	uint64_t						 d = model.Allocate(16 * MB);
+	CHECK_EQ(a, 0u);
+	CHECK_EQ(b, 16 * MB);
+	CHECK_EQ(c, 48 * MB);
+	CHECK_EQ(d, 112 * MB);
+	CHECK_EQ(model.GetSpanBytes(), 128 * MB);
+
+	// Two separate holes
+	model.Free(a, 16 * MB);
+	model.Free(c, 64 * MB);
+	CHECK_EQ(model.GetFreeBytes(), 80 * MB);
+	CHECK_EQ(model.GetFreeBlockCount(), 2u);
+	CHECK_EQ(model.GetLargestFreeBlock(), 64 * MB);
+	CHECK(std::fabs(model.GetFragmentation() - 0.2) < 1e-9);
+
+	// First fit takes the first hole that is large enough and leaves the rest of it
+	CHECK_EQ(model.Allocate(8 * MB), a);
+	CHECK_EQ(model.Allocate(24 * MB), c);
+	CHECK_EQ(model.GetFreeBytes(), 48 * MB);
+
+	// Freeing the neighbours merges the holes, a hole at the end shrinks the span
+	model.Free(b, 32 * MB);
+	CHECK_EQ(model.GetLargestFreeBlock(), 40 * MB);
+	model.Free(d, 16 * MB);
+	CHECK_EQ(model.GetSpanBytes(), 72 * MB);
+	CHECK_EQ(model.GetBlockCount(), 2u);
+	CHECK_EQ(model.GetAllocatedBytes(), 32 * MB);
+	CHECK_EQ(model.GetFreeBytes(), 40 * MB);
+
+	model.Free(a, 8 * MB);
+	model.Free(c, 24 * MB);
+	CHECK_EQ(model.GetSpanBytes(), 0u);
+	CHECK_EQ(model.GetFreeBytes(), 0u);
+	CHECK_EQ(model.GetFragmentation(), 0.0);
+}
+
+// Run frames until a barrier pushed now completes, returns the number of frames
+static int RunUntilBarrier(EvictionHelperCore* core, EvictionHelperSharedData* data)
+{
+	uint64_t barrier = EvictionHelper_PushCommand(data, EVICTION_HELPER_COMMAND_BARRIER, 0, 0, 0);
+	int		 frames	 = 0;
+	while(!EvictionHelper_IsCommandComplete(data, barrier) && frames < 1000)
+	{
+		core->ProcessCommands();
+		core->BeginFrame(16000000);
+		core->TouchActiveMemory();
+		core->EndFrame(16000000);
+		frames++;
+	}
+	CHECK(EvictionHelper_IsCommandComplete(data, barrier));
+	return frames;
+}
+
+static void TestHeapTable()
+{
+	TestSharedMemory		 sharedMem;
+	EvictionHelperSimDevice	 device(16384 * MB, 16384 * MB);
+	EvictionHelperHostDevice hostDevice;
+	EvictionHelperCore		 core(sharedMem.Get(), &device, &hostDevice, false);
+	device.SetCreationLatency(CREATION_LATENCY_NS);
+	core.InitializeDefaults();
+
+	// 64 heaps of 16, 32, 64 and 128 MB, alternating between buffer and render target heaps
+	EvictionHelperSharedData* data = sharedMem.Data();
+	for(uint32_t i = 0; i < 64; i++)
+	{
+		data->Heaps[i].SizeMB	= 16u << (i % 4);
+		data->Heaps[i].Type		= (i & 1) ? EVICTION_HELPER_HEAP_TYPE_BUFFERS : EVICTION_HELPER_HEAP_TYPE_RT_DS;
+		data->Heaps[i].Priority = static_cast<int>(i % 5);
+	}
+	data->HeapCount = 64;
+	RunUntilBarrier(&core, data);
+
+	const EvictionHelperHeapFragmentation& report = data->HeapFragmentation;
+	CHECK_EQ(data->HeapTableAllocatedBytes, 3840 * MB);
+	CHECK_EQ(data->HeapTablePendingBytes, 0u);
+	CHECK(data->HeapTableMaxCreationNs >= CREATION_LATENCY_NS);
+	CHECK_EQ(data->LocalCurrentUsage, 3840 * MB);
+	CHECK_EQ(report.HeapCount, 64u);
+	CHECK_EQ(report.FreeBytes, 0u);
+	CHECK_EQ(report.SpanBytes, 3840 * MB);
+	for(uint32_t i = 0; i < 64; i++)
+	{
+		CHECK_EQ(data->Heaps[i].AllocatedBytes, (16ULL << (i % 4)) * MB);
+		CHECK(data->Heaps[i].CreationNs >= CREATION_LATENCY_NS);
+		CHECK_EQ(data->Heaps[i].OutOfMemory, 0u);
+	}
+	CHECK_EQ(data->Heaps[5].ModelOffset, 256 * MB);
+
+	// Releasing every other heap leaves 16 MB and 64 MB holes between the rest
+	for(uint32_t i = 0; i < 64; i += 2)
+		data->Heaps[i].SizeMB = 0;
+	RunUntilBarrier(&core, data);
+	printf("every other heap released: %u holes, %llu MB free, largest %llu MB, %.1f%% fragmented\n", report.FreeBlockCount, (unsigned long long)(report.FreeBytes / MB),
+		   (unsigned long long)(report.LargestFreeBlock / MB), report.FragmentationPercent);
+	CHECK_EQ(data->HeapTableAllocatedBytes, 2560 * MB);
+	CHECK_EQ(report.HeapCount, 32u);
+	CHECK_EQ(report.FreeBlockCount, 32u);
+	CHECK_EQ(report.FreeBytes, 1280 * MB);
+	CHECK_EQ(report.LargestFreeBlock, 64 * MB);
+	CHECK(std::fabs(report.FragmentationPercent - 95.0f) < 0.01f);
+	CHECK_EQ(data->LocalCurrentUsage, 2560 * MB);
+
+	// A new heap reuses the first hole, a resized heap moves, and a command appends a heap beyond HeapCount
+	EvictionHelper_PushCommand(data, EVICTION_HELPER_COMMAND_ALLOCATE_HEAP, EVICTION_HELPER_HEAP_TABLE(0), 16, 0);
+	EvictionHelper_PushCommand(data, EVICTION_HELPER_COMMAND_ALLOCATE_HEAP, EVICTION_HELPER_HEAP_TABLE(100), 1024, 0);
+	data->Heaps[1].SizeMB = 17;
+	RunUntilBarrier(&core, data);
+	CHECK_EQ(data->HeapCount, 101u);
+	CHECK_EQ(data->Heaps[0].ModelOffset, 0u);
+	CHECK_EQ(data->Heaps[1].AllocatedBytes, 17 * MB);
+	CHECK_EQ(data->Heaps[100].ModelOffset, 3840 * MB);
+	CHECK_EQ(data->HeapTableAllocatedBytes, (2560 - 32 + 17 + 16 + 1024) * MB);
+
+	data->HeapCount = 0;
+	RunUntilBarrier(&core, data);
+	CHECK_EQ(data->HeapTableAllocatedBytes, 0u);
+	CHECK_EQ(report.HeapCount, 0u);
+	CHECK_EQ(report.SpanBytes, 0u);
+	CHECK_EQ(data->HeapTableMaxCreationNs, 0u);
+	core.Shutdown();
+
+	EvictionHelperMemoryInfo local;
+	EvictionHelperMemoryInfo nonLocal;
+	device.QueryMemoryInfo(&local, &nonLocal);
+	CHECK_EQ(local.CurrentUsage + nonLocal.CurrentUsage, 0u);
+}
+
+// A heap the device cannot create is flagged and retried once its size changes
+static void TestHeapOutOfMemory()
+{
+	TestSharedMemory		 sharedMem;
+	EvictionHelperSimDevice	 device(512 * MB, 512 * MB);
+	EvictionHelperHostDevice hostDevice;
+	EvictionHelperCore		 core(sharedMem.Get(), &device, &hostDevice, false);
+	core.InitializeDefaults();
+
+	EvictionHelperSharedData* data = sharedMem.Data();
+	data->Heaps[0].SizeMB		   = 2048;
+	data->HeapCount				   = 1;
+	RunUntilBarrier(&core, data);
+	CHECK_EQ(data->Heaps[0].OutOfMemory, 1u);
+	CHECK_EQ(data->Heaps[0].AllocatedBytes, 0u);
+
+	data->Heaps[0].SizeMB = 256;
+	RunUntilBarrier(&core, data);
+	CHECK_EQ(data->Heaps[0].OutOfMemory, 0u);
+	CHECK_EQ(data->Heaps[0].AllocatedBytes, 256 * MB);
+	core.Shutdown();
+}
+
+int main()
+{
+	RUN_TEST(TestFragmentationModel);
+	RUN_TEST(TestHeapTable);
+	RUN_TEST(TestHeapOutOfMemory);
+	return TestResult();
+}
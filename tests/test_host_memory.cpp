@@ -0,0 +1,120 @@
+// Host memory pressure: page-aligned allocations committed on creation and rewritten by every touch, and the core
+// driving the active and unused host pools from their targets with the byte counters published to shared memory
+
+#include "test_common.h"
+
+#include "eviction_helper_core.h"
+#include "eviction_helper_sim_device.h"
+
+#include <sys/mman.h>
+
+static const uint64_t MB = 1024ULL * 1024ULL;
+
+// Number of pages of the range that are in RAM
+static uint64_t CountResidentPages(void* address, uint64_t sizeBytes, uint64_t pageSize)
+{
+	std::vector<unsigned char> pages(static_cast<size_t>(sizeBytes / pageSize));
+	if(mincore(address, static_cast<size_t>(sizeBytes), pages.data()) != 0)
+		return 0;
+	uint64_t resident = 0;
+	for(unsigned char page : pages)
+		resident += page & 1;
+	return resident;
+}
+
+static void TestHostDevice()
+{
+	EvictionHelperHostDevice device;
+	uint64_t				 pageSize = HostMemory_GetPageSize();
+
+	// Sizes are rounded up to whole pages, every page is committed right away
+	EvictionHelperResource resource = device.CreateResource(0, 3 * MB + 1, EVICTION_HELPER_PRIORITY_NORMAL);
+	CHECK(resource != 0);
+	void*	 address   = nullptr;
+	uint64_t sizeBytes = 0;
+	CHECK(device.GetResourceRange(resource, &address, &sizeBytes));
+	CHECK_EQ(sizeBytes, 3 * MB + pageSize);
+	CHECK_EQ(reinterpret_cast<uintptr_t>(address) % pageSize, 0u);
+	CHECK_EQ(CountResidentPages(address, sizeBytes, pageSize), sizeBytes / pageSize);
+
+	EvictionHelperMemoryInfo local;
+	EvictionHelperMemoryInfo nonLocal;
+	device.QueryMemoryInfo(&local, &nonLocal);
+	CHECK_EQ(local.CurrentUsage, sizeBytes);
+	CHECK(local.Budget >= sizeBytes);
+
+	// A touch writes the frame index into every page, a partial touch only into the first part
+	const uint8_t* bytes = static_cast<const uint8_t*>(address);
+	device.BeginFrame(7);
+	device.TouchResource(resource);
+	CHECK_EQ(bytes[0], 7u);
+	CHECK_EQ(bytes[sizeBytes - pageSize], 7u);
+	device.BeginFrame(8);
+	device.TouchResourcePartial(resource, 0.5f);
+	CHECK_EQ(bytes[0], 8u);
+	CHECK_EQ(bytes[sizeBytes - pageSize], 7u);
+
+	// Freed slots are reused
+	device.DestroyResource(resource);
+	device.QueryMemoryInfo(&local, &nonLocal);
+	CHECK_EQ(local.CurrentUsage, 0u);
+	CHECK_EQ(device.CreateResource(0, pageSize, EVICTION_HELPER_PRIORITY_NORMAL), resource);
+}
+
+static void RunFrames(EvictionHelperCore* core, int frames)
+{
+	for(int i = 0; i < frames; i++)
+	{
+		core->ProcessCommands();
+		core->BeginFrame(33333333ULL);
+		core->TouchActiveMemory();
+		core->EndFrame(33333333ULL);
+	}
+}
+
+// The host targets grow and shrink the host pools like the VRAM targets do the VRAM pools, in whole chunks
+static void TestHostPools()
+{
+	TestSharedMemory		 sharedMem;
+	EvictionHelperSimDevice	 device(8192 * MB, 16384 * MB);
+	EvictionHelperHostDevice hostDevice;
+	EvictionHelperCore		 core(sharedMem.Get(), &device, &hostDevice, false);
+	core.InitializeDefaults();
+	EvictionHelperSharedData* data	  = sharedMem.Data();
+	const uint64_t			  chunkMB = HOST_MEMORY_CHUNK_SIZE / MB;
+
+	data->TargetHostMemoryUsageMB		= static_cast<int>(3 * chunkMB);
+	data->TargetUnusedHostMemoryUsageMB = static_cast<int>(chunkMB);
+	RunFrames(&core, 2);
+	CHECK_EQ(data->CurrentHostMemoryAllocationBytes, 3 * HOST_MEMORY_CHUNK_SIZE);
+	CHECK_EQ(data->CurrentUnusedHostMemoryAllocationBytes, HOST_MEMORY_CHUNK_SIZE);
+	CHECK_EQ(data->CurrentVRAMAllocationBytes + data->CurrentUnusedVRAMAllocationBytes, 0u);
+
+	// Host memory does not count against the VRAM device
+	EvictionHelperMemoryInfo local;
+	EvictionHelperMemoryInfo nonLocal;
+	device.QueryMemoryInfo(&local, &nonLocal);
+	CHECK_EQ(local.CurrentUsage, 0u);
+	hostDevice.QueryMemoryInfo(&local, &nonLocal);
+	CHECK_EQ(local.CurrentUsage, 4 * HOST_MEMORY_CHUNK_SIZE);
+
+	// Targets below a chunk round up to one chunk, 0 releases everything
+	data->TargetHostMemoryUsageMB		= 1;
+	data->TargetUnusedHostMemoryUsageMB = 0;
+	RunFrames(&core, 4);
+	CHECK_EQ(data->CurrentHostMemoryAllocationBytes, HOST_MEMORY_CHUNK_SIZE);
+	CHECK_EQ(data->CurrentUnusedHostMemoryAllocationBytes, 0u);
+	hostDevice.QueryMemoryInfo(&local, &nonLocal);
+	CHECK_EQ(local.CurrentUsage, HOST_MEMORY_CHUNK_SIZE);
+
+	core.Shutdown();
+	hostDevice.QueryMemoryInfo(&local, &nonLocal);
+	CHECK_EQ(local.CurrentUsage, 0u);
+}
+
+int main()
+{
+	RUN_TEST(TestHostDevice);
+	RUN_TEST(TestHostPools);
+	return TestResult();
+}
@@ -0,0 +1,269 @@
+// Host memory residency: the incremental scanner's page budget, cursor and passes, pools that change between scans,
+// pages dropped or paged out, the /proc/self/pagemap fallback, and the counters grouped by priority
+
+#include "test_common.h"
+
+#include "eviction_helper_core.h"
+#include "eviction_helper_pool.h"
+#include "eviction_helper_residency_scanner.h"
+#include "eviction_helper_sim_device.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static const uint64_t MB = 1024ULL * 1024ULL;
+
+// Host pool with its own allocation worker and release queue, created chunks arrive right away
+struct TestHostPool
+{
+	EvictionHelperHostDevice		   Device;
+	EvictionHelperAllocationWorker	   Worker;
+	EvictionHelperDeferredReleaseQueue ReleaseQueue;
+	EvictionHelperPool				   Pool;
+
+	explicit TestHostPool(uint64_t chunkSize)
+		: ReleaseQueue(&Device)
+		, Pool(&Device, EVICTION_HELPER_RESOURCE_HOST_MEMORY, chunkSize, EVICTION_HELPER_PRIORITY_NORMAL)
+	{
+	}
+
+	void Resize(uint64_t targetBytes)
+	{
+		Pool.Update(&Worker, &ReleaseQueue, targetBytes);
+		Worker.ExecutePending();
+		EvictionHelperAllocationResult result;
+		while(Worker.PopResult(&result))
+			result.Pool->OnAllocationResult(result);
+	}
+
+	void* GetChunk(uint32_t index, uint64_t* outSizeBytes = nullptr)
+	{
+		void*	 address   = nullptr;
+		uint64_t sizeBytes = 0;
+		Device.GetResourceRange(Pool.GetResources()[index], &address, &sizeBytes);
+		if(outSizeBytes)
+			*outSizeBytes = sizeBytes;
+		return address;
+	}
+
+	// Drop the pages of a chunk, private anonymous pages are gone until they are written again
+	void DropChunk(uint32_t index)
+	{
+		uint64_t sizeBytes = 0;
+		void*	 address   = GetChunk(index, &sizeBytes);
+		madvise(address, static_cast<size_t>(sizeBytes), MADV_DONTNEED);
+	}
+};
+
+// Resident pages of a range according to mincore()
+static uint64_t CountResidentPages(void* address, uint64_t sizeBytes, uint64_t pageSize)
+{
+	std::vector<unsigned char> pages(static_cast<size_t>(sizeBytes / pageSize));
+	if(mincore(address, static_cast<size_t>(sizeBytes), pages.data()) != 0)
+		return 0;
+	uint64_t resident = 0;
+	for(unsigned char page : pages)
+		resident += page & 1;
+	return resident;
+}
+
+// Each scan checks at most maxPages pages and continues where the previous one stopped, a pass completes when the
+// cursor wraps around
+static void TestScanCursor()
+{
+	TestHostPool		 host(MB);
+	HostResidencyScanner scanner;
+	const uint64_t		 pageSize	= host.Device.GetPageSize();
+	const uint64_t		 chunkPages = MB / pageSize;
+	host.Resize(2 * MB);
+	CHECK_EQ(host.Pool.GetResourceCount(), 2u);
+
+	// New chunks count as resident until they are scanned
+	host.DropChunk(0);
+	host.DropChunk(1);
+	scanner.Scan(host.Device, host.Pool, 0);
+	CHECK_EQ(scanner.GetResidentBytes(), 2 * MB);
+	CHECK_EQ(scanner.GetNonResidentBytes(), 0u);
+
+	scanner.Scan(host.Device, host.Pool, chunkPages / 2);
+	CHECK_EQ(scanner.GetNonResidentBytes(), chunkPages / 2 * pageSize);
+	scanner.Scan(host.Device, host.Pool, chunkPages);
+	CHECK_EQ(scanner.GetNonResidentBytes(), 3 * chunkPages / 2 * pageSize);
+	scanner.Scan(host.Device, host.Pool, chunkPages / 2);
+	CHECK_EQ(scanner.GetNonResidentBytes(), 2 * MB);
+	CHECK_EQ(scanner.GetResidentBytes(), 0u);
+	CHECK_EQ(scanner.GetCompletedPasses(), 0u);
+
+	// The next scan wraps around to the first chunk, which is written again
+	HostMemory_TouchPages(host.GetChunk(0), MB, pageSize, 2);
+	scanner.Scan(host.Device, host.Pool, chunkPages);
+	CHECK_EQ(scanner.GetCompletedPasses(), 1u);
+	CHECK_EQ(scanner.GetResidentBytes(), MB);
+	CHECK_EQ(scanner.GetNonResidentBytes(), MB);
+}
+
+// Chunks added, removed or replaced between scans, a replaced chunk must not keep the state of the old one
+static void TestPoolChanges()
+{
+	TestHostPool		 host(MB);
+	HostResidencyScanner scanner;
+	const uint64_t		 pageSize = host.Device.GetPageSize();
+	host.Resize(2 * MB);
+	host.DropChunk(1);
+	scanner.Scan(host.Device, host.Pool, 2 * MB / pageSize);
+	CHECK_EQ(scanner.GetNonResidentBytes(), MB);
+
+	host.Resize(3 * MB);
+	scanner.Scan(host.Device, host.Pool, 0);
+	CHECK_EQ(scanner.GetResidentBytes(), 2 * MB);
+	CHECK_EQ(scanner.GetNonResidentBytes(), MB);
+
+	host.Resize(MB);
+	scanner.Scan(host.Device, host.Pool, 0);
+	CHECK_EQ(scanner.GetResidentBytes(), MB);
+	CHECK_EQ(scanner.GetNonResidentBytes(), 0u);
+
+	// Released and created again before the next scan, the new chunks likely get the slots and addresses of the old
+	// ones but have every page written
+	host.Resize(2 * MB);
+	host.DropChunk(1);
+	scanner.Scan(host.Device, host.Pool, 2 * MB / pageSize);
+	CHECK_EQ(scanner.GetNonResidentBytes(), MB);
+	host.Pool.Release();
+	host.Resize(2 * MB);
+	scanner.Scan(host.Device, host.Pool, 0);
+	CHECK_EQ(scanner.GetResidentBytes(), 2 * MB);
+	CHECK_EQ(scanner.GetNonResidentBytes(), 0u);
+
+	// A different chunk size
+	host.Pool.Release();
+	host.Pool.SetLayout(&host.Device, EVICTION_HELPER_RESOURCE_HOST_MEMORY, 4 * MB);
+	host.Resize(4 * MB);
+	scanner.Scan(host.Device, host.Pool, 0);
+	CHECK_EQ(scanner.GetResidentBytes(), 4 * MB);
+	CHECK_EQ(scanner.GetNonResidentBytes(), 0u);
+	scanner.Scan(host.Device, host.Pool, 4 * MB / pageSize);
+	CHECK_EQ(scanner.GetResidentBytes(), 4 * MB);
+
+	// An empty pool has nothing to scan
+	host.Resize(0);
+	scanner.Scan(host.Device, host.Pool, 1000);
+	CHECK_EQ(scanner.GetResidentBytes() + scanner.GetNonResidentBytes(), 0u);
+}
+
+// /proc/self/pagemap reports the same pages as mincore()
+static void TestPagemapFallback()
+{
+	int fd = open("/proc/self/pagemap", O_RDONLY);
+	if(fd < 0)
+	{
+		printf("skipped, /proc/self/pagemap is not readable\n");
+		return;
+	}
+	close(fd);
+
+	TestHostPool		 host(MB);
+	HostResidencyScanner scanner;
+	HostResidencyScanner pagemapScanner;
+	pagemapScanner.SetUsePagemap(true);
+	const uint64_t pageSize = host.Device.GetPageSize();
+	host.Resize(2 * MB);
+	host.DropChunk(0);
+	HostMemory_TouchPages(host.GetChunk(0), MB / 4, pageSize, 2);
+
+	scanner.Scan(host.Device, host.Pool, 2 * MB / pageSize);
+	pagemapScanner.Scan(host.Device, host.Pool, 2 * MB / pageSize);
+	CHECK_EQ(scanner.GetNonResidentBytes(), 3 * MB / 4);
+	CHECK_EQ(pagemapScanner.GetNonResidentBytes(), scanner.GetNonResidentBytes());
+	CHECK_EQ(pagemapScanner.GetResidentBytes(), scanner.GetResidentBytes());
+}
+
+// HostMemory_PageOut() asks the kernel to reclaim the pages, without swap or MADV_PAGEOUT nothing may leave RAM
+static void TestPageOut()
+{
+	TestHostPool		 host(4 * MB);
+	HostResidencyScanner scanner;
+	const uint64_t		 pageSize = host.Device.GetPageSize();
+	host.Resize(4 * MB);
+
+	void* address = host.GetChunk(0);
+	if(!HostMemory_PageOut(address, 4 * MB))
+	{
+		printf("skipped, HostMemory_PageOut() is not supported\n");
+		return;
+	}
+	uint64_t residentPages = CountResidentPages(address, 4 * MB, pageSize);
+	if(residentPages == 4 * MB / pageSize)
+	{
+		printf("skipped, no page was paged out (no swap?)\n");
+		return;
+	}
+
+	// Untouched pages can only leave RAM, the scan lands between the counts before and after it
+	scanner.Scan(host.Device, host.Pool, 4 * MB / pageSize);
+	uint64_t residentPagesAfter = CountResidentPages(address, 4 * MB, pageSize);
+	printf("%llu of %llu pages paged out\n", (unsigned long long)(4 * MB / pageSize - residentPages), (unsigned long long)(4 * MB / pageSize));
+	CHECK(scanner.GetResidentBytes() <= residentPages * pageSize);
+	CHECK(scanner.GetResidentBytes() >= residentPagesAfter * pageSize);
+	CHECK_EQ(scanner.GetResidentBytes() + scanner.GetNonResidentBytes(), 4 * MB);
+}
+
+// One frame at 30 FPS
+static void RunFrame(EvictionHelperCore* core)
+{
+	core->BeginFrame(33333333ULL);
+	core->TouchActiveMemory();
+	core->EndFrame(33333333ULL);
+}
+
+// SET_PRIORITY on the host pools moves their bytes to the bucket of the new priority
+static void TestSetPriorityCommand()
+{
+	TestSharedMemory		 sharedMem;
+	EvictionHelperSimDevice	 device(8ULL << 30, 16ULL << 30);
+	EvictionHelperHostDevice hostDevice;
+	EvictionHelperCore		 core(sharedMem.Get(), &device, &hostDevice, false);
+	core.InitializeDefaults();
+
+	EvictionHelperSharedData* data		= sharedMem.Data();
+	const uint64_t			  poolBytes = HOST_MEMORY_CHUNK_SIZE;
+
+	data->TargetHostMemoryUsageMB		= (int)(poolBytes >> 20);
+	data->TargetUnusedHostMemoryUsageMB = (int)(poolBytes >> 20);
+	EvictionHelper_PushCommand(data, EVICTION_HELPER_COMMAND_SET_PRIORITY, EVICTION_HELPER_POOL_HOST_ACTIVE, EVICTION_HELPER_PRIORITY_MAXIMUM, 0);
+	EvictionHelper_PushCommand(data, EVICTION_HELPER_COMMAND_SET_PRIORITY, EVICTION_HELPER_POOL_HOST_UNUSED, EVICTION_HELPER_PRIORITY_MINIMUM, 0);
+	core.ProcessCommands();
+	CHECK_EQ(data->HostMemoryPriority, EVICTION_HELPER_PRIORITY_MAXIMUM);
+	CHECK_EQ(data->UnusedHostMemoryPriority, EVICTION_HELPER_PRIORITY_MINIMUM);
+
+	RunFrame(&core);
+	CHECK_EQ(data->CurrentHostMemoryAllocationBytes, poolBytes);
+	CHECK_EQ(data->CurrentUnusedHostMemoryAllocationBytes, poolBytes);
+	for(int priority = 0; priority < 5; priority++)
+	{
+		uint64_t expected = (priority == EVICTION_HELPER_PRIORITY_MAXIMUM || priority == EVICTION_HELPER_PRIORITY_MINIMUM) ? poolBytes : 0;
+		CHECK_EQ(data->HostResidentBytesByPriority[priority] + data->HostNonResidentBytesByPriority[priority], expected);
+	}
+
+	// Both pools under the same priority share one bucket
+	EvictionHelper_PushCommand(data, EVICTION_HELPER_COMMAND_SET_PRIORITY, EVICTION_HELPER_POOL_HOST_UNUSED, EVICTION_HELPER_PRIORITY_MAXIMUM, 0);
+	core.ProcessCommands();
+	RunFrame(&core);
+	CHECK_EQ(data->HostResidentBytesByPriority[EVICTION_HELPER_PRIORITY_MAXIMUM] + data->HostNonResidentBytesByPriority[EVICTION_HELPER_PRIORITY_MAXIMUM], 2 * poolBytes);
+	CHECK_EQ(data->HostResidentBytesByPriority[EVICTION_HELPER_PRIORITY_MINIMUM] + data->HostNonResidentBytesByPriority[EVICTION_HELPER_PRIORITY_MINIMUM], 0u);
+
+	// The touched active pool is resident
+	CHECK_EQ(data->HostMemoryResidentBytes, poolBytes);
+	core.Shutdown();
+}
+
+int main()
+{
+	RUN_TEST(TestScanCursor);
+	RUN_TEST(TestPoolChanges);
+	RUN_TEST(TestPagemapFallback);
+	RUN_TEST(TestPageOut);
+	RUN_TEST(TestSetPriorityCommand);
+	return TestResult();
+}
@@ -0,0 +1,287 @@
+// Memory sampler: the sample timeline on made up timestamps, every query written once without bursts after a slow one,
+// a budget dip shorter than a frame, the /proc/meminfo provider, and the core running the sampler through frame hitches
+
+#include "test_common.h"
+
+#include "eviction_helper_core.h"
+#include "eviction_helper_memory_sampler.h"
+#include "eviction_helper_sim_device.h"
+
+#include <thread>
+
+static const uint64_t MB = 1024ULL * 1024ULL;
+static const uint64_t MS = 1000000ULL;
+
+static std::vector<EvictionHelperMemorySample> ReadAllSamples(const EvictionHelperSharedData* data, uint64_t* inOutIndex)
+{
+	std::vector<EvictionHelperMemorySample> samples(EVICTION_HELPER_MEMORY_SAMPLE_RING_SIZE);
+	uint64_t								dropped = 0;
+	uint32_t								count	= EvictionHelper_ReadMemorySamples(data, inOutIndex, samples.data(), EVICTION_HELPER_MEMORY_SAMPLE_RING_SIZE, &dropped);
+	CHECK_EQ(dropped, 0u);
+	samples.resize(count);
+	return samples;
+}
+
+// Wait until the sampler has written count more samples than head, however long the scheduler takes
+// Returns false if that takes more than 5 seconds
+static bool WaitForSamples(const EvictionHelperSharedData* data, uint64_t head, uint64_t count)
+{
+	uint64_t timeoutNs = EvictionHelper_GetTimestampNs() + 5000 * MS;
+	while(data->MemorySamples.Head.load() < head + count)
+	{
+		if(EvictionHelper_GetTimestampNs() > timeoutNs)
+			return false;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return true;
+}
+
+// Counts its queries and reports the call number as the local budget, so every sample names the call it came from
+// One call can be made to take a while, like a driver call that blocks.
+class CountingProvider : public EvictionHelperMemoryInfoProvider
+{
+public:
+	void QueryMemoryInfo(EvictionHelperMemoryInfo* outLocal, EvictionHelperMemoryInfo* outNonLocal) override
+	{
+		uint64_t call	 = Calls.fetch_add(1) + 1;
+		*outLocal		 = {};
+		*outNonLocal	 = {};
+		outLocal->Budget = call;
+		if(call == SlowCall)
+			std::this_thread::sleep_for(std::chrono::nanoseconds(SlowCallNs));
+	}
+
+	std::atomic<uint64_t> Calls{ 0 };
+	uint64_t			  SlowCall	 = 0;
+	uint64_t			  SlowCallNs = 0;
+};
+
+// The timeline on made up timestamps at 1 kHz, nothing waits
+static void TestSchedule()
+{
+	uint64_t					 start = 1000 * MS;
+	EvictionHelperSampleSchedule schedule;
+	schedule.Start(start, MS);
+	CHECK_EQ(schedule.GetDeadlineNs(), start);
+
+	// Late samples and slow queries do not push back the ones after them
+	CHECK_EQ(schedule.Advance(start + MS / 10, MS), start + MS);
+	CHECK_EQ(schedule.GetLateNs(start + MS + MS / 2), MS / 2);
+	CHECK_EQ(schedule.GetLateNs(start + MS - 1), 0u);
+	CHECK_EQ(schedule.Advance(start + 2 * MS - 1, MS), start + 2 * MS);
+
+	// Ending up to one interval behind catches up on the timeline, more than that drops the missed samples
+	CHECK_EQ(schedule.Advance(start + 4 * MS, MS), start + 3 * MS);
+	CHECK_EQ(schedule.Advance(start + 9 * MS + 1, MS), start + 9 * MS + 1);
+	CHECK_EQ(schedule.Advance(start + 9 * MS + 2, MS), start + 10 * MS + 1);
+
+	// A rate change restarts the timeline where the sample ended
+	CHECK_EQ(schedule.Advance(start + 10 * MS + 5, 10 * MS), start + 20 * MS + 5);
+	CHECK_EQ(schedule.Advance(start + 20 * MS + 6, 10 * MS), start + 30 * MS + 5);
+}
+
+// Every query ends up in the ring exactly once and in order, and the sampler never takes more samples than its rate
+// allows, not even after a query that blocked for 30 intervals. How close it comes to the rate depends on the scheduler
+// and is measured by bench_memory_sampler.
+static void TestRate()
+{
+	TestSharedMemory			sharedMem;
+	CountingProvider			provider;
+	EvictionHelperMemorySampler sampler;
+	provider.SlowCall	= 5;
+	provider.SlowCallNs = 30 * MS;
+
+	// Run until a few samples after the slow one, however long the scheduler takes to get there
+	uint64_t startNs = EvictionHelper_GetTimestampNs();
+	sampler.Start(&provider, sharedMem.Data(), 1000);
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	while(provider.Calls.load() < provider.SlowCall + 3)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	sampler.Stop();
+	uint64_t elapsedNs = EvictionHelper_GetTimestampNs() - startNs;
+	CHECK(!sampler.IsRunning());
+	CHECK_EQ(sampler.GetIntervalNs(), MS);
+
+	uint64_t								index	= 0;
+	std::vector<EvictionHelperMemorySample> samples = ReadAllSamples(sharedMem.Data(), &index);
+	EvictionHelperMemorySamplerStats		stats;
+	sampler.GetStats(&stats);
+	printf("%zu samples in %.1f ms\n", samples.size(), elapsedNs / 1e6);
+	CHECK_EQ(provider.Calls.load(), samples.size());
+	CHECK_EQ(stats.SampleCount, samples.size());
+	CHECK(samples.size() <= elapsedNs / MS + 2);
+
+	uint64_t slowEndNs = 0;
+	for(size_t i = 0; i < samples.size(); i++)
+	{
+		CHECK_EQ(samples[i].LocalBudget, i + 1);
+		CHECK(samples[i].TimestampNs >= startNs);
+		if(i > 0)
+			CHECK(samples[i].TimestampNs > samples[i - 1].TimestampNs);
+		if(samples[i].LocalBudget == provider.SlowCall)
+		{
+			CHECK(samples[i].QueryNs >= provider.SlowCallNs);
+			slowEndNs = samples[i].TimestampNs + samples[i].QueryNs;
+		}
+	}
+
+	// No burst of back to back samples for the ones the slow query missed
+	uint32_t afterSlowCall = 0;
+	for(const EvictionHelperMemorySample& sample : samples)
+	{
+		if(sample.TimestampNs >= slowEndNs && sample.TimestampNs < slowEndNs + 5 * MS)
+			afterSlowCall++;
+	}
+	CHECK(afterSlowCall <= 7);
+
+	// Nothing is queried or written after Stop()
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	CHECK_EQ(provider.Calls.load(), samples.size());
+	CHECK(ReadAllSamples(sharedMem.Data(), &index).empty());
+
+	// Rates are clamped to [1, 1000] Hz
+	sampler.Start(&provider, sharedMem.Data(), 100000);
+	CHECK_EQ(sampler.GetIntervalNs(), MS);
+	sampler.Stop();
+	sampler.Start(&provider, sharedMem.Data(), 0);
+	CHECK_EQ(sampler.GetIntervalNs(), 1000 * MS);
+	sampler.Stop();
+}
+
+// A budget cut that lasts a few samples, much shorter than a frame at 30 FPS, shows up in every sample taken during it
+// and in none before or after
+static void TestShortBudgetDip()
+{
+	TestSharedMemory					   sharedMem;
+	EvictionHelperSimDevice				   device(8192 * MB, 16384 * MB);
+	EvictionHelperDeviceMemoryInfoProvider provider(&device);
+	EvictionHelperMemorySampler			   sampler;
+	EvictionHelperSharedData*			   data = sharedMem.Data();
+	sampler.Start(&provider, data, 1000);
+
+	// The cut lasts until six more samples were written, a sample queried just before it may be among them
+	CHECK(WaitForSamples(data, 0, 10));
+	uint64_t dipStartNs = EvictionHelper_GetTimestampNs();
+	device.SetLocalBudget(2048 * MB);
+	CHECK(WaitForSamples(data, data->MemorySamples.Head.load(), 6));
+	device.SetLocalBudget(8192 * MB);
+	uint64_t dipEndNs = EvictionHelper_GetTimestampNs();
+	CHECK(WaitForSamples(data, data->MemorySamples.Head.load(), 10));
+	sampler.Stop();
+
+	uint64_t index	   = 0;
+	uint32_t dipCount  = 0;
+	bool	 recovered = false;
+	for(const EvictionHelperMemorySample& sample : ReadAllSamples(data, &index))
+	{
+		if(sample.LocalBudget == 2048 * MB)
+		{
+			CHECK(sample.TimestampNs >= dipStartNs && sample.TimestampNs <= dipEndNs);
+			CHECK(!recovered);
+			dipCount++;
+		}
+		else if(dipCount)
+		{
+			recovered = true;
+		}
+	}
+	printf("%.1f ms budget dip seen in %u samples\n", (dipEndNs - dipStartNs) / 1e6, dipCount);
+	CHECK(dipCount >= 5);
+	CHECK(recovered);
+}
+
+// The system provider reads the same numbers as HostMemory_QuerySystemMemory()
+static void TestSystemProvider()
+{
+	EvictionHelperSystemMemoryInfoProvider provider;
+	EvictionHelperMemoryInfo			   local;
+	EvictionHelperMemoryInfo			   nonLocal;
+	provider.QueryMemoryInfo(&local, &nonLocal);
+
+	uint64_t totalBytes		= 0;
+	uint64_t availableBytes = 0;
+	uint64_t swapTotalBytes = 0;
+	uint64_t swapUsedBytes	= 0;
+	HostMemory_QuerySystemMemory(&totalBytes, &availableBytes, &swapTotalBytes, &swapUsedBytes);
+	CHECK_EQ(local.Budget, totalBytes);
+	CHECK(local.Budget > 0);
+	CHECK(local.CurrentUsage > 0 && local.CurrentUsage <= local.Budget);
+	CHECK_EQ(nonLocal.Budget, swapTotalBytes);
+	CHECK(nonLocal.CurrentUsage <= nonLocal.Budget);
+
+	// Re-reading the open file gives fresh numbers every time
+	for(int i = 0; i < 100; i++)
+	{
+		provider.QueryMemoryInfo(&local, &nonLocal);
+		CHECK_EQ(local.Budget, totalBytes);
+	}
+}
+
+// The core starts the sampler from MemorySampleRateHz, it keeps sampling while a frame does not end
+// The achieved rate is only checked against the configured one, how close it gets is measured by bench_memory_sampler.
+static void TestCoreSampler()
+{
+	TestSharedMemory		 sharedMem;
+	EvictionHelperSimDevice	 device(8192 * MB, 16384 * MB);
+	EvictionHelperHostDevice hostDevice;
+	EvictionHelperCore		 core(sharedMem.Get(), &device, &hostDevice, false);
+	core.InitializeDefaults();
+	EvictionHelperSharedData* data = sharedMem.Data();
+	data->MemorySampleRateHz	   = 500;
+
+	uint64_t hitchStartNs = 0;
+	uint64_t hitchEndNs	  = 0;
+	for(int frame = 0; frame < 40; frame++)
+	{
+		core.ProcessCommands();
+		core.BeginFrame(33000000);
+		core.TouchActiveMemory();
+		core.EndFrame(33000000);
+		if(frame == 10)
+		{
+			// The frame lasts until 21 more samples were written, one of them may have been queried before it
+			hitchStartNs = EvictionHelper_GetTimestampNs();
+			CHECK(WaitForSamples(data, data->MemorySamples.Head.load(), 21));
+			hitchEndNs = EvictionHelper_GetTimestampNs();
+		}
+		else
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(33));
+		}
+	}
+
+	uint64_t index		 = 0;
+	uint32_t hitchCount	 = 0;
+	uint32_t sampleCount = 0;
+	for(const EvictionHelperMemorySample& sample : ReadAllSamples(data, &index))
+	{
+		sampleCount++;
+		if(sample.TimestampNs > hitchStartNs && sample.TimestampNs < hitchEndNs)
+			hitchCount++;
+	}
+	printf("%u samples, %u during the %.1f ms frame, %.1f Hz achieved\n", sampleCount, hitchCount, (hitchEndNs - hitchStartNs) / 1e6, data->MemorySampleAchievedHz);
+	CHECK(hitchCount >= 20);
+	CHECK(data->MemorySampleAchievedHz > 0.0f && data->MemorySampleAchievedHz < 510.0f);
+	CHECK(data->MemorySampleMaxQueryNs > 0);
+	CHECK(data->MemorySampleMeanQueryNs <= data->MemorySampleMaxQueryNs);
+
+	// Rate 0 stops the sampler
+	data->MemorySampleRateHz = 0;
+	core.BeginFrame(33000000);
+	core.EndFrame(33000000);
+	uint64_t head = data->MemorySamples.Head.load();
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	CHECK_EQ(data->MemorySamples.Head.load(), head);
+	CHECK_EQ(data->MemorySampleAchievedHz, 0.0f);
+	core.Shutdown();
+}
+
+int main()
+{
+	RUN_TEST(TestSchedule);
+	RUN_TEST(TestRate);
+	RUN_TEST(TestShortBudgetDip);
+	RUN_TEST(TestSystemProvider);
+	RUN_TEST(TestCoreSampler);
+	return TestResult();
+}
@@ -0,0 +1,161 @@
+// Named pools on the simulated device: one pool of every kind with its own chunk size, touch policy, priority and ramp,
+// layout changes, commands addressed to named pools, and pools dropped by lowering NamedPoolCount
+
+#include "test_common.h"
+
+#include "eviction_helper_core.h"
+#include "eviction_helper_sim_device.h"
+
+#define FRAME_TIME_NS 16000000ULL
+
+static const uint64_t MB = 1024ULL * 1024ULL;
+
+static void RunFrames(EvictionHelperCore* core, int count)
+{
+	for(int frame = 0; frame < count; frame++)
+	{
+		core->ProcessCommands();
+		core->BeginFrame(FRAME_TIME_NS);
+		core->TouchActiveMemory();
+		core->EndFrame(FRAME_TIME_NS);
+	}
+}
+
+static void SetName(EvictionHelperPoolDesc* pool, const char* name)
+{
+	snprintf(pool->Name, sizeof(pool->Name), "%s", name);
+}
+
+static void TestNamedPools()
+{
+	TestSharedMemory		 sharedMem;
+	EvictionHelperSimDevice	 device(8192 * MB, 16384 * MB);
+	EvictionHelperHostDevice hostDevice;
+	EvictionHelperCore		 core(sharedMem.Get(), &device, &hostDevice, false);
+	core.InitializeDefaults();
+
+	EvictionHelperSharedData* data		= sharedMem.Data();
+	EvictionHelperPoolDesc*	  textures	= &data->NamedPools[0];
+	EvictionHelperPoolDesc*	  heaps		= &data->NamedPools[1];
+	EvictionHelperPoolDesc*	  host		= &data->NamedPools[2];
+	EvictionHelperPoolDesc*	  streaming = &data->NamedPools[3];
+
+	SetName(textures, "textures");
+	textures->TargetMB	   = 1024;
+	textures->ChunkSizeKB  = 4096;
+	textures->TouchPattern = EVICTION_HELPER_TOUCH_ROUND_ROBIN;
+	textures->TouchPercent = 25;
+
+	SetName(heaps, "heaps");
+	heaps->TargetMB = 512;
+	heaps->Kind		= EVICTION_HELPER_POOL_KIND_HEAP;
+	heaps->Priority = EVICTION_HELPER_PRIORITY_MINIMUM;
+
+	SetName(host, "host");
+	host->TargetMB	   = 256;
+	host->Kind		   = EVICTION_HELPER_POOL_KIND_HOST_MEMORY;
+	host->ChunkSizeKB  = 1024;
+	host->TouchPattern = EVICTION_HELPER_TOUCH_ROUND_ROBIN;
+	host->TouchPercent = 50;
+
+	SetName(streaming, "streaming");
+	streaming->TargetMB			 = 2048;
+	streaming->TouchPattern		 = EVICTION_HELPER_TOUCH_NONE;
+	streaming->RampUpMBPerSecond = 1024.0f;
+
+	data->NamedPoolCount = 4;
+	RunFrames(&core, 20);
+
+	// Every pool at its own size and chunk size, the streaming pool 20 frames of 16 ms into its ramp
+	CHECK_EQ(textures->AllocatedBytes, 1024 * MB);
+	CHECK_EQ(textures->ChunkSizeBytes, 4 * MB);
+	CHECK_EQ(textures->ResourceCount, 256u);
+	CHECK_EQ(heaps->AllocatedBytes, 512 * MB);
+	CHECK_EQ(heaps->ChunkSizeBytes, 64 * MB);
+	CHECK_EQ(host->AllocatedBytes, 256 * MB);
+	CHECK_EQ(host->ResourceCount, 256u);
+	CHECK_EQ(streaming->ChunkSizeBytes, RT_SIZE);
+	CHECK_EQ(streaming->RampPositionBytes, (uint64_t)(1024.0 * MB * 20 * FRAME_TIME_NS / 1e9));
+	CHECK(streaming->AllocatedBytes >= streaming->RampPositionBytes && streaming->AllocatedBytes < streaming->RampPositionBytes + RT_SIZE);
+
+	// Each pool follows its own touch policy, bare heaps are never touched
+	CHECK_EQ(textures->TouchedBytesLastFrame, 256 * MB);
+	CHECK_EQ(heaps->TouchedBytesLastFrame, 0u);
+	CHECK_EQ(host->TouchedBytesLastFrame, 128 * MB);
+	CHECK_EQ(streaming->TouchedBytesLastFrame, 0u);
+
+	RunFrames(&core, 150);
+	CHECK_EQ(streaming->AllocatedBytes, 2048 * MB);
+	CHECK_EQ(streaming->PendingBytes, 0u);
+	RunFrames(&core, 1);
+	CHECK_EQ(data->LocalCurrentUsage + data->NonLocalCurrentUsage, (1024 + 512 + 2048) * MB);
+
+	// A priority change of one pool is one call for all of its resources
+	uint64_t callsBefore   = device.GetPriorityCallCount();
+	uint64_t objectsBefore = device.GetPriorityObjectCount();
+	textures->Priority	   = EVICTION_HELPER_PRIORITY_HIGH;
+	RunFrames(&core, 1);
+	CHECK_EQ(device.GetPriorityCallCount() - callsBefore, 1u);
+	CHECK_EQ(device.GetPriorityObjectCount() - objectsBefore, 256u);
+
+	// A new chunk size reallocates the pool, a barrier waits for the new layout
+	textures->ChunkSizeKB = 32768;
+	uint64_t barrier	  = EvictionHelper_PushCommand(data, EVICTION_HELPER_COMMAND_BARRIER, 0, 0, 0);
+	for(int frame = 0; frame < 100 && !EvictionHelper_IsCommandComplete(data, barrier); frame++)
+		RunFrames(&core, 1);
+	CHECK(EvictionHelper_IsCommandComplete(data, barrier));
+	CHECK_EQ(textures->ChunkSizeBytes, 32 * MB);
+	CHECK_EQ(textures->ResourceCount, 32u);
+	CHECK_EQ(textures->AllocatedBytes, 1024 * MB);
+
+	// Commands address named pools by index
+	EvictionHelper_PushCommand(data, EVICTION_HELPER_COMMAND_SET_TARGET, EVICTION_HELPER_POOL_NAMED(1), 128, 0);
+	uint64_t evict = EvictionHelper_PushCommand(data, EVICTION_HELPER_COMMAND_EVICT, EVICTION_HELPER_POOL_NAMED(0), 0, 0);
+	RunFrames(&core, 5);
+	CHECK(EvictionHelper_IsCommandComplete(data, evict));
+	CHECK_EQ(heaps->TargetMB, 128);
+	CHECK_EQ(heaps->AllocatedBytes, 128 * MB);
+	CHECK_EQ(data->ResidencyOpStatus, (uint32_t)EVICTION_HELPER_RESIDENCY_OP_DONE);
+	CHECK_EQ(textures->EvictedBytes, 1024 * MB);
+	CHECK_EQ(textures->TouchedBytesLastFrame, 0u);
+
+	// Pools past NamedPoolCount are released
+	data->NamedPoolCount = 1;
+	RunFrames(&core, 5);
+	CHECK_EQ(textures->AllocatedBytes, 1024 * MB);
+	CHECK_EQ(heaps->AllocatedBytes, 0u);
+	CHECK_EQ(host->AllocatedBytes, 0u);
+	CHECK_EQ(streaming->AllocatedBytes, 0u);
+	CHECK_EQ(device.GetInFlightDestroyCount(), 0u);
+	core.Shutdown();
+}
+
+// A pool the device cannot fit reports it and stops requesting until its target changes
+static void TestOutOfMemory()
+{
+	TestSharedMemory		 sharedMem;
+	EvictionHelperSimDevice	 device(256 * MB, 256 * MB);
+	EvictionHelperHostDevice hostDevice;
+	EvictionHelperCore		 core(sharedMem.Get(), &device, &hostDevice, false);
+	core.InitializeDefaults();
+
+	EvictionHelperSharedData* data = sharedMem.Data();
+	data->NamedPools[0].TargetMB   = 1024;
+	data->NamedPoolCount		   = 1;
+	RunFrames(&core, 5);
+	CHECK_EQ(data->NamedPools[0].OutOfMemory, 1u);
+	CHECK_EQ(data->NamedPools[0].AllocatedBytes, 512 * MB);
+
+	data->NamedPools[0].TargetMB = 256;
+	RunFrames(&core, 5);
+	CHECK_EQ(data->NamedPools[0].OutOfMemory, 0u);
+	CHECK_EQ(data->NamedPools[0].AllocatedBytes, 256 * MB);
+	core.Shutdown();
+}
+
+int main()
+{
+	RUN_TEST(TestNamedPools);
+	RUN_TEST(TestOutOfMemory);
+	return TestResult();
+}
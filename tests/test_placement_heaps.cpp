@@ -0,0 +1,218 @@
+// Placement heap bookkeeping: render targets of two pools with the same priority never share a heap, resources of
+// one pool fill its heaps before a new one is needed, the blocks of released heaps are reused, and evicted heaps are
+// evicted and made resident once and get no new render targets
+
+#include "test_common.h"
+
+#include "eviction_helper_pool.h"
+#include "eviction_helper_placement_heaps.h"
+#include "eviction_helper_sim_device.h"
+
+#include <map>
+
+static const uint64_t MB		= 1024ULL * 1024ULL;
+static const uint64_t HEAP_SIZE = 4 * RT_SIZE;
+
+// Places render targets like the D3D12 backend does with PlacementHeapMB set, remembers the block of every resource
+// and counts the residency calls the backend would make on the heaps
+class PlacingDevice : public EvictionHelperSimDevice
+{
+public:
+	PlacingDevice() : EvictionHelperSimDevice(8192 * MB, 16384 * MB) {}
+
+	EvictionHelperResource CreateGroupedResource(uint32_t kind, uint64_t sizeBytes, int priority, uint64_t placementGroup) override
+	{
+		EvictionHelperResource handle = CreateResource(kind, sizeBytes, priority);
+		uint32_t			   block  = 0;
+		uint64_t			   offset = 0;
+		if(!Heaps.Allocate(placementGroup, priority, HEAP_SIZE, sizeBytes, &block, &offset))
+			block = Heaps.AddBlock(placementGroup, priority, HEAP_SIZE, sizeBytes, &offset);
+		Placed[handle] = { placementGroup, block };
+		return handle;
+	}
+
+	bool Evict(const EvictionHelperResource* handles, uint32_t count) override
+	{
+		for(uint32_t i = 0; i < count; i++)
+			HeapEvictions += Heaps.Evict(Placed[handles[i]].second);
+		return EvictionHelperSimDevice::Evict(handles, count);
+	}
+
+	bool MakeResident(const EvictionHelperResource* handles, uint32_t count) override
+	{
+		for(uint32_t i = 0; i < count; i++)
+			HeapEvictions -= Heaps.MakeResident(Placed[handles[i]].second);
+		return EvictionHelperSimDevice::MakeResident(handles, count);
+	}
+
+	EvictionHelperPlacementHeaps									Heaps;
+	std::map<EvictionHelperResource, std::pair<uint64_t, uint32_t>> Placed;			   // Group and block of every resource
+	int																HeapEvictions = 0; // Heaps evicted and not made resident again
+};
+
+static void TestGroupsNeverShare()
+{
+	EvictionHelperPlacementHeaps heaps;
+	uint32_t					 blockA	 = 0;
+	uint32_t					 blockB	 = 0;
+	uint64_t					 offsetA = 0;
+	uint64_t					 offsetB = 0;
+
+	// Group 2 has the same priority and heap size but finds no room in the heap of group 1
+	blockA = heaps.AddBlock(1, EVICTION_HELPER_PRIORITY_NORMAL, HEAP_SIZE, RT_SIZE, &offsetA);
+	CHECK(!heaps.Allocate(2, EVICTION_HELPER_PRIORITY_NORMAL, HEAP_SIZE, RT_SIZE, &blockB, &offsetB));
+	blockB = heaps.AddBlock(2, EVICTION_HELPER_PRIORITY_NORMAL, HEAP_SIZE, RT_SIZE, &offsetB);
+	CHECK(blockA != blockB);
+	CHECK_EQ(heaps.GetPlacementGroup(blockA), 1u);
+	CHECK_EQ(heaps.GetPlacementGroup(blockB), 2u);
+
+	// Both fill their own heap
+	uint32_t block	= 0;
+	uint64_t offset = 0;
+	for(int i = 1; i < 4; i++)
+	{
+		CHECK(heaps.Allocate(1, EVICTION_HELPER_PRIORITY_NORMAL, HEAP_SIZE, RT_SIZE, &block, &offset));
+		CHECK_EQ(block, blockA);
+		CHECK(heaps.Allocate(2, EVICTION_HELPER_PRIORITY_NORMAL, HEAP_SIZE, RT_SIZE, &block, &offset));
+		CHECK_EQ(block, blockB);
+	}
+	CHECK(!heaps.Allocate(1, EVICTION_HELPER_PRIORITY_NORMAL, HEAP_SIZE, RT_SIZE, &block, &offset));
+	CHECK_EQ(heaps.GetResourceCount(blockA), 4u);
+	CHECK_EQ(heaps.GetResourceCount(blockB), 4u);
+
+	// A priority change of one group leaves the other alone, and a heap of another priority is not reused
+	CHECK(heaps.SetPriority(blockA, EVICTION_HELPER_PRIORITY_HIGH));
+	CHECK(!heaps.SetPriority(blockA, EVICTION_HELPER_PRIORITY_HIGH));
+	heaps.Free(blockA, offsetA, false);
+	CHECK(!heaps.Allocate(1, EVICTION_HELPER_PRIORITY_NORMAL, HEAP_SIZE, RT_SIZE, &block, &offset));
+	CHECK(heaps.Allocate(1, EVICTION_HELPER_PRIORITY_HIGH, HEAP_SIZE, RT_SIZE, &block, &offset));
+	CHECK_EQ(block, blockA);
+	CHECK_EQ(offset, offsetA);
+}
+
+// The last free of a block releases it, the next heap takes its index
+static void TestBlockReuse()
+{
+	EvictionHelperPlacementHeaps heaps;
+	uint64_t					 offsets[3] = {};
+	uint32_t					 first		= heaps.AddBlock(1, EVICTION_HELPER_PRIORITY_NORMAL, HEAP_SIZE, RT_SIZE, &offsets[0]);
+	uint32_t					 second		= heaps.AddBlock(2, EVICTION_HELPER_PRIORITY_NORMAL, HEAP_SIZE, RT_SIZE, &offsets[1]);
+	uint32_t					 block		= 0;
+	CHECK(heaps.Allocate(1, EVICTION_HELPER_PRIORITY_NORMAL, HEAP_SIZE, RT_SIZE, &block, &offsets[2]));
+	CHECK_EQ(block, first);
+	CHECK(offsets[0] != offsets[2]);
+
+	CHECK(!heaps.Free(first, offsets[0], false));
+	CHECK(heaps.Free(first, offsets[2], false));
+	CHECK_EQ(heaps.GetResourceCount(first), 0u);
+	CHECK(!heaps.Allocate(1, EVICTION_HELPER_PRIORITY_NORMAL, HEAP_SIZE, RT_SIZE, &block, &offsets[0]));
+
+	CHECK_EQ(heaps.AddBlock(3, EVICTION_HELPER_PRIORITY_NORMAL, HEAP_SIZE, RT_SIZE, &offsets[0]), first);
+	CHECK_EQ(heaps.GetPlacementGroup(first), 3u);
+	CHECK_EQ(heaps.GetBlockCount(), 2u);
+	CHECK_EQ(heaps.GetResourceCount(second), 1u);
+}
+
+// The heap is evicted with its first resource and made resident with its last one, it takes no resources meanwhile
+static void TestEvictedBlocks()
+{
+	EvictionHelperPlacementHeaps heaps;
+	uint64_t					 offsets[2] = {};
+	uint32_t					 block		= heaps.AddBlock(1, EVICTION_HELPER_PRIORITY_NORMAL, HEAP_SIZE, RT_SIZE, &offsets[0]);
+	uint32_t					 other		= 0;
+	CHECK(heaps.Allocate(1, EVICTION_HELPER_PRIORITY_NORMAL, HEAP_SIZE, RT_SIZE, &other, &offsets[1]));
+
+	CHECK(heaps.Evict(block));
+	CHECK(!heaps.Evict(block));
+	CHECK_EQ(heaps.GetEvictedCount(block), 2u);
+	CHECK(!heaps.Allocate(1, EVICTION_HELPER_PRIORITY_NORMAL, HEAP_SIZE, RT_SIZE, &other, &offsets[1]));
+	other = heaps.AddBlock(1, EVICTION_HELPER_PRIORITY_NORMAL, HEAP_SIZE, RT_SIZE, &offsets[1]);
+	CHECK(other != block);
+
+	CHECK(!heaps.MakeResident(block));
+	CHECK(heaps.MakeResident(block));
+	CHECK(!heaps.MakeResident(block));
+	CHECK_EQ(heaps.GetEvictedCount(block), 0u);
+	CHECK(heaps.Allocate(1, EVICTION_HELPER_PRIORITY_NORMAL, HEAP_SIZE, RT_SIZE, &other, &offsets[1]));
+	CHECK_EQ(other, block);
+
+	// Destroying an evicted resource takes it out of the count
+	CHECK(heaps.Evict(block));
+	CHECK(!heaps.Free(block, offsets[0], true));
+	CHECK_EQ(heaps.GetEvictedCount(block), 0u);
+	CHECK_EQ(heaps.GetResourceCount(block), 2u);
+}
+
+// Two pools with equal priority, created through the allocation worker: each pool's render targets are in its own heaps
+static void TestPools()
+{
+	PlacingDevice					   device;
+	EvictionHelperAllocationWorker	   worker;
+	EvictionHelperDeferredReleaseQueue releaseQueue(&device);
+	EvictionHelperPool				   poolA(&device, EVICTION_HELPER_RESOURCE_RENDER_TARGET, RT_SIZE, EVICTION_HELPER_PRIORITY_NORMAL);
+	EvictionHelperPool				   poolB(&device, EVICTION_HELPER_RESOURCE_RENDER_TARGET, RT_SIZE, EVICTION_HELPER_PRIORITY_NORMAL);
+
+	// Interleaved requests, so a table keyed by priority alone would mix them
+	for(int i = 0; i < 6; i++)
+	{
+		poolA.Update(&worker, &releaseQueue, (i + 1) * RT_SIZE);
+		poolB.Update(&worker, &releaseQueue, (i + 1) * RT_SIZE);
+		worker.ExecutePending();
+		EvictionHelperAllocationResult result;
+		while(worker.PopResult(&result))
+			result.Pool->OnAllocationResult(result);
+	}
+	CHECK_EQ(poolA.GetResourceCount(), 6u);
+	CHECK_EQ(poolB.GetResourceCount(), 6u);
+
+	// Every heap holds the resources of one pool only, six render targets take two heaps of four per pool
+	std::map<uint64_t, uint32_t> groupCounts;
+	std::map<uint32_t, uint64_t> blockGroups;
+	for(const auto& placed : device.Placed)
+	{
+		uint64_t group = placed.second.first;
+		uint32_t block = placed.second.second;
+		CHECK(group == reinterpret_cast<uintptr_t>(&poolA) || group == reinterpret_cast<uintptr_t>(&poolB));
+		CHECK_EQ(device.Heaps.GetPlacementGroup(block), group);
+		CHECK_EQ(blockGroups.emplace(block, group).first->second, group);
+		groupCounts[group]++;
+	}
+	printf("%zu heaps for %zu render targets of two pools\n", blockGroups.size(), device.Placed.size());
+	CHECK_EQ(groupCounts.size(), 2u);
+	CHECK_EQ(groupCounts[reinterpret_cast<uintptr_t>(&poolA)], 6u);
+	CHECK_EQ(blockGroups.size(), 4u);
+
+	// Evicting pool A evicts its two heaps once each and none of pool B, render targets created meanwhile get a new heap
+	std::vector<EvictionHelperResource> resourcesA = poolA.GetResources();
+	CHECK(device.Evict(resourcesA.data(), 6));
+	CHECK_EQ(device.HeapEvictions, 2);
+	std::map<uint32_t, uint32_t> evictedCounts;
+	for(EvictionHelperResource resource : resourcesA)
+		evictedCounts[device.Placed[resource].second]++;
+	for(const auto& block : blockGroups)
+		CHECK_EQ(device.Heaps.GetEvictedCount(block.first), evictedCounts[block.first]);
+
+	poolA.Update(&worker, &releaseQueue, 7 * RT_SIZE);
+	worker.ExecutePending();
+	EvictionHelperAllocationResult result;
+	while(worker.PopResult(&result))
+		result.Pool->OnAllocationResult(result);
+	uint32_t newBlock = device.Placed[poolA.GetResources()[6]].second;
+	CHECK_EQ(blockGroups.count(newBlock), 0u);
+	CHECK_EQ(device.Heaps.GetEvictedCount(newBlock), 0u);
+
+	CHECK(device.MakeResident(resourcesA.data(), 6));
+	CHECK_EQ(device.HeapEvictions, 0);
+
+	poolA.Release();
+	poolB.Release();
+}
+
+int main()
+{
+	RUN_TEST(TestGroupsNeverShare);
+	RUN_TEST(TestBlockReuse);
+	RUN_TEST(TestEvictedBlocks);
+	RUN_TEST(TestPools);
+	return TestResult();
+}
@@ -0,0 +1,134 @@
+// Pool requests through the allocation worker: cancel accounting while results are in flight, and frame times while
+// the worker thread creates several GB behind the frame loop
+
+#include "test_common.h"
+
+#include "eviction_helper_core.h"
+#include "eviction_helper_pool.h"
+#include "eviction_helper_sim_device.h"
+
+#include <unistd.h>
+
+static const uint64_t MB = 1024ULL * 1024ULL;
+
+// Hand every finished request back to its pool, returns the number of cancelled ones
+static int CollectResults(EvictionHelperAllocationWorker* worker)
+{
+	int							   cancelled = 0;
+	EvictionHelperAllocationResult result;
+	while(worker->PopResult(&result))
+	{
+		if(result.Status == EVICTION_HELPER_ALLOCATION_CANCELLED)
+			cancelled++;
+		result.Pool->OnAllocationResult(result);
+	}
+	return cancelled;
+}
+
+// The worker consumed the cancels but the CANCELLED results have not been collected when the next update runs
+static void TestCancelResultInFlight()
+{
+	EvictionHelperSimDevice			   device(1024 * MB, 1024 * MB);
+	EvictionHelperAllocationWorker	   worker;
+	EvictionHelperDeferredReleaseQueue releaseQueue(&device);
+	EvictionHelperPool				   pool(&device, EVICTION_HELPER_RESOURCE_RENDER_TARGET, RT_SIZE, EVICTION_HELPER_PRIORITY_NORMAL);
+
+	pool.Update(&worker, &releaseQueue, 4 * RT_SIZE);
+	CHECK_EQ(pool.GetPendingBytes(), 4 * RT_SIZE);
+	pool.Update(&worker, &releaseQueue, 2 * RT_SIZE);
+	CHECK_EQ(pool.GetPendingBytes(), 2 * RT_SIZE);
+
+	// Two requests skipped, two created, nothing collected yet: the update must see two on the way and do nothing
+	worker.ExecutePending();
+	pool.Update(&worker, &releaseQueue, 2 * RT_SIZE);
+	CHECK_EQ(pool.GetPendingBytes(), 2 * RT_SIZE);
+	CHECK_EQ(CollectResults(&worker), 2);
+	CHECK_EQ(pool.GetResourceCount(), 2u);
+	CHECK_EQ(pool.GetPendingBytes(), 0u);
+	CHECK(!pool.IsIdle());
+
+	// No cancel is left over to swallow the next request
+	pool.Update(&worker, &releaseQueue, 3 * RT_SIZE);
+	worker.ExecutePending();
+	CHECK_EQ(CollectResults(&worker), 0);
+	CHECK_EQ(pool.GetResourceCount(), 3u);
+	CHECK_EQ(releaseQueue.GetPendingBytes(), 0u);
+	pool.Release();
+}
+
+// Cancels issued for requests the worker had already created are taken back when the resources arrive
+static void TestCancelAfterCreate()
+{
+	EvictionHelperSimDevice			   device(1024 * MB, 1024 * MB);
+	EvictionHelperAllocationWorker	   worker;
+	EvictionHelperDeferredReleaseQueue releaseQueue(&device);
+	EvictionHelperPool				   pool(&device, EVICTION_HELPER_RESOURCE_RENDER_TARGET, RT_SIZE, EVICTION_HELPER_PRIORITY_NORMAL);
+
+	pool.Update(&worker, &releaseQueue, 3 * RT_SIZE);
+	worker.ExecutePending();
+	pool.Update(&worker, &releaseQueue, 0);
+	CHECK_EQ(CollectResults(&worker), 0);
+	CHECK_EQ(pool.GetResourceCount(), 3u);
+	CHECK_EQ(pool.GetPendingBytes(), 0u);
+
+	// The three arrived anyway, the next update releases them instead
+	pool.Update(&worker, &releaseQueue, 0);
+	CHECK_EQ(pool.GetResourceCount(), 0u);
+	CHECK_EQ(releaseQueue.GetPendingBytes(), 3 * RT_SIZE);
+
+	pool.Update(&worker, &releaseQueue, RT_SIZE);
+	worker.ExecutePending();
+	CHECK_EQ(CollectResults(&worker), 0);
+	CHECK_EQ(pool.GetResourceCount(), 1u);
+
+	releaseQueue.SignalFrame();
+	releaseQueue.Flush();
+	pool.Release();
+}
+
+// Ramp to 8 GB with every create taking 2 ms: the frame loop keeps running while the worker thread catches up
+static void TestAsyncRampFrameTime()
+{
+	TestSharedMemory		 sharedMem;
+	EvictionHelperSimDevice	 device(16384 * MB, 16384 * MB);
+	EvictionHelperHostDevice hostDevice;
+	device.SetCreationLatency(2000000);
+
+	EvictionHelperCore core(sharedMem.Get(), &device, &hostDevice, true);
+	core.InitializeDefaults();
+
+	EvictionHelperSharedData* data		   = sharedMem.Data();
+	const uint64_t			  targetBytes  = 8192 * MB;
+	const uint64_t			  createTimeNs = targetBytes / RT_SIZE * 2000000ULL;
+	data->TargetVRAMUsageMB				   = (int)(targetBytes / MB);
+
+	std::vector<uint64_t> frameTimes;
+	uint64_t			  startNs = EvictionHelper_GetTimestampNs();
+	while(data->CurrentVRAMAllocationBytes < targetBytes && EvictionHelper_GetTimestampNs() - startNs < 30000000000ULL)
+	{
+		uint64_t frameStartNs = EvictionHelper_GetTimestampNs();
+		core.ProcessCommands();
+		core.BeginFrame(1000000);
+		core.TouchActiveMemory();
+		core.EndFrame(1000000);
+		frameTimes.push_back(EvictionHelper_GetTimestampNs() - frameStartNs);
+		usleep(1000);
+	}
+	uint64_t rampNs = EvictionHelper_GetTimestampNs() - startNs;
+	printf("ramp to %llu MB in %.0f ms over %zu frames, creates alone take %.0f ms\n", (unsigned long long)(targetBytes / MB), rampNs / 1e6, frameTimes.size(), createTimeNs / 1e6);
+	PrintPercentilesUs("frame time during the ramp", frameTimes);
+
+	// The creates are spread over hundreds of frames and none of them waits for a create, the samples are sorted
+	CHECK_EQ(data->CurrentVRAMAllocationBytes, targetBytes);
+	CHECK(frameTimes.size() > 100);
+	CHECK(frameTimes.back() < 20000000ULL);
+	core.Shutdown();
+}
+
+int main()
+{
+	RUN_TEST(TestCancelResultInFlight);
+	RUN_TEST(TestCancelAfterCreate);
+	RUN_TEST(TestAsyncRampFrameTime);
+	return TestResult();
+}
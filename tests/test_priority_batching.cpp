@@ -0,0 +1,135 @@
+// Batched residency priority changes: one device call per pool flip, stale priorities from the worker fixed in one
+// batch, and the frame time of flipping a 32 GB pool on the simulated device with a per-call kernel cost
+
+#include "test_common.h"
+
+#include "eviction_helper_core.h"
+#include "eviction_helper_pool.h"
+#include "eviction_helper_sim_device.h"
+
+static const uint64_t MB = 1024ULL * 1024ULL;
+
+// Cost charged for every priority call, in the range of a kernel transition
+#define PRIORITY_CALL_LATENCY_NS 20000ULL
+
+static void CollectResults(EvictionHelperAllocationWorker* worker)
+{
+	EvictionHelperAllocationResult result;
+	while(worker->PopResult(&result))
+		result.Pool->OnAllocationResult(result);
+}
+
+static void TestPoolFlip()
+{
+	EvictionHelperSimDevice			   device(4096 * MB, 4096 * MB);
+	EvictionHelperAllocationWorker	   worker;
+	EvictionHelperDeferredReleaseQueue releaseQueue(&device);
+	EvictionHelperPool				   pool(&device, EVICTION_HELPER_RESOURCE_RENDER_TARGET, RT_SIZE, EVICTION_HELPER_PRIORITY_NORMAL);
+
+	pool.Update(&worker, &releaseQueue, 2048 * MB);
+	worker.ExecutePending();
+	CollectResults(&worker);
+	CHECK_EQ(pool.GetResourceCount(), 128u);
+
+	// Setting the same priority again costs nothing
+	pool.SetPriority(EVICTION_HELPER_PRIORITY_NORMAL);
+	CHECK_EQ(device.GetPriorityCallCount(), 0u);
+
+	pool.SetPriority(EVICTION_HELPER_PRIORITY_LOW);
+	CHECK_EQ(device.GetPriorityCallCount(), 1u);
+	CHECK_EQ(device.GetPriorityObjectCount(), 128u);
+	for(EvictionHelperResource resource : pool.GetResources())
+		CHECK_EQ(device.GetResidencyPriority(resource), EVICTION_HELPER_PRIORITY_LOW);
+	pool.Release();
+}
+
+// Requests queued before a flip arrive with the old priority, the next SetPriority() fixes all of them in one call
+static void TestStalePriorityBatch()
+{
+	EvictionHelperSimDevice			   device(4096 * MB, 4096 * MB);
+	EvictionHelperAllocationWorker	   worker;
+	EvictionHelperDeferredReleaseQueue releaseQueue(&device);
+	EvictionHelperPool				   pool(&device, EVICTION_HELPER_RESOURCE_RENDER_TARGET, RT_SIZE, EVICTION_HELPER_PRIORITY_NORMAL);
+
+	pool.Update(&worker, &releaseQueue, 512 * MB);
+	pool.SetPriority(EVICTION_HELPER_PRIORITY_HIGH);
+	CHECK_EQ(device.GetPriorityCallCount(), 0u);
+
+	worker.ExecutePending();
+	CollectResults(&worker);
+	CHECK_EQ(pool.GetResourceCount(), 32u);
+	CHECK_EQ(device.GetResidencyPriority(pool.GetResources()[0]), EVICTION_HELPER_PRIORITY_NORMAL);
+
+	pool.SetPriority(EVICTION_HELPER_PRIORITY_HIGH);
+	CHECK_EQ(device.GetPriorityCallCount(), 1u);
+	CHECK_EQ(device.GetPriorityObjectCount(), 32u);
+	for(EvictionHelperResource resource : pool.GetResources())
+		CHECK_EQ(device.GetResidencyPriority(resource), EVICTION_HELPER_PRIORITY_HIGH);
+
+	// Nothing is stale anymore
+	pool.SetPriority(EVICTION_HELPER_PRIORITY_HIGH);
+	CHECK_EQ(device.GetPriorityCallCount(), 1u);
+	pool.Release();
+}
+
+static uint64_t RunFrame(EvictionHelperCore* core)
+{
+	uint64_t startNs = EvictionHelper_GetTimestampNs();
+	core->ProcessCommands();
+	core->BeginFrame(33333333ULL);
+	core->TouchActiveMemory();
+	core->EndFrame(33333333ULL);
+	return EvictionHelper_GetTimestampNs() - startNs;
+}
+
+// 2048 render targets in the active pool and both standalone heaps in the unused one, flipped mid-run
+static void TestCoreFlip32GB()
+{
+	TestSharedMemory		 sharedMem;
+	EvictionHelperSimDevice	 device(65536 * MB, 65536 * MB);
+	EvictionHelperHostDevice hostDevice;
+	EvictionHelperCore		 core(sharedMem.Get(), &device, &hostDevice, false);
+	core.InitializeDefaults();
+
+	EvictionHelperSharedData* data = sharedMem.Data();
+	data->TargetVRAMUsageMB		   = 32768;
+	data->Allocate512MBHeap		   = 1;
+	data->Allocate1GBHeap		   = 1;
+	RunFrame(&core);
+	RunFrame(&core);
+	CHECK_EQ(data->AllocatedRenderTargetCount, 2048u);
+
+	device.SetPriorityCallLatency(PRIORITY_CALL_LATENCY_NS);
+	uint64_t callsBefore   = device.GetPriorityCallCount();
+	uint64_t objectsBefore = device.GetPriorityObjectCount();
+	uint64_t baseNs		   = RunFrame(&core);
+
+	data->ActiveVRAMPriority = EVICTION_HELPER_PRIORITY_LOW;
+	uint64_t activeFlipNs	 = RunFrame(&core);
+	CHECK_EQ(device.GetPriorityCallCount() - callsBefore, 1u);
+	CHECK_EQ(device.GetPriorityObjectCount() - objectsBefore, 2048u);
+
+	data->UnusedVRAMPriority = EVICTION_HELPER_PRIORITY_MINIMUM;
+	uint64_t heapFlipNs		 = RunFrame(&core);
+	CHECK_EQ(device.GetPriorityCallCount() - callsBefore, 2u);
+	CHECK_EQ(device.GetPriorityObjectCount() - objectsBefore, 2050u);
+
+	// The same flip one resource at a time, for comparison
+	uint64_t startNs = EvictionHelper_GetTimestampNs();
+	for(int i = 0; i < 2048; i++)
+		device.SetResidencyPriority(1, EVICTION_HELPER_PRIORITY_LOW);
+	uint64_t unbatchedNs = EvictionHelper_GetTimestampNs() - startNs;
+
+	printf("frame %.2f ms, active flip %.2f ms, heap flip %.2f ms, unbatched 2048 calls %.2f ms\n", baseNs / 1e6, activeFlipNs / 1e6, heapFlipNs / 1e6, unbatchedNs / 1e6);
+	CHECK(activeFlipNs < 16000000ULL);
+	CHECK(activeFlipNs < unbatchedNs / 4);
+	core.Shutdown();
+}
+
+int main()
+{
+	RUN_TEST(TestPoolFlip);
+	RUN_TEST(TestStalePriorityBatch);
+	RUN_TEST(TestCoreFlip32GB);
+	return TestResult();
+}
@@ -0,0 +1,109 @@
+// Rate-limited pool ramps: the limiter itself, and a 10 minute ramp of the core on the simulated device driven by a
+// virtual clock, checked minute by minute in well under a second of wall time
+
+#include "test_common.h"
+
+#include "eviction_helper_core.h"
+#include "eviction_helper_ramp.h"
+#include "eviction_helper_sim_device.h"
+
+#include <cmath>
+
+#define FRAME_TIME_NS 16666667ULL // 60 FPS of virtual time
+
+static const uint64_t MB = 1024ULL * 1024ULL;
+
+static void TestLimiter()
+{
+	RampLimiter ramp;
+	CHECK_EQ(ramp.Update(1000 * MB, 100.0 * MB, 50.0 * MB, 1.0), 100 * MB);
+	CHECK(!ramp.IsAtTarget());
+	CHECK_EQ(ramp.Update(1000 * MB, 100.0 * MB, 50.0 * MB, 20.0), 1000 * MB);
+	CHECK(ramp.IsAtTarget());
+
+	// Down at its own rate
+	CHECK_EQ(ramp.Update(0, 100.0 * MB, 50.0 * MB, 2.0), 900 * MB);
+
+	// A rate of 0 jumps
+	CHECK_EQ(ramp.Update(0, 100.0 * MB, 0.0, 1.0), 0u);
+	CHECK_EQ(ramp.Update(4096 * MB, 0.0, 0.0, 0.001), 4096 * MB);
+	CHECK(ramp.IsAtTarget());
+}
+
+// 1 byte per second at 1024 FPS adds less than a byte per frame, the position still moves
+static void TestSlowRamp()
+{
+	RampLimiter ramp;
+	for(int frame = 0; frame < 10240; frame++)
+		ramp.Update(1000, 1.0, 1.0, 1.0 / 1024.0);
+	CHECK_EQ(ramp.GetPositionBytes(), 10u);
+}
+
+static void RunFrames(EvictionHelperCore* core, int count)
+{
+	for(int frame = 0; frame < count; frame++)
+	{
+		core->ProcessCommands();
+		core->BeginFrame(FRAME_TIME_NS);
+		core->TouchActiveMemory();
+		core->EndFrame(FRAME_TIME_NS);
+	}
+}
+
+// 0 to 12000 MB at 20 MB/s takes 600 s of virtual time, then down to 7000 MB at 100 MB/s in 50 s
+// A barrier pushed with the target completes once the ramp has arrived
+static void TestVirtualClockRamp()
+{
+	TestSharedMemory		 sharedMem;
+	EvictionHelperSimDevice	 device(32768 * MB, 32768 * MB);
+	EvictionHelperHostDevice hostDevice;
+	EvictionHelperCore		 core(sharedMem.Get(), &device, &hostDevice, false);
+	core.InitializeDefaults();
+
+	EvictionHelperSharedData* data						   = sharedMem.Data();
+	data->RampUpMBPerSecond[EVICTION_HELPER_POOL_ACTIVE]   = 20.0f;
+	data->RampDownMBPerSecond[EVICTION_HELPER_POOL_ACTIVE] = 100.0f;
+	data->TargetVRAMUsageMB								   = 12000;
+
+	uint64_t barrier = EvictionHelper_PushCommand(data, EVICTION_HELPER_COMMAND_BARRIER, 0, 0, 0);
+
+	const int framesPerMinute = 60 * 60;
+	uint64_t  startNs		  = EvictionHelper_GetTimestampNs();
+	for(int minute = 1; minute <= 10; minute++)
+	{
+		RunFrames(&core, framesPerMinute);
+		double	 expectedMB = std::min(12000.0, 20.0 * 60.0 * minute);
+		uint64_t position	= data->RampPositionBytes[EVICTION_HELPER_POOL_ACTIVE];
+		CHECK(std::fabs(position / (double)MB - expectedMB) < 1.0);
+
+		// The pool follows the position, rounded up to whole render targets
+		CHECK(data->CurrentVRAMAllocationBytes >= position);
+		CHECK(data->CurrentVRAMAllocationBytes < position + RT_SIZE);
+		CHECK(!EvictionHelper_IsCommandComplete(data, barrier));
+	}
+	CHECK_EQ(data->CurrentVRAMAllocationBytes, 12000 * MB);
+
+	// The barrier completes with the first commands processed after the ramp arrived
+	RunFrames(&core, 1);
+	CHECK(EvictionHelper_IsCommandComplete(data, barrier));
+
+	data->TargetVRAMUsageMB = 7000;
+	RunFrames(&core, 25 * 60);
+	CHECK(std::fabs(data->RampPositionBytes[EVICTION_HELPER_POOL_ACTIVE] / (double)MB - 9500.0) < 1.0);
+	RunFrames(&core, 25 * 60);
+	CHECK_EQ(data->RampPositionBytes[EVICTION_HELPER_POOL_ACTIVE], 7000 * MB);
+	CHECK_EQ(data->CurrentVRAMAllocationBytes, (7000 * MB + RT_SIZE - 1) / RT_SIZE * RT_SIZE);
+
+	double seconds = (EvictionHelper_GetTimestampNs() - startNs) / 1e9;
+	printf("650 s of virtual time in %.3f s\n", seconds);
+	CHECK(seconds < 10.0);
+	core.Shutdown();
+}
+
+int main()
+{
+	RUN_TEST(TestLimiter);
+	RUN_TEST(TestSlowRamp);
+	RUN_TEST(TestVirtualClockRamp);
+	return TestResult();
+}
@@ -0,0 +1,164 @@
+// EVICT and MAKE_RESIDENT commands against the simulated device with a fixed paging bandwidth: the published bytes,
+// durations and bandwidth, blocking and enqueued page-in, and evicted resources staying untouched
+
+#include "test_common.h"
+
+#include "eviction_helper_core.h"
+#include "eviction_helper_sim_device.h"
+
+static const uint64_t MB = 1024ULL * 1024ULL;
+
+#define PAGING_BYTES_PER_SECOND (64ULL << 30)
+
+static void RunFrames(EvictionHelperCore* core, int count)
+{
+	for(int frame = 0; frame < count; frame++)
+	{
+		core->ProcessCommands();
+		core->BeginFrame(1000000);
+		core->TouchActiveMemory();
+		core->EndFrame(1000000);
+	}
+}
+
+// Run frames until a command completes, false if it takes longer than a second
+// Enqueued page-ins complete on the simulated device by wall time, not by frames
+static bool RunUntilComplete(EvictionHelperCore* core, EvictionHelperSharedData* data, uint64_t sequence)
+{
+	uint64_t deadline = EvictionHelper_GetTimestampNs() + 1000000000ULL;
+	while(!EvictionHelper_IsCommandComplete(data, sequence))
+	{
+		if(EvictionHelper_GetTimestampNs() >= deadline)
+			return false;
+		RunFrames(core, 1);
+	}
+	return true;
+}
+
+// Published timings of an operation that moved bytes at the paging bandwidth, sleeping may only make it slower
+static void CheckBandwidth(const EvictionHelperSharedData* data, uint64_t bytes)
+{
+	uint64_t transferNs = bytes * 1000000000ULL / PAGING_BYTES_PER_SECOND;
+	CHECK_EQ(data->ResidencyOpStatus, (uint32_t)EVICTION_HELPER_RESIDENCY_OP_DONE);
+	CHECK_EQ(data->ResidencyOpBytes, bytes);
+	CHECK(data->ResidencyOpDurationNs >= transferNs);
+	CHECK(data->ResidencyOpBytesPerSecond <= PAGING_BYTES_PER_SECOND);
+	CHECK(data->ResidencyOpBytesPerSecond > PAGING_BYTES_PER_SECOND / 4);
+	printf("%-14s %5llu MB in %7.2f ms, device call %7.2f ms, %6.2f GB/s\n", data->ResidencyOpType == EVICTION_HELPER_COMMAND_EVICT ? "evict" : "make resident",
+		   (unsigned long long)(bytes / MB), data->ResidencyOpDurationNs / 1e6, data->ResidencyOpSubmitNs / 1e6, data->ResidencyOpBytesPerSecond / (double)(1ULL << 30));
+}
+
+static void TestEvictAndMakeResident()
+{
+	TestSharedMemory		 sharedMem;
+	EvictionHelperSimDevice	 device(8192 * MB, 16384 * MB);
+	EvictionHelperHostDevice hostDevice;
+	EvictionHelperCore		 core(sharedMem.Get(), &device, &hostDevice, false);
+	device.SetPagingBandwidth(PAGING_BYTES_PER_SECOND);
+	core.InitializeDefaults();
+
+	EvictionHelperSharedData* data = sharedMem.Data();
+	data->TargetVRAMUsageMB		   = 1024;
+	data->TargetUnusedVRAMUsageMB  = 2048;
+	RunFrames(&core, 2);
+
+	uint64_t sequence = EvictionHelper_PushCommand(data, EVICTION_HELPER_COMMAND_EVICT, EVICTION_HELPER_POOL_UNUSED, 0, 0);
+	CHECK(RunUntilComplete(&core, data, sequence));
+	CheckBandwidth(data, 2048 * MB);
+	CHECK_EQ(data->ResidencyOpSequence, sequence);
+	CHECK_EQ(data->ResidencyOpPool, (uint32_t)EVICTION_HELPER_POOL_UNUSED);
+	CHECK_EQ(data->EvictedPoolBytes[EVICTION_HELPER_POOL_UNUSED], 2048 * MB);
+	RunFrames(&core, 1);
+	CHECK_EQ(data->NonLocalCurrentUsage, 2048 * MB);
+
+	uint64_t pageIns = device.GetPageInCount();
+	sequence		 = EvictionHelper_PushCommand(data, EVICTION_HELPER_COMMAND_MAKE_RESIDENT, EVICTION_HELPER_POOL_UNUSED, EVICTION_HELPER_MAKE_RESIDENT_BLOCKING, 0);
+	CHECK(RunUntilComplete(&core, data, sequence));
+	CheckBandwidth(data, 2048 * MB);
+	CHECK_EQ(data->EvictedPoolBytes[EVICTION_HELPER_POOL_UNUSED], 0u);
+	CHECK_EQ(device.GetPageInCount() - pageIns, 128u);
+	RunFrames(&core, 1);
+	CHECK_EQ(data->NonLocalCurrentUsage, 0u);
+	core.Shutdown();
+}
+
+// An evicted active pool is not touched, so nothing is paged back in until the enqueued page-in completes
+static void TestEnqueueMakeResident()
+{
+	TestSharedMemory		 sharedMem;
+	EvictionHelperSimDevice	 device(8192 * MB, 16384 * MB);
+	EvictionHelperHostDevice hostDevice;
+	EvictionHelperCore		 core(sharedMem.Get(), &device, &hostDevice, false);
+	device.SetPagingBandwidth(PAGING_BYTES_PER_SECOND);
+	core.InitializeDefaults();
+
+	EvictionHelperSharedData* data = sharedMem.Data();
+	data->TargetVRAMUsageMB		   = 1024;
+	RunFrames(&core, 2);
+
+	uint64_t sequence = EvictionHelper_PushCommand(data, EVICTION_HELPER_COMMAND_EVICT, EVICTION_HELPER_POOL_ACTIVE, 0, 0);
+	CHECK(RunUntilComplete(&core, data, sequence));
+	uint64_t pageIns = device.GetPageInCount();
+	RunFrames(&core, 10);
+	CHECK_EQ(device.GetPageInCount(), pageIns);
+	CHECK_EQ(data->EvictedPoolBytes[EVICTION_HELPER_POOL_ACTIVE], 1024 * MB);
+
+	// The enqueue returns right away, a barrier behind it waits for the residency fence
+	sequence		 = EvictionHelper_PushCommand(data, EVICTION_HELPER_COMMAND_MAKE_RESIDENT, EVICTION_HELPER_POOL_ACTIVE, EVICTION_HELPER_MAKE_RESIDENT_ENQUEUE, 0);
+	uint64_t barrier = EvictionHelper_PushCommand(data, EVICTION_HELPER_COMMAND_BARRIER, 0, 0, 0);
+	CHECK(RunUntilComplete(&core, data, barrier));
+	CHECK(EvictionHelper_IsCommandComplete(data, sequence));
+	CheckBandwidth(data, 1024 * MB);
+	CHECK_EQ(data->ResidencyOpMode, (uint32_t)EVICTION_HELPER_MAKE_RESIDENT_ENQUEUE);
+	CHECK(data->ResidencyOpSubmitNs < data->ResidencyOpDurationNs);
+	CHECK_EQ(data->EvictedPoolBytes[EVICTION_HELPER_POOL_ACTIVE], 0u);
+	core.Shutdown();
+}
+
+static void TestInvalidTarget()
+{
+	TestSharedMemory		 sharedMem;
+	EvictionHelperSimDevice	 device(1024 * MB, 1024 * MB);
+	EvictionHelperHostDevice hostDevice;
+	EvictionHelperCore		 core(sharedMem.Get(), &device, &hostDevice, false);
+	core.InitializeDefaults();
+
+	EvictionHelperSharedData* data	   = sharedMem.Data();
+	uint64_t				  sequence = EvictionHelper_PushCommand(data, EVICTION_HELPER_COMMAND_EVICT, EVICTION_HELPER_POOL_NAMED(EVICTION_HELPER_MAX_NAMED_POOLS), 0, 0);
+	CHECK(RunUntilComplete(&core, data, sequence));
+	CHECK_EQ(data->ResidencyOpStatus, (uint32_t)EVICTION_HELPER_RESIDENCY_OP_FAILED);
+	core.Shutdown();
+}
+
+// Shrinking an evicted pool releases evicted resources without destroying anything still in flight
+static void TestShrinkWhileEvicted()
+{
+	TestSharedMemory		 sharedMem;
+	EvictionHelperSimDevice	 device(8192 * MB, 16384 * MB);
+	EvictionHelperHostDevice hostDevice;
+	EvictionHelperCore		 core(sharedMem.Get(), &device, &hostDevice, false);
+	device.SetFrameLatency(2);
+	core.InitializeDefaults();
+
+	EvictionHelperSharedData* data = sharedMem.Data();
+	data->TargetUnusedVRAMUsageMB  = 2048;
+	RunFrames(&core, 2);
+
+	EvictionHelper_PushCommand(data, EVICTION_HELPER_COMMAND_EVICT, EVICTION_HELPER_POOL_UNUSED, 0, 0);
+	EvictionHelper_PushCommand(data, EVICTION_HELPER_COMMAND_SET_TARGET, EVICTION_HELPER_POOL_UNUSED, 512, 0);
+	uint64_t barrier = EvictionHelper_PushCommand(data, EVICTION_HELPER_COMMAND_BARRIER, 0, 0, 0);
+	CHECK(RunUntilComplete(&core, data, barrier));
+	CHECK_EQ(data->CurrentUnusedVRAMAllocationBytes, 512 * MB);
+	CHECK_EQ(data->EvictedPoolBytes[EVICTION_HELPER_POOL_UNUSED], 512 * MB);
+	CHECK_EQ(device.GetInFlightDestroyCount(), 0u);
+	core.Shutdown();
+}
+
+int main()
+{
+	RUN_TEST(TestEvictAndMakeResident);
+	RUN_TEST(TestEnqueueMakeResident);
+	RUN_TEST(TestInvalidTarget);
+	RUN_TEST(TestShrinkWhileEvicted);
+	return TestResult();
+}
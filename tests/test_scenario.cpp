@@ -0,0 +1,393 @@
+// Scenarios: the parser and its errors, the value of each segment shape over time, the next value jump, the core running
+// a minute long scenario on the frame clock in a few frames of the simulated device, and the monotonic clock with the
+// wake time a service loop sleeps until
+
+#include "test_common.h"
+
+#include "eviction_helper_core.h"
+#include "eviction_helper_scenario.h"
+#include "eviction_helper_sim_device.h"
+
+#include <cmath>
+#include <thread>
+
+static const uint64_t MB = 1024ULL * 1024ULL;
+
+static const char* SCENARIO_PATH = "test_scenario.txt";
+
+static void WriteScenario(const char* text)
+{
+	FILE* file = fopen(SCENARIO_PATH, "w");
+	CHECK(file != nullptr);
+	fputs(text, file);
+	fclose(file);
+}
+
+// Value of target/property at timeSeconds, -1 if the track has not started
+static int GetValue(const EvictionHelperScenario& scenario, double timeSeconds, uint32_t target, uint32_t property)
+{
+	std::vector<EvictionHelperScenarioValue> values;
+	scenario.Evaluate(timeSeconds, &values);
+	for(const EvictionHelperScenarioValue& value : values)
+	{
+		if(value.Target == target && value.Property == property)
+			return value.Value;
+	}
+	return -1;
+}
+
+static void TestParse()
+{
+	EvictionHelperScenario scenario;
+	CHECK(scenario.Parse("# comment\r\n"
+						 "step 0 active priority high   # trailing comment\r\n"
+						 "\r\n"
+						 "ramp 0 20 active size 1024 6144\n"
+						 "square 20 60 unused size 0 2048 4 25\n"
+						 "random 20 60 host size 256 768 64 0.5 7\n"
+						 "sawtooth 0 10 named15 size 0 100 2\n"
+						 "end 60\n"
+						 "loop"));
+	CHECK_EQ(scenario.GetSegmentCount(), 5u);
+	CHECK_EQ(scenario.GetDurationSeconds(), 60.0);
+	CHECK(scenario.IsLooping());
+
+	const EvictionHelperScenarioSegment& step = scenario.GetSegment(0);
+	CHECK_EQ(step.Line, 2u);
+	CHECK_EQ(step.Shape, (uint32_t)EVICTION_HELPER_SCENARIO_STEP);
+	CHECK_EQ(step.Property, (uint32_t)EVICTION_HELPER_SCENARIO_PRIORITY);
+	CHECK_EQ(step.From, (double)EVICTION_HELPER_PRIORITY_HIGH);
+
+	const EvictionHelperScenarioSegment& square = scenario.GetSegment(2);
+	CHECK_EQ(square.Line, 5u);
+	CHECK_EQ(square.Target, (uint32_t)EVICTION_HELPER_POOL_UNUSED);
+	CHECK_EQ(square.Period, 4.0);
+	CHECK_EQ(square.Duty, 0.25);
+
+	// 40 s in intervals of 0.5 s
+	CHECK_EQ(scenario.GetSegment(3).Walk.size(), 80u);
+	CHECK_EQ(scenario.GetSegment(4).Target, (uint32_t)EVICTION_HELPER_POOL_NAMED(15));
+
+	// Without an end line the scenario lasts until the last segment ends
+	CHECK(scenario.Parse("step 5 active size 10\nramp 2 8 unused size 0 1\n"));
+	CHECK_EQ(scenario.GetDurationSeconds(), 8.0);
+	CHECK(!scenario.IsLooping());
+
+	// The first bad line is reported and the scenario is left empty
+	struct BadScenario
+	{
+		const char* Text;
+		uint32_t	Line;
+		const char* Error;
+	};
+	const BadScenario bad[] = {
+		{ "step 0 active size 1\njump 0 active size 1\n", 2, "line 2: unknown keyword" },
+		{ "step 0 active size\n", 1, "line 1: wrong number of arguments" },
+		{ "step 0 named16 size 1\n", 1, "line 1: unknown target" },
+		{ "step 0 active color 1\n", 1, "line 1: unknown property" },
+		{ "step 0 active priority 7\n", 1, "line 1: invalid value" },
+		{ "ramp 5 2 active size 1 2\n", 1, "line 1: invalid end time" },
+		{ "square 0 10 unused size 5 1 0\n", 1, "line 1: invalid period" },
+		{ "square 0 10 unused size 0 1 2 150\n", 1, "line 1: invalid duty percentage" },
+		{ "random 0 10 host size 9 1 1 1\n", 1, "line 1: min is above max" },
+		{ "random 0 1e9 host size 0 1 1 1\n", 1, "line 1: too many random walk steps" },
+		{ "# empty\n", 0, "no segments" },
+		{ "loop\nstep 0 active size 1\n", 0, "loop needs a length above 0" },
+	};
+	for(const BadScenario& entry : bad)
+	{
+		CHECK(!scenario.Parse(entry.Text));
+		CHECK(scenario.IsEmpty());
+		CHECK_EQ(scenario.GetErrorLine(), entry.Line);
+		CHECK(scenario.GetError() == entry.Error);
+	}
+
+	CHECK(!scenario.Load("missing_scenario.txt"));
+	CHECK(scenario.GetError() == "cannot open the file");
+}
+
+static void TestShapes()
+{
+	EvictionHelperScenario scenario;
+	CHECK(scenario.Parse("step 1 active priority low\n"
+						 "ramp 0 10 active size 0 1000\n"
+						 "sawtooth 0 10 unused size 0 100 4\n"
+						 "square 0 10 host size 10 20 4 25\n"
+						 "random 0 10 unused_host size 0 1000 100 1 3\n"
+						 "step 5 active size 50\n"
+						 "step 5 active size 60\n"));
+
+	// Before its first segment a track is left alone
+	CHECK_EQ(GetValue(scenario, 0.5, EVICTION_HELPER_POOL_ACTIVE, EVICTION_HELPER_SCENARIO_PRIORITY), -1);
+	CHECK_EQ(GetValue(scenario, 1.0, EVICTION_HELPER_POOL_ACTIVE, EVICTION_HELPER_SCENARIO_PRIORITY), EVICTION_HELPER_PRIORITY_LOW);
+
+	// Ramp up to 5 s, then the later of the two steps at 5 s wins and holds
+	CHECK_EQ(GetValue(scenario, 2.5, EVICTION_HELPER_POOL_ACTIVE, EVICTION_HELPER_SCENARIO_SIZE), 250);
+	CHECK_EQ(GetValue(scenario, 5.0, EVICTION_HELPER_POOL_ACTIVE, EVICTION_HELPER_SCENARIO_SIZE), 60);
+	CHECK_EQ(GetValue(scenario, 30.0, EVICTION_HELPER_POOL_ACTIVE, EVICTION_HELPER_SCENARIO_SIZE), 60);
+
+	// Rises over each 4 s period, the last period is cut at the end and its value is held
+	CHECK_EQ(GetValue(scenario, 1.0, EVICTION_HELPER_POOL_UNUSED, EVICTION_HELPER_SCENARIO_SIZE), 25);
+	CHECK_EQ(GetValue(scenario, 4.0, EVICTION_HELPER_POOL_UNUSED, EVICTION_HELPER_SCENARIO_SIZE), 0);
+	CHECK_EQ(GetValue(scenario, 7.0, EVICTION_HELPER_POOL_UNUSED, EVICTION_HELPER_SCENARIO_SIZE), 75);
+	CHECK_EQ(GetValue(scenario, 10.0, EVICTION_HELPER_POOL_UNUSED, EVICTION_HELPER_SCENARIO_SIZE), 50);
+	CHECK_EQ(GetValue(scenario, 20.0, EVICTION_HELPER_POOL_UNUSED, EVICTION_HELPER_SCENARIO_SIZE), 50);
+
+	// High for the first second of every 4
+	CHECK_EQ(GetValue(scenario, 0.0, EVICTION_HELPER_POOL_HOST_ACTIVE, EVICTION_HELPER_SCENARIO_SIZE), 20);
+	CHECK_EQ(GetValue(scenario, 0.99, EVICTION_HELPER_POOL_HOST_ACTIVE, EVICTION_HELPER_SCENARIO_SIZE), 20);
+	CHECK_EQ(GetValue(scenario, 1.0, EVICTION_HELPER_POOL_HOST_ACTIVE, EVICTION_HELPER_SCENARIO_SIZE), 10);
+	CHECK_EQ(GetValue(scenario, 4.5, EVICTION_HELPER_POOL_HOST_ACTIVE, EVICTION_HELPER_SCENARIO_SIZE), 20);
+
+	// Starts halfway and moves by one step per interval, within the limits
+	CHECK_EQ(GetValue(scenario, 0.5, EVICTION_HELPER_POOL_HOST_UNUSED, EVICTION_HELPER_SCENARIO_SIZE), 500);
+	int previous = 500;
+	for(int i = 1; i < 10; i++)
+	{
+		int value = GetValue(scenario, i + 0.5, EVICTION_HELPER_POOL_HOST_UNUSED, EVICTION_HELPER_SCENARIO_SIZE);
+		CHECK_EQ(std::abs(value - previous), 100);
+		CHECK(value >= 0 && value <= 1000);
+		previous = value;
+	}
+
+	// The same seed walks the same way
+	EvictionHelperScenario again;
+	CHECK(again.Parse("random 0 10 unused_host size 0 1000 100 1 3\n"));
+	for(int i = 0; i < 10; i++)
+		CHECK_EQ(GetValue(again, i, EVICTION_HELPER_POOL_HOST_UNUSED, EVICTION_HELPER_SCENARIO_SIZE), GetValue(scenario, i, EVICTION_HELPER_POOL_HOST_UNUSED, EVICTION_HELPER_SCENARIO_SIZE));
+
+	CHECK_EQ(scenario.GetCurrentSegment(0.5), 4);
+	CHECK_EQ(scenario.GetCurrentSegment(6.0), 6);
+}
+
+static void TestNextChange()
+{
+	EvictionHelperScenario scenario;
+	CHECK(scenario.Parse("square 1 9 unused size 0 100 2 25\n"
+						 "ramp 0 20 active size 0 1000\n"
+						 "step 12 host size 5\n"
+						 "end 15\n"));
+
+	// Square edges at 1.5, 3, 3.5, ..., the ramp never jumps, then the step and the end
+	CHECK_EQ(scenario.GetNextChangeSeconds(0.0), 1.0);
+	CHECK_EQ(scenario.GetNextChangeSeconds(1.0), 1.5);
+	CHECK_EQ(scenario.GetNextChangeSeconds(1.5), 3.0);
+	CHECK_EQ(scenario.GetNextChangeSeconds(7.6), 12.0);
+	CHECK_EQ(scenario.GetNextChangeSeconds(12.0), 15.0);
+	CHECK(std::isinf(scenario.GetNextChangeSeconds(15.0)));
+
+	// A jump time computed by GetNextChangeSeconds() lands in the new value
+	double next = scenario.GetNextChangeSeconds(2.0);
+	CHECK_EQ(GetValue(scenario, next, EVICTION_HELPER_POOL_UNUSED, EVICTION_HELPER_SCENARIO_SIZE), 100);
+	next = scenario.GetNextChangeSeconds(next);
+	CHECK_EQ(GetValue(scenario, next, EVICTION_HELPER_POOL_UNUSED, EVICTION_HELPER_SCENARIO_SIZE), 0);
+}
+
+static void RunFrame(EvictionHelperCore* core, uint64_t frameTimeNs)
+{
+	core->ProcessCommands();
+	core->BeginFrame(frameTimeNs);
+	core->TouchActiveMemory();
+	core->EndFrame(frameTimeNs);
+}
+
+// A minute of scenario on the frame clock, 100 ms per frame
+static void TestCoreFrameClock()
+{
+	WriteScenario("step 0 active priority high\n"
+				  "ramp 0 20 active size 1024 6144\n"
+				  "square 20 60 unused size 0 2048 4 25\n"
+				  "random 20 60 host size 16 64 8 0.5 7\n"
+				  "step 30 named2 priority low\n"
+				  "step 30 named2 size 300\n"
+				  "end 60\n");
+
+	TestSharedMemory		 sharedMem;
+	EvictionHelperSimDevice	 device(65536 * MB, 65536 * MB);
+	EvictionHelperHostDevice hostDevice;
+	EvictionHelperCore		 core(sharedMem.Get(), &device, &hostDevice, false);
+	core.InitializeDefaults();
+
+	EvictionHelperSharedData* data = sharedMem.Data();
+	data->NamedPoolCount		   = 3;
+	data->NamedPools[2].Kind	   = EVICTION_HELPER_POOL_KIND_HEAP;
+	snprintf(data->ScenarioPath, sizeof(data->ScenarioPath), "%s", SCENARIO_PATH);
+	data->Scenario = 1;
+
+	uint64_t startNs = EvictionHelper_GetTimestampNs();
+	RunFrame(&core, 0);
+	CHECK_EQ(data->ScenarioState, (uint32_t)EVICTION_HELPER_SCENARIO_STATE_RUNNING);
+	CHECK_EQ(data->ScenarioStepCount, 6u);
+	CHECK_EQ(data->ScenarioDurationNs, 60000000000ULL);
+	CHECK_EQ(data->ActiveVRAMPriority, EVICTION_HELPER_PRIORITY_HIGH);
+	CHECK_EQ(data->TargetVRAMUsageMB, 1024);
+
+	for(int frame = 0; frame < 100; frame++)
+		RunFrame(&core, 100000000ULL);
+	CHECK_EQ(data->ScenarioTimeNs, 10000000000ULL);
+	CHECK_EQ(data->TargetVRAMUsageMB, 3584);
+	CHECK_EQ(data->ScenarioStepLine, 2u);
+
+	for(int frame = 0; frame < 105; frame++)
+		RunFrame(&core, 100000000ULL);
+	CHECK_EQ(data->TargetVRAMUsageMB, 6144);
+	CHECK_EQ(data->TargetUnusedVRAMUsageMB, 2048);
+	CHECK(data->TargetHostMemoryUsageMB >= 16 && data->TargetHostMemoryUsageMB <= 64);
+
+	// High for the first second of each 4 s period, the random walk on the later line is the current step
+	for(int frame = 0; frame < 6; frame++)
+		RunFrame(&core, 100000000ULL);
+	CHECK_EQ(data->TargetUnusedVRAMUsageMB, 0);
+	CHECK_EQ(data->ScenarioStepLine, 4u);
+
+	// The later line of the two steps at 30 s is current, both are applied
+	for(int frame = 0; frame < 90; frame++)
+		RunFrame(&core, 100000000ULL);
+	CHECK_EQ(data->ScenarioStepLine, 6u);
+	CHECK_EQ(data->NamedPools[2].TargetMB, 300);
+	CHECK_EQ(data->NamedPools[2].Priority, EVICTION_HELPER_PRIORITY_LOW);
+	RunFrame(&core, 100000000ULL);
+	CHECK_EQ(data->NamedPools[2].AllocatedBytes, 320 * MB);
+
+	// After the end the inputs belong to the user again
+	for(int frame = 0; frame < 300; frame++)
+		RunFrame(&core, 100000000ULL);
+	CHECK_EQ(data->ScenarioState, (uint32_t)EVICTION_HELPER_SCENARIO_STATE_FINISHED);
+	CHECK_EQ(data->ScenarioTimeNs, 60000000000ULL);
+	data->TargetVRAMUsageMB = 100;
+	RunFrame(&core, 100000000ULL);
+	CHECK_EQ(data->TargetVRAMUsageMB, 100);
+	uint64_t elapsedNs = EvictionHelper_GetTimestampNs() - startNs;
+	printf("60 s scenario on the frame clock in %.1f ms\n", elapsedNs / 1e6);
+
+	data->Scenario = 0;
+	RunFrame(&core, 0);
+	CHECK_EQ(data->ScenarioState, (uint32_t)EVICTION_HELPER_SCENARIO_STATE_IDLE);
+
+	// A bad file is reported with its line
+	WriteScenario("step 0 active size 1\nsquare 0 10 unused size 5 1 0\n");
+	data->Scenario = 1;
+	RunFrame(&core, 0);
+	CHECK_EQ(data->ScenarioState, (uint32_t)EVICTION_HELPER_SCENARIO_STATE_FAILED);
+	CHECK_EQ(data->ScenarioErrorLine, 2u);
+	CHECK(strcmp(data->ScenarioError, "line 2: invalid period") == 0);
+	core.Shutdown();
+	remove(SCENARIO_PATH);
+}
+
+// A looping 50 ms square wave on the monotonic clock, applied by ProcessCommands() between 33 ms frames while the loop
+// sleeps until GetNextCommandTimeNs() like the service does
+static void TestCoreMonotonicClock()
+{
+	WriteScenario("loop\nsquare 0 0.2 unused size 100 200 0.1\nend 0.2\n");
+
+	TestSharedMemory		 sharedMem;
+	EvictionHelperSimDevice	 device(8192 * MB, 8192 * MB);
+	EvictionHelperHostDevice hostDevice;
+	EvictionHelperCore		 core(sharedMem.Get(), &device, &hostDevice, false);
+	core.InitializeDefaults();
+
+	EvictionHelperSharedData* data = sharedMem.Data();
+	snprintf(data->ScenarioPath, sizeof(data->ScenarioPath), "%s", SCENARIO_PATH);
+	data->ScenarioClock = EVICTION_HELPER_SCENARIO_CLOCK_MONOTONIC;
+	data->Scenario		= 1;
+	RunFrame(&core, 0);
+
+	uint64_t startNs	 = EvictionHelper_GetTimestampNs();
+	uint64_t lastFrameNs = startNs;
+	uint64_t maxLateNs	 = 0;
+	int		 edges		 = 0;
+	int		 value		 = data->TargetUnusedVRAMUsageMB;
+	while(EvictionHelper_GetTimestampNs() - startNs < 500000000ULL)
+	{
+		uint64_t wakeNs = lastFrameNs + 33000000ULL;
+		uint64_t nextNs = core.GetNextCommandTimeNs();
+		CHECK(nextNs != 0);
+		wakeNs = std::min(wakeNs, nextNs);
+
+		uint64_t now = EvictionHelper_GetTimestampNs();
+		if(wakeNs > now)
+			std::this_thread::sleep_for(std::chrono::nanoseconds(wakeNs - now));
+
+		core.ProcessCommands();
+		if(data->TargetUnusedVRAMUsageMB != value)
+		{
+			value = data->TargetUnusedVRAMUsageMB;
+			edges++;
+			maxLateNs = std::max(maxLateNs, EvictionHelper_GetTimestampNs() - nextNs);
+		}
+
+		now = EvictionHelper_GetTimestampNs();
+		if(now - lastFrameNs >= 33000000ULL)
+		{
+			RunFrame(&core, now - lastFrameNs);
+			lastFrameNs = now;
+		}
+	}
+	printf("monotonic: %d edges in 500 ms, %u loops, applied at most %.3f ms late\n", edges, data->ScenarioLoopCount, maxLateNs / 1e6);
+	CHECK(edges >= 9 && edges <= 11);
+	CHECK(data->ScenarioLoopCount >= 2);
+	CHECK(maxLateNs < 10000000ULL);
+	core.Shutdown();
+	remove(SCENARIO_PATH);
+}
+
+// A blocked command at the head of the ring does not hide the next scenario step, and only future execute times count
+static void TestNextCommandTime()
+{
+	WriteScenario("square 0 10 unused size 0 100 1\n");
+
+	TestSharedMemory		 sharedMem;
+	EvictionHelperSimDevice	 device(8192 * MB, 16384 * MB);
+	EvictionHelperHostDevice hostDevice;
+	EvictionHelperCore		 core(sharedMem.Get(), &device, &hostDevice, false);
+	device.SetPagingBandwidth(1ULL << 30);
+	core.InitializeDefaults();
+
+	EvictionHelperSharedData* data = sharedMem.Data();
+	data->TargetVRAMUsageMB		   = 256;
+	RunFrame(&core, 1000000);
+	CHECK_EQ(core.GetNextCommandTimeNs(), 0u);
+
+	// A delayed command is a wake time
+	uint64_t delayedNs = EvictionHelper_GetTimestampNs() + 1000000000ULL;
+	uint64_t delayed   = EvictionHelper_PushCommand(data, EVICTION_HELPER_COMMAND_SET_TARGET, EVICTION_HELPER_POOL_ACTIVE, 256, delayedNs);
+	CHECK_EQ(core.GetNextCommandTimeNs(), delayedNs);
+	while(!EvictionHelper_IsCommandComplete(data, delayed))
+		RunFrame(&core, 1000000);
+
+	snprintf(data->ScenarioPath, sizeof(data->ScenarioPath), "%s", SCENARIO_PATH);
+	data->ScenarioClock = EVICTION_HELPER_SCENARIO_CLOCK_MONOTONIC;
+	data->Scenario		= 1;
+	RunFrame(&core, 1000000);
+
+	// Evicted and enqueued back at 1 GB/s, the barrier behind the page-in waits for the residency fence
+	uint64_t evict = EvictionHelper_PushCommand(data, EVICTION_HELPER_COMMAND_EVICT, EVICTION_HELPER_POOL_ACTIVE, 0, 0);
+	while(!EvictionHelper_IsCommandComplete(data, evict))
+		RunFrame(&core, 1000000);
+	EvictionHelper_PushCommand(data, EVICTION_HELPER_COMMAND_MAKE_RESIDENT, EVICTION_HELPER_POOL_ACTIVE, EVICTION_HELPER_MAKE_RESIDENT_ENQUEUE, 0);
+	uint64_t barrier = EvictionHelper_PushCommand(data, EVICTION_HELPER_COMMAND_BARRIER, 0, 0, 0);
+	core.ProcessCommands();
+	CHECK(!EvictionHelper_IsCommandComplete(data, barrier));
+
+	uint64_t nextNs = core.GetNextCommandTimeNs();
+	uint64_t now	= EvictionHelper_GetTimestampNs();
+	CHECK(nextNs > now);
+	CHECK(nextNs <= now + 500000000ULL);
+
+	while(!EvictionHelper_IsCommandComplete(data, barrier))
+		RunFrame(&core, 1000000);
+	core.Shutdown();
+	remove(SCENARIO_PATH);
+}
+
+int main()
+{
+	RUN_TEST(TestParse);
+	RUN_TEST(TestShapes);
+	RUN_TEST(TestNextChange);
+	RUN_TEST(TestCoreFrameClock);
+	RUN_TEST(TestCoreMonotonicClock);
+	RUN_TEST(TestNextCommandTime);
+	return TestResult();
+}
@@ -0,0 +1,193 @@
+// Headless service loop: a controller driving it only through shared memory commands and signals against the
+// simulated device and host memory, delayed commands applied between frames, the CPU cost while nobody talks to it,
+// and shutdown on request
+
+#include "test_common.h"
+
+#include "eviction_helper_core.h"
+#include "eviction_helper_service.h"
+#include "eviction_helper_sim_device.h"
+
+#include <thread>
+
+static const uint64_t MB = 1024ULL * 1024ULL;
+
+// Service loop on its own thread, as the headless executable runs it
+class TestService
+{
+public:
+	TestService(EvictionHelperDevice* vramDevice, uint32_t framesPerSecond)
+		: m_Core(m_SharedMem.Get(), vramDevice, &m_HostDevice, true)
+	{
+		m_Core.InitializeDefaults();
+		EvictionHelperSharedData* data		= m_SharedMem.Data();
+		data->TargetVRAMUsageMB				= 0;
+		data->TargetUnusedVRAMUsageMB		= 0;
+		data->TargetHostMemoryUsageMB		= 0;
+		data->TargetUnusedHostMemoryUsageMB = 0;
+		data->FrameRate						= framesPerSecond;
+		data->IsRunning						= 1;
+		m_Thread							= std::thread([this] { EvictionHelper_RunService(m_SharedMem.Get(), &m_Core, nullptr); });
+	}
+
+	~TestService()
+	{
+		Stop();
+		m_Core.Shutdown();
+	}
+
+	// Request shutdown and wait for the loop, returns how long it took
+	uint64_t Stop()
+	{
+		if(!m_Thread.joinable())
+			return 0;
+
+		uint64_t startNs					= EvictionHelper_GetTimestampNs();
+		m_SharedMem.Data()->RequestShutdown = 1;
+		EvictionHelper_SignalHelper(m_SharedMem.Get());
+		m_Thread.join();
+		return EvictionHelper_GetTimestampNs() - startNs;
+	}
+
+	EvictionHelperSharedMemory* Get() { return m_SharedMem.Get(); }
+	EvictionHelperSharedData*	Data() { return m_SharedMem.Data(); }
+
+private:
+	TestSharedMemory		 m_SharedMem;
+	EvictionHelperHostDevice m_HostDevice;
+	EvictionHelperCore		 m_Core;
+	std::thread				 m_Thread;
+};
+
+// Push a command followed by a barrier, signal the helper and wait for the barrier, returns the round trip
+static uint64_t SetTargetAndWait(TestService* service, uint32_t pool, int64_t targetMB)
+{
+	EvictionHelperSharedData* data	  = service->Data();
+	uint64_t				  startNs = EvictionHelper_GetTimestampNs();
+	CHECK(EvictionHelper_PushCommand(data, EVICTION_HELPER_COMMAND_SET_TARGET, pool, targetMB, 0) != 0);
+	uint64_t barrier = EvictionHelper_PushCommand(data, EVICTION_HELPER_COMMAND_BARRIER, 0, 0, 0);
+	EvictionHelper_SignalHelper(service->Get());
+	while(!EvictionHelper_IsCommandComplete(data, barrier) && EvictionHelper_GetTimestampNs() - startNs < 2000000000ULL)
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+	CHECK(EvictionHelper_IsCommandComplete(data, barrier));
+	return EvictionHelper_GetTimestampNs() - startNs;
+}
+
+// 200 rounds of growing and shrinking the active pool. Shrinks wait for the frame fence, so a frame ends every round
+// trip, without a release budget per frame one is enough.
+static void TestCommandSoak()
+{
+	EvictionHelperSimDevice device(8192 * MB, 16384 * MB);
+	device.SetCreationLatency(20000);
+	TestService				  service(&device, 60);
+	EvictionHelperSharedData* data = service.Data();
+	data->ReleaseBudgetMBPerFrame  = 0;
+
+	std::vector<uint64_t> roundTripsNs;
+	for(int round = 0; round < 200; round++)
+	{
+		int64_t targetMB = (round % 2) ? 2048 : 512;
+		roundTripsNs.push_back(SetTargetAndWait(&service, EVICTION_HELPER_POOL_ACTIVE, targetMB));
+		CHECK_EQ(data->TargetVRAMUsageMB, targetMB);
+		CHECK_EQ(data->CurrentVRAMAllocationBytes, static_cast<uint64_t>(targetMB) * MB);
+	}
+	uint64_t frames = data->FrameCount;
+	PrintPercentilesUs("grow/shrink round trip", roundTripsNs);
+	CHECK(roundTripsNs[roundTripsNs.size() / 2] < 50000000ULL);
+
+	uint64_t stopNs = service.Stop();
+	printf("stopped in %.3f ms after %llu frames\n", stopNs / 1e6, (unsigned long long)frames);
+	CHECK(stopNs < 100000000ULL);
+	CHECK_EQ(device.GetInFlightDestroyCount(), 0u);
+}
+
+// At one frame per second growing commands are applied on the signal, not with the next frame
+static void TestCommandsBetweenFrames()
+{
+	EvictionHelperSimDevice	  device(8192 * MB, 16384 * MB);
+	TestService				  service(&device, 1);
+	EvictionHelperSharedData* data = service.Data();
+
+	std::vector<uint64_t> roundTripsNs;
+	for(int round = 0; round < 50; round++)
+	{
+		roundTripsNs.push_back(SetTargetAndWait(&service, EVICTION_HELPER_POOL_ACTIVE, 64 * (round + 1)));
+		CHECK_EQ(data->CurrentVRAMAllocationBytes, 64 * (round + 1) * MB);
+	}
+	uint64_t frames = data->FrameCount;
+	PrintPercentilesUs("grow round trip at 1 fps", roundTripsNs);
+	CHECK(frames <= 3);
+	CHECK(roundTripsNs[roundTripsNs.size() * 99 / 100] < 100000000ULL);
+}
+
+// A delayed command is applied when it is due rather than with the next frame
+static void TestDelayedCommand()
+{
+	EvictionHelperSimDevice	  device(8192 * MB, 16384 * MB);
+	TestService				  service(&device, 1);
+	EvictionHelperSharedData* data = service.Data();
+	SetTargetAndWait(&service, EVICTION_HELPER_POOL_ACTIVE, 256);
+
+	std::vector<uint64_t> latesNs;
+	for(int i = 0; i < 10; i++)
+	{
+		uint64_t dueNs	  = EvictionHelper_GetTimestampNs() + 50000000ULL;
+		uint64_t sequence = EvictionHelper_PushCommand(data, EVICTION_HELPER_COMMAND_SET_TARGET, EVICTION_HELPER_POOL_UNUSED, 64 * (i + 1), dueNs);
+		EvictionHelper_SignalHelper(service.Get());
+		while(!EvictionHelper_IsCommandComplete(data, sequence) && EvictionHelper_GetTimestampNs() < dueNs + 2000000000ULL)
+			std::this_thread::yield();
+		CHECK(EvictionHelper_IsCommandComplete(data, sequence));
+		uint64_t now = EvictionHelper_GetTimestampNs();
+		CHECK(now >= dueNs);
+		latesNs.push_back(now - dueNs);
+	}
+	PrintPercentilesUs("delayed command applied after due", latesNs);
+	CHECK(latesNs[latesNs.size() / 2] < 10000000ULL);
+}
+
+// Without a controller the loop sleeps between 30 touches per second
+static void TestIdleCost()
+{
+	EvictionHelperSimDevice device(8192 * MB, 16384 * MB);
+	TestService				service(&device, 30);
+	SetTargetAndWait(&service, EVICTION_HELPER_POOL_ACTIVE, 1024);
+
+	uint64_t frames	 = service.Data()->FrameCount;
+	uint64_t cpuNs	 = GetProcessCpuTimeNs();
+	uint64_t startNs = EvictionHelper_GetTimestampNs();
+	std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+	uint64_t wallNs = EvictionHelper_GetTimestampNs() - startNs;
+	cpuNs			= GetProcessCpuTimeNs() - cpuNs;
+	frames			= service.Data()->FrameCount - frames;
+
+	printf("idle: %llu frames in %.0f ms, %.2f%% of a core\n", (unsigned long long)frames, wallNs / 1e6, 100.0 * cpuNs / wallNs);
+	CHECK(frames >= 25 && frames <= 35);
+	CHECK(cpuNs < wallNs / 10);
+}
+
+// The same control path with the VRAM pools in real host memory, host memory comes in chunks of 64 MB
+static void TestHostMemoryBackend()
+{
+	EvictionHelperHostDevice  vramDevice;
+	TestService				  service(&vramDevice, 30);
+	EvictionHelperSharedData* data = service.Data();
+	for(int round = 0; round < 20; round++)
+	{
+		int64_t targetMB = (round % 2) ? 192 : 64;
+		SetTargetAndWait(&service, EVICTION_HELPER_POOL_ACTIVE, targetMB);
+		SetTargetAndWait(&service, EVICTION_HELPER_POOL_HOST_ACTIVE, 256 - targetMB);
+		CHECK_EQ(data->CurrentVRAMAllocationBytes, static_cast<uint64_t>(targetMB) * MB);
+		CHECK_EQ(data->CurrentHostMemoryAllocationBytes, static_cast<uint64_t>(256 - targetMB) * MB);
+	}
+	CHECK(service.Stop() < 100000000ULL);
+}
+
+int main()
+{
+	RUN_TEST(TestCommandSoak);
+	RUN_TEST(TestCommandsBetweenFrames);
+	RUN_TEST(TestDelayedCommand);
+	RUN_TEST(TestIdleCost);
+	RUN_TEST(TestHostMemoryBackend);
+	return TestResult();
+}
@@ -0,0 +1,208 @@
+// POSIX shared memory transport: create, open from a second process, mapping flags and cleanup, a second helper
+// refused while the first runs, mappings left behind by a crashed helper, and the fallback from hugetlbfs to shm_open
+
+// A plain directory stands in for hugetlbfs, so the file backed path also runs where hugetlbfs is not mounted
+#define EVICTION_HELPER_HUGETLBFS_DIR "/tmp"
+
+#include "test_common.h"
+
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Child writes into the mapping it opened by name, parent checks it sees the writes and vice versa
+static void RoundTrip(uint32_t flags)
+{
+	EvictionHelperSharedMemory helper;
+	CHECK(EvictionHelper_CreateSharedMemoryEx(&helper, GetTestSharedMemoryName(), flags));
+	if(!helper.pData)
+		return;
+
+	CHECK(helper.MappedSize >= sizeof(EvictionHelperSharedData));
+	CHECK_EQ(helper.pData->FrameCount, 0u);
+	helper.pData->TargetVRAMUsageMB = 4242;
+	helper.pData->BudgetControlKp	= 0.5f;
+
+	pid_t pid = fork();
+	if(pid == 0)
+	{
+		EvictionHelperSharedMemory controller;
+		if(!EvictionHelper_OpenSharedMemoryEx(&controller, GetTestSharedMemoryName(), flags))
+			_exit(2);
+		int ok = controller.pData->TargetVRAMUsageMB == 4242 && controller.pData->BudgetControlKp == 0.5f && controller.IsOwner == 0;
+		controller.pData->FrameCount = 77;
+		controller.pData->BudgetGeneration.store(5);
+		EvictionHelper_CloseSharedMemory(&controller);
+		_exit(ok ? 0 : 3);
+	}
+
+	int status = 0;
+	waitpid(pid, &status, 0);
+	CHECK(WIFEXITED(status));
+	CHECK_EQ(WEXITSTATUS(status), 0);
+	CHECK_EQ(helper.pData->FrameCount, 77u);
+	CHECK_EQ(helper.pData->BudgetGeneration.load(), 5u);
+
+	// The controller closing its view must not remove the name, the owner closing it must
+	EvictionHelperSharedMemory reopened;
+	CHECK(EvictionHelper_OpenSharedMemoryEx(&reopened, GetTestSharedMemoryName(), EVICTION_HELPER_MAPPING_DEFAULT));
+	EvictionHelper_CloseSharedMemory(&reopened);
+
+	EvictionHelper_CloseSharedMemory(&helper);
+	CHECK(helper.pData == NULL);
+	CHECK(!EvictionHelper_OpenSharedMemoryEx(&reopened, GetTestSharedMemoryName(), EVICTION_HELPER_MAPPING_DEFAULT));
+}
+
+static void TestDefaultMapping()
+{
+	RoundTrip(EVICTION_HELPER_MAPPING_DEFAULT);
+}
+
+static void TestPopulatedMapping()
+{
+	RoundTrip(EVICTION_HELPER_MAPPING_POPULATE);
+}
+
+static void TestHugePageMapping()
+{
+	RoundTrip(EVICTION_HELPER_MAPPING_HUGE_PAGES | EVICTION_HELPER_MAPPING_POPULATE);
+}
+
+// File the mapping uses when it is placed on hugetlbfs
+static std::string GetHugeTlbFsPath()
+{
+	return std::string(EVICTION_HELPER_HUGETLBFS_DIR) + GetTestSharedMemoryName();
+}
+
+static bool Exists(const std::string& path)
+{
+	struct stat st;
+	return stat(path.c_str(), &st) == 0;
+}
+
+// A child creates the mapping and exits without closing it, like a helper that crashed
+static void LeaveStaleMapping(uint32_t flags)
+{
+	const char* name = GetTestSharedMemoryName();
+	pid_t		pid	 = fork();
+	if(pid == 0)
+	{
+		EvictionHelperSharedMemory helper;
+		if(!EvictionHelper_CreateSharedMemoryEx(&helper, name, flags))
+			_exit(2);
+		helper.pData->TargetVRAMUsageMB = 1234;
+		_exit(0);
+	}
+	int status = 0;
+	waitpid(pid, &status, 0);
+	CHECK(WIFEXITED(status));
+	CHECK_EQ(WEXITSTATUS(status), 0);
+}
+
+// A second helper must not zero the mapping of a running one, on either backing
+static void TestCreateWhileRunning()
+{
+	EvictionHelperSharedMemory helper;
+	CHECK(EvictionHelper_CreateSharedMemoryEx(&helper, GetTestSharedMemoryName(), EVICTION_HELPER_MAPPING_DEFAULT));
+	helper.pData->TargetVRAMUsageMB = 4242;
+
+	EvictionHelperSharedMemory second;
+	CHECK(!EvictionHelper_CreateSharedMemoryEx(&second, GetTestSharedMemoryName(), EVICTION_HELPER_MAPPING_DEFAULT));
+	CHECK(!EvictionHelper_CreateSharedMemoryEx(&second, GetTestSharedMemoryName(), EVICTION_HELPER_MAPPING_HUGE_PAGES));
+	CHECK(second.pData == NULL);
+	CHECK_EQ(helper.pData->TargetVRAMUsageMB, 4242);
+
+	// Names must be valid shm_open() names
+	CHECK(!EvictionHelper_CreateSharedMemoryEx(&second, "NoSlash", EVICTION_HELPER_MAPPING_DEFAULT));
+	EvictionHelper_CloseSharedMemory(&helper);
+}
+
+// The mapping of a helper that crashed is not locked, the next helper takes it over and starts from zero
+static void TestStaleMapping()
+{
+	LeaveStaleMapping(EVICTION_HELPER_MAPPING_DEFAULT);
+	EvictionHelperSharedMemory controller;
+	CHECK(EvictionHelper_OpenSharedMemoryEx(&controller, GetTestSharedMemoryName(), EVICTION_HELPER_MAPPING_DEFAULT));
+	CHECK_EQ(controller.pData->TargetVRAMUsageMB, 1234);
+	EvictionHelper_CloseSharedMemory(&controller);
+
+	EvictionHelperSharedMemory helper;
+	CHECK(EvictionHelper_CreateSharedMemoryEx(&helper, GetTestSharedMemoryName(), EVICTION_HELPER_MAPPING_DEFAULT));
+	CHECK_EQ(helper.pData->TargetVRAMUsageMB, 0);
+	EvictionHelper_CloseSharedMemory(&helper);
+	CHECK(!EvictionHelper_OpenSharedMemoryEx(&controller, GetTestSharedMemoryName(), EVICTION_HELPER_MAPPING_DEFAULT));
+}
+
+// A stale shm object next to the running helper's hugetlbfs file must not hide it from controllers
+static void TestStaleMappingOnOtherBacking()
+{
+	LeaveStaleMapping(EVICTION_HELPER_MAPPING_DEFAULT);
+
+	EvictionHelperSharedMemory helper;
+	CHECK(EvictionHelper_CreateSharedMemoryEx(&helper, GetTestSharedMemoryName(), EVICTION_HELPER_MAPPING_HUGE_PAGES));
+	CHECK_EQ(helper.IsHugeTlbFs, 1u);
+	helper.pData->TargetVRAMUsageMB = 4242;
+
+	EvictionHelperSharedMemory controller;
+	CHECK(EvictionHelper_OpenSharedMemoryEx(&controller, GetTestSharedMemoryName(), EVICTION_HELPER_MAPPING_DEFAULT));
+	CHECK_EQ(controller.IsHugeTlbFs, 1u);
+	CHECK_EQ(controller.pData->TargetVRAMUsageMB, 4242);
+	EvictionHelper_CloseSharedMemory(&controller);
+	EvictionHelper_CloseSharedMemory(&helper);
+	CHECK(!Exists(GetHugeTlbFsPath()));
+
+	// The stale object is still there and opens again once the helper is gone
+	CHECK(EvictionHelper_OpenSharedMemoryEx(&controller, GetTestSharedMemoryName(), EVICTION_HELPER_MAPPING_DEFAULT));
+	CHECK_EQ(controller.IsHugeTlbFs, 0u);
+	EvictionHelper_CloseSharedMemory(&controller);
+	shm_unlink(GetTestSharedMemoryName());
+}
+
+// A hugetlbfs file that cannot be sized (here a FIFO) is removed and the mapping falls back to shm_open
+static void TestHugePageFallback()
+{
+	CHECK_EQ(mkfifo(GetHugeTlbFsPath().c_str(), 0600), 0);
+
+	EvictionHelperSharedMemory helper;
+	CHECK(EvictionHelper_CreateSharedMemoryEx(&helper, GetTestSharedMemoryName(), EVICTION_HELPER_MAPPING_HUGE_PAGES));
+	CHECK(helper.pData != NULL);
+	CHECK_EQ(helper.IsHugeTlbFs, 0u);
+	CHECK(!Exists(GetHugeTlbFsPath()));
+
+	EvictionHelperSharedMemory controller;
+	CHECK(EvictionHelper_OpenSharedMemoryEx(&controller, GetTestSharedMemoryName(), EVICTION_HELPER_MAPPING_DEFAULT));
+	EvictionHelper_CloseSharedMemory(&controller);
+	EvictionHelper_CloseSharedMemory(&helper);
+	unlink(GetHugeTlbFsPath().c_str());
+}
+
+static void TestOpenWithoutHelper()
+{
+	EvictionHelperSharedMemory controller;
+	CHECK(!EvictionHelper_OpenSharedMemoryEx(&controller, GetTestSharedMemoryName(), EVICTION_HELPER_MAPPING_DEFAULT));
+	CHECK(controller.pData == NULL);
+}
+
+static void TestMappingSize()
+{
+	size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+	size_t size		= EvictionHelper_GetMappingSize(false);
+	CHECK(size >= sizeof(EvictionHelperSharedData));
+	CHECK_EQ(size % pageSize, 0u);
+	CHECK(size - sizeof(EvictionHelperSharedData) < pageSize);
+	CHECK_EQ(EvictionHelper_GetMappingSize(true) % EVICTION_HELPER_HUGE_PAGE_SIZE, 0u);
+}
+
+int main()
+{
+	RUN_TEST(TestOpenWithoutHelper);
+	RUN_TEST(TestMappingSize);
+	RUN_TEST(TestDefaultMapping);
+	RUN_TEST(TestPopulatedMapping);
+	RUN_TEST(TestHugePageMapping);
+	RUN_TEST(TestCreateWhileRunning);
+	RUN_TEST(TestStaleMapping);
+	RUN_TEST(TestStaleMappingOnOtherBacking);
+	RUN_TEST(TestHugePageFallback);
+	return TestResult();
+}
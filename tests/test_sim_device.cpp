@@ -0,0 +1,176 @@
+// Simulated residency device: memory info, eviction by priority and LRU, page-in on touch, creation limits, fences,
+// and the core running headless on it
+
+#include "test_common.h"
+
+#include "eviction_helper_core.h"
+#include "eviction_helper_sim_device.h"
+
+static const uint64_t MB = 1024ULL * 1024ULL;
+
+static void RunDeviceFrame(EvictionHelperSimDevice* device, uint64_t frame, const std::vector<EvictionHelperResource>& touched)
+{
+	device->BeginFrame(frame);
+	for(EvictionHelperResource resource : touched)
+		device->TouchResource(resource);
+	device->EndFrame();
+}
+
+static void TestMemoryInfo()
+{
+	EvictionHelperSimDevice	 device(64 * MB, 128 * MB);
+	EvictionHelperMemoryInfo local;
+	EvictionHelperMemoryInfo nonLocal;
+
+	EvictionHelperResource a = device.CreateResource(EVICTION_HELPER_RESOURCE_RENDER_TARGET, 16 * MB, EVICTION_HELPER_PRIORITY_NORMAL);
+	EvictionHelperResource b = device.CreateResource(EVICTION_HELPER_RESOURCE_HEAP, 32 * MB, EVICTION_HELPER_PRIORITY_NORMAL);
+	CHECK(a != 0 && b != 0);
+	device.QueryMemoryInfo(&local, &nonLocal);
+	CHECK_EQ(local.Budget, 64 * MB);
+	CHECK_EQ(local.CurrentUsage, 48 * MB);
+	CHECK_EQ(nonLocal.Budget, 128 * MB);
+	CHECK_EQ(nonLocal.CurrentUsage, 0u);
+
+	CHECK(device.Evict(&b, 1));
+	device.QueryMemoryInfo(&local, &nonLocal);
+	CHECK_EQ(local.CurrentUsage, 16 * MB);
+	CHECK_EQ(nonLocal.CurrentUsage, 32 * MB);
+
+	device.DestroyResource(b);
+	device.DestroyResource(a);
+	device.QueryMemoryInfo(&local, &nonLocal);
+	CHECK_EQ(local.CurrentUsage, 0u);
+	CHECK_EQ(nonLocal.CurrentUsage, 0u);
+}
+
+// Over budget, the lowest priority goes first, then the least recently touched within a priority
+static void TestEvictionOrder()
+{
+	EvictionHelperSimDevice device(64 * MB, 1024 * MB);
+
+	EvictionHelperResource low	  = device.CreateResource(EVICTION_HELPER_RESOURCE_RENDER_TARGET, 16 * MB, EVICTION_HELPER_PRIORITY_LOW);
+	EvictionHelperResource oldest = device.CreateResource(EVICTION_HELPER_RESOURCE_RENDER_TARGET, 16 * MB, EVICTION_HELPER_PRIORITY_NORMAL);
+	EvictionHelperResource older  = device.CreateResource(EVICTION_HELPER_RESOURCE_RENDER_TARGET, 16 * MB, EVICTION_HELPER_PRIORITY_NORMAL);
+	EvictionHelperResource high	  = device.CreateResource(EVICTION_HELPER_RESOURCE_RENDER_TARGET, 16 * MB, EVICTION_HELPER_PRIORITY_HIGH);
+	RunDeviceFrame(&device, 1, { oldest });
+	RunDeviceFrame(&device, 2, { older, high, low });
+	CHECK_EQ(device.GetEvictionCount(), 0u);
+
+	// 64 MB resident in a 32 MB budget: the low priority one goes first even though it was touched last frame
+	device.SetLocalBudget(32 * MB);
+	RunDeviceFrame(&device, 3, {});
+	CHECK(!device.IsResident(low));
+	CHECK(!device.IsResident(oldest));
+	CHECK(device.IsResident(older));
+	CHECK(device.IsResident(high));
+	CHECK_EQ(device.GetEvictionCount(), 2u);
+
+	// Raising the priority of the evicted one does not page it in, touching it does and pushes out the next LRU
+	device.SetResidencyPriority(oldest, EVICTION_HELPER_PRIORITY_MAXIMUM);
+	CHECK(!device.IsResident(oldest));
+	RunDeviceFrame(&device, 4, { oldest });
+	CHECK(device.IsResident(oldest));
+	CHECK(!device.IsResident(older));
+	CHECK_EQ(device.GetPageInCount(), 1u);
+	CHECK_EQ(device.GetPageInBytes(), 16 * MB);
+}
+
+// Resources used by the current frame stay resident even at the lowest priority
+static void TestCurrentFrameStaysResident()
+{
+	EvictionHelperSimDevice device(32 * MB, 1024 * MB);
+
+	EvictionHelperResource hot	= device.CreateResource(EVICTION_HELPER_RESOURCE_RENDER_TARGET, 16 * MB, EVICTION_HELPER_PRIORITY_MINIMUM);
+	EvictionHelperResource cold = device.CreateResource(EVICTION_HELPER_RESOURCE_RENDER_TARGET, 16 * MB, EVICTION_HELPER_PRIORITY_MAXIMUM);
+	device.SetLocalBudget(16 * MB);
+	RunDeviceFrame(&device, 1, { hot });
+	CHECK(device.IsResident(hot));
+	CHECK(!device.IsResident(cold));
+}
+
+static void TestCreationLimit()
+{
+	EvictionHelperSimDevice device(32 * MB, 32 * MB);
+
+	std::vector<EvictionHelperResource> resources;
+	for(int i = 0; i < 4; i++)
+		resources.push_back(device.CreateResource(EVICTION_HELPER_RESOURCE_RENDER_TARGET, 16 * MB, EVICTION_HELPER_PRIORITY_NORMAL));
+	for(EvictionHelperResource resource : resources)
+		CHECK(resource != 0);
+	CHECK_EQ(device.CreateResource(EVICTION_HELPER_RESOURCE_RENDER_TARGET, 16 * MB, EVICTION_HELPER_PRIORITY_NORMAL), 0u);
+
+	// Slots of destroyed resources are reused
+	device.DestroyResource(resources[1]);
+	CHECK_EQ(device.CreateResource(EVICTION_HELPER_RESOURCE_RENDER_TARGET, 16 * MB, EVICTION_HELPER_PRIORITY_NORMAL), resources[1]);
+}
+
+// Frames complete SetFrameLatency() signals later, destroying a resource before that is counted
+static void TestFrameLatency()
+{
+	EvictionHelperSimDevice device(64 * MB, 64 * MB);
+	device.SetFrameLatency(2);
+
+	EvictionHelperResource resource = device.CreateResource(EVICTION_HELPER_RESOURCE_RENDER_TARGET, 16 * MB, EVICTION_HELPER_PRIORITY_NORMAL);
+	RunDeviceFrame(&device, 1, { resource });
+	uint64_t touchedFence = device.Signal();
+	CHECK(device.GetCompletedFenceValue() < touchedFence);
+	device.Signal();
+	CHECK(device.GetCompletedFenceValue() < touchedFence);
+	device.Signal();
+	CHECK(device.GetCompletedFenceValue() >= touchedFence);
+
+	EvictionHelperResource early = device.CreateResource(EVICTION_HELPER_RESOURCE_RENDER_TARGET, 16 * MB, EVICTION_HELPER_PRIORITY_NORMAL);
+	RunDeviceFrame(&device, 2, { early });
+	device.Signal();
+	device.DestroyResource(early);
+	device.DestroyResource(resource);
+	CHECK_EQ(device.GetInFlightDestroyCount(), 1u);
+}
+
+// The whole core on the simulated device with both pools together over budget, thousands of frames per second
+static void TestHeadlessCore()
+{
+	TestSharedMemory		 sharedMem;
+	EvictionHelperSimDevice	 device(1024 * MB, 4096 * MB);
+	EvictionHelperHostDevice hostDevice;
+	EvictionHelperCore		 core(sharedMem.Get(), &device, &hostDevice, false);
+	core.InitializeDefaults();
+
+	EvictionHelperSharedData* data = sharedMem.Data();
+	data->TargetVRAMUsageMB		   = 768;
+	data->TargetUnusedVRAMUsageMB  = 512;
+
+	const int frameCount = 3000;
+	uint64_t  startNs	 = EvictionHelper_GetTimestampNs();
+	for(int frame = 0; frame < frameCount; frame++)
+	{
+		core.ProcessCommands();
+		core.BeginFrame(33333333ULL);
+		core.TouchActiveMemory();
+		core.EndFrame(33333333ULL);
+	}
+	double seconds = (EvictionHelper_GetTimestampNs() - startNs) / 1e9;
+	printf("%d frames in %.3f s, %.0f frames/s\n", frameCount, seconds, frameCount / seconds);
+
+	// The active pool is touched every frame and outranks the unused pool, which is pushed out of the budget
+	CHECK_EQ(data->CurrentVRAMAllocationBytes, 768 * MB);
+	CHECK_EQ(data->CurrentUnusedVRAMAllocationBytes, 512 * MB);
+	CHECK_EQ(data->LocalBudget, 1024 * MB);
+	CHECK(data->LocalCurrentUsage <= 1024 * MB);
+	CHECK_EQ(data->LocalCurrentUsage + data->NonLocalCurrentUsage, 1280 * MB);
+	CHECK_EQ(data->FrameCount, (uint64_t)frameCount);
+	CHECK_EQ(device.GetPageInCount(), 0u);
+	CHECK(frameCount / seconds > 1000.0);
+	core.Shutdown();
+}
+
+int main()
+{
+	RUN_TEST(TestMemoryInfo);
+	RUN_TEST(TestEvictionOrder);
+	RUN_TEST(TestCurrentFrameStaysResident);
+	RUN_TEST(TestCreationLimit);
+	RUN_TEST(TestFrameLatency);
+	RUN_TEST(TestHeadlessCore);
+	return TestResult();
+}
@@ -0,0 +1,189 @@
+// Seqlock snapshots: one writer and several reader processes on the POSIX mapping, no reader may ever see a snapshot
+// that mixes two writes
+
+#include "test_common.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define SNAPSHOT_READER_COUNT 3
+#define SNAPSHOT_WRITE_TIME_NS 2000000000ULL
+
+static_assert(sizeof(EvictionHelperSnapshot) % sizeof(uint64_t) == 0, "The stress test fills the snapshot word by word");
+
+static const size_t SnapshotWordCount = sizeof(EvictionHelperSnapshot) / sizeof(uint64_t);
+
+// Every word of the snapshot is derived from the write index, so a torn copy has words from two indices
+static uint64_t SnapshotWord(uint64_t writeIndex, size_t word)
+{
+	return (writeIndex + 1) * 0x9E3779B97F4A7C15ULL ^ ((uint64_t)word << 56);
+}
+
+static void FillSnapshot(EvictionHelperSnapshot* snapshot, uint64_t writeIndex)
+{
+	uint64_t words[SnapshotWordCount];
+	for(size_t i = 0; i < SnapshotWordCount; i++)
+		words[i] = SnapshotWord(writeIndex, i);
+	memcpy(snapshot, words, sizeof(words));
+}
+
+// Returns the write index the snapshot was filled from, or UINT64_MAX if its words disagree
+static uint64_t CheckSnapshot(const EvictionHelperSnapshot* snapshot)
+{
+	uint64_t words[SnapshotWordCount];
+	memcpy(words, snapshot, sizeof(words));
+
+	uint64_t writeIndex = (words[0] * 0xF1DE83E19937733DULL) - 1; // Inverse of the golden ratio multiplier
+	for(size_t i = 0; i < SnapshotWordCount; i++)
+	{
+		if(words[i] != SnapshotWord(writeIndex, i))
+			return UINT64_MAX;
+	}
+	return writeIndex;
+}
+
+// Counts of one reader process, in an anonymous shared mapping so the parent can print them
+struct ReaderResult
+{
+	uint64_t Reads;
+	uint64_t TornReads;
+	uint64_t FailedReads;	 // Every attempt overlapped with a write
+	uint64_t BackwardsReads; // Older snapshot than a previous read
+};
+
+// Reader process, reads until the writer finishes, returns 1 on any torn or out of order read
+static int RunReader(ReaderResult* result)
+{
+	EvictionHelperSharedMemory controller;
+	if(!EvictionHelper_OpenSharedMemoryEx(&controller, GetTestSharedMemoryName(), EVICTION_HELPER_MAPPING_DEFAULT))
+		return 2;
+
+	EvictionHelperSharedData* data = controller.pData;
+	while(__atomic_load_n(&data->IsRunning, __ATOMIC_ACQUIRE) == 0)
+		sched_yield();
+
+	uint64_t lastIndex = 0;
+	while(__atomic_load_n(&data->IsRunning, __ATOMIC_ACQUIRE) == 1)
+	{
+		EvictionHelperSnapshot snapshot;
+		if(!EvictionHelper_ReadSnapshot(data, &snapshot))
+		{
+			result->FailedReads++;
+			continue;
+		}
+
+		result->Reads++;
+		uint64_t writeIndex = CheckSnapshot(&snapshot);
+		if(writeIndex == UINT64_MAX)
+		{
+			result->TornReads++;
+			continue;
+		}
+		if(writeIndex < lastIndex)
+			result->BackwardsReads++;
+		lastIndex = writeIndex;
+	}
+
+	EvictionHelper_CloseSharedMemory(&controller);
+	return result->TornReads || result->BackwardsReads ? 1 : 0;
+}
+
+static void TestSingleProcess()
+{
+	TestSharedMemory	   sharedMem;
+	EvictionHelperSnapshot snapshot = {};
+
+	CHECK(EvictionHelper_ReadSnapshot(sharedMem.Data(), &snapshot));
+	for(uint64_t i = 0; i < 1000; i++)
+	{
+		FillSnapshot(&snapshot, i);
+		EvictionHelper_WriteSnapshot(sharedMem.Data(), &snapshot);
+
+		EvictionHelperSnapshot read;
+		CHECK(EvictionHelper_ReadSnapshot(sharedMem.Data(), &read));
+		CHECK_EQ(CheckSnapshot(&read), i);
+	}
+	CHECK_EQ(sharedMem.Data()->SnapshotSequence.load(), 2000u);
+}
+
+// A writer that stays in the middle of a write must not block readers, they give up after a bounded number of tries
+static void TestReadDuringWrite()
+{
+	TestSharedMemory	   sharedMem;
+	EvictionHelperSnapshot snapshot;
+	sharedMem.Data()->SnapshotSequence.store(3);
+	CHECK(!EvictionHelper_ReadSnapshot(sharedMem.Data(), &snapshot));
+	CHECK(!EvictionHelper_ReadSnapshot(nullptr, &snapshot));
+}
+
+static void TestMultiProcessStress()
+{
+	EvictionHelperSharedMemory helper;
+	CHECK(EvictionHelper_CreateSharedMemoryEx(&helper, GetTestSharedMemoryName(), EVICTION_HELPER_MAPPING_DEFAULT));
+	if(!helper.pData)
+		return;
+
+	// Reader results live in an anonymous shared mapping, the helper mapping only carries the snapshot
+	ReaderResult* results = (ReaderResult*)mmap(NULL, sizeof(ReaderResult) * SNAPSHOT_READER_COUNT, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	CHECK(results != MAP_FAILED);
+	if(results == MAP_FAILED)
+	{
+		EvictionHelper_CloseSharedMemory(&helper);
+		return;
+	}
+	memset(results, 0, sizeof(ReaderResult) * SNAPSHOT_READER_COUNT);
+
+	pid_t readers[SNAPSHOT_READER_COUNT];
+	for(int i = 0; i < SNAPSHOT_READER_COUNT; i++)
+	{
+		readers[i] = fork();
+		if(readers[i] == 0)
+			_exit(RunReader(&results[i]));
+	}
+
+	// The zeroed snapshot of a new mapping does not decode to a write index, so readers start after the first write
+	EvictionHelperSharedData* data = helper.pData;
+	EvictionHelperSnapshot	  snapshot;
+	FillSnapshot(&snapshot, 0);
+	EvictionHelper_WriteSnapshot(data, &snapshot);
+	__atomic_store_n(&data->IsRunning, 1u, __ATOMIC_RELEASE);
+
+	uint64_t writes = 1;
+	uint64_t endNs	= EvictionHelper_GetTimestampNs() + SNAPSHOT_WRITE_TIME_NS;
+	while(EvictionHelper_GetTimestampNs() < endNs)
+	{
+		for(int i = 0; i < 1000; i++, writes++)
+		{
+			FillSnapshot(&snapshot, writes);
+			EvictionHelper_WriteSnapshot(data, &snapshot);
+		}
+	}
+	__atomic_store_n(&data->IsRunning, 2u, __ATOMIC_RELEASE);
+
+	for(int i = 0; i < SNAPSHOT_READER_COUNT; i++)
+	{
+		int status = 0;
+		waitpid(readers[i], &status, 0);
+		CHECK(WIFEXITED(status));
+		CHECK_EQ(WEXITSTATUS(status), 0);
+
+		const ReaderResult& result = results[i];
+		printf("reader %d: %llu reads, %llu torn, %llu failed, %llu backwards\n", i, (unsigned long long)result.Reads, (unsigned long long)result.TornReads,
+			   (unsigned long long)result.FailedReads, (unsigned long long)result.BackwardsReads);
+		CHECK(result.Reads > 0);
+		CHECK_EQ(result.TornReads, 0u);
+		CHECK_EQ(result.BackwardsReads, 0u);
+	}
+	printf("writer: %llu snapshots\n", (unsigned long long)writes);
+
+	munmap(results, sizeof(ReaderResult) * SNAPSHOT_READER_COUNT);
+	EvictionHelper_CloseSharedMemory(&helper);
+}
+
+int main()
+{
+	RUN_TEST(TestSingleProcess);
+	RUN_TEST(TestReadDuringWrite);
+	RUN_TEST(TestMultiProcessStress);
+	return TestResult();
+}
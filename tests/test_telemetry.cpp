@@ -0,0 +1,163 @@
+// Telemetry history ring: one sample per frame from the core with a budget cut on its exact frame, a reader that fell
+// behind by more than the ring, and a lock-free reader racing the writer without ever seeing a torn sample
+
+#include "test_common.h"
+
+#include "eviction_helper_core.h"
+#include "eviction_helper_sim_device.h"
+
+#include <thread>
+
+static const uint64_t MB = 1024ULL * 1024ULL;
+
+#define FRAME_TIME_NS 16000000ULL
+
+static void TestCoreTimeline()
+{
+	TestSharedMemory		 sharedMem;
+	EvictionHelperSimDevice	 device(8192 * MB, 16384 * MB);
+	EvictionHelperHostDevice hostDevice;
+	EvictionHelperCore		 core(sharedMem.Get(), &device, &hostDevice, false);
+	core.InitializeDefaults();
+	EvictionHelperSharedData* data	= sharedMem.Data();
+	data->TargetVRAMUsageMB			= 512;
+	uint64_t				  index = data->Telemetry.Head.load();
+
+	uint64_t cutFrame = 0;
+	for(int frame = 0; frame < 100; frame++)
+	{
+		if(frame == 40)
+		{
+			device.SetLocalBudget(2048 * MB);
+			cutFrame = data->FrameCount;
+		}
+		core.ProcessCommands();
+		core.BeginFrame(FRAME_TIME_NS);
+		core.TouchActiveMemory();
+		core.EndFrame(FRAME_TIME_NS);
+	}
+
+	std::vector<EvictionHelperTelemetrySample> samples(EVICTION_HELPER_TELEMETRY_RING_SIZE);
+	uint64_t								   dropped = 0;
+	uint32_t								   count   = EvictionHelper_ReadTelemetry(data, &index, samples.data(), EVICTION_HELPER_TELEMETRY_RING_SIZE, &dropped);
+	CHECK_EQ(count, 100u);
+	CHECK_EQ(dropped, 0u);
+	CHECK_EQ(index, data->Telemetry.Head.load());
+
+	uint64_t firstCutFrame = 0;
+	for(uint32_t i = 0; i < count; i++)
+	{
+		CHECK_EQ(samples[i].FrameTimeNs, FRAME_TIME_NS);
+		CHECK_EQ(samples[i].NonLocalBudget, 16384 * MB);
+		if(i > 0)
+		{
+			CHECK_EQ(samples[i].FrameCount, samples[i - 1].FrameCount + 1);
+			CHECK(samples[i].TimestampNs >= samples[i - 1].TimestampNs);
+		}
+		if(!firstCutFrame && samples[i].LocalBudget == 2048 * MB)
+			firstCutFrame = samples[i].FrameCount;
+	}
+	printf("budget cut before frame %llu, first sample with the new budget in frame %llu\n", (unsigned long long)cutFrame, (unsigned long long)firstCutFrame);
+	CHECK_EQ(samples[0].LocalBudget, 8192 * MB);
+	CHECK(firstCutFrame >= cutFrame && firstCutFrame <= cutFrame + 1);
+	CHECK_EQ(samples[count - 1].LocalBudget, 2048 * MB);
+	CHECK_EQ(samples[count - 1].ActiveAllocationBytes, 512 * MB);
+	CHECK_EQ(samples[count - 1].LocalCurrentUsage, 512 * MB);
+
+	// Nothing new until the next frame
+	CHECK_EQ(EvictionHelper_ReadTelemetry(data, &index, samples.data(), EVICTION_HELPER_TELEMETRY_RING_SIZE, &dropped), 0u);
+	core.Shutdown();
+}
+
+// A reader that was away for more than the ring capacity is told how many samples it missed
+static void TestOverrun()
+{
+	TestSharedMemory		  sharedMem;
+	EvictionHelperSharedData* data	= sharedMem.Data();
+	const uint64_t			  total = EVICTION_HELPER_TELEMETRY_RING_SIZE + 100;
+	for(uint64_t i = 0; i < total; i++)
+	{
+		EvictionHelperTelemetrySample sample = {};
+		sample.FrameCount					 = i;
+		EvictionHelper_WriteTelemetry(data, &sample);
+	}
+	CHECK_EQ(data->Telemetry.Head.load(), total);
+
+	// Small batches, the first one skips the overwritten samples
+	EvictionHelperTelemetrySample samples[64];
+	uint64_t					  index	   = 0;
+	uint64_t					  dropped  = 0;
+	uint64_t					  received = 0;
+	uint64_t					  expected = 100;
+	while(uint32_t count = EvictionHelper_ReadTelemetry(data, &index, samples, 64, &dropped))
+	{
+		for(uint32_t i = 0; i < count; i++)
+			CHECK_EQ(samples[i].FrameCount, expected++);
+		received += count;
+	}
+	CHECK_EQ(dropped, 100u);
+	CHECK_EQ(received, static_cast<uint64_t>(EVICTION_HELPER_TELEMETRY_RING_SIZE));
+	CHECK_EQ(index, total);
+
+	// Invalid arguments read nothing
+	CHECK_EQ(EvictionHelper_ReadTelemetry(nullptr, &index, samples, 64, &dropped), 0u);
+	CHECK_EQ(EvictionHelper_ReadTelemetry(data, nullptr, samples, 64, &dropped), 0u);
+}
+
+// Every field of sample i is i, a torn read would mix two samples
+static void TestConcurrentReader()
+{
+	TestSharedMemory		  sharedMem;
+	EvictionHelperSharedData* data	= sharedMem.Data();
+	const uint64_t			  total = 500000;
+
+	std::thread writer([data, total] {
+		for(uint64_t i = 0; i < total; i++)
+		{
+			EvictionHelperTelemetrySample sample;
+			uint64_t*					  fields = reinterpret_cast<uint64_t*>(&sample);
+			for(size_t field = 0; field < sizeof(sample) / sizeof(uint64_t); field++)
+				fields[field] = i;
+			EvictionHelper_WriteTelemetry(data, &sample);
+		}
+	});
+
+	std::vector<EvictionHelperTelemetrySample> samples(256);
+	uint64_t								   index	= 0;
+	uint64_t								   dropped	= 0;
+	uint64_t								   received = 0;
+	uint64_t								   torn		= 0;
+	uint64_t								   last		= 0;
+	while(index < total)
+	{
+		uint32_t count = EvictionHelper_ReadTelemetry(data, &index, samples.data(), 256, &dropped);
+		for(uint32_t i = 0; i < count; i++)
+		{
+			const uint64_t* fields = reinterpret_cast<const uint64_t*>(&samples[i]);
+			for(size_t field = 1; field < sizeof(samples[i]) / sizeof(uint64_t); field++)
+			{
+				if(fields[field] != fields[0])
+					torn++;
+			}
+			CHECK((received == 0 && i == 0) || fields[0] > last);
+			last = fields[0];
+		}
+		received += count;
+		if(!count)
+			std::this_thread::yield();
+	}
+	writer.join();
+
+	printf("%llu samples read, %llu overwritten before they were read\n", (unsigned long long)received, (unsigned long long)dropped);
+	CHECK_EQ(torn, 0u);
+	CHECK_EQ(received + dropped, total);
+	CHECK(received > 0);
+}
+
+int main()
+{
+	RUN_TEST(TestCoreTimeline);
+	RUN_TEST(TestOverrun);
+	RUN_TEST(TestConcurrentReader);
+	return TestResult();
+}
@@ -0,0 +1,229 @@
+// Touch patterns: the same seed gives the same frames, round-robin coverage, random subsets, the Zipf skew, and the core
+// driving the simulated device and host memory with a pattern reproducibly
+
+#include "test_common.h"
+
+#include "eviction_helper_core.h"
+#include "eviction_helper_pool.h"
+#include "eviction_helper_sim_device.h"
+#include "eviction_helper_touch_pattern.h"
+
+#include <set>
+
+static const uint64_t MB = 1024ULL * 1024ULL;
+
+// Same seed, same frames, for every pattern, and Reset() restarts the sequence
+static void TestDeterminism()
+{
+	for(uint32_t pattern = EVICTION_HELPER_TOUCH_ALL; pattern <= EVICTION_HELPER_TOUCH_NONE; pattern++)
+	{
+		EvictionHelperTouchPattern a(42);
+		EvictionHelperTouchPattern b(42);
+		std::vector<uint32_t>	   indicesA;
+		std::vector<uint32_t>	   indicesB;
+		std::vector<uint32_t>	   firstFrame;
+		for(int frame = 0; frame < 500; frame++)
+		{
+			a.Generate(pattern, 1000, 10, 1.0f, &indicesA);
+			b.Generate(pattern, 1000, 10, 1.0f, &indicesB);
+			CHECK(indicesA == indicesB);
+			if(frame == 0)
+				firstFrame = indicesA;
+		}
+		a.Reset(42);
+		a.Generate(pattern, 1000, 10, 1.0f, &indicesA);
+		CHECK(indicesA == firstFrame);
+	}
+
+	// Another seed is another sequence
+	EvictionHelperTouchPattern a(1);
+	EvictionHelperTouchPattern b(2);
+	std::vector<uint32_t>	   indicesA;
+	std::vector<uint32_t>	   indicesB;
+	a.Generate(EVICTION_HELPER_TOUCH_RANDOM, 1000, 10, 1.0f, &indicesA);
+	b.Generate(EVICTION_HELPER_TOUCH_RANDOM, 1000, 10, 1.0f, &indicesB);
+	CHECK(indicesA != indicesB);
+
+	// The generator is splitmix64, so the numbers behind the patterns are the same on every platform
+	EvictionHelperRandom random;
+	CHECK_EQ(random.Next(), 0xE220A8397B1DCDAFULL);
+	CHECK_EQ(random.Next(), 0x6E789E6AA1B965F4ULL);
+	random.Seed(0);
+	CHECK_EQ(random.Next(), 0xE220A8397B1DCDAFULL);
+	double unit = random.NextUnit();
+	CHECK(unit >= 0.0 && unit < 1.0);
+}
+
+// 25% per frame visits every resource exactly once every 4 frames
+static void TestRoundRobin()
+{
+	EvictionHelperTouchPattern pattern;
+	std::vector<uint32_t>	   indices;
+	std::vector<int>		   hits(200, 0);
+	for(int frame = 0; frame < 40; frame++)
+	{
+		pattern.Generate(EVICTION_HELPER_TOUCH_ROUND_ROBIN, 200, 25, 0.0f, &indices);
+		CHECK_EQ(indices.size(), 50u);
+		for(uint32_t index : indices)
+			hits[index]++;
+	}
+	for(int count : hits)
+		CHECK_EQ(count, 10);
+
+	// A window that does not divide the pool wraps around
+	pattern.Generate(EVICTION_HELPER_TOUCH_ROUND_ROBIN, 7, 50, 0.0f, &indices);
+	pattern.Generate(EVICTION_HELPER_TOUCH_ROUND_ROBIN, 7, 50, 0.0f, &indices);
+	CHECK((indices == std::vector<uint32_t>{ 4, 5, 6, 0 }));
+}
+
+// Exactly the requested count without duplicates, every resource touched about equally often
+static void TestRandom()
+{
+	EvictionHelperTouchPattern pattern(7);
+	std::vector<uint32_t>	   indices;
+	std::vector<int>		   hits(100, 0);
+	for(int frame = 0; frame < 10000; frame++)
+	{
+		pattern.Generate(EVICTION_HELPER_TOUCH_RANDOM, 100, 10, 0.0f, &indices);
+		CHECK_EQ(indices.size(), 10u);
+		CHECK_EQ(std::set<uint32_t>(indices.begin(), indices.end()).size(), 10u);
+		for(uint32_t index : indices)
+			hits[index]++;
+	}
+	for(int count : hits)
+		CHECK(count > 800 && count < 1200);
+}
+
+// The average matches the percentage, the hottest resource is touched every frame and the coldest rarely
+static void TestZipf()
+{
+	EvictionHelperTouchPattern pattern(3);
+	std::vector<uint32_t>	   indices;
+	std::vector<int>		   hits(1000, 0);
+	uint64_t				   touched = 0;
+	const int				   frames  = 2000;
+	for(int frame = 0; frame < frames; frame++)
+	{
+		pattern.Generate(EVICTION_HELPER_TOUCH_ZIPF, 1000, 10, 1.0f, &indices);
+		touched += indices.size();
+		for(uint32_t index : indices)
+			hits[index]++;
+	}
+	double average = (double)touched / frames;
+	printf("zipf: %.1f per frame, hottest %d, index 100 %d, coldest %d of %d frames\n", average, hits[0], hits[100], hits[999], frames);
+	CHECK(average > 95.0 && average < 105.0);
+	CHECK_EQ(hits[0], frames);
+	CHECK(hits[100] < frames && hits[100] > hits[999]);
+	CHECK(hits[999] < frames / 20);
+
+	// A steeper exponent concentrates the same count on fewer resources
+	EvictionHelperTouchPattern steep(3);
+	std::vector<int>		   steepHits(1000, 0);
+	for(int frame = 0; frame < frames; frame++)
+	{
+		steep.Generate(EVICTION_HELPER_TOUCH_ZIPF, 1000, 10, 2.0f, &indices);
+		for(uint32_t index : indices)
+			steepHits[index]++;
+	}
+	CHECK(steepHits[999] < hits[999]);
+}
+
+// Touched resources of a pool are stamped with the frame, untouched ones keep their last stamp
+static void TestLastTouchedFrame()
+{
+	EvictionHelperSimDevice			   device(1024 * MB, 1024 * MB);
+	EvictionHelperAllocationWorker	   worker;
+	EvictionHelperDeferredReleaseQueue releaseQueue(&device);
+	EvictionHelperPool				   pool(&device, EVICTION_HELPER_RESOURCE_RENDER_TARGET, RT_SIZE, EVICTION_HELPER_PRIORITY_NORMAL);
+	pool.Update(&worker, &releaseQueue, 8 * RT_SIZE);
+	worker.ExecutePending();
+
+	EvictionHelperAllocationResult result;
+	while(worker.PopResult(&result))
+		pool.OnAllocationResult(result);
+
+	EvictionHelperTouchPattern pattern;
+	std::vector<uint32_t>	   indices;
+	for(uint64_t frame = 1; frame <= 3; frame++)
+	{
+		pattern.Generate(EVICTION_HELPER_TOUCH_ROUND_ROBIN, pool.GetTouchableCount(), 25, 0.0f, &indices);
+		CHECK_EQ(pool.Touch(indices, frame, 0.5f), 2 * RT_SIZE);
+	}
+	const uint64_t expected[8] = { 1, 1, 2, 2, 3, 3, 0, 0 };
+	for(uint32_t i = 0; i < 8; i++)
+		CHECK_EQ(pool.GetLastTouchedFrame(i), expected[i]);
+	pool.Release();
+}
+
+struct CoreRun
+{
+	uint64_t TouchedVRAMBytes;
+	uint64_t TouchedHostBytes;
+	uint64_t PageInCount;
+	uint64_t EvictionCount;
+};
+
+// 4 GB touched with a Zipf pattern in a 3 GB budget, plus a host pool, for 300 frames
+static CoreRun RunCore(uint32_t seed)
+{
+	TestSharedMemory		 sharedMem;
+	EvictionHelperSimDevice	 device(3072 * MB, 16384 * MB);
+	EvictionHelperHostDevice hostDevice;
+	EvictionHelperCore		 core(sharedMem.Get(), &device, &hostDevice, false);
+	core.InitializeDefaults();
+
+	EvictionHelperSharedData* data = sharedMem.Data();
+	data->TargetVRAMUsageMB		   = 4096;
+	data->TargetHostMemoryUsageMB  = 256;
+	data->TouchPattern			   = EVICTION_HELPER_TOUCH_ZIPF;
+	data->TouchPercent			   = 25;
+	data->TouchCoveragePercent	   = 50;
+	data->TouchSeed				   = seed;
+
+	CoreRun run = {};
+	for(int frame = 0; frame < 300; frame++)
+	{
+		core.ProcessCommands();
+		core.BeginFrame(33333333ULL);
+		core.TouchActiveMemory();
+		core.EndFrame(33333333ULL);
+		run.TouchedVRAMBytes += data->TouchedVRAMBytesLastFrame;
+		run.TouchedHostBytes += data->TouchedHostBytesLastFrame;
+	}
+	run.PageInCount	  = device.GetPageInCount();
+	run.EvictionCount = device.GetEvictionCount();
+	core.Shutdown();
+	return run;
+}
+
+static void TestCoreReproducible()
+{
+	CoreRun first  = RunCore(7);
+	CoreRun second = RunCore(7);
+	CoreRun other  = RunCore(8);
+	printf("seed 7: %.0f MB touched per frame, %llu page-ins, %llu evictions\n", first.TouchedVRAMBytes / 300.0 / MB, (unsigned long long)first.PageInCount,
+		   (unsigned long long)first.EvictionCount);
+
+	CHECK_EQ(first.TouchedVRAMBytes, second.TouchedVRAMBytes);
+	CHECK_EQ(first.TouchedHostBytes, second.TouchedHostBytes);
+	CHECK_EQ(first.PageInCount, second.PageInCount);
+	CHECK_EQ(first.EvictionCount, second.EvictionCount);
+	CHECK(first.TouchedVRAMBytes != other.TouchedVRAMBytes);
+
+	// About a quarter of the pool per frame, the cold part is paged out and only occasionally back in
+	double perFrameMB = first.TouchedVRAMBytes / 300.0 / MB;
+	CHECK(perFrameMB > 900.0 && perFrameMB < 1150.0);
+	CHECK(first.EvictionCount > 0);
+	CHECK(first.PageInCount < 300 * 256 / 4);
+}
+
+int main()
+{
+	RUN_TEST(TestDeterminism);
+	RUN_TEST(TestRoundRobin);
+	RUN_TEST(TestRandom);
+	RUN_TEST(TestZipf);
+	RUN_TEST(TestLastTouchedFrame);
+	RUN_TEST(TestCoreReproducible);
+	return TestResult();
+}
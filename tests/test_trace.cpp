@@ -0,0 +1,394 @@
+// Allocation traces: the file format and reader, recording a device and replaying the recording into the same
+// footprint, replay speeds with their drift on the frame clock, the replay thread against the real time, and the
+// core recording its own activity and replaying it through the shared memory inputs
+
+#include "test_common.h"
+
+#include "eviction_helper_core.h"
+#include "eviction_helper_sim_device.h"
+#include "eviction_helper_trace.h"
+#include "eviction_helper_trace_replay.h"
+
+static const uint64_t MB = 1024ULL * 1024ULL;
+
+#define FRAME_TIME_NS 16000000ULL
+
+static const char* TRACE_PATH  = "test_trace.trace";
+static const char* RECORD_PATH = "test_trace_record.trace";
+
+static EvictionHelperTraceEvent MakeEvent(uint64_t timeNs, uint8_t type, uint32_t id, uint8_t kind, uint64_t sizeBytes, int priority)
+{
+	EvictionHelperTraceEvent event = {};
+	event.TimeNs				   = timeNs;
+	event.SizeBytes				   = sizeBytes;
+	event.Id					   = id;
+	event.Type					   = type;
+	event.Kind					   = kind;
+	event.Priority				   = static_cast<uint8_t>(priority);
+	return event;
+}
+
+// 1000 allocations of 1 to 8 MB over one second, the first 600 freed 200 ms later
+static void WriteSyntheticTrace()
+{
+	std::vector<EvictionHelperTraceEvent> events;
+	for(uint32_t i = 0; i < 1000; i++)
+	{
+		uint8_t kind = (i % 3 == 0) ? EVICTION_HELPER_RESOURCE_HEAP : EVICTION_HELPER_RESOURCE_HOST_MEMORY;
+		events.push_back(MakeEvent(i * 1000000ULL, EVICTION_HELPER_TRACE_ALLOC, i + 1, kind, (1 + i % 8) * MB, EVICTION_HELPER_PRIORITY_NORMAL));
+		if(i < 600)
+			events.push_back(MakeEvent(i * 1000000ULL + 200000000ULL, EVICTION_HELPER_TRACE_FREE, i + 1, kind, 0, 0));
+	}
+	CHECK(EvictionHelperTrace_WriteFile(TRACE_PATH, events));
+}
+
+static uint64_t SumHistogram(const uint64_t* histogram)
+{
+	uint64_t sum = 0;
+	for(uint32_t i = 0; i < EVICTION_HELPER_LATENCY_BUCKETS; i++)
+		sum += histogram[i];
+	return sum;
+}
+
+static uint64_t GetDeviceUsage(EvictionHelperDevice* device)
+{
+	EvictionHelperMemoryInfo local;
+	EvictionHelperMemoryInfo nonLocal;
+	device->QueryMemoryInfo(&local, &nonLocal);
+	return local.CurrentUsage + nonLocal.CurrentUsage;
+}
+
+// Events come back sorted, unclosed recordings and truncated files are read up to their last whole event
+static void TestFileFormat()
+{
+	std::vector<EvictionHelperTraceEvent> events;
+	events.push_back(MakeEvent(3000, EVICTION_HELPER_TRACE_FREE, 1, EVICTION_HELPER_RESOURCE_HEAP, 0, 0));
+	events.push_back(MakeEvent(1000, EVICTION_HELPER_TRACE_ALLOC, 1, EVICTION_HELPER_RESOURCE_HEAP, 4 * MB, EVICTION_HELPER_PRIORITY_HIGH));
+	events.push_back(MakeEvent(2000, EVICTION_HELPER_TRACE_SET_PRIORITY, 1, EVICTION_HELPER_RESOURCE_HEAP, 0, EVICTION_HELPER_PRIORITY_LOW));
+	CHECK(EvictionHelperTrace_WriteFile(TRACE_PATH, events));
+
+	EvictionHelperTraceReader reader;
+	CHECK(reader.Open(TRACE_PATH));
+	CHECK_EQ(reader.GetEventCount(), 3u);
+	CHECK_EQ(reader.GetDurationNs(), 3000u);
+	const EvictionHelperTraceEvent* event = reader.Next();
+	CHECK(event != nullptr);
+	CHECK_EQ(event->Type, EVICTION_HELPER_TRACE_ALLOC);
+	CHECK_EQ(event->SizeBytes, 4 * MB);
+	CHECK_EQ(event->Priority, EVICTION_HELPER_PRIORITY_HIGH);
+	CHECK_EQ(reader.Next()->Type, EVICTION_HELPER_TRACE_SET_PRIORITY);
+	CHECK_EQ(reader.Next()->Type, EVICTION_HELPER_TRACE_FREE);
+	CHECK(reader.Next() == nullptr);
+	reader.Rewind();
+	CHECK_EQ(reader.Peek()->TimeNs, 1000u);
+	reader.Close();
+
+	// Without an event count in the header and with half an event at the end
+	FILE* file = fopen(TRACE_PATH, "r+b");
+	CHECK(file != nullptr);
+	EvictionHelperTraceHeader header;
+	CHECK_EQ(fread(&header, sizeof(header), 1, file), 1u);
+	header.EventCount = 0;
+	fseek(file, 0, SEEK_SET);
+	fwrite(&header, sizeof(header), 1, file);
+	fseek(file, 0, SEEK_END);
+	fwrite(&header, sizeof(EvictionHelperTraceEvent) / 2, 1, file);
+	fclose(file);
+	CHECK(reader.Open(TRACE_PATH));
+	CHECK_EQ(reader.GetEventCount(), 3u);
+	reader.Close();
+
+	// Not a trace file, or missing
+	file = fopen(TRACE_PATH, "wb");
+	fputs("not a trace file, just long enough to have a header", file);
+	fclose(file);
+	CHECK(!reader.Open(TRACE_PATH));
+	remove(TRACE_PATH);
+	CHECK(!reader.Open(TRACE_PATH));
+	CHECK(!reader.IsOpen());
+}
+
+// A recording started late begins with the live resources, so replaying it ends at the same footprint
+static void TestRecordReplayRoundTrip()
+{
+	EvictionHelperSimDevice			   device(4096 * MB, 4096 * MB);
+	EvictionHelperTraceRecordingDevice recorder(&device);
+	EvictionHelperTraceWriter		   writer;
+
+	EvictionHelperResource early = recorder.CreateResource(EVICTION_HELPER_RESOURCE_HEAP, 64 * MB, EVICTION_HELPER_PRIORITY_NORMAL);
+	EvictionHelperResource gone	 = recorder.CreateResource(EVICTION_HELPER_RESOURCE_HEAP, 32 * MB, EVICTION_HELPER_PRIORITY_NORMAL);
+	CHECK(writer.Open(RECORD_PATH));
+	recorder.StartRecording(&writer);
+	CHECK_EQ(writer.GetEventCount(), 2u);
+
+	std::vector<EvictionHelperResource> resources;
+	for(uint32_t i = 0; i < 20; i++)
+		resources.push_back(recorder.CreateResource(EVICTION_HELPER_RESOURCE_RENDER_TARGET, (1 + i % 4) * RT_SIZE / 4, EVICTION_HELPER_PRIORITY_NORMAL));
+	for(uint32_t i = 0; i < 20; i += 3)
+		recorder.DestroyResource(resources[i]);
+	recorder.DestroyResource(gone);
+	recorder.SetResidencyPriorities(&resources[1], 2, EVICTION_HELPER_PRIORITY_HIGH);
+	recorder.StopRecording();
+
+	// Not recorded anymore
+	recorder.DestroyResource(early);
+	writer.Close();
+
+	// 2 live at the start, 20 allocations, 7 + 1 frees and 2 priority changes
+	EvictionHelperTraceReader reader;
+	CHECK(reader.Open(RECORD_PATH));
+	CHECK_EQ(reader.GetEventCount(), 32u);
+	uint64_t lastNs = 0;
+	while(const EvictionHelperTraceEvent* event = reader.Next())
+	{
+		CHECK(event->TimeNs >= lastNs);
+		lastNs = event->TimeNs;
+	}
+	reader.Close();
+
+	uint64_t recordedBytes = GetDeviceUsage(&device) + 64 * MB;
+
+	EvictionHelperSimDevice			replayDevice(4096 * MB, 4096 * MB);
+	EvictionHelperTraceReplay		replay;
+	EvictionHelperTraceReplayConfig config;
+	config.Path		  = RECORD_PATH;
+	config.Playing	  = true;
+	config.Speed	  = 0.0;
+	config.VRAMDevice = &replayDevice;
+	config.HostDevice = &replayDevice;
+	replay.SetConfig(config);
+	replay.Advance(FRAME_TIME_NS / 1e9);
+
+	EvictionHelperTraceReplayStats stats;
+	replay.GetStats(&stats);
+	CHECK_EQ(stats.State, (uint32_t)EVICTION_HELPER_TRACE_STATE_FINISHED);
+	CHECK_EQ(stats.IssuedEventCount, 32u);
+	CHECK_EQ(stats.SkippedEventCount, 0u);
+	CHECK_EQ(stats.ResourceCount, 14u);
+	CHECK_EQ(stats.AllocatedBytes, recordedBytes);
+	CHECK_EQ(GetDeviceUsage(&replayDevice), recordedBytes);
+	CHECK_EQ(replayDevice.GetPriorityCallCount(), 2u);
+
+	// Stopping playback releases the replayed resources
+	config.Playing = false;
+	replay.SetConfig(config);
+	replay.Advance(FRAME_TIME_NS / 1e9);
+	replay.GetStats(&stats);
+	CHECK_EQ(stats.State, (uint32_t)EVICTION_HELPER_TRACE_STATE_IDLE);
+	CHECK_EQ(GetDeviceUsage(&replayDevice), 0u);
+	remove(RECORD_PATH);
+}
+
+struct ReplayRun
+{
+	int							   Frames;
+	EvictionHelperTraceReplayStats Stats;
+};
+
+// Replay the synthetic trace on the frame clock until it finishes
+static ReplayRun RunReplay(double speed)
+{
+	EvictionHelperSimDevice			device(4096 * MB, 4096 * MB);
+	EvictionHelperTraceReplay		replay;
+	EvictionHelperTraceReplayConfig config;
+	config.Path		  = TRACE_PATH;
+	config.Playing	  = true;
+	config.Speed	  = speed;
+	config.VRAMDevice = &device;
+	config.HostDevice = &device;
+	replay.SetConfig(config);
+
+	ReplayRun run = {};
+	do
+	{
+		replay.Advance(FRAME_TIME_NS / 1e9);
+		replay.GetStats(&run.Stats);
+		run.Frames++;
+	} while(run.Stats.State == EVICTION_HELPER_TRACE_STATE_PLAYING && run.Frames < 1000);
+
+	CHECK_EQ(GetDeviceUsage(&device), run.Stats.AllocatedBytes);
+	replay.Release();
+	return run;
+}
+
+static void TestReplaySpeeds()
+{
+	WriteSyntheticTrace();
+
+	ReplayRun original = RunReplay(1.0);
+	ReplayRun faster   = RunReplay(4.0);
+	ReplayRun fastest  = RunReplay(0.0);
+	printf("speed 1: %d frames, max drift %.2f ms; speed 4: %d frames, max drift %.2f ms; as fast as possible: %d frame\n", original.Frames, original.Stats.MaxDriftNs / 1e6,
+		   faster.Frames, faster.Stats.MaxDriftNs / 1e6, fastest.Frames);
+
+	// The last event is at 999 ms, on 16 ms frames
+	CHECK_EQ(original.Frames, 63);
+	CHECK_EQ(faster.Frames, 16);
+	CHECK_EQ(fastest.Frames, 1);
+	for(const ReplayRun* run : { &original, &faster, &fastest })
+	{
+		const EvictionHelperTraceReplayStats& stats = run->Stats;
+		CHECK_EQ(stats.State, (uint32_t)EVICTION_HELPER_TRACE_STATE_FINISHED);
+		CHECK_EQ(stats.EventCount, 1600u);
+		CHECK_EQ(stats.IssuedEventCount, 1600u);
+		CHECK_EQ(stats.SkippedEventCount, 0u);
+		CHECK_EQ(stats.ResourceCount, 400u);
+		CHECK_EQ(stats.PositionNs, stats.DurationNs);
+		CHECK_EQ(SumHistogram(stats.DriftHistogram), 1600u);
+		CHECK_EQ(SumHistogram(stats.AllocLatencyHistogram), 1000u);
+		CHECK_EQ(SumHistogram(stats.FreeLatencyHistogram), 600u);
+	}
+
+	// Events wait for the frame that reaches them, at most one frame of real time at any speed, the event at 0 waits
+	// for the whole first frame
+	CHECK(original.Stats.MaxDriftNs <= FRAME_TIME_NS && original.Stats.MaxDriftNs + 1000 > FRAME_TIME_NS);
+	CHECK(faster.Stats.MaxDriftNs <= FRAME_TIME_NS && faster.Stats.MaxDriftNs + 1000 > FRAME_TIME_NS);
+	CHECK_EQ(fastest.Stats.TotalDriftNs, 0u);
+
+	// Frees of ids that are not live and allocations of unknown kinds are skipped
+	std::vector<EvictionHelperTraceEvent> events;
+	events.push_back(MakeEvent(0, EVICTION_HELPER_TRACE_FREE, 5, EVICTION_HELPER_RESOURCE_HEAP, 0, 0));
+	events.push_back(MakeEvent(0, EVICTION_HELPER_TRACE_ALLOC, 6, 200, MB, 0));
+	events.push_back(MakeEvent(0, EVICTION_HELPER_TRACE_ALLOC, 7, EVICTION_HELPER_RESOURCE_HEAP, MB, 0));
+	events.push_back(MakeEvent(0, EVICTION_HELPER_TRACE_ALLOC, 7, EVICTION_HELPER_RESOURCE_HEAP, MB, 0));
+	CHECK(EvictionHelperTrace_WriteFile(TRACE_PATH, events));
+	ReplayRun skipped = RunReplay(0.0);
+	CHECK_EQ(skipped.Stats.SkippedEventCount, 3u);
+	CHECK_EQ(skipped.Stats.ResourceCount, 1u);
+	remove(TRACE_PATH);
+}
+
+// The replay thread issues a 300 ms trace in about 300 ms of real time
+static void TestReplayThread()
+{
+	std::vector<EvictionHelperTraceEvent> events;
+	for(uint32_t i = 0; i < 300; i++)
+		events.push_back(MakeEvent(i * 1000000ULL, EVICTION_HELPER_TRACE_ALLOC, i + 1, EVICTION_HELPER_RESOURCE_HEAP, MB, 0));
+	CHECK(EvictionHelperTrace_WriteFile(TRACE_PATH, events));
+
+	EvictionHelperSimDevice			device(4096 * MB, 4096 * MB);
+	EvictionHelperTraceReplay		replay;
+	EvictionHelperTraceReplayConfig config;
+	config.Path		  = TRACE_PATH;
+	config.Playing	  = true;
+	config.Speed	  = 1.0;
+	config.VRAMDevice = &device;
+	config.HostDevice = &device;
+
+	uint64_t startNs = EvictionHelper_GetTimestampNs();
+	replay.SetConfig(config);
+	replay.Start();
+	EvictionHelperTraceReplayStats stats;
+	do
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		replay.GetStats(&stats);
+	} while(stats.State == EVICTION_HELPER_TRACE_STATE_PLAYING && EvictionHelper_GetTimestampNs() - startNs < 5000000000ULL);
+	uint64_t elapsedNs = EvictionHelper_GetTimestampNs() - startNs;
+	replay.Stop();
+
+	printf("thread: 299 ms trace in %.1f ms, mean drift %.3f ms, max %.3f ms\n", elapsedNs / 1e6, stats.TotalDriftNs / 1e6 / stats.IssuedEventCount, stats.MaxDriftNs / 1e6);
+	CHECK_EQ(stats.State, (uint32_t)EVICTION_HELPER_TRACE_STATE_FINISHED);
+	CHECK_EQ(stats.IssuedEventCount, 300u);
+	CHECK(elapsedNs >= 299000000ULL);
+	CHECK(stats.TotalDriftNs / stats.IssuedEventCount < 20000000ULL);
+	CHECK_EQ(GetDeviceUsage(&device), 300 * MB);
+	replay.Release();
+	CHECK_EQ(GetDeviceUsage(&device), 0u);
+	remove(TRACE_PATH);
+}
+
+static void RunFrames(EvictionHelperCore* core, int count)
+{
+	for(int frame = 0; frame < count; frame++)
+	{
+		core->ProcessCommands();
+		core->BeginFrame(FRAME_TIME_NS);
+		core->TouchActiveMemory();
+		core->EndFrame(FRAME_TIME_NS);
+	}
+}
+
+// The core records its pools and heap table, a second helper replays the recording into the same footprint
+static void TestCoreRecordAndReplay()
+{
+	uint64_t recordedBytes = 0;
+	{
+		TestSharedMemory		 sharedMem;
+		EvictionHelperSimDevice	 device(16384 * MB, 16384 * MB);
+		EvictionHelperHostDevice hostDevice;
+		EvictionHelperCore		 core(sharedMem.Get(), &device, &hostDevice, false);
+		core.InitializeDefaults();
+
+		EvictionHelperSharedData* data		= sharedMem.Data();
+		data->TargetVRAMUsageMB				= 512;
+		data->TargetUnusedVRAMUsageMB		= 0;
+		data->TargetHostMemoryUsageMB		= 0;
+		data->TargetUnusedHostMemoryUsageMB = 0;
+		RunFrames(&core, 5);
+
+		snprintf(data->TraceRecordPath, sizeof(data->TraceRecordPath), "%s", RECORD_PATH);
+		data->TraceRecord = 1;
+		RunFrames(&core, 1);
+		CHECK_EQ(data->TraceRecording, 1u);
+
+		data->TargetUnusedVRAMUsageMB = 256;
+		data->HeapCount				  = 4;
+		for(uint32_t i = 0; i < 4; i++)
+			data->Heaps[i].SizeMB = 64;
+		data->UnusedVRAMPriority = EVICTION_HELPER_PRIORITY_LOW;
+		RunFrames(&core, 30);
+		data->TargetVRAMUsageMB = 128;
+		RunFrames(&core, 30);
+
+		data->TraceRecord = 0;
+		RunFrames(&core, 1);
+		CHECK_EQ(data->TraceRecording, 0u);
+		CHECK(data->TraceRecordedEventCount > 0);
+		recordedBytes = GetDeviceUsage(&device);
+		CHECK_EQ(recordedBytes, (128 + 256 + 256) * MB);
+		core.Shutdown();
+	}
+
+	TestSharedMemory		 sharedMem;
+	EvictionHelperSimDevice	 device(16384 * MB, 16384 * MB);
+	EvictionHelperHostDevice hostDevice;
+	EvictionHelperCore		 core(sharedMem.Get(), &device, &hostDevice, false);
+	core.InitializeDefaults();
+
+	EvictionHelperSharedData* data		= sharedMem.Data();
+	data->TargetVRAMUsageMB				= 0;
+	data->TargetUnusedVRAMUsageMB		= 0;
+	data->TargetHostMemoryUsageMB		= 0;
+	data->TargetUnusedHostMemoryUsageMB = 0;
+	snprintf(data->TraceReplayPath, sizeof(data->TraceReplayPath), "%s", RECORD_PATH);
+	data->TraceReplaySpeed = 0.0f;
+	data->TraceReplay	   = 1;
+	RunFrames(&core, 2);
+	CHECK_EQ(data->TraceReplayState, (uint32_t)EVICTION_HELPER_TRACE_STATE_FINISHED);
+	CHECK_EQ(data->TraceIssuedEventCount, data->TraceEventCount);
+	CHECK_EQ(data->TraceSkippedEventCount, 0u);
+	CHECK_EQ(data->TraceAllocatedBytes, recordedBytes);
+	CHECK_EQ(GetDeviceUsage(&device), recordedBytes);
+
+	// A missing file fails, switching off releases everything
+	data->TraceReplay = 0;
+	RunFrames(&core, 1);
+	snprintf(data->TraceReplayPath, sizeof(data->TraceReplayPath), "%s", "missing.trace");
+	data->TraceReplay = 1;
+	RunFrames(&core, 1);
+	CHECK_EQ(data->TraceReplayState, (uint32_t)EVICTION_HELPER_TRACE_STATE_FAILED);
+	CHECK_EQ(GetDeviceUsage(&device), 0u);
+	core.Shutdown();
+	remove(RECORD_PATH);
+}
+
+int main()
+{
+	RUN_TEST(TestFileFormat);
+	RUN_TEST(TestRecordReplayRoundTrip);
+	RUN_TEST(TestReplaySpeeds);
+	RUN_TEST(TestReplayThread);
+	RUN_TEST(TestCoreRecordAndReplay);
+	return TestResult();
+}